@@ -0,0 +1,145 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_ALLOCATION_TRACKER_H_
+#define MAIDSAFE_DRIVE_ALLOCATION_TRACKER_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define MAIDSAFE_DRIVE_ALLOCATION_CONCAT_IMPL(a, b) a##b
+#define MAIDSAFE_DRIVE_ALLOCATION_CONCAT(a, b) MAIDSAFE_DRIVE_ALLOCATION_CONCAT_IMPL(a, b)
+
+// Attributes heap allocations made by this thread within the enclosing scope to 'name', which must
+// be a string literal (or otherwise outlive the AllocationTracker).
+#define DRIVE_ALLOCATION_SCOPE(name)                                                      \
+  maidsafe::drive::AllocationScope MAIDSAFE_DRIVE_ALLOCATION_CONCAT(drive_allocation_scope_, \
+                                                                   __LINE__)(name)
+
+namespace maidsafe {
+
+namespace drive {
+
+class AllocationScope;
+
+// Process-wide count of heap allocations, attributed to the innermost AllocationScope open on the
+// allocating thread.  Every OperationMetrics::ScopedRecorder and TraceScope is also an allocation
+// scope, so allocations are attributed to each filesystem callback, each Drive primitive and
+// internal phases such as Directory::Serialise and flushes.
+//
+// Allocations are only seen in executables which link in the global operator new replacement from
+// allocation_hook.cc: the benchmarks always do, and the drive library does when configured with
+// DRIVE_ALLOCATION_TRACKING.  Even then, nothing is counted until Start() is called, and while
+// stopped the hook and each scope cost a single relaxed atomic load.  Recording never allocates.
+// All member functions are threadsafe.
+class AllocationTracker {
+ public:
+  // Scopes are tallied in a fixed table; allocations in scopes beyond this many distinct names are
+  // attributed to "(other)".
+  static const size_t kMaxSites = 1024;
+
+  // The allocations made within one scope name.  'self' counts those made with this as the
+  // innermost scope; 'total' also includes those made in nested scopes.
+  struct Site {
+    Site();
+    double AllocationsPerCall() const;
+    double BytesPerCall() const;
+
+    std::string name;
+    uint64_t calls, self_count, self_bytes, total_count, total_bytes;
+  };
+
+  static AllocationTracker& Instance();
+  // Whether the global operator new hook is linked in.
+  static bool hooked() { return hooked_.load(std::memory_order_relaxed); }
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+  // The allocations made by the calling thread while tracking was enabled.  Never reset.
+  static uint64_t thread_allocation_count();
+  static uint64_t thread_allocated_bytes();
+
+  // Zeroes all counts and starts counting.
+  void Start();
+  void Stop();
+  // Called by the operator new hook.
+  static void SetHooked();
+  void RecordAllocation(size_t size);
+
+  uint64_t total_count() const { return total_count_.load(std::memory_order_relaxed); }
+  uint64_t total_bytes() const { return total_bytes_.load(std::memory_order_relaxed); }
+  // Sites which have been entered or have allocated, heaviest first by 'self_bytes'.  Allocations
+  // made outside any scope are reported as "(unscoped)".
+  std::vector<Site> GetSites() const;
+  // Human-readable table of the 'site_count' heaviest sites.
+  std::string Report(size_t site_count = 30) const;
+
+ private:
+  friend class AllocationScope;
+
+  struct Entry {
+    Entry();
+    void Reset();
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> calls, self_count, self_bytes, total_count, total_bytes;
+  };
+
+  AllocationTracker();
+  AllocationTracker(const AllocationTracker&);
+  AllocationTracker(AllocationTracker&&);
+  AllocationTracker& operator=(AllocationTracker);
+
+  Entry& GetEntry(const char* name);
+
+  static std::atomic<bool> enabled_, hooked_;
+  std::array<Entry, kMaxSites> entries_;
+  Entry unscoped_, other_;
+  std::atomic<uint64_t> total_count_, total_bytes_;
+};
+
+class AllocationScope {
+ public:
+  explicit AllocationScope(const char* name) : entry_(nullptr), parent_(nullptr) {
+    if (AllocationTracker::enabled())
+      Enter(name);
+  }
+  ~AllocationScope() {
+    if (entry_)
+      Exit();
+  }
+
+ private:
+  friend class AllocationTracker;
+
+  AllocationScope(const AllocationScope&);
+  AllocationScope(AllocationScope&&);
+  AllocationScope& operator=(AllocationScope);
+
+  void Enter(const char* name);
+  void Exit();
+
+  AllocationTracker::Entry* entry_;
+  AllocationScope* parent_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_ALLOCATION_TRACKER_H_
@@ -0,0 +1,162 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_CACHED_STORE_H_
+#define MAIDSAFE_DRIVE_CACHED_STORE_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "boost/thread/future.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/data_types/immutable_data.h"
+#include "maidsafe/common/data_types/mutable_data.h"
+#include "maidsafe/common/data_types/structured_data_versions.h"
+
+#include "maidsafe/drive/chunk_cache.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// Puts a ChunkCache in front of a (typically remote) Storage.  Chunks are looked for in the cache
+// before being requested from 'storage', and are added to the cache both when fetched and when
+// stored.  Version operations are passed straight through, since versions are mutable.  If
+// 'cache' is null, every call is passed through.
+template <typename Storage>
+class CachedStore {
+ public:
+  typedef std::vector<StructuredDataVersions::VersionName> VersionNames;
+
+  CachedStore(std::shared_ptr<Storage> storage, std::shared_ptr<ChunkCache> cache);
+  ~CachedStore();
+
+  boost::future<ImmutableData> Get(const ImmutableData::Name& data_name);
+  void Put(const ImmutableData& data);
+  void IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names);
+  boost::future<VersionNames> GetVersions(const MutableData::Name& data_name);
+  boost::future<VersionNames> GetBranch(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& branch_tip);
+  void PutVersion(const MutableData::Name& data_name,
+                  const StructuredDataVersions::VersionName& old_version_name,
+                  const StructuredDataVersions::VersionName& new_version_name);
+  boost::future<void> CreateVersionTree(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& version_name,
+                                        uint32_t max_versions, uint32_t max_branches);
+
+  std::shared_ptr<ChunkCache> cache() const { return cache_; }
+
+ private:
+  CachedStore(const CachedStore&);
+  CachedStore(CachedStore&&);
+  CachedStore& operator=(CachedStore);
+
+  std::shared_ptr<Storage> storage_;
+  std::shared_ptr<ChunkCache> cache_;
+};
+
+// ==================== Implementation =============================================================
+template <typename Storage>
+CachedStore<Storage>::CachedStore(std::shared_ptr<Storage> storage,
+                                  std::shared_ptr<ChunkCache> cache)
+    : storage_(storage), cache_(cache) {
+  if (!storage_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+}
+
+template <typename Storage>
+CachedStore<Storage>::~CachedStore() {
+  if (!cache_)
+    return;
+  auto statistics(cache_->GetStatistics());
+  LOG(kInfo) << "Chunk cache hit rate " << statistics.HitRate() * 100.0 << "% ("
+             << statistics.hits << " hits, " << statistics.misses << " misses, "
+             << statistics.insertions << " insertions, " << statistics.evictions << " evictions, "
+             << statistics.corruptions << " corrupt chunks)";
+}
+
+template <typename Storage>
+boost::future<ImmutableData> CachedStore<Storage>::Get(const ImmutableData::Name& data_name) {
+  if (!cache_)
+    return storage_->Get(data_name);
+  auto cached(cache_->Get(data_name));
+  boost::promise<ImmutableData> promise;
+  if (cached) {
+    promise.set_value(*cached);
+    return promise.get_future();
+  }
+  // The drive always waits on the returned future immediately, so fetching synchronously here
+  // doesn't lose any concurrency.
+  try {
+    auto data(storage_->Get(data_name).get());
+    cache_->Put(data);
+    promise.set_value(data);
+  }
+  catch (...) {
+    promise.set_exception(boost::current_exception());
+  }
+  return promise.get_future();
+}
+
+template <typename Storage>
+void CachedStore<Storage>::Put(const ImmutableData& data) {
+  storage_->Put(data);
+  if (cache_)
+    cache_->Put(data);
+}
+
+template <typename Storage>
+void CachedStore<Storage>::IncrementReferenceCount(
+    const std::vector<ImmutableData::Name>& data_names) {
+  storage_->IncrementReferenceCount(data_names);
+}
+
+template <typename Storage>
+boost::future<typename CachedStore<Storage>::VersionNames> CachedStore<Storage>::GetVersions(
+    const MutableData::Name& data_name) {
+  return storage_->GetVersions(data_name);
+}
+
+template <typename Storage>
+boost::future<typename CachedStore<Storage>::VersionNames> CachedStore<Storage>::GetBranch(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& branch_tip) {
+  return storage_->GetBranch(data_name, branch_tip);
+}
+
+template <typename Storage>
+void CachedStore<Storage>::PutVersion(const MutableData::Name& data_name,
+                                      const StructuredDataVersions::VersionName& old_version_name,
+                                      const StructuredDataVersions::VersionName& new_version_name) {
+  storage_->PutVersion(data_name, old_version_name, new_version_name);
+}
+
+template <typename Storage>
+boost::future<void> CachedStore<Storage>::CreateVersionTree(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& version_name,
+    uint32_t max_versions, uint32_t max_branches) {
+  return storage_->CreateVersionTree(data_name, version_name, max_versions, max_branches);
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_CACHED_STORE_H_
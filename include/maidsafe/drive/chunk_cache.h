@@ -0,0 +1,107 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_CHUNK_CACHE_H_
+#define MAIDSAFE_DRIVE_CHUNK_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+#include "boost/optional/optional.hpp"
+
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/data_types/immutable_data.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// A size-bounded, persistent, least-recently-used cache of encrypted chunks.  Each chunk is held
+// in its own file named by the hex encoding of the chunk's name.  Since an ImmutableData's name is
+// the hash of its content, every chunk is verified as it's read back; any which fail are removed.
+// Files are read, written and removed without holding the cache's lock, so slow disk I/O on one
+// chunk doesn't block lookups of others.  The recency order is kept in memory and written to a
+// "recency" file in the cache directory on destruction; after a crash, chunks are ordered by their
+// files' last write times instead.  Thread-safe.
+class ChunkCache {
+ public:
+  struct Statistics {
+    Statistics() : hits(0), misses(0), insertions(0), evictions(0), corruptions(0) {}
+    double HitRate() const {
+      return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / (hits + misses);
+    }
+    uint64_t hits, misses, insertions, evictions, corruptions;
+  };
+
+  // Loads the index of any chunks already held in 'cache_dir', evicting the oldest if they exceed
+  // 'max_disk_usage'.  Throws if 'cache_dir' can't be created.
+  ChunkCache(const boost::filesystem::path& cache_dir, DiskUsage max_disk_usage);
+  // Persists the recency order.
+  ~ChunkCache();
+
+  boost::optional<ImmutableData> Get(const ImmutableData::Name& name);
+  // Chunks larger than the whole cache are silently ignored.
+  void Put(const ImmutableData& data);
+  bool Has(const ImmutableData::Name& name) const;
+  // Removes every chunk.  Statistics are left untouched.
+  void Clear();
+
+  DiskUsage GetCurrentDiskUsage() const;
+  Statistics GetStatistics() const;
+
+ private:
+  typedef std::list<ImmutableData::Name> RecencyList;
+  struct Entry {
+    RecencyList::iterator recency_itr;
+    uint64_t size;
+  };
+
+  ChunkCache(const ChunkCache&);
+  ChunkCache(ChunkCache&&);
+  ChunkCache& operator=(ChunkCache);
+
+  boost::filesystem::path GetPath(const ImmutableData::Name& name) const;
+  boost::filesystem::path GetRecencyPath() const;
+  void LoadIndex();
+  void SaveRecency() const;
+  // All three must be called with 'mutex_' locked.  Erased entries' files are appended to
+  // 'doomed', to be removed by the caller once 'mutex_' has been released.
+  void Erase(std::map<ImmutableData::Name, Entry>::iterator itr,
+             std::vector<boost::filesystem::path>& doomed);
+  void EvictUntilWithinLimit(uint64_t required_space, std::vector<boost::filesystem::path>& doomed);
+  void MarkAsMostRecent(std::map<ImmutableData::Name, Entry>::iterator itr);
+
+  const boost::filesystem::path kCacheDir_;
+  const DiskUsage kMaxDiskUsage_;
+  mutable std::mutex mutex_;
+  // Most recently used at the front.
+  RecencyList recency_list_;
+  std::map<ImmutableData::Name, Entry> entries_;
+  uint64_t current_disk_usage_;
+  Statistics statistics_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_CHUNK_CACHE_H_
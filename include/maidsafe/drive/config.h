@@ -45,6 +45,8 @@ typedef TaggedValue<Identity, detail::ParentIdTag> ParentId;
 namespace detail {
 
 extern const boost::filesystem::path kRoot;
+// The hidden, virtual directory at the root of a mount which holds the stat and control files.
+extern const boost::filesystem::path kControlDirectory;
 extern const MaxVersions kMaxVersions;
 // The delay between the last update to a directory and the creation of the corresponding version.
 extern const std::chrono::steady_clock::duration kDirectoryInactivityDelay;
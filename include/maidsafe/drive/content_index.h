@@ -0,0 +1,116 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_CONTENT_INDEX_H_
+#define MAIDSAFE_DRIVE_CONTENT_INDEX_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/encrypt/data_map.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// A persistent index from the hash and size of a file's whole content to the data map it encrypted
+// to, recorded once that data map's chunks have been stored.  Self-encryption is deterministic, so
+// a file written later with the same content would encrypt to the same data map:  it's given the
+// indexed data map instead of flushing its encryptor, and its chunks only have their reference
+// counts incremented.  Chunks are never deleted from the drive's storage, so an entry stays valid
+// for as long as the storage it was recorded against.  Each index must therefore belong to a
+// single store, and only to one whose Puts have completed by the time they return.
+//
+// The index is an append-only file of checksummed records, scanned on construction.  Only the
+// position of each data map is held in memory.
+class ContentIndex {
+ public:
+  // SHA-512 of the content, and its size.
+  typedef std::pair<std::string, uint64_t> Key;
+
+  explicit ContentIndex(const boost::filesystem::path& index_dir);
+  ~ContentIndex();
+
+  bool Find(const Key& key, encrypt::DataMap& data_map) const;
+  // Does nothing if 'key' is already indexed or 'data_map' holds no chunks.
+  void Add(const Key& key, const encrypt::DataMap& data_map);
+
+  size_t size() const;
+  // Number of flushes which reused an indexed data map, and the bytes of content they covered.
+  uint64_t hit_count() const { return hit_count_; }
+  uint64_t hit_bytes() const { return hit_bytes_; }
+  void RecordHit(uint64_t content_size);
+
+ private:
+  ContentIndex(const ContentIndex&);
+  ContentIndex(ContentIndex&&);
+  ContentIndex& operator=(ContentIndex);
+
+  void Load();
+
+  const boost::filesystem::path kIndexPath_;
+  mutable std::mutex mutex_;
+  // Offset and size within the index file of each serialised data map.
+  std::map<Key, std::pair<uint64_t, uint32_t>> entries_;
+  std::FILE* file_;
+  uint64_t file_size_;
+  std::atomic<uint64_t> hit_count_, hit_bytes_;
+};
+
+// Hashes a file's content as it's written, for as long as it's written sequentially from empty,
+// which is how files are usually copied.  Any other write leaves the hasher invalid.
+class ContentHasher {
+ public:
+  explicit ContentHasher(std::shared_ptr<ContentIndex> content_index);
+
+  void Update(const char* data, uint32_t size, uint64_t offset);
+  void Truncate(uint64_t size);
+  // Looks up the content hashed so far, if it's valid and is all 'file_size' bytes of the file.
+  bool Find(uint64_t file_size, encrypt::DataMap& data_map) const;
+  // Sets 'key' for the content hashed so far, if it's valid and is all 'file_size' bytes of the
+  // file.  The key is added to the index once the file's chunks have been stored.
+  bool GetKey(uint64_t file_size, ContentIndex::Key& key) const;
+  std::shared_ptr<ContentIndex> content_index() const { return content_index_; }
+
+ private:
+  ContentHasher(const ContentHasher&);
+  ContentHasher& operator=(const ContentHasher&);
+
+  bool HashedWholeFile(uint64_t file_size) const;
+  ContentIndex::Key GetKey() const;
+
+  std::shared_ptr<ContentIndex> content_index_;
+  crypto::SHA512 hash_;
+  uint64_t size_;
+  bool valid_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_CONTENT_INDEX_H_
@@ -0,0 +1,99 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_CONTROL_FILES_H_
+#define MAIDSAFE_DRIVE_CONTROL_FILES_H_
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+namespace maidsafe {
+
+namespace drive {
+
+// A named value reported through the stat files of the control directory.  Counters only ever
+// increase; gauges can go up and down.
+struct Statistic {
+  enum class Type { kGauge, kCounter };
+  Statistic(const std::string& name_in, const std::string& help_in, double value_in,
+            Type type_in = Type::kGauge);
+  std::string name, help;
+  double value;
+  Type type;
+};
+
+// One "name value" line per statistic.
+std::string FormatStatistics(const std::vector<Statistic>& statistics);
+// The Prometheus text exposition format, with every name prefixed by "maidsafe_drive_".  A name may
+// carry labels (e.g. 'calls_total{operation="Get"}'); statistics sharing a name must be adjacent.
+std::string FormatStatisticsForPrometheus(const std::vector<Statistic>& statistics);
+
+// The files served from 'detail::kControlDirectory'.  Stat files are read-only and their contents
+// are generated afresh each time they're opened.  Control files are write-only and run their action
+// each time they're written to.  All member functions are threadsafe.
+class ControlFiles {
+ public:
+  typedef std::function<std::string()> Generator;
+  typedef std::function<void()> Action;
+
+  ControlFiles();
+
+  // Replaces any existing file with the same name.
+  void AddStatFile(const std::string& name, Generator generator);
+  void AddControlFile(const std::string& name, Action action);
+
+  // Stops the control directory being served, so that an entry of the drive's own with the same
+  // name is served instead.  Can't be undone.
+  void Disable();
+  bool enabled() const { return enabled_; }
+  // True for the control directory itself and for any path inside it, unless disabled.
+  bool IsControlPath(const boost::filesystem::path& path) const;
+  bool IsControlDirectory(const boost::filesystem::path& path) const;
+  bool IsStatFile(const boost::filesystem::path& path) const;
+  bool IsControlFile(const boost::filesystem::path& path) const;
+  // Names of all stat and control files, sorted.
+  std::vector<std::string> Names() const;
+  // Throws 'DriveErrors::no_such_file' if 'path' isn't a stat file.
+  std::string Generate(const boost::filesystem::path& path) const;
+  // Throws 'DriveErrors::no_such_file' if 'path' isn't a control file.
+  void Trigger(const boost::filesystem::path& path) const;
+
+ private:
+  ControlFiles(const ControlFiles&);
+  ControlFiles(ControlFiles&&);
+  ControlFiles& operator=(ControlFiles);
+
+  static std::string Name(const boost::filesystem::path& path);
+
+  std::atomic<bool> enabled_;
+  mutable std::mutex mutex_;
+  std::map<std::string, Generator> stat_files_;
+  std::map<std::string, Action> control_files_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_CONTROL_FILES_H_
@@ -0,0 +1,177 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_DEDUPLICATING_STORE_H_
+#define MAIDSAFE_DRIVE_DEDUPLICATING_STORE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "boost/thread/future.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/data_types/immutable_data.h"
+#include "maidsafe/common/data_types/mutable_data.h"
+#include "maidsafe/common/data_types/structured_data_versions.h"
+
+#include "maidsafe/drive/known_chunk_index.h"
+#include "maidsafe/drive/storage_completion.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// Uses a KnownChunkIndex to replace the Put of any chunk already known to be held by 'storage'
+// with a reference count increment, so duplicate content (copied files, re-saved documents, etc.)
+// isn't uploaded again.  Chunks become known once they've been stored, retrieved or had their
+// reference count incremented via this class.  If 'index' is null, every call is passed through.
+//
+// This is the layer which talks to the network, so Put, IncrementReferenceCount and PutVersion only
+// return once 'storage' reports them complete (see storage_completion.h), and throw if it reports
+// a failure.
+template <typename Storage>
+class DeduplicatingStore {
+ public:
+  typedef std::vector<StructuredDataVersions::VersionName> VersionNames;
+
+  DeduplicatingStore(std::shared_ptr<Storage> storage, std::shared_ptr<KnownChunkIndex> index);
+  ~DeduplicatingStore();
+
+  boost::future<ImmutableData> Get(const ImmutableData::Name& data_name);
+  void Put(const ImmutableData& data);
+  void IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names);
+  boost::future<VersionNames> GetVersions(const MutableData::Name& data_name);
+  boost::future<VersionNames> GetBranch(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& branch_tip);
+  void PutVersion(const MutableData::Name& data_name,
+                  const StructuredDataVersions::VersionName& old_version_name,
+                  const StructuredDataVersions::VersionName& new_version_name);
+  boost::future<void> CreateVersionTree(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& version_name,
+                                        uint32_t max_versions, uint32_t max_branches);
+
+  uint64_t deduplicated_count() const { return deduplicated_count_; }
+  uint64_t deduplicated_bytes() const { return deduplicated_bytes_; }
+
+ private:
+  DeduplicatingStore(const DeduplicatingStore&);
+  DeduplicatingStore(DeduplicatingStore&&);
+  DeduplicatingStore& operator=(DeduplicatingStore);
+
+  std::shared_ptr<Storage> storage_;
+  std::shared_ptr<KnownChunkIndex> index_;
+  std::atomic<uint64_t> deduplicated_count_, deduplicated_bytes_;
+};
+
+// ==================== Implementation =============================================================
+template <typename Storage>
+DeduplicatingStore<Storage>::DeduplicatingStore(std::shared_ptr<Storage> storage,
+                                                std::shared_ptr<KnownChunkIndex> index)
+    : storage_(storage), index_(index), deduplicated_count_(0), deduplicated_bytes_(0) {
+  if (!storage_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+}
+
+template <typename Storage>
+DeduplicatingStore<Storage>::~DeduplicatingStore() {
+  if (!index_)
+    return;
+  auto statistics(index_->GetStatistics());
+  LOG(kInfo) << "Replaced " << deduplicated_count_ << " chunk uploads (" << deduplicated_bytes_
+             << " bytes) with reference count increments.  Known chunk index: "
+             << statistics.lookups << " lookups, " << statistics.hits << " hits, "
+             << statistics.additions << " additions.";
+}
+
+template <typename Storage>
+boost::future<ImmutableData> DeduplicatingStore<Storage>::Get(
+    const ImmutableData::Name& data_name) {
+  if (!index_)
+    return storage_->Get(data_name);
+  boost::promise<ImmutableData> promise;
+  try {
+    auto data(storage_->Get(data_name).get());
+    index_->Add(data_name);
+    promise.set_value(data);
+  }
+  catch (...) {
+    promise.set_exception(boost::current_exception());
+  }
+  return promise.get_future();
+}
+
+template <typename Storage>
+void DeduplicatingStore<Storage>::Put(const ImmutableData& data) {
+  if (index_ && index_->Contains(data.name())) {
+    detail::ConfirmedIncrementReferenceCount(*storage_,
+                                             std::vector<ImmutableData::Name>(1, data.name()));
+    ++deduplicated_count_;
+    deduplicated_bytes_ += data.data().string().size();
+    return;
+  }
+  detail::ConfirmedPut(*storage_, data);
+  if (index_)
+    index_->Add(data.name());
+}
+
+template <typename Storage>
+void DeduplicatingStore<Storage>::IncrementReferenceCount(
+    const std::vector<ImmutableData::Name>& data_names) {
+  detail::ConfirmedIncrementReferenceCount(*storage_, data_names);
+  if (index_) {
+    for (const auto& data_name : data_names)
+      index_->Add(data_name);
+  }
+}
+
+template <typename Storage>
+boost::future<typename DeduplicatingStore<Storage>::VersionNames>
+    DeduplicatingStore<Storage>::GetVersions(const MutableData::Name& data_name) {
+  return storage_->GetVersions(data_name);
+}
+
+template <typename Storage>
+boost::future<typename DeduplicatingStore<Storage>::VersionNames>
+    DeduplicatingStore<Storage>::GetBranch(const MutableData::Name& data_name,
+                                           const StructuredDataVersions::VersionName& branch_tip) {
+  return storage_->GetBranch(data_name, branch_tip);
+}
+
+template <typename Storage>
+void DeduplicatingStore<Storage>::PutVersion(
+    const MutableData::Name& data_name,
+    const StructuredDataVersions::VersionName& old_version_name,
+    const StructuredDataVersions::VersionName& new_version_name) {
+  detail::ConfirmedPutVersion(*storage_, data_name, old_version_name, new_version_name);
+}
+
+template <typename Storage>
+boost::future<void> DeduplicatingStore<Storage>::CreateVersionTree(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& version_name,
+    uint32_t max_versions, uint32_t max_branches) {
+  return storage_->CreateVersionTree(data_name, version_name, max_versions, max_branches);
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_DEDUPLICATING_STORE_H_
@@ -39,6 +39,9 @@
 
 #include "maidsafe/drive/config.h"
 #include "maidsafe/drive/file_context.h"
+#include "maidsafe/drive/memory_accounting.h"
+#include "maidsafe/drive/slow_operation_log.h"
+#include "maidsafe/drive/write_amplification.h"
 
 namespace maidsafe {
 
@@ -57,17 +60,29 @@ class DirectoryTest;
 
 class Directory {
  public:
+  struct Statistics {
+    Statistics() : open_children(0), live_encryptors(0), store_pending(false), memory() {}
+    size_t open_children, live_encryptors;
+    // True while a store is scheduled or in progress.
+    bool store_pending;
+    // The directory and its children's FileContexts, data maps and timers, and its pending
+    // reference count increments.
+    MemoryStatistics memory;
+  };
+
   Directory(ParentId parent_id, DirectoryId directory_id, boost::asio::io_service& io_service,
             std::function<void(Directory*)> put_functor,  // NOLINT
             std::function<void(const ImmutableData&)> put_chunk_functor,
             std::function<void(const std::vector<ImmutableData::Name>&)> increment_chunks_functor,
-            const boost::filesystem::path& path);  // NOLINT
+            const boost::filesystem::path& path,  // NOLINT
+            WriteAmplification* total_write_amplification = nullptr);
   Directory(ParentId parent_id, const std::string& serialised_directory,
             const std::vector<StructuredDataVersions::VersionName>& versions,
             boost::asio::io_service& io_service, std::function<void(Directory*)> put_functor,  // NOLINT
             std::function<void(const ImmutableData&)> put_chunk_functor,
             std::function<void(const std::vector<ImmutableData::Name>&)> increment_chunks_functor,
-            const boost::filesystem::path& path);
+            const boost::filesystem::path& path,
+            WriteAmplification* total_write_amplification = nullptr);
   ~Directory();
   // This marks the start of an attempt to store the directory.  It serialises the appropriate
   // member data (critically parent_id_ must never be serialised), and sets 'store_state_' to
@@ -102,12 +117,21 @@ class Directory {
   DirectoryId directory_id() const;
   void ScheduleForStoring();
   void StoreImmediatelyIfPending();
+  // Returns running totals, which are kept up to date as children are added, removed and renamed.
+  // Changes made through a child's encryptor (opening, writing, flushing) are only picked up when
+  // the child's encryptor is deleted or the directory is next stored.  Doesn't lock 'mutex_'.
+  Statistics GetStatistics() const;
+  // Counts the file content written to this directory's children and what was put to storage for
+  // them and for this directory's listing.  Everything recorded is passed on to the total given on
+  // construction.
+  WriteAmplification& write_amplification() { return write_amplification_; }
+  const WriteAmplification& write_amplification() const { return write_amplification_; }
 
   friend void test::DirectoriesMatch(const Directory& lhs, const Directory& rhs);
   friend class test::DirectoryTest;
 
   // TODO(Fraser#5#): 2014-01-30 - BEFORE_RELEASE - Make mutex_ private.
-  mutable std::mutex mutex_;
+  mutable TimedMutex mutex_;
 
  private:
   Directory(const Directory& other);
@@ -120,20 +144,34 @@ class Directory {
   Children::const_iterator Find(const boost::filesystem::path& name) const;
   void SortAndResetChildrenCounter();
   void DoScheduleForStoring(bool use_delay = true);
-
-  std::condition_variable cond_var_;
+  enum class StoreState { kPending, kOngoing, kComplete };
+  // Must be called with 'mutex_' locked.
+  void SetStoreState(StoreState store_state);
+  // Recounts the directory's own memory and publishes it along with 'children_statistics_' for
+  // 'GetStatistics'.  Must be called with 'mutex_' locked.
+  void UpdateStatistics();
+
+  std::condition_variable_any cond_var_;
   ParentId parent_id_;
   DirectoryId directory_id_;
   boost::asio::steady_timer timer_;
   std::function<void(const boost::system::error_code&)> store_functor_;
-  std::function<void(const ImmutableData&)> put_chunk_functor_;
+  // Returns false if the chunk couldn't be stored.
+  std::function<bool(const ImmutableData&)> put_chunk_functor_;
   std::function<void(std::vector<ImmutableData::Name>)> increment_chunks_functor_;
   std::vector<ImmutableData::Name> chunks_to_be_incremented_;
+  // Flushes whose chunks are being put with 'mutex_' released.  Guarded by 'mutex_'.
+  int uploads_in_progress_;
   std::deque<StructuredDataVersions::VersionName> versions_;
   MaxVersions max_versions_;
   Children children_;
   size_t children_count_position_;
-  enum class StoreState { kPending, kOngoing, kComplete } store_state_;
+  StoreState store_state_;
+  WriteAmplification write_amplification_;
+  // The children's contribution to 'statistics_'.  Guarded by 'mutex_'.
+  Statistics children_statistics_;
+  mutable std::mutex statistics_mutex_;
+  Statistics statistics_;
 };
 
 bool operator<(const Directory& lhs, const Directory& rhs);
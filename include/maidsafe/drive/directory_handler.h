@@ -20,6 +20,8 @@
 #define MAIDSAFE_DRIVE_DIRECTORY_HANDLER_H_
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <limits>
 #include <map>
@@ -48,7 +50,14 @@
 
 #include "maidsafe/drive/config.h"
 #include "maidsafe/drive/directory.h"
+#include "maidsafe/drive/memory_accounting.h"
+#include "maidsafe/drive/probes.h"
+#include "maidsafe/drive/slow_operation_log.h"
+#include "maidsafe/drive/storage_metrics.h"
+#include "maidsafe/drive/storage_scheduler.h"
+#include "maidsafe/drive/tracer.h"
 #include "maidsafe/drive/utils.h"
+#include "maidsafe/drive/write_amplification.h"
 #include "maidsafe/drive/file_context.h"
 
 namespace maidsafe {
@@ -62,6 +71,17 @@ namespace test { class DirectoryHandlerTest; }
 template <typename Storage>
 class DirectoryHandler {
  public:
+  struct CacheStatistics {
+    CacheStatistics()
+        : directories(0), open_files(0), live_encryptors(0), pending_stores(0), hits(0),
+          misses(0), memory() {}
+    size_t directories, open_files, live_encryptors, pending_stores;
+    // Lookups in 'Get' satisfied from the cache, and directories fetched from storage.
+    uint64_t hits, misses;
+    // Everything but the file buffers, which are owned by the Drive.
+    MemoryStatistics memory;
+  };
+
   DirectoryHandler(std::shared_ptr<Storage> storage, const Identity& unique_user_id,
                    const Identity& root_parent_id, const boost::filesystem::path& disk_buffer_path,
                    bool create, boost::asio::io_service& asio_service);
@@ -77,6 +97,15 @@ class DirectoryHandler {
                                   const std::string& name, const NonEmptyString& content) const;
 
   Identity root_parent_id() const { return root_parent_id_; }
+  CacheStatistics GetCacheStatistics() const;
+  StorageMetrics& storage_metrics() const { return storage_metrics_; }
+  StorageScheduler& storage_scheduler() const { return storage_scheduler_; }
+  // Totals across every directory, including those no longer cached.
+  WriteAmplification::Counters GetWriteAmplification() const { return write_amplification_.Get(); }
+  // Up to 'count' cached directories, ordered by the bytes put to storage on their behalf.
+  std::vector<std::pair<boost::filesystem::path, WriteAmplification::Counters>>
+      GetTopWriteAmplification(size_t count) const;
+  void ResetWriteAmplification();
 
   friend class test::DirectoryHandlerTest;
 
@@ -93,6 +122,9 @@ class DirectoryHandler {
                              const boost::filesystem::path& new_relative_path,
                              Directory* new_parent);
   void Put(Directory* directory);
+  // Storage calls which are scheduled by 'storage_scheduler_' and recorded in 'storage_metrics_'.
+  ImmutableData GetChunk(const ImmutableData::Name& name, StorageCaller caller) const;
+  void PutChunk(const ImmutableData& chunk, StorageCaller caller) const;
   ImmutableData SerialiseDirectory(Directory* directory) const;
   std::unique_ptr<Directory> GetFromStorage(const boost::filesystem::path& relative_path,
       const ParentId& parent_id, const DirectoryId& directory_id);
@@ -104,15 +136,21 @@ class DirectoryHandler {
   void DeleteAllVersions(Directory* directory);
 
   std::shared_ptr<Storage> storage_;
+  mutable StorageMetrics storage_metrics_;
+  mutable StorageScheduler storage_scheduler_;
   Identity unique_user_id_, root_parent_id_;
+  const boost::filesystem::path kDiskBufferPath_;
+  const MemoryUsage kDiskBufferMaxMemory_;
   mutable detail::FileContext::Buffer disk_buffer_;
   std::function<NonEmptyString(const std::string&)> get_chunk_from_store_;
   std::function<void(Directory*)> put_functor_;  // NOLINT
   std::function<void(const ImmutableData&)> put_chunk_functor_;
   std::function<void(std::vector<ImmutableData::Name>)> increment_chunks_functor_;
-  mutable std::mutex cache_mutex_;
+  WriteAmplification write_amplification_;
+  mutable TimedMutex cache_mutex_;
   boost::asio::io_service& asio_service_;
   std::map<boost::filesystem::path, std::unique_ptr<Directory>> cache_;
+  std::atomic<uint64_t> cache_hits_, cache_misses_;
 };
 
 // ==================== Implementation details ====================================================
@@ -124,28 +162,45 @@ DirectoryHandler<Storage>::DirectoryHandler(std::shared_ptr<Storage> storage,
                                             bool create,
                                             boost::asio::io_service& asio_service)
     : storage_(storage),
+      storage_metrics_(),
+      storage_scheduler_(),
       unique_user_id_(unique_user_id),
       root_parent_id_(root_parent_id),
+      kDiskBufferPath_(disk_buffer_path),
+      kDiskBufferMaxMemory_(Concurrency() * 1024 * 1024),
       // All chunks of serialised dirs should comfortably have been stored well before being popped
       // out of buffer, so allow pop_functor to be a no-op.
-      disk_buffer_(MemoryUsage(Concurrency() * 1024 * 1024), DiskUsage(30 * 1024 * 1024),
+      disk_buffer_(kDiskBufferMaxMemory_, DiskUsage(30 * 1024 * 1024),
                    [](const std::string&, const NonEmptyString&) {}, disk_buffer_path, true),
       get_chunk_from_store_(),
       put_functor_([this](Directory* directory) { Put(directory); }),
-      put_chunk_functor_([this](const ImmutableData& chunk) { storage_->Put(chunk); }),
+      put_chunk_functor_([this](const ImmutableData& chunk) {
+                           PutChunk(chunk, StorageCaller::kFileData);
+                         }),
       increment_chunks_functor_([this](const std::vector<ImmutableData::Name>& chunk_names) {
+                                  StorageScheduler::ScopedSlot slot(storage_scheduler_,
+                                      StorageScheduler::Priority::kDataUpload, 0);
+                                  StorageMetrics::ScopedRecorder recorder(storage_metrics_,
+                                      StorageOperation::kIncrementReferenceCount,
+                                      StorageCaller::kFileData);
+                                  DRIVE_TRACE_SCOPE("storage",
+                                                    "Storage::IncrementReferenceCount");
                                   storage_->IncrementReferenceCount(chunk_names);
+                                  recorder.Succeeded();
                                 }),
-      cache_mutex_(),
+      write_amplification_(),
+      cache_mutex_(SlowOperationPhase::kCacheLock),
       asio_service_(asio_service),
-      cache_() {
+      cache_(),
+      cache_hits_(0),
+      cache_misses_(0) {
   if (!unique_user_id.IsInitialised())
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
   if (!root_parent_id.IsInitialised())
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
   get_chunk_from_store_ = [this](const std::string& name)->NonEmptyString {
     try {
-      auto chunk(storage_->Get(ImmutableData::Name(Identity(name))).get());
+      auto chunk(GetChunk(ImmutableData::Name(Identity(name)), StorageCaller::kDirectoryListing));
       return chunk.data();
     }
     catch (const std::exception& e) {
@@ -165,10 +220,10 @@ DirectoryHandler<Storage>::DirectoryHandler(std::shared_ptr<Storage> storage,
     FileContext root_file_context(kRoot, true);
     std::unique_ptr<Directory> root_parent(new Directory(ParentId(unique_user_id_),
         root_parent_id, asio_service_, put_functor_, put_chunk_functor_, increment_chunks_functor_,
-        ""));
+        "", &write_amplification_));
     std::unique_ptr<Directory> root(new Directory(ParentId(root_parent_id),
         *root_file_context.meta_data.directory_id, asio_service_, put_functor_, put_chunk_functor_,
-        increment_chunks_functor_, kRoot));
+        increment_chunks_functor_, kRoot, &write_amplification_));
     root_file_context.parent = root_parent.get();
     root_parent->AddChild(std::move(root_file_context));
     root->ScheduleForStoring();
@@ -186,14 +241,15 @@ template <typename Storage>
 void DirectoryHandler<Storage>::Add(const boost::filesystem::path& relative_path,
                                     FileContext&& file_context) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("directory", "DirectoryHandler::Add");
   auto parent(GetParent(relative_path));
   assert(parent.first && parent.second);
 
   if (IsDirectory(file_context)) {
     std::unique_ptr<Directory> directory(new Directory(ParentId(parent.first->directory_id()),
         *file_context.meta_data.directory_id, asio_service_, put_functor_, put_chunk_functor_,
-        increment_chunks_functor_, relative_path));
-    std::lock_guard<std::mutex> lock(cache_mutex_);
+        increment_chunks_functor_, relative_path, &write_amplification_));
+    std::lock_guard<TimedMutex> lock(cache_mutex_);
     cache_[relative_path] = std::move(directory);
   }
 
@@ -214,14 +270,19 @@ void DirectoryHandler<Storage>::Add(const boost::filesystem::path& relative_path
 template <typename Storage>
 Directory* DirectoryHandler<Storage>::Get(const boost::filesystem::path& relative_path) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("directory", "DirectoryHandler::Get");
+  SlowOperationTimer timer(SlowOperationPhase::kPathResolution);
   Directory* parent(nullptr);
   boost::filesystem::path antecedent;
   {  // NOLINT
-    std::lock_guard<std::mutex> lock(cache_mutex_);
+    std::lock_guard<TimedMutex> lock(cache_mutex_);
     // Try to find the exact directory
     auto itr(cache_.find(relative_path));
-    if (itr != std::end(cache_))
+    if (itr != std::end(cache_)) {
+      ++cache_hits_;
+      DRIVE_PROBE1(directory_cache__hit, relative_path.c_str());
       return itr->second.get();
+    }
 
     // Locate the first antecedent in cache
     antecedent = relative_path;
@@ -248,10 +309,12 @@ Directory* DirectoryHandler<Storage>::Get(const boost::filesystem::path& relativ
 
     if (!file_context->meta_data.directory_id)
       BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    ++cache_misses_;
+    DRIVE_PROBE1(directory_cache__miss, antecedent.c_str());
     auto directory(GetFromStorage(antecedent, ParentId(parent->directory_id()),
                                   *file_context->meta_data.directory_id));
     {
-      std::lock_guard<std::mutex> lock(cache_mutex_);
+      std::lock_guard<TimedMutex> lock(cache_mutex_);
       parent = directory.get();
       auto insertion_result(cache_.emplace(antecedent, std::move(directory)));
       assert(insertion_result.second);
@@ -262,11 +325,71 @@ Directory* DirectoryHandler<Storage>::Get(const boost::filesystem::path& relativ
   return parent;
 }
 
+template <typename Storage>
+typename DirectoryHandler<Storage>::CacheStatistics
+    DirectoryHandler<Storage>::GetCacheStatistics() const {
+  CacheStatistics statistics;
+  statistics.hits = cache_hits_;
+  statistics.misses = cache_misses_;
+  statistics.memory.directory_buffer_memory_limit = kDiskBufferMaxMemory_.data;
+  statistics.memory.directory_buffer_disk = DirectorySize(kDiskBufferPath_);
+  statistics.memory.upload_queues = storage_scheduler_.waiting_bytes();
+  // Each directory keeps running totals for its children, so this doesn't visit the children or
+  // wait on any directory's mutex.
+  std::lock_guard<TimedMutex> lock(cache_mutex_);
+  statistics.directories = cache_.size();
+  for (const auto& directory : cache_) {
+    auto directory_statistics(directory.second->GetStatistics());
+    statistics.open_files += directory_statistics.open_children;
+    statistics.live_encryptors += directory_statistics.live_encryptors;
+    if (directory_statistics.store_pending)
+      ++statistics.pending_stores;
+    statistics.memory += directory_statistics.memory;
+    // The cache's tree node: the entry, three links and a colour.
+    statistics.memory.directories += sizeof(typename decltype(cache_)::value_type) +
+                                     4 * sizeof(void*) + kHeapBlockOverhead +
+                                     HeapBytes(directory.first);
+  }
+  return statistics;
+}
+
+template <typename Storage>
+std::vector<std::pair<boost::filesystem::path, WriteAmplification::Counters>>
+    DirectoryHandler<Storage>::GetTopWriteAmplification(size_t count) const {
+  std::vector<std::pair<boost::filesystem::path, WriteAmplification::Counters>> top;
+  {
+    std::lock_guard<TimedMutex> lock(cache_mutex_);
+    top.reserve(cache_.size());
+    for (const auto& directory : cache_)
+      top.emplace_back(directory.first, directory.second->write_amplification().Get());
+  }
+  typedef std::pair<boost::filesystem::path, WriteAmplification::Counters> Entry;
+  auto by_storage_bytes([](const Entry& lhs, const Entry& rhs) {
+    return lhs.second.StorageBytes() > rhs.second.StorageBytes();
+  });
+  if (top.size() > count) {
+    std::partial_sort(std::begin(top), std::begin(top) + count, std::end(top), by_storage_bytes);
+    top.resize(count);
+  } else {
+    std::sort(std::begin(top), std::end(top), by_storage_bytes);
+  }
+  return top;
+}
+
+template <typename Storage>
+void DirectoryHandler<Storage>::ResetWriteAmplification() {
+  std::lock_guard<TimedMutex> lock(cache_mutex_);
+  write_amplification_.Reset();
+  for (const auto& directory : cache_)
+    directory.second->write_amplification().Reset();
+}
+
 template <typename Storage>
 void DirectoryHandler<Storage>::FlushAll() {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("flush", "DirectoryHandler::FlushAll");
   bool error(false);
-  std::lock_guard<std::mutex> lock(cache_mutex_);
+  std::lock_guard<TimedMutex> lock(cache_mutex_);
   for (auto& dir : cache_) {
     dir.second->ResetChildrenCounter();
     auto child(dir.second->GetChildAndIncrementCounter());
@@ -287,6 +410,7 @@ void DirectoryHandler<Storage>::FlushAll() {
 template <typename Storage>
 void DirectoryHandler<Storage>::Delete(const boost::filesystem::path& relative_path) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("directory", "DirectoryHandler::Delete");
   auto parent(GetParent(relative_path));
   assert(parent.first && parent.second);
 
@@ -296,7 +420,7 @@ void DirectoryHandler<Storage>::Delete(const boost::filesystem::path& relative_p
     auto directory(Get(relative_path));
     DeleteAllVersions(directory);
     {  // NOLINT
-      std::lock_guard<std::mutex> lock(cache_mutex_);
+      std::lock_guard<TimedMutex> lock(cache_mutex_);
       cache_.erase(relative_path);
     }
   }
@@ -315,6 +439,7 @@ template <typename Storage>
 void DirectoryHandler<Storage>::Rename(const boost::filesystem::path& old_relative_path,
                                        const boost::filesystem::path& new_relative_path) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("directory", "DirectoryHandler::Rename");
   assert(old_relative_path != new_relative_path);
 
   auto new_parent(Get(new_relative_path.parent_path()));
@@ -326,7 +451,7 @@ void DirectoryHandler<Storage>::Rename(const boost::filesystem::path& old_relati
     RenameDifferentParent(old_relative_path, new_relative_path, new_parent);
 
   if (IsDirectory(FileContext(old_relative_path, true))) {
-    std::lock_guard<std::mutex> lock(cache_mutex_);
+    std::lock_guard<TimedMutex> lock(cache_mutex_);
     // Fix old entry (if it's still there) and any children entries in the cache (effectively
     // renaming the key part of each such entry).
     auto old_path_size(old_relative_path.string().size());
@@ -377,7 +502,7 @@ void DirectoryHandler<Storage>::PrepareNewPath(const boost::filesystem::path& ne
       if (existing_directory->empty()) {
         new_parent->RemoveChild(new_relative_path.filename());
         DeleteAllVersions(existing_directory);
-        std::lock_guard<std::mutex> lock(cache_mutex_);
+        std::lock_guard<TimedMutex> lock(cache_mutex_);
         cache_.erase(new_relative_path);
       } else {
         BOOST_THROW_EXCEPTION(MakeError(DriveErrors::file_exists));
@@ -413,7 +538,7 @@ void DirectoryHandler<Storage>::RenameDifferentParent(
     auto directory(Get(old_relative_path));
     DeleteAllVersions(directory);
     {
-      std::lock_guard<std::mutex> lock(cache_mutex_);
+      std::lock_guard<TimedMutex> lock(cache_mutex_);
       auto itr(cache_.find(old_relative_path));
       assert(itr != std::end(cache_));
       std::unique_ptr<Directory> temp(std::move(itr->second));
@@ -454,21 +579,62 @@ void DirectoryHandler<Storage>::RenameDifferentParent(
 
 template <typename Storage>
 void DirectoryHandler<Storage>::Put(Directory* directory) {
+  DRIVE_TRACE_SCOPE("flush", "DirectoryHandler::Put");
   ImmutableData encrypted_data_map(SerialiseDirectory(directory));
-  storage_->Put(encrypted_data_map);
+  PutChunk(encrypted_data_map, StorageCaller::kDirectoryListing);
+  directory->write_amplification().RecordListingPut(encrypted_data_map.data().string().size());
+  directory->write_amplification().RecordVersionOperation();
   if (directory->VersionsCount() == 0) {
     auto result(directory->InitialiseVersions(encrypted_data_map.name()));
     MutableData::Name hash_directory_id(crypto::Hash<crypto::SHA512>(std::get<0>(result)));
+    StorageScheduler::ScopedSlot slot(storage_scheduler_,
+                                      StorageScheduler::Priority::kMetadataStore, 0);
+    StorageMetrics::ScopedRecorder recorder(storage_metrics_,
+        StorageOperation::kCreateVersionTree, StorageCaller::kVersioning);
+    DRIVE_TRACE_SCOPE("storage", "Storage::CreateVersionTree");
     auto future(storage_->CreateVersionTree(hash_directory_id,
                                             std::get<1>(result), kMaxVersions, 2));
     future.get();
+    recorder.Succeeded();
   } else {
     auto result(directory->AddNewVersion(encrypted_data_map.name()));
     MutableData::Name hash_directory_id(crypto::Hash<crypto::SHA512>(std::get<0>(result)));
+    StorageScheduler::ScopedSlot slot(storage_scheduler_,
+                                      StorageScheduler::Priority::kMetadataStore, 0);
+    StorageMetrics::ScopedRecorder recorder(storage_metrics_, StorageOperation::kPutVersion,
+                                            StorageCaller::kVersioning);
+    DRIVE_TRACE_SCOPE("storage", "Storage::PutVersion");
     storage_->PutVersion(hash_directory_id, std::get<1>(result), std::get<2>(result));
+    recorder.Succeeded();
   }
 }
 
+template <typename Storage>
+ImmutableData DirectoryHandler<Storage>::GetChunk(const ImmutableData::Name& name,
+                                                  StorageCaller caller) const {
+  StorageScheduler::ScopedSlot slot(storage_scheduler_,
+                                    StorageScheduler::Priority::kInteractiveRead, 0);
+  StorageMetrics::ScopedRecorder recorder(storage_metrics_, StorageOperation::kGet, caller);
+  recorder.set_chunk_name(name->string());
+  DRIVE_TRACE_SCOPE("storage", "Storage::Get");
+  auto chunk(storage_->Get(name).get());
+  recorder.set_bytes(chunk.data().string().size());
+  recorder.Succeeded();
+  return chunk;
+}
+
+template <typename Storage>
+void DirectoryHandler<Storage>::PutChunk(const ImmutableData& chunk, StorageCaller caller) const {
+  StorageScheduler::ScopedSlot slot(storage_scheduler_,
+      StorageScheduler::PriorityOf(StorageOperation::kPut, caller), chunk.data().string().size());
+  StorageMetrics::ScopedRecorder recorder(storage_metrics_, StorageOperation::kPut, caller,
+                                          chunk.data().string().size());
+  recorder.set_chunk_name(chunk.name()->string());
+  DRIVE_TRACE_SCOPE("storage", "Storage::Put");
+  storage_->Put(chunk);
+  recorder.Succeeded();
+}
+
 template <typename Storage>
 ImmutableData DirectoryHandler<Storage>::SerialiseDirectory(Directory* directory) const {
   std::string serialised_directory(directory->Serialise());
@@ -483,7 +649,8 @@ ImmutableData DirectoryHandler<Storage>::SerialiseDirectory(Directory* directory
   }
   for (const auto& chunk : data_map.chunks) {
     auto content(disk_buffer_.Get(chunk.hash));
-    storage_->Put(ImmutableData(content));
+    PutChunk(ImmutableData(content), StorageCaller::kDirectoryListing);
+    directory->write_amplification().RecordListingPut(content.string().size());
   }
   auto encrypted_data_map_contents(encrypt::EncryptDataMap(directory->parent_id(),
                                                            directory->directory_id(), data_map));
@@ -495,7 +662,16 @@ std::unique_ptr<Directory> DirectoryHandler<Storage>::GetFromStorage(
     const boost::filesystem::path& relative_path, const ParentId& parent_id,
     const DirectoryId& directory_id) {
   MutableData::Name hash_directory_id(crypto::Hash<crypto::SHA512>(directory_id));
-  auto version_tip_of_trees(storage_->GetVersions(hash_directory_id).get());
+  std::vector<StructuredDataVersions::VersionName> version_tip_of_trees;
+  {
+    StorageScheduler::ScopedSlot slot(storage_scheduler_,
+                                      StorageScheduler::Priority::kInteractiveRead, 0);
+    StorageMetrics::ScopedRecorder recorder(storage_metrics_, StorageOperation::kGetVersions,
+                                            StorageCaller::kVersioning);
+    DRIVE_TRACE_SCOPE("storage", "Storage::GetVersions");
+    version_tip_of_trees = storage_->GetVersions(hash_directory_id).get();
+    recorder.Succeeded();
+  }
   assert(!version_tip_of_trees.empty());
   if (version_tip_of_trees.size() != 1U) {
     // TODO(Fraser#5#): 2013-12-05 - Handle multiple branches (resolve conflicts if possible or
@@ -503,10 +679,20 @@ std::unique_ptr<Directory> DirectoryHandler<Storage>::GetFromStorage(
     //                  one to keep)
     version_tip_of_trees.resize(1);
   }
-  auto versions(storage_->GetBranch(hash_directory_id, version_tip_of_trees.front()).get());
+  std::vector<StructuredDataVersions::VersionName> versions;
+  {
+    StorageScheduler::ScopedSlot slot(storage_scheduler_,
+                                      StorageScheduler::Priority::kInteractiveRead, 0);
+    StorageMetrics::ScopedRecorder recorder(storage_metrics_, StorageOperation::kGetBranch,
+                                            StorageCaller::kVersioning);
+    DRIVE_TRACE_SCOPE("storage", "Storage::GetBranch");
+    versions = storage_->GetBranch(hash_directory_id, version_tip_of_trees.front()).get();
+    recorder.Succeeded();
+  }
   assert(!versions.empty());
   try {
-    ImmutableData encrypted_data_map(storage_->Get(versions.front().id).get());
+    ImmutableData encrypted_data_map(GetChunk(versions.front().id,
+                                              StorageCaller::kDirectoryListing));
     return ParseDirectory(relative_path, encrypted_data_map, parent_id, directory_id,
                           std::move(versions));
   }
@@ -532,7 +718,7 @@ std::unique_ptr<Directory> DirectoryHandler<Storage>::ParseDirectory(
 
   std::unique_ptr<Directory> directory(new Directory(parent_id, serialised_listing,
       std::move(versions), asio_service_, put_functor_, put_chunk_functor_,
-      increment_chunks_functor_, relative_path));
+      increment_chunks_functor_, relative_path, &write_amplification_));
   assert(directory->directory_id() == directory_id);
   return std::move(directory);
 }
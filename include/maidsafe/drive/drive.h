@@ -20,6 +20,7 @@
 #define MAIDSAFE_DRIVE_DRIVE_H_
 
 #include <algorithm>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <functional>
@@ -31,6 +32,7 @@
 #include <tuple>
 #include <vector>
 
+#include "boost/asio/steady_timer.hpp"
 #include "boost/filesystem/operations.hpp"
 #include "boost/filesystem/path.hpp"
 #include "boost/thread/future.hpp"
@@ -39,10 +41,20 @@
 #include "maidsafe/common/rsa.h"
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/drive/allocation_tracker.h"
 #include "maidsafe/drive/config.h"
+#include "maidsafe/drive/control_files.h"
+#include "maidsafe/drive/memory_accounting.h"
 #include "maidsafe/drive/meta_data.h"
+#include "maidsafe/drive/operation_metrics.h"
+#include "maidsafe/drive/operation_trace.h"
+#include "maidsafe/drive/probes.h"
 #include "maidsafe/drive/directory_handler.h"
+#include "maidsafe/drive/slow_operation_log.h"
+#include "maidsafe/drive/storage_metrics.h"
+#include "maidsafe/drive/tracer.h"
 #include "maidsafe/drive/utils.h"
+#include "maidsafe/drive/write_amplification.h"
 #include "maidsafe/drive/tools/launcher.h"
 
 namespace maidsafe {
@@ -54,6 +66,39 @@ class Drive {
  public:
   Identity root_parent_id() const;
   boost::future<void> GetMountFuture();
+  const StorageMetrics& storage_metrics() const;
+  // Writes the storage metrics to the log and to "storage_metrics.txt" in the user app dir.
+  void DumpStorageMetrics() const;
+  // Latency histograms of the filesystem callbacks and of the Drive primitives they call.
+  const OperationMetrics& operation_metrics() const;
+  // Writes the operation metrics to the log and to "operation_metrics.txt" in the user app dir.
+  void DumpOperationMetrics() const;
+  // Dumps the storage and operation metrics every 'interval' until the drive is destroyed.  A zero
+  // interval stops the periodic dumps.
+  void SetStorageMetricsDumpInterval(const std::chrono::steady_clock::duration& interval);
+  // Caps the rate at which file content is uploaded to storage.  Zero removes the cap.  Where
+  // 'Storage' is a WriteBackStore, set the cap on its replay scheduler instead.
+  void SetUploadRateLimit(uint64_t bytes_per_second);
+  // Files written from empty are then checked against 'content_index' when flushed.  Must be called
+  // before mounting; null disables the check.
+  void SetContentIndex(std::shared_ptr<ContentIndex> content_index);
+  // Cache, buffer, storage queue and operation statistics, as served by the "stats" and "metrics"
+  // files of the control directory.
+  std::vector<Statistic> GetStatistics() const;
+  // Estimated live bytes held by each subsystem, as served by the "memory" control file and
+  // included in 'GetStatistics'.
+  MemoryStatistics GetMemoryStatistics() const;
+  // Appends the statistics returned by 'provider' (e.g. those of a storage layer's own cache) to
+  // those returned by 'GetStatistics'.
+  void AddStatisticsProvider(std::function<std::vector<Statistic>()> provider);
+  // The stat and control files served from 'detail::kControlDirectory'.  Further files can be added
+  // before or after mounting, and serving them can be disabled before mounting.
+  ControlFiles& control_files() { return control_files_; }
+  // Records every filesystem callback to 'trace_file' until 'StopRecordingOperations' is called or
+  // the drive is unmounted.  The trace can be replayed in-process by 'ReplayDrive'.  Throws if the
+  // file can't be created.
+  void StartRecordingOperations(const boost::filesystem::path& trace_file);
+  void StopRecordingOperations();
 
  protected:
   Drive(std::shared_ptr<Storage> storage, const Identity& unique_user_id,
@@ -79,6 +124,9 @@ class Drive {
                 uint64_t offset);
   uint32_t Write(const boost::filesystem::path& relative_path, const char* data, uint32_t size,
                  uint64_t offset);
+  // For drives which serve the control files.  If the root already holds an entry named like
+  // 'detail::kControlDirectory', the control files are disabled so that the entry stays reachable.
+  void DisableControlFilesIfShadowed();
 
   std::shared_ptr<Storage> storage_;
   const boost::filesystem::path kMountDir_;
@@ -88,16 +136,32 @@ class Drive {
   const std::string kMountStatusSharedObjectName_;
   boost::promise<void> mount_promise_;
   std::once_flag unmounted_once_flag_;
+  OperationMetrics operation_metrics_;
+  OperationRecorder operation_recorder_;
+  ControlFiles control_files_;
 
  private:
   typedef detail::FileContext::Buffer Buffer;
   void InitialiseEncryptor(const boost::filesystem::path& relative_path,
                            detail::FileContext& file_context);
   void ScheduleDeletionOfEncryptor(detail::FileContext* file_context);
+  void ScheduleStorageMetricsDump();
+  void AddDefaultControlFiles();
+  // Total size of the files in the buffer directories.
+  uint64_t GetBufferDiskUsage() const;
+  MemoryStatistics GetMemoryStatistics(
+      const typename detail::DirectoryHandler<Storage>::CacheStatistics& cache) const;
 
   std::function<NonEmptyString(const std::string&)> get_chunk_from_store_;
   MemoryUsage default_max_buffer_memory_;
   DiskUsage default_max_buffer_disk_;
+  mutable std::mutex storage_metrics_dump_mutex_;
+  std::chrono::steady_clock::duration storage_metrics_dump_interval_;
+  // Created on first use and destroyed once 'asio_service_' has been stopped.
+  std::unique_ptr<boost::asio::steady_timer> storage_metrics_dump_timer_;
+  std::shared_ptr<ContentIndex> content_index_;
+  mutable std::mutex statistics_providers_mutex_;
+  std::vector<std::function<std::vector<Statistic>()>> statistics_providers_;
 
  protected:
   AsioService asio_service_;
@@ -128,18 +192,35 @@ Drive<Storage>::Drive(std::shared_ptr<Storage> storage, const Identity& unique_u
       kMountStatusSharedObjectName_(mount_status_shared_object_name),
       mount_promise_(),
       unmounted_once_flag_(),
+      operation_metrics_(),
+      operation_recorder_(),
+      control_files_(),
       get_chunk_from_store_(),
       // TODO(Fraser#5#): 2013-11-27 - BEFORE_RELEASE - confirm the following 2 variables.
       default_max_buffer_memory_(Concurrency() * 1024 * 1024),  // cores * default chunk size
       default_max_buffer_disk_(static_cast<uint64_t>(
           boost::filesystem::space(kUserAppDir_).available / 10)),
+      storage_metrics_dump_mutex_(),
+      storage_metrics_dump_interval_(std::chrono::steady_clock::duration::zero()),
+      storage_metrics_dump_timer_(),
+      content_index_(),
+      statistics_providers_mutex_(),
+      statistics_providers_(),
       asio_service_(2),
       directory_handler_(storage, unique_user_id, root_parent_id,
           boost::filesystem::unique_path(*kBufferRoot_ / "%%%%%-%%%%%-%%%%%-%%%%%"),
           create, asio_service_.service()) {
   get_chunk_from_store_ = [this](const std::string& name)->NonEmptyString {
     try {
+      StorageScheduler::ScopedSlot slot(directory_handler_.storage_scheduler(),
+                                        StorageScheduler::Priority::kInteractiveRead, 0);
+      StorageMetrics::ScopedRecorder recorder(directory_handler_.storage_metrics(),
+                                              StorageOperation::kGet, StorageCaller::kFileData);
+      recorder.set_chunk_name(name);
+      DRIVE_TRACE_SCOPE("storage", "Storage::Get");
       auto chunk(storage_->Get(ImmutableData::Name(Identity(name))).get());
+      recorder.set_bytes(chunk.data().string().size());
+      recorder.Succeeded();
       return chunk.data();
     }
     catch (const std::exception& e) {
@@ -147,11 +228,20 @@ Drive<Storage>::Drive(std::shared_ptr<Storage> storage, const Identity& unique_u
       throw;
     }
   };
+  AddDefaultControlFiles();
 }
 
 template <typename Storage>
 Drive<Storage>::~Drive() {
+  {
+    std::lock_guard<std::mutex> lock(storage_metrics_dump_mutex_);
+    storage_metrics_dump_interval_ = std::chrono::steady_clock::duration::zero();
+    boost::system::error_code ec;
+    if (storage_metrics_dump_timer_)
+      storage_metrics_dump_timer_->cancel(ec);
+  }
   asio_service_.Stop();
+  storage_metrics_dump_timer_.reset();
 }
 
 template <typename Storage>
@@ -164,6 +254,227 @@ boost::future<void> Drive<Storage>::GetMountFuture() {
   return mount_promise_.get_future();
 }
 
+template <typename Storage>
+const StorageMetrics& Drive<Storage>::storage_metrics() const {
+  return directory_handler_.storage_metrics();
+}
+
+template <typename Storage>
+void Drive<Storage>::DumpStorageMetrics() const {
+  auto report(directory_handler_.storage_metrics().Report());
+  LOG(kInfo) << "Storage metrics for " << kMountDir_ << ":\n" << report;
+  if (!WriteFile(kUserAppDir_ / "storage_metrics.txt", report))
+    LOG(kWarning) << "Failed to write storage metrics to " << kUserAppDir_;
+}
+
+template <typename Storage>
+const OperationMetrics& Drive<Storage>::operation_metrics() const {
+  return operation_metrics_;
+}
+
+template <typename Storage>
+void Drive<Storage>::DumpOperationMetrics() const {
+  auto report(operation_metrics_.Report());
+  LOG(kInfo) << "Operation metrics for " << kMountDir_ << ":\n" << report;
+  if (!WriteFile(kUserAppDir_ / "operation_metrics.txt", report))
+    LOG(kWarning) << "Failed to write operation metrics to " << kUserAppDir_;
+}
+
+template <typename Storage>
+void Drive<Storage>::SetUploadRateLimit(uint64_t bytes_per_second) {
+  directory_handler_.storage_scheduler().SetUploadRateLimit(bytes_per_second);
+}
+
+template <typename Storage>
+void Drive<Storage>::SetContentIndex(std::shared_ptr<ContentIndex> content_index) {
+  content_index_ = content_index;
+}
+
+template <typename Storage>
+void Drive<Storage>::StartRecordingOperations(const boost::filesystem::path& trace_file) {
+  operation_recorder_.Start(trace_file);
+  LOG(kInfo) << "Recording filesystem operations to " << trace_file;
+}
+
+template <typename Storage>
+void Drive<Storage>::StopRecordingOperations() {
+  if (!operation_recorder_.enabled())
+    return;
+  operation_recorder_.Stop();
+  LOG(kInfo) << "Stopped recording filesystem operations after "
+             << operation_recorder_.record_count() << " calls.";
+}
+
+template <typename Storage>
+std::vector<Statistic> Drive<Storage>::GetStatistics() const {
+  typedef Statistic::Type Type;
+  std::vector<Statistic> statistics;
+  auto cache(directory_handler_.GetCacheStatistics());
+  statistics.emplace_back("directory_cache_directories", "Directories held in the cache.",
+                          static_cast<double>(cache.directories));
+  statistics.emplace_back("directory_cache_hits_total", "Directory lookups served from the cache.",
+                          static_cast<double>(cache.hits), Type::kCounter);
+  statistics.emplace_back("directory_cache_misses_total",
+                          "Directories which had to be fetched from storage.",
+                          static_cast<double>(cache.misses), Type::kCounter);
+  statistics.emplace_back("directory_cache_hit_ratio", "Fraction of directory lookups which hit.",
+      cache.hits + cache.misses == 0 ? 0.0 :
+          static_cast<double>(cache.hits) / (cache.hits + cache.misses));
+  statistics.emplace_back("open_files", "Files and directories currently open.",
+                          static_cast<double>(cache.open_files));
+  statistics.emplace_back("live_encryptors", "Files with a live encryptor and buffer.",
+                          static_cast<double>(cache.live_encryptors));
+  statistics.emplace_back("pending_directory_stores",
+                          "Directories with a store scheduled or in progress.",
+                          static_cast<double>(cache.pending_stores));
+  statistics.emplace_back("buffer_memory_limit_bytes",
+                          "Upper bound of the memory held by the buffers of live encryptors.",
+                          static_cast<double>(cache.live_encryptors) *
+                              static_cast<double>(default_max_buffer_memory_.data));
+  statistics.emplace_back("buffer_disk_bytes", "Disk space used by the file and directory buffers.",
+                          static_cast<double>(GetBufferDiskUsage()));
+  auto memory(ToStatistics(GetMemoryStatistics(cache)));
+  statistics.insert(std::end(statistics), std::begin(memory), std::end(memory));
+  auto amplification(ToStatistics(directory_handler_.GetWriteAmplification()));
+  statistics.insert(std::end(statistics), std::begin(amplification), std::end(amplification));
+  auto& scheduler(directory_handler_.storage_scheduler());
+  statistics.emplace_back("storage_queue_depth", "Storage calls waiting for a scheduler slot.",
+                          static_cast<double>(scheduler.waiting_count()));
+  statistics.emplace_back("storage_active_calls", "Storage calls currently in progress.",
+                          static_cast<double>(scheduler.active_count()));
+  for (int i(0); i != static_cast<int>(StorageOperation::kCount); ++i) {
+    auto operation(static_cast<StorageOperation>(i));
+    statistics.emplace_back("storage_calls_total{operation=\"" + ToString(operation) + "\"}",
+                            "Storage calls issued by the drive.",
+                            static_cast<double>(storage_metrics().Get(operation).count),
+                            Type::kCounter);
+  }
+  for (int i(0); i != static_cast<int>(DriveOperation::kCount); ++i) {
+    auto operation(static_cast<DriveOperation>(i));
+    statistics.emplace_back("operations_total{operation=\"" + ToString(operation) + "\"}",
+                            "Filesystem callbacks and Drive primitives completed.",
+                            static_cast<double>(operation_metrics_.Get(operation).count),
+                            Type::kCounter);
+  }
+  for (int i(0); i != static_cast<int>(DriveOperation::kCount); ++i) {
+    auto operation(static_cast<DriveOperation>(i));
+    statistics.emplace_back(
+        "operation_p99_microseconds{operation=\"" + ToString(operation) + "\"}",
+        "99th percentile latency of filesystem callbacks and Drive primitives.",
+        operation_metrics_.Get(operation).PercentileMicroseconds(0.99));
+  }
+  std::lock_guard<std::mutex> lock(statistics_providers_mutex_);
+  for (const auto& provider : statistics_providers_) {
+    auto provided(provider());
+    statistics.insert(std::end(statistics), std::begin(provided), std::end(provided));
+  }
+  return statistics;
+}
+
+template <typename Storage>
+MemoryStatistics Drive<Storage>::GetMemoryStatistics() const {
+  return GetMemoryStatistics(directory_handler_.GetCacheStatistics());
+}
+
+template <typename Storage>
+MemoryStatistics Drive<Storage>::GetMemoryStatistics(
+    const typename detail::DirectoryHandler<Storage>::CacheStatistics& cache) const {
+  MemoryStatistics memory(cache.memory);
+  memory.file_buffer_memory_limit =
+      static_cast<uint64_t>(cache.live_encryptors) * default_max_buffer_memory_.data;
+  // The directory buffer is held below 'kBufferRoot_' too.
+  auto buffer_disk(GetBufferDiskUsage());
+  memory.file_buffer_disk =
+      buffer_disk > memory.directory_buffer_disk ? buffer_disk - memory.directory_buffer_disk : 0;
+  {
+    std::lock_guard<std::mutex> lock(storage_metrics_dump_mutex_);
+    if (storage_metrics_dump_timer_) {
+      memory.timers += sizeof(boost::asio::steady_timer) + detail::kHeapBlockOverhead;
+      ++memory.timer_count;
+    }
+  }
+  return memory;
+}
+
+template <typename Storage>
+void Drive<Storage>::AddStatisticsProvider(
+    std::function<std::vector<Statistic>()> provider) {
+  std::lock_guard<std::mutex> lock(statistics_providers_mutex_);
+  statistics_providers_.push_back(provider);
+}
+
+template <typename Storage>
+void Drive<Storage>::AddDefaultControlFiles() {
+  control_files_.AddStatFile("stats", [this] { return FormatStatistics(GetStatistics()); });
+  control_files_.AddStatFile("metrics", [this] {
+    return FormatStatisticsForPrometheus(GetStatistics());
+  });
+  control_files_.AddStatFile("storage_metrics", [this] { return storage_metrics().Report(); });
+  control_files_.AddStatFile("operation_metrics", [this] { return operation_metrics_.Report(); });
+  control_files_.AddStatFile("memory", [this] {
+    return FormatStatistics(ToStatistics(GetMemoryStatistics()));
+  });
+  control_files_.AddStatFile("write_amplification", [this] {
+    return FormatWriteAmplification(directory_handler_.GetWriteAmplification(),
+                                    directory_handler_.GetTopWriteAmplification(10));
+  });
+  control_files_.AddStatFile("slow_operations", [] {
+    return SlowOperationLog::Instance().Report();
+  });
+  control_files_.AddStatFile("allocations", [] { return AllocationTracker::Instance().Report(); });
+  control_files_.AddControlFile("flush", [this] { directory_handler_.FlushAll(); });
+  control_files_.AddControlFile("reset_metrics", [this] {
+    directory_handler_.storage_metrics().Reset();
+    operation_metrics_.Reset();
+    directory_handler_.ResetWriteAmplification();
+    if (AllocationTracker::enabled())
+      AllocationTracker::Instance().Start();
+  });
+}
+
+template <typename Storage>
+void Drive<Storage>::DisableControlFilesIfShadowed() {
+  if (directory_handler_.Get(detail::kRoot)->HasChild(detail::kControlDirectory.filename())) {
+    LOG(kWarning) << "The drive's root holds an entry named "
+                  << detail::kControlDirectory.filename() << ", so it's served in place of the "
+                  << "control directory.  Rename it to use the control files.";
+    control_files_.Disable();
+  }
+}
+
+template <typename Storage>
+uint64_t Drive<Storage>::GetBufferDiskUsage() const {
+  return detail::DirectorySize(*kBufferRoot_);
+}
+
+template <typename Storage>
+void Drive<Storage>::SetStorageMetricsDumpInterval(
+    const std::chrono::steady_clock::duration& interval) {
+  std::lock_guard<std::mutex> lock(storage_metrics_dump_mutex_);
+  storage_metrics_dump_interval_ = interval;
+  if (!storage_metrics_dump_timer_)
+    storage_metrics_dump_timer_.reset(new boost::asio::steady_timer(asio_service_.service()));
+  boost::system::error_code ec;
+  storage_metrics_dump_timer_->cancel(ec);
+  if (interval > std::chrono::steady_clock::duration::zero())
+    ScheduleStorageMetricsDump();
+}
+
+// Must be called with 'storage_metrics_dump_mutex_' locked.
+template <typename Storage>
+void Drive<Storage>::ScheduleStorageMetricsDump() {
+  storage_metrics_dump_timer_->expires_from_now(storage_metrics_dump_interval_);
+  storage_metrics_dump_timer_->async_wait([this](const boost::system::error_code& ec) {
+    if (ec == boost::asio::error::operation_aborted)
+      return;
+    DumpStorageMetrics();
+    DumpOperationMetrics();
+    std::lock_guard<std::mutex> lock(storage_metrics_dump_mutex_);
+    if (storage_metrics_dump_interval_ > std::chrono::steady_clock::duration::zero())
+      ScheduleStorageMetricsDump();
+  });
+}
+
 template <typename Storage>
 void Drive<Storage>::InitialiseEncryptor(const boost::filesystem::path& relative_path,
                                          detail::FileContext& file_context) {
@@ -185,8 +496,15 @@ void Drive<Storage>::InitialiseEncryptor(const boost::filesystem::path& relative
   auto disk_buffer_path(boost::filesystem::unique_path(*kBufferRoot_ / "%%%%%-%%%%%-%%%%%-%%%%%"));
   file_context.buffer.reset(new detail::FileContext::Buffer(default_max_buffer_memory_,
       default_max_buffer_disk_, buffer_pop_functor, disk_buffer_path, true));
-  file_context.self_encryptor.reset(new encrypt::SelfEncryptor(*file_context.meta_data.data_map,
-      *file_context.buffer, get_chunk_from_store_));
+  {
+    SlowOperationTimer timer(SlowOperationPhase::kEncryption);
+    file_context.self_encryptor.reset(new encrypt::SelfEncryptor(*file_context.meta_data.data_map,
+        *file_context.buffer, get_chunk_from_store_));
+  }
+  DRIVE_PROBE2(encryptor__create, static_cast<void*>(&file_context),
+               file_context.meta_data.name.c_str());
+  if (content_index_ && file_context.self_encryptor->size() == 0)
+    file_context.content_hasher.reset(new ContentHasher(content_index_));
 }
 
 template <typename Storage>
@@ -222,6 +540,7 @@ void Drive<Storage>::ScheduleDeletionOfEncryptor(detail::FileContext* file_conte
 template <typename Storage>
 const detail::FileContext* Drive<Storage>::GetContext(
     const boost::filesystem::path& relative_path) {
+  OperationMetrics::ScopedRecorder recorder(operation_metrics_, DriveOperation::kDriveGetContext);
   detail::Directory* parent(directory_handler_.Get(relative_path.parent_path()));
   return parent->GetChild(relative_path.filename());
 }
@@ -230,6 +549,9 @@ template <typename Storage>
 detail::FileContext* Drive<Storage>::GetMutableContext(
     const boost::filesystem::path& relative_path) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("drive", "Drive::GetMutableContext");
+  OperationMetrics::ScopedRecorder recorder(operation_metrics_,
+                                            DriveOperation::kDriveGetMutableContext);
   detail::Directory* parent(directory_handler_.Get(relative_path.parent_path()));
   return parent->GetMutableChild(relative_path.filename());
 }
@@ -237,6 +559,7 @@ detail::FileContext* Drive<Storage>::GetMutableContext(
 template <typename Storage>
 void Drive<Storage>::Create(const boost::filesystem::path& relative_path,
                             detail::FileContext&& file_context) {
+  OperationMetrics::ScopedRecorder recorder(operation_metrics_, DriveOperation::kDriveCreate);
   if (!file_context.meta_data.directory_id) {
     InitialiseEncryptor(relative_path, file_context);
     *file_context.open_count = 1;
@@ -246,12 +569,13 @@ void Drive<Storage>::Create(const boost::filesystem::path& relative_path,
 
 template <typename Storage>
 void Drive<Storage>::Open(const boost::filesystem::path& relative_path) {
+  OperationMetrics::ScopedRecorder recorder(operation_metrics_, DriveOperation::kDriveOpen);
   detail::Directory* parent(directory_handler_.Get(relative_path.parent_path()));
   auto file_context(parent->GetMutableChild(relative_path.filename()));
   if (!file_context->meta_data.directory_id) {
     LOG(kInfo) << "Opening " << relative_path << " open count: " << *file_context->open_count + 1;
     if (++(*file_context->open_count) == 1) {
-      std::lock_guard<std::mutex> lock(parent->mutex_);
+      std::lock_guard<TimedMutex> lock(parent->mutex_);
       InitialiseEncryptor(relative_path, *file_context);
     }
   }
@@ -259,7 +583,10 @@ void Drive<Storage>::Open(const boost::filesystem::path& relative_path) {
 
 template <typename Storage>
 void Drive<Storage>::Flush(const boost::filesystem::path& relative_path) {
+  DRIVE_TRACE_SCOPE("flush", "Drive::Flush");
+  OperationMetrics::ScopedRecorder recorder(operation_metrics_, DriveOperation::kDriveFlush);
   auto file_context(GetMutableContext(relative_path));
+  SlowOperationTimer timer(SlowOperationPhase::kEncryption);
   if (file_context->self_encryptor && !file_context->self_encryptor->Flush()) {
     LOG(kError) << "Failed to flush " << relative_path;
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
@@ -269,6 +596,8 @@ void Drive<Storage>::Flush(const boost::filesystem::path& relative_path) {
 template <typename Storage>
 void Drive<Storage>::Release(const boost::filesystem::path& relative_path) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("drive", "Drive::Release");
+  OperationMetrics::ScopedRecorder recorder(operation_metrics_, DriveOperation::kDriveRelease);
   auto file_context(GetMutableContext(relative_path));
   if (!file_context->meta_data.directory_id) {
     LOG(kInfo) << "Releasing " << relative_path << " open count: " << *file_context->open_count - 1;
@@ -281,30 +610,38 @@ void Drive<Storage>::Release(const boost::filesystem::path& relative_path) {
 template <typename Storage>
 void Drive<Storage>::ReleaseDir(const boost::filesystem::path& relative_path) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("drive", "Drive::ReleaseDir");
+  OperationMetrics::ScopedRecorder recorder(operation_metrics_, DriveOperation::kDriveReleaseDir);
   auto directory(directory_handler_.Get(relative_path));
   directory->ResetChildrenCounter();
 }
 
 template <typename Storage>
 void Drive<Storage>::Delete(const boost::filesystem::path& relative_path) {
+  OperationMetrics::ScopedRecorder recorder(operation_metrics_, DriveOperation::kDriveDelete);
   directory_handler_.Delete(relative_path);
 }
 
 template <typename Storage>
 void Drive<Storage>::Rename(const boost::filesystem::path& old_relative_path,
                             const boost::filesystem::path& new_relative_path) {
+  OperationMetrics::ScopedRecorder recorder(operation_metrics_, DriveOperation::kDriveRename);
   directory_handler_.Rename(old_relative_path, new_relative_path);
 }
 
 template <typename Storage>
 uint32_t Drive<Storage>::Read(const boost::filesystem::path& relative_path, char* data,
                               uint32_t size, uint64_t offset) {
+  OperationMetrics::ScopedRecorder recorder(operation_metrics_, DriveOperation::kDriveRead);
   auto file_context(GetContext(relative_path));
   assert(file_context->self_encryptor);
   LOG(kInfo) << "For "  << relative_path << ", reading " << size << " of "
              << file_context->self_encryptor->size() << " bytes at offset " << offset;
-  if (!file_context->self_encryptor->Read(data, size, offset))
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  {
+    SlowOperationTimer timer(SlowOperationPhase::kEncryption);
+    if (!file_context->self_encryptor->Read(data, size, offset))
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  }
   // TODO(Fraser#5#): 2013-12-02 - Update last access time?
   if (offset + size > file_context->self_encryptor->size()) {
     return offset > file_context->self_encryptor->size() ? 0 :
@@ -317,11 +654,18 @@ uint32_t Drive<Storage>::Read(const boost::filesystem::path& relative_path, char
 template <typename Storage>
 uint32_t Drive<Storage>::Write(const boost::filesystem::path& relative_path, const char* data,
                                uint32_t size, uint64_t offset) {
+  OperationMetrics::ScopedRecorder recorder(operation_metrics_, DriveOperation::kDriveWrite);
   auto file_context(GetMutableContext(relative_path));
   assert(file_context->self_encryptor);
   LOG(kInfo) << "For "  << relative_path << ", writing " << size << " bytes at offset " << offset;
-  if (!file_context->self_encryptor->Write(data, size, offset))
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  {
+    SlowOperationTimer timer(SlowOperationPhase::kEncryption);
+    if (!file_context->self_encryptor->Write(data, size, offset))
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  }
+  if (file_context->content_hasher)
+    file_context->content_hasher->Update(data, size, offset);
+  file_context->parent->write_amplification().RecordApplicationWrite(size);
   // TODO(Fraser#5#): 2013-12-02 - Update last write time?
 #ifndef MAIDSAFE_WIN32
   int64_t max_size(
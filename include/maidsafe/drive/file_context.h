@@ -29,6 +29,7 @@
 #include "maidsafe/common/data_stores/data_buffer.h"
 #include "maidsafe/encrypt/self_encryptor.h"
 
+#include "maidsafe/drive/content_index.h"
 #include "maidsafe/drive/meta_data.h"
 
 namespace maidsafe {
@@ -52,6 +53,9 @@ struct FileContext {
   MetaData meta_data;
   std::unique_ptr<Buffer> buffer;
   std::unique_ptr<encrypt::SelfEncryptor> self_encryptor;
+  // Only set while the file's content is being written from empty and the drive has a content
+  // index.
+  std::unique_ptr<ContentHasher> content_hasher;
   std::unique_ptr<boost::asio::steady_timer> timer;
   std::unique_ptr<std::atomic<int>> open_count;
   Directory* parent;
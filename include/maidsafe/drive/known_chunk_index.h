@@ -0,0 +1,94 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_KNOWN_CHUNK_INDEX_H_
+#define MAIDSAFE_DRIVE_KNOWN_CHUNK_INDEX_H_
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/data_types/immutable_data.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// A persistent set of the names of chunks known to be held by the network, allowing a Put of
+// such a chunk to be replaced by a reference count increment.  Names are only ever appended to
+// the backing file, so losing the tail of it (e.g. after a crash) only costs some deduplication.
+// In memory, each name is held as its first 16 bytes in a sorted array (16 bytes per name), so a
+// lookup is a binary search.  Chunk names are SHA512 hashes, so a false match on 128 bits isn't a
+// practical concern.  Once 'max_names' are held, further names aren't indexed.  Since the drive
+// never deletes chunks from the network, there's no means of removing a name.  Thread-safe.
+class KnownChunkIndex {
+ public:
+  struct Statistics {
+    Statistics() : lookups(0), hits(0), additions(0) {}
+    uint64_t lookups, hits, additions;
+  };
+
+  static const size_t kDefaultMaxNames = 4 * 1024 * 1024;
+
+  // Loads any names already held in 'index_path', creating it if required.
+  explicit KnownChunkIndex(const boost::filesystem::path& index_path,
+                           size_t max_names = kDefaultMaxNames);
+
+  bool Contains(const ImmutableData::Name& name);
+  void Add(const ImmutableData::Name& name);
+
+  size_t size() const;
+  Statistics GetStatistics() const;
+
+ private:
+  typedef std::pair<uint64_t, uint64_t> Key;
+
+  KnownChunkIndex(const KnownChunkIndex&);
+  KnownChunkIndex(KnownChunkIndex&&);
+  KnownChunkIndex& operator=(KnownChunkIndex);
+
+  static Key ToKey(const std::string& name);
+  void LoadIndex();
+  bool ContainsKey(const Key& key) const;
+  void MergeRecentKeys();
+  bool Append(const std::string& name);
+  bool ReopenIndexFile();
+
+  const boost::filesystem::path kIndexPath_;
+  const size_t kMaxNames_;
+  mutable std::mutex mutex_;
+  // 'keys_' is sorted.  Additions go to the small 'recent_keys_' which is merged into 'keys_' once
+  // it fills, so an Add doesn't have to shift the whole array.
+  std::vector<Key> keys_, recent_keys_;
+  std::ofstream index_file_;
+  // The number of complete names in the backing file, and whether it can still be appended to.
+  uint64_t names_in_file_;
+  bool persistent_, full_;
+  Statistics statistics_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_KNOWN_CHUNK_INDEX_H_
@@ -0,0 +1,99 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_MEMORY_ACCOUNTING_H_
+#define MAIDSAFE_DRIVE_MEMORY_ACCOUNTING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/encrypt/data_map.h"
+
+#include "maidsafe/drive/control_files.h"
+#include "maidsafe/drive/meta_data.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// Live bytes held by each of the drive's subsystems, as served by the "memory" control file.
+//
+// The heap figures are estimates made by walking the structures concerned, with each heap block
+// counted along with 'detail::kHeapBlockOverhead' bytes of allocator bookkeeping.  Memory which
+// has been freed but not returned to the OS isn't included.  DataBuffers don't report how much
+// of their memory is in use, so the buffers' memory limits are given instead.
+struct MemoryStatistics {
+  MemoryStatistics();
+  MemoryStatistics& operator+=(const MemoryStatistics& other);
+  // Everything held in memory, i.e. all but the buffers' disk usage.
+  uint64_t TotalMemory() const;
+
+  // Cached Directory objects, including their cache entries, children indices and versions.
+  uint64_t directories;
+  // The FileContexts of the cached directories' children, excluding their data maps.
+  uint64_t file_contexts;
+  // The children's data maps, and the original data maps held by live encryptors.
+  uint64_t data_maps;
+  // Upper bounds of the memory held by the live encryptors' buffers and by the buffer used to
+  // encrypt directory listings.
+  uint64_t file_buffer_memory_limit, directory_buffer_memory_limit;
+  uint64_t file_buffer_disk, directory_buffer_disk;
+  // Chunks held by Storage calls waiting for a scheduler slot, and chunk names waiting for their
+  // reference counts to be incremented.
+  uint64_t upload_queues;
+  // Asio timers: one per cached directory and one per file which has been opened.
+  uint64_t timers;
+  size_t timer_count;
+  // FileContexts counted in 'file_contexts'.
+  size_t file_context_count;
+};
+
+// The figures as "memory_bytes{subsystem=...}" and "memory_disk_bytes{subsystem=...}" statistics,
+// along with the total and the bytes per cached FileContext.
+std::vector<Statistic> ToStatistics(const MemoryStatistics& memory);
+
+// Bytes of heap currently allocated by the whole process, including the allocator's per-block
+// overhead, as reported by the C library.  Zero where the C library doesn't report it.  Used to
+// check the estimates above against what's actually allocated.
+uint64_t HeapBytesInUse();
+
+namespace detail {
+
+const size_t kHeapBlockOverhead = 2 * sizeof(void*);
+
+// The heap memory owned by the given object, excluding the object itself.
+uint64_t HeapBytes(const std::string& value);
+uint64_t HeapBytes(const boost::filesystem::path& path);
+uint64_t HeapBytes(const encrypt::DataMap& data_map);
+// Excludes the data map, which is accounted separately.
+uint64_t HeapBytes(const MetaData& meta_data);
+
+// Total size of the regular files below 'directory'.  Errors are ignored.
+uint64_t DirectorySize(const boost::filesystem::path& directory);
+
+}  // namespace detail
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_MEMORY_ACCOUNTING_H_
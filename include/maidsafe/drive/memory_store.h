@@ -0,0 +1,92 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_MEMORY_STORE_H_
+#define MAIDSAFE_DRIVE_MEMORY_STORE_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "boost/thread/future.hpp"
+
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/data_types/immutable_data.h"
+#include "maidsafe/common/data_types/mutable_data.h"
+#include "maidsafe/common/data_types/structured_data_versions.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// A thread-safe Storage which holds all chunks and version trees in memory.  It implements the
+// subset of the data_stores::LocalStore interface which the drive uses, so can replace it wherever
+// the cost of the chunk store's file I/O would otherwise mask the cost of the drive itself.
+// Nothing is persisted; all data is lost when the store is destroyed.
+class MemoryStore {
+ public:
+  typedef std::vector<StructuredDataVersions::VersionName> VersionNames;
+
+  MemoryStore();
+
+  // The returned future throws CommonErrors::no_such_element if 'data_name' isn't held.
+  boost::future<ImmutableData> Get(const ImmutableData::Name& data_name);
+  // Storing an existing chunk increments its reference count.
+  void Put(const ImmutableData& data);
+  // Decrements the chunk's reference count, removing it once this reaches zero.
+  void Delete(const ImmutableData::Name& data_name);
+  void IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names);
+
+  boost::future<VersionNames> GetVersions(const MutableData::Name& data_name);
+  boost::future<VersionNames> GetBranch(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& branch_tip);
+  // Throws CommonErrors::no_such_element if no version tree exists for 'data_name'.
+  void PutVersion(const MutableData::Name& data_name,
+                  const StructuredDataVersions::VersionName& old_version_name,
+                  const StructuredDataVersions::VersionName& new_version_name);
+  // Replaces any existing version tree for 'data_name'.
+  boost::future<void> CreateVersionTree(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& version_name,
+                                        uint32_t max_versions, uint32_t max_branches);
+
+  // Total size of the chunks currently held, ignoring reference counts.
+  MemoryUsage GetCurrentMemoryUsage() const;
+  size_t ChunkCount() const;
+
+ private:
+  MemoryStore(const MemoryStore&);
+  MemoryStore(MemoryStore&&);
+  MemoryStore& operator=(MemoryStore);
+
+  // Chunk and its reference count.
+  typedef std::pair<ImmutableData, uint64_t> Chunk;
+
+  mutable std::mutex mutex_;
+  std::map<ImmutableData::Name, Chunk> chunks_;
+  std::map<MutableData::Name, std::unique_ptr<StructuredDataVersions>> version_trees_;
+  uint64_t memory_usage_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_MEMORY_STORE_H_
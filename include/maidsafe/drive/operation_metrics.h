@@ -0,0 +1,191 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_OPERATION_METRICS_H_
+#define MAIDSAFE_DRIVE_OPERATION_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "boost/thread/tss.hpp"
+
+#include "maidsafe/drive/allocation_tracker.h"
+#include "maidsafe/drive/slow_operation_log.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// The filesystem callbacks and the Drive primitives they call.
+enum class DriveOperation {
+  kAccess,
+  kChmod,
+  kChown,
+  kCreate,
+  kDestroy,
+  kFgetattr,
+  kFlush,
+  kFtruncate,
+  kGetattr,
+  kInit,
+  kMkdir,
+  kMknod,
+  kOpen,
+  kOpendir,
+  kRead,
+  kReaddir,
+  kRelease,
+  kReleasedir,
+  kRename,
+  kRmdir,
+  kStatfs,
+  kTruncate,
+  kUnlink,
+  kUtimens,
+  kWrite,
+  kDriveGetContext,
+  kDriveGetMutableContext,
+  kDriveCreate,
+  kDriveOpen,
+  kDriveFlush,
+  kDriveRelease,
+  kDriveReleaseDir,
+  kDriveDelete,
+  kDriveRename,
+  kDriveRead,
+  kDriveWrite,
+  kCount
+};
+
+std::string ToString(DriveOperation operation);
+
+// Latency histograms of the drive's operations.  Each thread records into its own set of
+// histograms, so recording never contends with other threads; the per-thread histograms are merged
+// whenever they're read.  When a thread exits, its histograms are folded into a shared set and
+// freed, so threads which come and go don't each leave a set behind.  All member functions are
+// threadsafe.
+class OperationMetrics {
+ public:
+  // Latencies are recorded in nanoseconds.  Values below 'kSubBucketCount' have a bucket each, and
+  // every power of two above that is split into 'kSubBucketCount' equal buckets, so the bucket
+  // holding a value is never more than 1/'kSubBucketCount' of the value wide.  Values of 2^41ns
+  // (about 37 minutes) or more fall into the last bucket.
+  static const size_t kSubBucketBits = 3;
+  static const size_t kSubBucketCount = size_t(1) << kSubBucketBits;
+  static const size_t kMaxExponent = 40;
+  static const size_t kHistogramBucketCount = (kMaxExponent - kSubBucketBits + 2) * kSubBucketCount;
+
+  static size_t BucketIndex(uint64_t nanoseconds);
+  static uint64_t BucketUpperBound(size_t index);
+
+  struct Summary {
+    Summary();
+    double MeanMicroseconds() const;
+    // Returns the upper bound of the histogram bucket holding the given percentile (0.0 to 1.0).
+    double PercentileMicroseconds(double percentile) const;
+    double MaxMicroseconds() const;
+
+    uint64_t count, total_nanoseconds, max_nanoseconds;
+    std::vector<uint64_t> histogram;
+  };
+
+  // Records a single operation when destroyed.  Also an allocation scope and a slow operation scope
+  // named after the operation.
+  class ScopedRecorder {
+   public:
+    ScopedRecorder(OperationMetrics& metrics, DriveOperation operation);
+    ~ScopedRecorder();
+
+   private:
+    ScopedRecorder(const ScopedRecorder&);
+    ScopedRecorder(ScopedRecorder&&);
+    ScopedRecorder& operator=(ScopedRecorder);
+
+    AllocationScope allocation_scope_;
+    SlowOperationScope slow_operation_scope_;
+    OperationMetrics& metrics_;
+    const DriveOperation kOperation_;
+    const std::chrono::steady_clock::time_point kStartTime_;
+  };
+
+  OperationMetrics();
+
+  void Record(DriveOperation operation, std::chrono::steady_clock::duration duration);
+  Summary Get(DriveOperation operation) const;
+  void Reset();
+  // Number of threads currently holding histograms of their own.
+  size_t LiveShardCount() const;
+  // Human-readable table of all recorded operations.
+  std::string Report() const;
+
+ private:
+  OperationMetrics(const OperationMetrics&);
+  OperationMetrics(OperationMetrics&&);
+  OperationMetrics& operator=(OperationMetrics);
+
+  static const size_t kOperationCount = static_cast<size_t>(DriveOperation::kCount);
+
+  // Only ever written by its owning thread, but read and reset by others.
+  struct Cell {
+    Cell();
+    void AddTo(Summary& summary) const;
+    // Must be called with the owning 'Shards::mutex' locked.
+    void AddTo(Cell& cell) const;
+    void Reset();
+    std::atomic<uint64_t> count, total_nanoseconds, max_nanoseconds;
+    std::array<std::atomic<uint64_t>, kHistogramBucketCount> histogram;
+  };
+
+  typedef std::array<Cell, kOperationCount> Shard;
+
+  // Held by this object and by each thread's 'LocalShard', so that a thread which outlives this
+  // object can still retire its shard.
+  struct Shards {
+    Shards();
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Shard>> live;
+    // The counts of shards whose threads have exited.
+    Shard retired;
+  };
+
+  // The thread-specific pointer is keyed on this object's address.  Comparing 'shards' guards
+  // against picking up a shard left behind by a destroyed instance which lived at the same address.
+  struct LocalShard {
+    std::shared_ptr<Shards> shards;
+    Shard* shard;
+  };
+
+  // Cleanup function of 'local_shard_'.  Folds the shard into 'Shards::retired' and frees it.
+  static void RetireLocalShard(LocalShard* local_shard);
+  Shard& GetLocalShard();
+
+  std::shared_ptr<Shards> shards_;
+  boost::thread_specific_ptr<LocalShard> local_shard_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_OPERATION_METRICS_H_
@@ -0,0 +1,169 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_OPERATION_TRACE_H_
+#define MAIDSAFE_DRIVE_OPERATION_TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/drive/operation_metrics.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// A single filesystem callback.  'flags' holds the open flags for open, read, write and release,
+// and the mode for chmod, create, mkdir and mknod.  'size' holds the new size for truncate and
+// ftruncate.  'new_path' is only set for rename.  'result' is the callback's return value, i.e. a
+// negated errno if the call failed.
+struct OperationTraceRecord {
+  OperationTraceRecord();
+
+  DriveOperation operation;
+  std::string path, new_path;
+  uint64_t offset, size;
+  uint32_t flags;
+  int32_t result;
+  // 'start' is relative to the start of the recording.
+  std::chrono::nanoseconds start, duration;
+};
+
+// Writes records in a compact binary format: each distinct path is written once and referred to by
+// index thereafter, and all integers are variable-length encoded.  Output is buffered; it's flushed
+// by 'Flush' and on destruction.  Not threadsafe.
+class OperationTraceWriter {
+ public:
+  // Throws if 'trace_file' can't be created.
+  explicit OperationTraceWriter(const boost::filesystem::path& trace_file);
+  ~OperationTraceWriter();
+
+  void Write(const OperationTraceRecord& record);
+  void Flush();
+
+ private:
+  OperationTraceWriter(const OperationTraceWriter&);
+  OperationTraceWriter(OperationTraceWriter&&);
+  OperationTraceWriter& operator=(OperationTraceWriter);
+
+  uint64_t PathIndex(const std::string& path);
+
+  std::ofstream stream_;
+  std::string buffer_;
+  std::map<std::string, uint64_t> path_indices_;
+  int64_t previous_start_;
+};
+
+// Reads back a file written by 'OperationTraceWriter'.  Not threadsafe.
+class OperationTraceReader {
+ public:
+  // Throws if 'trace_file' can't be read or isn't a trace.
+  explicit OperationTraceReader(const boost::filesystem::path& trace_file);
+
+  // Returns false once the end of the trace is reached.  Throws if the trace is corrupt or
+  // truncated.
+  bool Next(OperationTraceRecord& record);
+
+ private:
+  OperationTraceReader(const OperationTraceReader&);
+  OperationTraceReader(OperationTraceReader&&);
+  OperationTraceReader& operator=(OperationTraceReader);
+
+  uint64_t ReadVarint();
+  const std::string& ReadPath();
+
+  std::string contents_;
+  size_t position_;
+  std::vector<std::string> paths_;
+  int64_t previous_start_;
+};
+
+// Records filesystem callbacks to a trace file while enabled.  A 'ScopedRecord' costs a single
+// atomic load while recording is disabled.  All member functions are threadsafe.
+class OperationRecorder {
+ public:
+  class ScopedRecord {
+   public:
+    ScopedRecord(OperationRecorder& recorder, DriveOperation operation, const char* path,
+                 uint64_t offset = 0, uint64_t size = 0, uint32_t flags = 0);
+    ScopedRecord(OperationRecorder& recorder, DriveOperation operation, const char* path,
+                 const char* new_path);
+    ~ScopedRecord();
+
+    // Records 'result' as the callback's return value and passes it through, so callbacks can
+    // 'return record.Return(...)'.  A callback which never calls this is recorded as succeeding.
+    int Return(int result) {
+      result_ = result;
+      return result;
+    }
+
+   private:
+    ScopedRecord(const ScopedRecord&);
+    ScopedRecord(ScopedRecord&&);
+    ScopedRecord& operator=(ScopedRecord);
+
+    OperationRecorder& recorder_;
+    const bool kEnabled_;
+    DriveOperation operation_;
+    const char* path_;
+    const char* new_path_;
+    uint64_t offset_, size_;
+    uint32_t flags_;
+    int result_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  OperationRecorder();
+
+  // Starts recording to 'trace_file', ending any recording already in progress.  Throws if the file
+  // can't be created.
+  void Start(const boost::filesystem::path& trace_file);
+  // Ends the recording in progress (if any) and flushes it to its file.
+  void Stop();
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  uint64_t record_count() const;
+
+ private:
+  OperationRecorder(const OperationRecorder&);
+  OperationRecorder(OperationRecorder&&);
+  OperationRecorder& operator=(OperationRecorder);
+
+  void Record(OperationTraceRecord& record, std::chrono::steady_clock::time_point start,
+              std::chrono::steady_clock::time_point end);
+
+  std::atomic<bool> enabled_;
+  mutable std::mutex mutex_;
+  std::unique_ptr<OperationTraceWriter> writer_;
+  std::chrono::steady_clock::time_point start_time_;
+  uint64_t record_count_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_OPERATION_TRACE_H_
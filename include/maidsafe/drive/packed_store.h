@@ -0,0 +1,142 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_PACKED_STORE_H_
+#define MAIDSAFE_DRIVE_PACKED_STORE_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+#include "boost/thread/future.hpp"
+
+#include "maidsafe/common/data_stores/local_store.h"
+#include "maidsafe/common/data_types/immutable_data.h"
+#include "maidsafe/common/data_types/mutable_data.h"
+#include "maidsafe/common/data_types/structured_data_versions.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// A local Storage which appends chunks to a few large pack files rather than holding each in its
+// own file as data_stores::LocalStore does, so small-file workloads aren't dominated by inode and
+// directory lookup costs.
+//
+// Every change is appended to the newest pack as a checksummed record: a chunk with its reference
+// count, or just a new reference count.  The in-memory index is rebuilt by scanning the packs in
+// order on construction, the last record for each chunk winning.  Once a full pack's dead bytes
+// (chunks whose reference count has fallen to zero) reach 'compaction_threshold' of its size, a
+// background thread copies its remaining live chunks to the newest pack and removes it.
+//
+// Version operations are passed to 'version_store'.
+class PackedStore {
+ public:
+  typedef std::vector<StructuredDataVersions::VersionName> VersionNames;
+
+  struct Statistics {
+    Statistics();
+    uint64_t pack_count, chunk_count, live_bytes, total_bytes, compaction_count;
+  };
+
+  PackedStore(const boost::filesystem::path& pack_dir,
+              std::shared_ptr<data_stores::LocalStore> version_store,
+              uint64_t max_pack_size = 64 * 1024 * 1024, double compaction_threshold = 0.5);
+  ~PackedStore();
+
+  // The returned future throws CommonErrors::no_such_element if 'data_name' isn't held.
+  boost::future<ImmutableData> Get(const ImmutableData::Name& data_name);
+  // Storing an existing chunk increments its reference count.
+  void Put(const ImmutableData& data);
+  // Decrements the chunk's reference count; its space is reclaimed by compaction once this reaches
+  // zero.
+  void Delete(const ImmutableData::Name& data_name);
+  void IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names);
+  boost::future<VersionNames> GetVersions(const MutableData::Name& data_name);
+  boost::future<VersionNames> GetBranch(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& branch_tip);
+  void PutVersion(const MutableData::Name& data_name,
+                  const StructuredDataVersions::VersionName& old_version_name,
+                  const StructuredDataVersions::VersionName& new_version_name);
+  boost::future<void> CreateVersionTree(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& version_name,
+                                        uint32_t max_versions, uint32_t max_branches);
+
+  // Compacts every full pack which has reached the threshold now, rather than waiting for the
+  // background thread.  Returns the number of packs compacted.
+  size_t Compact();
+  Statistics GetStatistics() const;
+
+ private:
+  class Pack;
+  // Where a chunk's latest copy is held and which pack holds its latest reference count.  Entries
+  // with a count of zero are kept until the chunk's pack is compacted, so that an older record of
+  // the chunk can't be resurrected by a later scan.
+  struct Entry {
+    Entry();
+    uint32_t pack_id, count_pack_id, size, count;
+    uint64_t offset;
+  };
+
+  PackedStore(const PackedStore&);
+  PackedStore(PackedStore&&);
+  PackedStore& operator=(PackedStore);
+
+  void LoadPacks();
+  // The index is saved on destruction and reused if no pack has changed since; otherwise every
+  // pack is scanned.
+  bool LoadIndex();
+  void SaveIndex() const;
+  void ScanPack(Pack& pack, bool is_newest);
+  // The following are called with 'mutex_' held.  Append adds a record to the newest pack,
+  // starting a new one if it's full, and returns the offset of 'content' within the pack.
+  uint64_t Append(const ImmutableData::Name& data_name, uint32_t count, const std::string* content);
+  void StartNewPack();
+  void OpenWriter();
+  bool NeedsCompaction(const Pack& pack) const;
+  void CompactPack(std::shared_ptr<Pack> pack);
+  void RunCompaction();
+
+  const boost::filesystem::path kPackDir_;
+  const uint64_t kMaxPackSize_;
+  const double kCompactionThreshold_;
+  std::shared_ptr<data_stores::LocalStore> version_store_;
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  std::map<ImmutableData::Name, Entry> index_;
+  std::map<uint32_t, std::shared_ptr<Pack>> packs_;
+  std::shared_ptr<Pack> active_pack_;
+  std::FILE* writer_;
+  uint64_t compaction_count_;
+  bool compaction_requested_, stopping_;
+  std::mutex compaction_mutex_;
+  std::thread compaction_thread_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_PACKED_STORE_H_
@@ -0,0 +1,67 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_PROBES_H_
+#define MAIDSAFE_DRIVE_PROBES_H_
+
+// Static tracepoints (USDT) on the drive's hot paths, for tracing a live mount with eBPF,
+// SystemTap or perf, e.g.
+//   bpftrace -e 'usdt:./local_drive:maidsafe_drive:operation__entry { @[arg0] = count(); }'
+//
+// The probes are only compiled in when MAIDSAFE_DRIVE_USDT is defined, which CMake does on Linux if
+// sys/sdt.h is available (see the DRIVE_USDT_PROBES option).  Each probe is then a single nop
+// until a tracer attaches, and is passed only values which are already at hand, so an unattached
+// probe costs nothing measurable.  Otherwise the macros expand to nothing and their arguments aren't
+// evaluated.
+//
+// The provider is "maidsafe_drive", and the probes are:
+//   operation__entry(int operation, const char* path)
+//   operation__exit(int operation, const char* path)
+//       Around each filesystem callback, where 'operation' is its DriveOperation value.
+//   storage__start(int operation, int caller, uint64_t bytes)
+//   storage__end(int operation, int caller, uint64_t bytes, int succeeded)
+//       Around each Storage call, where 'operation' and 'caller' are its StorageOperation and
+//       StorageCaller values.  'bytes' may only be known by the end.
+//   directory__store__state(void* directory, int state)
+//       When a Directory's store becomes pending (0), ongoing (1) or complete (2).
+//   encryptor__create(void* file_context, const char* name)
+//   encryptor__delete(void* file_context, const char* name)
+//       When a file's encryptor and buffer are created and deleted.
+//   directory_cache__hit(const char* path)
+//   directory_cache__miss(const char* path)
+//       For each DirectoryHandler lookup, and each directory it then fetches from storage.
+
+#ifdef MAIDSAFE_DRIVE_USDT
+
+#include <sys/sdt.h>
+
+#define DRIVE_PROBE1(name, a1) DTRACE_PROBE1(maidsafe_drive, name, a1)
+#define DRIVE_PROBE2(name, a1, a2) DTRACE_PROBE2(maidsafe_drive, name, a1, a2)
+#define DRIVE_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(maidsafe_drive, name, a1, a2, a3)
+#define DRIVE_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(maidsafe_drive, name, a1, a2, a3, a4)
+
+#else
+
+#define DRIVE_PROBE1(name, a1)
+#define DRIVE_PROBE2(name, a1, a2)
+#define DRIVE_PROBE3(name, a1, a2, a3)
+#define DRIVE_PROBE4(name, a1, a2, a3, a4)
+
+#endif
+
+#endif  // MAIDSAFE_DRIVE_PROBES_H_
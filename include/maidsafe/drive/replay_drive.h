@@ -0,0 +1,246 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_REPLAY_DRIVE_H_
+#define MAIDSAFE_DRIVE_REPLAY_DRIVE_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/drive/control_files.h"
+#include "maidsafe/drive/directory.h"
+#include "maidsafe/drive/drive.h"
+#include "maidsafe/drive/file_context.h"
+#include "maidsafe/drive/operation_trace.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// A drive which is never mounted.  Instead, 'Replay' calls the Drive primitives directly, making
+// the same calls as FuseDrive's callbacks would have made for each record of a trace written by
+// 'Drive::StartRecordingOperations'.  This reproduces a recorded workload in-process without a
+// kernel mount, and doubles as a deterministic benchmark.
+//
+// File contents aren't recorded, so writes use pseudo-random data from a fixed seed.  Calls which
+// failed when recorded, and calls on the control files, are skipped.  Replaying against a new drive
+// only succeeds fully for traces recorded from a new drive; calls on paths which don't exist are
+// counted as failures.
+template <typename Storage>
+class ReplayDrive : public Drive<Storage> {
+ public:
+  struct Result {
+    Result() : operations(0), failures(0), skipped(0), elapsed(0) {}
+    uint64_t operations, failures, skipped;
+    std::chrono::steady_clock::duration elapsed;
+  };
+
+  ReplayDrive(std::shared_ptr<Storage> storage, const Identity& unique_user_id,
+              const Identity& root_parent_id, const boost::filesystem::path& user_app_dir,
+              bool create);
+  virtual ~ReplayDrive() {}
+
+  // With 'original_speed', each call is delayed until the offset from the start of the replay at
+  // which it was originally made; otherwise calls are issued back to back.  Throws if the trace
+  // can't be read or is corrupt.
+  Result Replay(const boost::filesystem::path& trace_file, bool original_speed);
+
+ private:
+  ReplayDrive(const ReplayDrive&);
+  ReplayDrive(ReplayDrive&&);
+  ReplayDrive& operator=(ReplayDrive);
+
+  virtual void Mount() {}
+  virtual void Unmount() {}
+
+  // Throws if the call fails.
+  void Apply(const OperationTraceRecord& record);
+  void SetAttributes(const OperationTraceRecord& record);
+  void Truncate(const boost::filesystem::path& path, uint64_t size);
+  void ReadDirectory(const boost::filesystem::path& path, uint64_t offset);
+  const char* GetWriteData(uint64_t size);
+
+  std::vector<char> read_buffer_, write_data_;
+  std::mt19937 generator_;
+};
+
+// ==================== Implementation =============================================================
+template <typename Storage>
+ReplayDrive<Storage>::ReplayDrive(std::shared_ptr<Storage> storage, const Identity& unique_user_id,
+                                  const Identity& root_parent_id,
+                                  const boost::filesystem::path& user_app_dir, bool create)
+    : Drive<Storage>(storage, unique_user_id, root_parent_id, user_app_dir, user_app_dir, "",
+                     create),
+      read_buffer_(),
+      write_data_(),
+      generator_(0) {
+  this->DisableControlFilesIfShadowed();
+}
+
+template <typename Storage>
+typename ReplayDrive<Storage>::Result ReplayDrive<Storage>::Replay(
+    const boost::filesystem::path& trace_file, bool original_speed) {
+  OperationTraceReader reader(trace_file);
+  OperationTraceRecord record;
+  Result result;
+  auto start(std::chrono::steady_clock::now());
+  while (reader.Next(record)) {
+    if (record.result < 0 || record.operation == DriveOperation::kStatfs ||
+        this->control_files_.IsControlPath(record.path) ||
+        this->control_files_.IsControlPath(record.new_path)) {
+      ++result.skipped;
+      continue;
+    }
+    if (original_speed)
+      std::this_thread::sleep_until(start + record.start);
+    ++result.operations;
+    try {
+      Apply(record);
+    }
+    catch (const std::exception& e) {
+      LOG(kVerbose) << "Replaying " << ToString(record.operation) << " on " << record.path
+                    << " failed: " << e.what();
+      ++result.failures;
+    }
+  }
+  result.elapsed = std::chrono::steady_clock::now() - start;
+  return result;
+}
+
+template <typename Storage>
+void ReplayDrive<Storage>::Apply(const OperationTraceRecord& record) {
+  boost::filesystem::path path(record.path);
+  switch (record.operation) {
+    case DriveOperation::kCreate:
+    case DriveOperation::kMkdir:
+    case DriveOperation::kMknod: {
+      bool is_directory(record.operation == DriveOperation::kMkdir);
+      detail::FileContext file_context(path.filename(), is_directory);
+#ifndef MAIDSAFE_WIN32
+      time(&file_context.meta_data.attributes.st_atime);
+      file_context.meta_data.attributes.st_ctime = file_context.meta_data.attributes.st_mtime =
+          file_context.meta_data.attributes.st_atime;
+      file_context.meta_data.attributes.st_mode = record.flags | (is_directory ? S_IFDIR : 0);
+      file_context.meta_data.attributes.st_nlink = (is_directory ? 2 : 1);
+#endif
+      return this->Create(path, std::move(file_context));
+    }
+    case DriveOperation::kGetattr:
+    case DriveOperation::kFgetattr:
+      this->GetContext(path);
+      return;
+    case DriveOperation::kChmod:
+    case DriveOperation::kChown:
+    case DriveOperation::kUtimens:
+      return SetAttributes(record);
+    case DriveOperation::kTruncate:
+    case DriveOperation::kFtruncate:
+      return Truncate(path, record.size);
+    case DriveOperation::kOpen:
+    case DriveOperation::kOpendir:
+      return this->Open(path);
+    case DriveOperation::kRead:
+      read_buffer_.resize(std::max<size_t>(read_buffer_.size(), record.size));
+      this->Read(path, read_buffer_.data(), static_cast<uint32_t>(record.size), record.offset);
+      return;
+    case DriveOperation::kWrite:
+      this->Write(path, GetWriteData(record.size), static_cast<uint32_t>(record.size),
+                  record.offset);
+      return;
+    case DriveOperation::kReaddir:
+      return ReadDirectory(path, record.offset);
+    case DriveOperation::kFlush:
+      return this->Flush(path);
+    case DriveOperation::kRelease:
+      return this->Release(path);
+    case DriveOperation::kReleasedir:
+      return this->ReleaseDir(path);
+    case DriveOperation::kRename:
+      return this->Rename(path, boost::filesystem::path(record.new_path));
+    case DriveOperation::kRmdir:
+    case DriveOperation::kUnlink:
+      return this->Delete(path);
+    default:
+      return;
+  }
+}
+
+template <typename Storage>
+void ReplayDrive<Storage>::SetAttributes(const OperationTraceRecord& record) {
+  auto file_context(this->GetMutableContext(record.path));
+#ifndef MAIDSAFE_WIN32
+  if (record.operation == DriveOperation::kChmod)
+    file_context->meta_data.attributes.st_mode = record.flags;
+  time(&file_context->meta_data.attributes.st_ctime);
+  if (record.operation == DriveOperation::kUtimens) {
+    file_context->meta_data.attributes.st_atime = file_context->meta_data.attributes.st_mtime =
+        file_context->meta_data.attributes.st_ctime;
+  }
+#endif
+  file_context->parent->ScheduleForStoring();
+}
+
+template <typename Storage>
+void ReplayDrive<Storage>::Truncate(const boost::filesystem::path& path, uint64_t size) {
+  auto file_context(this->GetMutableContext(path));
+  if (!file_context->self_encryptor)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  file_context->self_encryptor->Truncate(size);
+  if (file_context->content_hasher)
+    file_context->content_hasher->Truncate(size);
+#ifndef MAIDSAFE_WIN32
+  file_context->meta_data.attributes.st_size = size;
+  time(&file_context->meta_data.attributes.st_mtime);
+  file_context->meta_data.attributes.st_ctime = file_context->meta_data.attributes.st_atime =
+      file_context->meta_data.attributes.st_mtime;
+#endif
+  file_context->parent->ScheduleForStoring();
+}
+
+template <typename Storage>
+void ReplayDrive<Storage>::ReadDirectory(const boost::filesystem::path& path, uint64_t offset) {
+  detail::Directory* directory(this->directory_handler_.Get(path));
+  if (offset == 0)
+    directory->ResetChildrenCounter();
+  while (directory->GetChildAndIncrementCounter()) {}
+}
+
+template <typename Storage>
+const char* ReplayDrive<Storage>::GetWriteData(uint64_t size) {
+  while (write_data_.size() < size)
+    write_data_.push_back(static_cast<char>(generator_() & 0xff));
+  return write_data_.data();
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_REPLAY_DRIVE_H_
@@ -0,0 +1,438 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_SIMULATED_NETWORK_STORE_H_
+#define MAIDSAFE_DRIVE_SIMULATED_NETWORK_STORE_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/asio/steady_timer.hpp"
+#include "boost/system/error_code.hpp"
+#include "boost/thread/future.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/data_types/immutable_data.h"
+#include "maidsafe/common/data_types/mutable_data.h"
+#include "maidsafe/common/data_types/structured_data_versions.h"
+
+#include "maidsafe/drive/storage_metrics.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+class LatencyDistribution {
+ public:
+  enum class Type { kConstant, kUniform, kNormal, kExponential };
+
+  // Constant zero latency.
+  LatencyDistribution();
+  // For kConstant, 'first' is the latency and 'second' is ignored.  For kUniform, they are the
+  // lower and upper bounds.  For kNormal, they are the mean and standard deviation.  For
+  // kExponential, 'first' is the mean and 'second' is ignored.
+  LatencyDistribution(Type type, std::chrono::milliseconds first,
+                      std::chrono::milliseconds second = std::chrono::milliseconds(0));
+
+  // Parses "<type>:<first>[:<second>]" where <type> is one of "constant", "uniform", "normal" or
+  // "exponential" and the values are in milliseconds, e.g. "normal:80:20".
+  static LatencyDistribution Parse(const std::string& spec);
+
+  // Never returns a negative duration.
+  std::chrono::microseconds Sample(std::mt19937_64& generator) const;
+
+ private:
+  Type type_;
+  std::chrono::milliseconds first_, second_;
+};
+
+// Describes the simulated link between the drive and the network.  Bandwidth limits of 0 mean
+// unlimited; probabilities are in the range [0, 1].
+struct SimulatedNetworkProfile {
+  SimulatedNetworkProfile();
+
+  // Parses a comma-separated list of "key=value" pairs, e.g.
+  //   "latency=normal:80:20,put=constant:150,jitter=10,upload_kbps=512,failure=0.01,seed=7"
+  // Recognised keys are:
+  //   latency - LatencyDistribution applied to every operation not given its own value below
+  //   get, put, increment, get_versions, get_branch, put_version, create_version_tree
+  //           - LatencyDistribution for that operation only
+  //   jitter - maximum extra uniformly-distributed delay in milliseconds
+  //   upload_kbps, download_kbps - bandwidth caps in KiB per second
+  //   failure - probability that a Get, GetVersions, GetBranch or CreateVersionTree fails
+  //   timeout - probability that one of those operations times out instead
+  //   timeout_ms - how long a timed-out operation takes to report its failure
+  //   seed - seed for the random number generator, so that runs are reproducible
+  // Throws CommonErrors::invalid_parameter for any malformed or unrecognised entry.
+  static SimulatedNetworkProfile Parse(const std::string& spec);
+
+  std::array<LatencyDistribution, static_cast<size_t>(StorageOperation::kCount)> latencies;
+  std::chrono::milliseconds jitter;
+  uint64_t upload_bytes_per_second, download_bytes_per_second;
+  double failure_probability, timeout_probability;
+  std::chrono::milliseconds timeout;
+  uint64_t seed;
+};
+
+// Wraps a Storage (e.g. data_stores::LocalStore) and makes it behave like a remote one:  every
+// operation is subject to the latency, jitter and bandwidth limits of 'profile', and
+// future-returning operations can be made to fail or time out.  Stores are passed straight through
+// to the wrapped Storage so that no data is lost, but the stored data only becomes visible to
+// subsequent reads once its simulated upload has completed.  Upload and download are modelled as
+// two independent links, each of which carries one transfer at a time.
+template <typename Storage>
+class SimulatedNetworkStore {
+ public:
+  typedef std::vector<StructuredDataVersions::VersionName> VersionNames;
+
+  SimulatedNetworkStore(std::shared_ptr<Storage> storage, const SimulatedNetworkProfile& profile);
+  ~SimulatedNetworkStore();
+
+  boost::future<ImmutableData> Get(const ImmutableData::Name& data_name);
+  void Put(const ImmutableData& data);
+  void IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names);
+  boost::future<VersionNames> GetVersions(const MutableData::Name& data_name);
+  boost::future<VersionNames> GetBranch(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& branch_tip);
+  void PutVersion(const MutableData::Name& data_name,
+                  const StructuredDataVersions::VersionName& old_version_name,
+                  const StructuredDataVersions::VersionName& new_version_name);
+  boost::future<void> CreateVersionTree(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& version_name,
+                                        uint32_t max_versions, uint32_t max_branches);
+
+ private:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+  enum class Outcome { kSuccess, kFailure, kTimeout };
+
+  struct Plan {
+    TimePoint ready;
+    Outcome outcome;
+  };
+
+  SimulatedNetworkStore(const SimulatedNetworkStore&);
+  SimulatedNetworkStore(SimulatedNetworkStore&&);
+  SimulatedNetworkStore& operator=(SimulatedNetworkStore);
+
+  // Works out when an operation issued now will complete, and whether it will succeed.  Must be
+  // called with 'mutex_' locked.  Only future-returning operations are allowed to fail.
+  Plan MakePlan(StorageOperation operation, uint64_t upload_size, uint64_t download_size,
+                bool can_fail);
+  TimePoint ReserveLink(TimePoint start, uint64_t size, uint64_t bytes_per_second,
+                        TimePoint& link_free) const;
+  // Records when a stored item becomes visible, discarding records which have already expired
+  // once there are too many of them.
+  template <typename Name>
+  void AddPending(std::map<Name, TimePoint>& pending, const Name& name, TimePoint visible) const;
+  // Ensures a read doesn't complete before the item being read has finished being stored.
+  template <typename Name>
+  void DelayUntilVisible(std::map<Name, TimePoint>& pending, const Name& name, Plan& plan) const;
+  template <typename T>
+  boost::future<T> Deliver(const Plan& plan, std::function<void(boost::promise<T>&)> complete);
+
+  std::shared_ptr<Storage> storage_;
+  const SimulatedNetworkProfile kProfile_;
+  std::mutex mutex_;
+  std::mt19937_64 generator_;
+  TimePoint upload_link_free_, download_link_free_;
+  // Times at which stored chunks and versions become visible to readers.
+  std::map<ImmutableData::Name, TimePoint> pending_chunks_;
+  std::map<MutableData::Name, TimePoint> pending_versions_;
+  std::atomic<uint64_t> injected_failures_, injected_timeouts_;
+  AsioService asio_service_;
+};
+
+// ==================== Implementation =============================================================
+template <typename Storage>
+SimulatedNetworkStore<Storage>::SimulatedNetworkStore(std::shared_ptr<Storage> storage,
+                                                      const SimulatedNetworkProfile& profile)
+    : storage_(storage),
+      kProfile_(profile),
+      mutex_(),
+      generator_(profile.seed),
+      upload_link_free_(std::chrono::steady_clock::now()),
+      download_link_free_(upload_link_free_),
+      pending_chunks_(),
+      pending_versions_(),
+      injected_failures_(0),
+      injected_timeouts_(0),
+      asio_service_(2) {
+  if (!storage_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+}
+
+template <typename Storage>
+SimulatedNetworkStore<Storage>::~SimulatedNetworkStore() {
+  asio_service_.Stop();
+  LOG(kInfo) << "Simulated network injected " << injected_failures_ << " failures and "
+             << injected_timeouts_ << " timeouts.";
+}
+
+template <typename Storage>
+boost::future<ImmutableData> SimulatedNetworkStore<Storage>::Get(
+    const ImmutableData::Name& data_name) {
+  boost::exception_ptr error;
+  std::shared_ptr<ImmutableData> data;
+  try {
+    data = std::make_shared<ImmutableData>(storage_->Get(data_name).get());
+  }
+  catch (...) {
+    error = boost::current_exception();
+  }
+
+  Plan plan;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    plan = MakePlan(StorageOperation::kGet, 0, data ? data->data().string().size() : 0, true);
+    DelayUntilVisible(pending_chunks_, data_name, plan);
+  }
+  return Deliver<ImmutableData>(plan, [data, error](boost::promise<ImmutableData>& promise) {
+    if (data)
+      promise.set_value(*data);
+    else
+      promise.set_exception(error);
+  });
+}
+
+template <typename Storage>
+void SimulatedNetworkStore<Storage>::Put(const ImmutableData& data) {
+  storage_->Put(data);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto plan(MakePlan(StorageOperation::kPut, data.data().string().size(), 0, false));
+  AddPending(pending_chunks_, data.name(), plan.ready);
+}
+
+template <typename Storage>
+void SimulatedNetworkStore<Storage>::IncrementReferenceCount(
+    const std::vector<ImmutableData::Name>& data_names) {
+  storage_->IncrementReferenceCount(data_names);
+  std::lock_guard<std::mutex> lock(mutex_);
+  MakePlan(StorageOperation::kIncrementReferenceCount,
+           data_names.size() * crypto::SHA512::DIGESTSIZE, 0, false);
+}
+
+template <typename Storage>
+boost::future<typename SimulatedNetworkStore<Storage>::VersionNames>
+    SimulatedNetworkStore<Storage>::GetVersions(const MutableData::Name& data_name) {
+  boost::exception_ptr error;
+  std::shared_ptr<VersionNames> versions;
+  try {
+    versions = std::make_shared<VersionNames>(storage_->GetVersions(data_name).get());
+  }
+  catch (...) {
+    error = boost::current_exception();
+  }
+
+  Plan plan;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    plan = MakePlan(StorageOperation::kGetVersions, 0, 0, true);
+    DelayUntilVisible(pending_versions_, data_name, plan);
+  }
+  return Deliver<VersionNames>(plan, [versions, error](boost::promise<VersionNames>& promise) {
+    if (versions)
+      promise.set_value(*versions);
+    else
+      promise.set_exception(error);
+  });
+}
+
+template <typename Storage>
+boost::future<typename SimulatedNetworkStore<Storage>::VersionNames>
+    SimulatedNetworkStore<Storage>::GetBranch(
+        const MutableData::Name& data_name,
+        const StructuredDataVersions::VersionName& branch_tip) {
+  boost::exception_ptr error;
+  std::shared_ptr<VersionNames> versions;
+  try {
+    versions = std::make_shared<VersionNames>(storage_->GetBranch(data_name, branch_tip).get());
+  }
+  catch (...) {
+    error = boost::current_exception();
+  }
+
+  Plan plan;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    plan = MakePlan(StorageOperation::kGetBranch, 0, 0, true);
+    DelayUntilVisible(pending_versions_, data_name, plan);
+  }
+  return Deliver<VersionNames>(plan, [versions, error](boost::promise<VersionNames>& promise) {
+    if (versions)
+      promise.set_value(*versions);
+    else
+      promise.set_exception(error);
+  });
+}
+
+template <typename Storage>
+void SimulatedNetworkStore<Storage>::PutVersion(
+    const MutableData::Name& data_name,
+    const StructuredDataVersions::VersionName& old_version_name,
+    const StructuredDataVersions::VersionName& new_version_name) {
+  storage_->PutVersion(data_name, old_version_name, new_version_name);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto plan(MakePlan(StorageOperation::kPutVersion, 0, 0, false));
+  AddPending(pending_versions_, data_name, plan.ready);
+}
+
+template <typename Storage>
+boost::future<void> SimulatedNetworkStore<Storage>::CreateVersionTree(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& version_name,
+    uint32_t max_versions, uint32_t max_branches) {
+  boost::exception_ptr error;
+  try {
+    storage_->CreateVersionTree(data_name, version_name, max_versions, max_branches).get();
+  }
+  catch (...) {
+    error = boost::current_exception();
+  }
+
+  Plan plan;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    plan = MakePlan(StorageOperation::kCreateVersionTree, 0, 0, true);
+    AddPending(pending_versions_, data_name, plan.ready);
+  }
+  return Deliver<void>(plan, [error](boost::promise<void>& promise) {
+    if (error)
+      promise.set_exception(error);
+    else
+      promise.set_value();
+  });
+}
+
+template <typename Storage>
+typename SimulatedNetworkStore<Storage>::Plan SimulatedNetworkStore<Storage>::MakePlan(
+    StorageOperation operation, uint64_t upload_size, uint64_t download_size, bool can_fail) {
+  auto now(std::chrono::steady_clock::now());
+  Plan plan;
+  plan.outcome = Outcome::kSuccess;
+  if (can_fail) {
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    auto roll(distribution(generator_));
+    if (roll < kProfile_.failure_probability)
+      plan.outcome = Outcome::kFailure;
+    else if (roll < kProfile_.failure_probability + kProfile_.timeout_probability)
+      plan.outcome = Outcome::kTimeout;
+  }
+  if (plan.outcome == Outcome::kTimeout) {
+    plan.ready = now + kProfile_.timeout;
+    return plan;
+  }
+
+  auto latency(kProfile_.latencies[static_cast<size_t>(operation)].Sample(generator_));
+  if (kProfile_.jitter.count() > 0) {
+    std::uniform_int_distribution<int64_t> distribution(
+        0, std::chrono::duration_cast<std::chrono::microseconds>(kProfile_.jitter).count());
+    latency += std::chrono::microseconds(distribution(generator_));
+  }
+  // Half of the round trip is spent getting the request to the network, the other half getting
+  // the response back.
+  auto request_sent(ReserveLink(now + latency / 2, upload_size,
+                                kProfile_.upload_bytes_per_second, upload_link_free_));
+  plan.ready = ReserveLink(request_sent + latency / 2, download_size,
+                           kProfile_.download_bytes_per_second, download_link_free_);
+  return plan;
+}
+
+template <typename Storage>
+typename SimulatedNetworkStore<Storage>::TimePoint SimulatedNetworkStore<Storage>::ReserveLink(
+    TimePoint start, uint64_t size, uint64_t bytes_per_second, TimePoint& link_free) const {
+  if (size == 0 || bytes_per_second == 0)
+    return start;
+  auto transfer_start(std::max(start, link_free));
+  link_free = transfer_start + std::chrono::microseconds(size * 1000000 / bytes_per_second);
+  return link_free;
+}
+
+template <typename Storage>
+template <typename Name>
+void SimulatedNetworkStore<Storage>::AddPending(std::map<Name, TimePoint>& pending,
+                                                const Name& name, TimePoint visible) const {
+  pending[name] = visible;
+  if (pending.size() < 4096)
+    return;
+  auto now(std::chrono::steady_clock::now());
+  for (auto itr(std::begin(pending)); itr != std::end(pending);) {
+    if (itr->second <= now)
+      itr = pending.erase(itr);
+    else
+      ++itr;
+  }
+}
+
+template <typename Storage>
+template <typename Name>
+void SimulatedNetworkStore<Storage>::DelayUntilVisible(std::map<Name, TimePoint>& pending,
+                                                       const Name& name, Plan& plan) const {
+  auto itr(pending.find(name));
+  if (itr == std::end(pending))
+    return;
+  plan.ready = std::max(plan.ready, itr->second);
+  if (itr->second <= std::chrono::steady_clock::now())
+    pending.erase(itr);
+}
+
+template <typename Storage>
+template <typename T>
+boost::future<T> SimulatedNetworkStore<Storage>::Deliver(
+    const Plan& plan, std::function<void(boost::promise<T>&)> complete) {
+  auto promise(std::make_shared<boost::promise<T>>());
+  auto future(promise->get_future());
+  auto timer(std::make_shared<boost::asio::steady_timer>(asio_service_.service(), plan.ready));
+  auto outcome(plan.outcome);
+  timer->async_wait([this, timer, promise, outcome, complete](
+      const boost::system::error_code& error_code) {
+    if (error_code) {
+      promise->set_exception(boost::copy_exception(MakeError(CommonErrors::unknown)));
+    } else if (outcome == Outcome::kFailure) {
+      ++injected_failures_;
+      promise->set_exception(
+          boost::copy_exception(MakeError(CommonErrors::unable_to_handle_request)));
+    } else if (outcome == Outcome::kTimeout) {
+      ++injected_timeouts_;
+      promise->set_exception(
+          boost::copy_exception(MakeError(CommonErrors::unable_to_handle_request)));
+    } else {
+      complete(*promise);
+    }
+  });
+  return future;
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_SIMULATED_NETWORK_STORE_H_
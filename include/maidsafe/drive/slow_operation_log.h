@@ -0,0 +1,205 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_SLOW_OPERATION_LOG_H_
+#define MAIDSAFE_DRIVE_SLOW_OPERATION_LOG_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace maidsafe {
+
+namespace drive {
+
+// Where an operation spent its time.  Phases can nest, e.g. the storage calls made on a directory
+// cache miss also count towards path resolution, so they needn't sum to the operation's duration.
+enum class SlowOperationPhase {
+  kPathResolution,
+  kDirectoryLock,
+  kCacheLock,
+  kStorageQueue,
+  kStorage,
+  kEncryption,
+  kStoreWait,
+  kCount
+};
+
+std::string ToString(SlowOperationPhase phase);
+
+class SlowOperationScope;
+
+// Process-wide log of the filesystem callbacks and Drive primitives which take longer than a
+// threshold.  Each slow operation is logged at kWarning with the time it spent in each
+// SlowOperationPhase and the storage calls it made, and the most recent are kept for the
+// "slow_operations" control file.
+//
+// Every OperationMetrics::ScopedRecorder is also a SlowOperationScope; the outermost one open on a
+// thread collects the breakdown.  While no threshold is set, each scope, phase timer and timed lock
+// costs a single relaxed atomic load, and while one is set, operations which don't make storage
+// calls don't allocate.  All member functions are threadsafe.
+class SlowOperationLog {
+ public:
+  // Storage calls beyond this many per operation are only counted.
+  static const size_t kMaxStorageCalls = 32;
+  static const size_t kMaxEntries = 100;
+  static const size_t kPhaseCount = static_cast<size_t>(SlowOperationPhase::kCount);
+
+  struct StorageCall {
+    StorageCall();
+    StorageCall(const char* operation_in, std::string chunk_name_in,
+                std::chrono::steady_clock::duration duration_in);
+    const char* operation;
+    // Hex prefix of the chunk name, or empty for calls not naming a single chunk.
+    std::string chunk_name;
+    std::chrono::steady_clock::duration duration;
+  };
+
+  struct Entry {
+    Entry();
+    std::string ToString() const;
+
+    // Counts the slow operations logged since the process started, from 1.
+    uint64_t number;
+    std::string operation;
+    std::chrono::steady_clock::duration duration;
+    std::array<std::chrono::steady_clock::duration, kPhaseCount> phases;
+    std::vector<StorageCall> storage_calls;
+    size_t dropped_storage_calls;
+  };
+
+  static SlowOperationLog& Instance();
+  static bool enabled() { return threshold_nanoseconds_.load(std::memory_order_relaxed) != 0; }
+
+  // A threshold of zero disables the log.
+  void SetThreshold(std::chrono::steady_clock::duration threshold);
+  std::chrono::steady_clock::duration threshold() const;
+  // Called by the outermost SlowOperationScope of an operation which exceeded the threshold.
+  void Record(Entry&& entry);
+  uint64_t slow_count() const { return slow_count_.load(std::memory_order_relaxed); }
+  // The most recent slow operations, oldest first.
+  std::vector<Entry> GetRecent() const;
+  // Human-readable list of the most recent slow operations, newest first.
+  std::string Report() const;
+  void Clear();
+
+ private:
+  SlowOperationLog();
+  SlowOperationLog(const SlowOperationLog&);
+  SlowOperationLog(SlowOperationLog&&);
+  SlowOperationLog& operator=(SlowOperationLog);
+
+  static std::atomic<int64_t> threshold_nanoseconds_;
+  std::atomic<uint64_t> slow_count_;
+  mutable std::mutex mutex_;
+  std::deque<Entry> recent_;
+};
+
+class SlowOperationScope {
+ public:
+  // 'operation' must be a string literal (or otherwise outlive the scope).
+  explicit SlowOperationScope(const char* operation) : operation_(nullptr) {
+    if (SlowOperationLog::enabled())
+      Enter(operation);
+  }
+  ~SlowOperationScope() {
+    if (operation_)
+      Exit();
+  }
+
+  // Adds 'duration' to 'phase' of the operation open on the calling thread, if any.
+  static void AddPhaseTime(SlowOperationPhase phase, std::chrono::steady_clock::duration duration);
+  // Called for each storage call made by the operation open on the calling thread, if any.
+  static void RecordStorageCall(const char* operation, const std::string& chunk_name,
+                                std::chrono::steady_clock::duration duration);
+
+ private:
+  SlowOperationScope(const SlowOperationScope&);
+  SlowOperationScope(SlowOperationScope&&);
+  SlowOperationScope& operator=(SlowOperationScope);
+
+  void Enter(const char* operation);
+  void Exit();
+
+  const char* operation_;
+  std::chrono::steady_clock::time_point start_time_;
+  std::array<std::chrono::steady_clock::duration, SlowOperationLog::kPhaseCount> phases_;
+  std::unique_ptr<std::vector<SlowOperationLog::StorageCall>> storage_calls_;
+  size_t dropped_storage_calls_;
+};
+
+// Counts the time until destruction towards 'phase' of the operation open on the calling thread.
+class SlowOperationTimer {
+ public:
+  explicit SlowOperationTimer(SlowOperationPhase phase) : kPhase_(phase), active_(false),
+                                                          start_time_() {
+    if (SlowOperationLog::enabled()) {
+      active_ = true;
+      start_time_ = std::chrono::steady_clock::now();
+    }
+  }
+  ~SlowOperationTimer() {
+    if (active_)
+      SlowOperationScope::AddPhaseTime(kPhase_, std::chrono::steady_clock::now() - start_time_);
+  }
+
+ private:
+  SlowOperationTimer(const SlowOperationTimer&);
+  SlowOperationTimer(SlowOperationTimer&&);
+  SlowOperationTimer& operator=(SlowOperationTimer);
+
+  const SlowOperationPhase kPhase_;
+  bool active_;
+  std::chrono::steady_clock::time_point start_time_;
+};
+
+// A std::mutex whose contended waits are counted towards 'phase' of the operation open on the
+// locking thread.  An uncontended lock costs the same as a std::mutex.
+class TimedMutex {
+ public:
+  explicit TimedMutex(SlowOperationPhase phase) : mutex_(), kPhase_(phase) {}
+  void lock() {
+    if (!mutex_.try_lock()) {
+      SlowOperationTimer timer(kPhase_);
+      mutex_.lock();
+    }
+  }
+  bool try_lock() { return mutex_.try_lock(); }
+  void unlock() { mutex_.unlock(); }
+
+ private:
+  TimedMutex(const TimedMutex&);
+  TimedMutex(TimedMutex&&);
+  TimedMutex& operator=(TimedMutex);
+
+  std::mutex mutex_;
+  const SlowOperationPhase kPhase_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_SLOW_OPERATION_LOG_H_
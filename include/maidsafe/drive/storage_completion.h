@@ -0,0 +1,74 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_STORAGE_COMPLETION_H_
+#define MAIDSAFE_DRIVE_STORAGE_COMPLETION_H_
+
+#include <type_traits>
+#include <vector>
+
+#include "maidsafe/common/data_types/immutable_data.h"
+#include "maidsafe/common/data_types/mutable_data.h"
+#include "maidsafe/common/data_types/structured_data_versions.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace detail {
+
+// A mutating Storage call either completes before returning (e.g. MemoryStore) or returns a future
+// through which the client reports completion (e.g. a network client).  'WaitFor' blocks until
+// 'call' has completed, rethrowing any error it reported.  Nothing is read back to check the
+// result:  that would double the traffic of every upload, and a read issued straight after an
+// asynchronous Put can fail even though the Put goes on to succeed.
+template <typename Call>
+auto WaitFor(Call call) -> typename std::enable_if<std::is_void<decltype(call())>::value>::type {
+  call();
+}
+
+template <typename Call>
+auto WaitFor(Call call) -> typename std::enable_if<!std::is_void<decltype(call())>::value>::type {
+  call().get();
+}
+
+template <typename Storage>
+void ConfirmedPut(Storage& storage, const ImmutableData& data) {
+  WaitFor([&] { return storage.Put(data); });
+}
+
+template <typename Storage>
+void ConfirmedPutVersion(Storage& storage, const MutableData::Name& data_name,
+                         const StructuredDataVersions::VersionName& old_version_name,
+                         const StructuredDataVersions::VersionName& new_version_name) {
+  WaitFor([&] { return storage.PutVersion(data_name, old_version_name, new_version_name); });
+}
+
+template <typename Storage>
+void ConfirmedIncrementReferenceCount(Storage& storage,
+                                      const std::vector<ImmutableData::Name>& data_names) {
+  WaitFor([&] { return storage.IncrementReferenceCount(data_names); });
+}
+
+}  // namespace detail
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_STORAGE_COMPLETION_H_
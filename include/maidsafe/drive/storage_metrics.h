@@ -0,0 +1,132 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_STORAGE_METRICS_H_
+#define MAIDSAFE_DRIVE_STORAGE_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace maidsafe {
+
+namespace drive {
+
+// The Storage operations used by the drive.
+enum class StorageOperation {
+  kGet,
+  kPut,
+  kIncrementReferenceCount,
+  kGetVersions,
+  kGetBranch,
+  kPutVersion,
+  kCreateVersionTree,
+  kCount
+};
+
+// The parts of the drive which issue Storage operations.
+enum class StorageCaller {
+  kFileData,
+  kDirectoryListing,
+  kVersioning,
+  kCount
+};
+
+std::string ToString(StorageOperation operation);
+std::string ToString(StorageCaller caller);
+
+// Counts, bytes and latency histograms of the Storage operations issued by the drive, kept per
+// operation type and per caller.  All member functions are threadsafe.
+class StorageMetrics {
+ public:
+  // Bucket 0 holds latencies of 0us, bucket 'i' (i > 0) holds latencies in [2^(i-1), 2^i) us and
+  // the last bucket holds everything longer.
+  static const size_t kHistogramBucketCount = 32;
+
+  struct Summary {
+    Summary();
+    double MeanMicroseconds() const;
+    // Returns the upper bound of the histogram bucket holding the given percentile (0.0 to 1.0).
+    uint64_t PercentileMicroseconds(double percentile) const;
+
+    uint64_t count, failures, bytes, total_microseconds, max_microseconds;
+    std::array<uint64_t, kHistogramBucketCount> histogram;
+  };
+
+  // Records a single operation when destroyed.  Unless 'Succeeded' has been called by then, the
+  // operation is recorded as a failure (e.g. because the Storage call threw).
+  class ScopedRecorder {
+   public:
+    ScopedRecorder(StorageMetrics& metrics, StorageOperation operation, StorageCaller caller,
+                   uint64_t bytes = 0);
+    ~ScopedRecorder();
+    void set_bytes(uint64_t bytes) { bytes_ = bytes; }
+    // Names the chunk in the slow operation log; a no-op while that's disabled.
+    void set_chunk_name(const std::string& name);
+    void Succeeded() { succeeded_ = true; }
+
+   private:
+    ScopedRecorder(const ScopedRecorder&);
+    ScopedRecorder(ScopedRecorder&&);
+    ScopedRecorder& operator=(ScopedRecorder);
+
+    StorageMetrics& metrics_;
+    const StorageOperation kOperation_;
+    const StorageCaller kCaller_;
+    const std::chrono::steady_clock::time_point kStartTime_;
+    uint64_t bytes_;
+    bool succeeded_;
+    std::string chunk_name_;
+  };
+
+  StorageMetrics();
+
+  void Record(StorageOperation operation, StorageCaller caller, uint64_t bytes,
+              std::chrono::steady_clock::duration duration, bool succeeded);
+  Summary Get(StorageOperation operation, StorageCaller caller) const;
+  // Sum over all callers of the given operation.
+  Summary Get(StorageOperation operation) const;
+  void Reset();
+  // Human-readable table of all non-empty operation/caller pairs.
+  std::string Report() const;
+
+ private:
+  StorageMetrics(const StorageMetrics&);
+  StorageMetrics(StorageMetrics&&);
+  StorageMetrics& operator=(StorageMetrics);
+
+  struct Cell {
+    Cell();
+    void AddTo(Summary& summary) const;
+    std::atomic<uint64_t> count, failures, bytes, total_microseconds, max_microseconds;
+    std::array<std::atomic<uint64_t>, kHistogramBucketCount> histogram;
+  };
+
+  static const size_t kOperationCount = static_cast<size_t>(StorageOperation::kCount);
+  static const size_t kCallerCount = static_cast<size_t>(StorageCaller::kCount);
+
+  std::array<std::array<Cell, kCallerCount>, kOperationCount> cells_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_STORAGE_METRICS_H_
@@ -0,0 +1,124 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_STORAGE_SCHEDULER_H_
+#define MAIDSAFE_DRIVE_STORAGE_SCHEDULER_H_
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "maidsafe/drive/storage_metrics.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// Orders the drive's Storage calls by priority class once more than 'max_concurrent' of them are
+// outstanding, using weighted fair queueing so that lower classes are slowed rather than starved.
+// Uploads (kDataUpload and kBackground) can additionally be capped by a token bucket.  Threadsafe.
+class StorageScheduler {
+ public:
+  enum class Priority {
+    kInteractiveRead,  // Reads which a user (or the kernel on their behalf) is waiting on.
+    kMetadataStore,    // Directory listings and versions.
+    kDataUpload,       // File content chunks.
+    kBackground,       // Prefetching and garbage collection.
+    kCount
+  };
+  static const size_t kPriorityCount = static_cast<size_t>(Priority::kCount);
+
+  // Waits for the scheduler to admit the call on construction, and frees its slot on destruction.
+  class ScopedSlot {
+   public:
+    ScopedSlot(StorageScheduler& scheduler, Priority priority, uint64_t bytes);
+    ~ScopedSlot();
+
+   private:
+    ScopedSlot(const ScopedSlot&);
+    ScopedSlot(ScopedSlot&&);
+    ScopedSlot& operator=(ScopedSlot);
+
+    StorageScheduler& scheduler_;
+  };
+
+  // 'weights' are the relative shares of a saturated storage path given to each class.
+  explicit StorageScheduler(
+      int max_concurrent = 4,
+      const std::array<uint32_t, kPriorityCount>& weights = DefaultWeights());
+
+  static std::array<uint32_t, kPriorityCount> DefaultWeights();
+  static Priority PriorityOf(StorageOperation operation, StorageCaller caller);
+
+  // Caps the rate of uploads.  'burst_bytes' defaults to one second's worth.  A rate of zero
+  // removes the cap.
+  void SetUploadRateLimit(uint64_t bytes_per_second, uint64_t burst_bytes = 0);
+  uint64_t upload_rate_limit() const;
+  size_t waiting_count() const;
+  // Sum of the 'bytes' passed by the calls which are waiting, i.e. the data they're holding.
+  uint64_t waiting_bytes() const;
+  // Number of calls currently admitted.
+  int active_count() const;
+
+  void Acquire(Priority priority, uint64_t bytes);
+  void Release();
+
+ private:
+  StorageScheduler(const StorageScheduler&);
+  StorageScheduler(StorageScheduler&&);
+  StorageScheduler& operator=(StorageScheduler);
+
+  struct Waiter {
+    Waiter(Priority priority_in, uint64_t bytes_in, double finish_tag_in)
+        : priority(priority_in), bytes(bytes_in), finish_tag(finish_tag_in), admitted(false) {}
+    Priority priority;
+    uint64_t bytes;
+    double finish_tag;
+    bool admitted;
+  };
+  typedef std::multimap<std::pair<double, uint64_t>, Waiter*> Queue;
+
+  bool IsRateLimited(Priority priority) const;
+  // All must be called with 'mutex_' locked.
+  void RefillTokens(std::chrono::steady_clock::time_point now);
+  // Admits as many waiters as possible, and returns when the next rate-limited one can go.
+  std::chrono::steady_clock::time_point Dispatch();
+
+  const int kMaxConcurrent_;
+  const std::array<uint32_t, kPriorityCount> kWeights_;
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  Queue queue_;
+  uint64_t next_sequence_number_;
+  int active_count_;
+  double virtual_time_;
+  std::array<double, kPriorityCount> last_finish_tags_;
+  uint64_t upload_bytes_per_second_, burst_bytes_;
+  double tokens_;
+  std::chrono::steady_clock::time_point last_refill_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_STORAGE_SCHEDULER_H_
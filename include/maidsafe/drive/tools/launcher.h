@@ -82,15 +82,17 @@ struct Options {
               unique_id(), root_parent_id(),
               create_store(false), check_data(false), monitor_parent(true),
               drive_type(DriveType::kNetwork),
-              drive_logging_args(), mount_status_shared_object_name(), peer_endpoint(),
+              drive_logging_args(), drive_storage_args(), mount_status_shared_object_name(),
+              peer_endpoint(),
               encrypted_maid(), symm_key(), symm_iv(), parent_handle(nullptr) {}
   boost::filesystem::path mount_path, storage_path, keys_path, drive_name;
   int key_index;
   Identity unique_id, root_parent_id;
   bool create_store, check_data, monitor_parent;
   DriveType drive_type;
-  std::string drive_logging_args, mount_status_shared_object_name, peer_endpoint,
-              encrypted_maid, symm_key, symm_iv;
+  // Both sets of args are passed to the drive process on its command line rather than via IPC.
+  std::string drive_logging_args, drive_storage_args, mount_status_shared_object_name,
+              peer_endpoint, encrypted_maid, symm_key, symm_iv;
   void* parent_handle;
 };
 
@@ -0,0 +1,140 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_TRACER_H_
+#define MAIDSAFE_DRIVE_TRACER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+#include "boost/thread/tss.hpp"
+
+#include "maidsafe/drive/allocation_tracker.h"
+
+#define MAIDSAFE_DRIVE_TRACE_CONCAT_IMPL(a, b) a##b
+#define MAIDSAFE_DRIVE_TRACE_CONCAT(a, b) MAIDSAFE_DRIVE_TRACE_CONCAT_IMPL(a, b)
+
+// Records the enclosing scope as a trace event while tracing is enabled, and attributes its
+// allocations to 'name' while allocation tracking is enabled.  'category' and 'name' must be string
+// literals (or otherwise outlive the Tracer).
+#define DRIVE_TRACE_SCOPE(category, name)                                                    \
+  maidsafe::drive::TraceScope MAIDSAFE_DRIVE_TRACE_CONCAT(drive_trace_scope_, __LINE__)( \
+      category, name)
+
+namespace maidsafe {
+
+namespace drive {
+
+// Process-wide recorder of timed scopes, written out in the Chrome trace-event format (which can be
+// loaded into chrome://tracing or the Perfetto UI).  Each thread records into its own buffer, so
+// threads only contend when tracing is started or written.  Recording is a single atomic load when
+// tracing is disabled.  All member functions are threadsafe.
+class Tracer {
+ public:
+  static const size_t kDefaultMaxEventsPerThread = 1 << 18;
+
+  static Tracer& Instance();
+
+  // Discards any previously recorded events and starts recording.  Once a thread has recorded
+  // 'max_events_per_thread', its further events are dropped (and counted).
+  void Start(size_t max_events_per_thread = kDefaultMaxEventsPerThread);
+  void Stop();
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  void Record(const char* category, const char* name,
+              std::chrono::steady_clock::time_point start,
+              std::chrono::steady_clock::time_point end);
+  size_t event_count() const;
+  size_t dropped_count() const;
+
+  std::string ToJson() const;
+  // Stops recording and writes the events to 'path'.  Returns false if the file can't be written.
+  bool StopAndWrite(const boost::filesystem::path& path);
+
+ private:
+  struct Event {
+    const char* category;
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration duration;
+  };
+
+  struct ThreadBuffer {
+    explicit ThreadBuffer(uint32_t thread_id_in)
+        : thread_id(thread_id_in), mutex(), events(), dropped_count(0) {}
+    const uint32_t thread_id;
+    std::mutex mutex;
+    std::vector<Event> events;
+    size_t dropped_count;
+  };
+
+  Tracer();
+  Tracer(const Tracer&);
+  Tracer(Tracer&&);
+  Tracer& operator=(Tracer);
+
+  ThreadBuffer& GetThreadBuffer();
+  void WriteJson(std::ostream& stream) const;
+
+  std::atomic<bool> enabled_;
+  std::atomic<size_t> max_events_per_thread_;
+  std::chrono::steady_clock::time_point origin_;
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<ThreadBuffer>> thread_buffers_;
+  // Buffers are owned by 'thread_buffers_' so that events outlive the threads which recorded them.
+  boost::thread_specific_ptr<ThreadBuffer> thread_buffer_;
+};
+
+class TraceScope {
+ public:
+  TraceScope(const char* category, const char* name)
+      : allocation_scope_(name),
+        kCategory_(category),
+        kName_(name),
+        kActive_(Tracer::Instance().enabled()),
+        kStart_(kActive_ ? std::chrono::steady_clock::now()
+                         : std::chrono::steady_clock::time_point()) {}
+  ~TraceScope() {
+    if (kActive_)
+      Tracer::Instance().Record(kCategory_, kName_, kStart_, std::chrono::steady_clock::now());
+  }
+
+ private:
+  TraceScope(const TraceScope&);
+  TraceScope(TraceScope&&);
+  TraceScope& operator=(TraceScope);
+
+  AllocationScope allocation_scope_;
+  const char* const kCategory_;
+  const char* const kName_;
+  const bool kActive_;
+  const std::chrono::steady_clock::time_point kStart_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_TRACER_H_
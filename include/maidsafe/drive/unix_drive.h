@@ -21,9 +21,11 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <utility>
@@ -165,6 +167,19 @@ class FuseDrive : public Drive<Storage> {
   static int GetAttributes(const char* path, struct stat* stbuf);
   static int Truncate(const char* path, off_t size);
 
+  // Whether 'path' is served from the virtual control directory, which is disabled if the drive's
+  // root holds an entry of the same name (see 'Drive::DisableControlFilesIfShadowed').
+  static bool IsControlPath(const fs::path& path);
+  static bool IsControlDirectory(const fs::path& path);
+  // Serve the virtual control directory (see 'ControlFiles').  The contents of a stat file are
+  // generated once when it's opened and held against 'file_info->fh' until it's released.
+  static int ControlGetAttributes(const char* path, struct stat* stbuf);
+  static int ControlOpen(const char* path, struct fuse_file_info* file_info);
+  static int ControlRead(char* buf, size_t size, off_t offset, struct fuse_file_info* file_info);
+  static int ControlWrite(const char* path, size_t size);
+  static int ControlRelease(struct fuse_file_info* file_info);
+  static int ControlReaddir(const char* path, void* buf, fuse_fill_dir_t filler);
+
   static struct fuse_operations maidsafe_ops_;
   struct fuse* fuse_;
   fuse_chan* fuse_channel_;
@@ -172,6 +187,9 @@ class FuseDrive : public Drive<Storage> {
   std::string drive_name_;
   std::once_flag mounted_once_flag_;
   std::thread unmount_ipc_waiter_;
+  std::mutex control_mutex_;
+  std::map<uint64_t, std::string> control_snapshots_;
+  uint64_t next_control_handle_;
 };
 
 const int kMaxPath(4096);
@@ -196,7 +214,11 @@ FuseDrive<Storage>::FuseDrive(std::shared_ptr<Storage> storage, const Identity&
       fuse_mountpoint_(mount_dir),
       drive_name_(drive_name.string()),
       mounted_once_flag_(),
-      unmount_ipc_waiter_() {
+      unmount_ipc_waiter_(),
+      control_mutex_(),
+      control_snapshots_(),
+      next_control_handle_(0) {
+  this->DisableControlFilesIfShadowed();
   fs::create_directory(fuse_mountpoint_);
   Init();
 }
@@ -344,6 +366,9 @@ void FuseDrive<Storage>::Unmount() {
       fuse_remove_signal_handlers(fuse_get_session(fuse_));
       fuse_unmount(fuse_mountpoint_.c_str(), fuse_channel_);
       fuse_destroy(fuse_);
+      this->DumpStorageMetrics();
+      this->DumpOperationMetrics();
+      this->StopRecordingOperations();
     });
   }
   catch (const std::exception& e) {
@@ -366,6 +391,8 @@ void FuseDrive<Storage>::Unmount() {
 // given, this method is not called.
 template <typename Storage>
 int FuseDrive<Storage>::OpsAccess(const char* /*path*/, int /* mask */) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kAccess);
   return 0;
 }
 
@@ -374,7 +401,13 @@ int FuseDrive<Storage>::OpsAccess(const char* /*path*/, int /* mask */) {
 // Change the permission bits of a file.
 template <typename Storage>
 int FuseDrive<Storage>::OpsChmod(const char* path, mode_t mode) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kChmod);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kChmod, path, 0, 0, mode);
   LOG(kInfo) << "OpsChmod: " << path << ", to " << std::oct << mode;
+  if (IsControlPath(path))
+    return record.Return(-EACCES);
   try {
     auto file_context(Global<Storage>::g_fuse_drive->GetMutableContext(path));
     file_context->meta_data.attributes.st_mode = mode;
@@ -383,9 +416,9 @@ int FuseDrive<Storage>::OpsChmod(const char* path, mode_t mode) {
   }
   catch (const std::exception& e) {
     LOG(kWarning) << "Failed to chmod " << path << ": " << e.what();
-    return -ENOENT;
+    return record.Return(-ENOENT);
   }
-  return 0;
+  return record.Return(0);
 }
 
 // Quote from FUSE documentation:
@@ -393,11 +426,17 @@ int FuseDrive<Storage>::OpsChmod(const char* path, mode_t mode) {
 // Change the owner and group of a file.
 template <typename Storage>
 int FuseDrive<Storage>::OpsChown(const char* path, uid_t uid, gid_t gid) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kChown);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kChown, path);
   LOG(kInfo) << "OpsChown: " << path;
+  if (IsControlPath(path))
+    return record.Return(-EACCES);
   bool change_uid(uid != static_cast<uid_t>(-1));
   bool change_gid(gid != static_cast<gid_t>(-1));
   if (!change_uid && !change_gid)
-    return 0;
+    return record.Return(0);
   try {
     auto file_context(Global<Storage>::g_fuse_drive->GetMutableContext(path));
     if (change_uid)
@@ -409,9 +448,9 @@ int FuseDrive<Storage>::OpsChown(const char* path, uid_t uid, gid_t gid) {
   }
   catch (const std::exception& e) {
     LOG(kWarning) << "Failed to chown " << path << ": " << e.what();
-    return -ENOENT;
+    return record.Return(-ENOENT);
   }
-  return 0;
+  return record.Return(0);
 }
 
 // Quote from FUSE documentation:
@@ -424,9 +463,15 @@ int FuseDrive<Storage>::OpsChown(const char* path, uid_t uid, gid_t gid) {
 template <typename Storage>
 int FuseDrive<Storage>::OpsCreate(const char* path, mode_t mode,
                                   struct fuse_file_info* /*file_info*/) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kCreate);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kCreate, path, 0, 0, mode);
   LOG(kInfo) << "OpsCreate: " << path << " (" << detail::GetFileType(mode) << "), mode: "
              << std::oct << mode;
-  return Global<Storage>::g_fuse_drive->CreateNew(path, mode);
+  if (IsControlPath(path))
+    return record.Return(-EACCES);
+  return record.Return(Global<Storage>::g_fuse_drive->CreateNew(path, mode));
 }
 
 // Quote from FUSE documentation:
@@ -436,6 +481,8 @@ int FuseDrive<Storage>::OpsCreate(const char* path, mode_t mode,
 // Called on filesystem exit.
 template <typename Storage>
 void FuseDrive<Storage>::OpsDestroy(void* /*fuse*/) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kDestroy);
   LOG(kInfo) << "OpsDestroy";
 }
 
@@ -450,8 +497,14 @@ void FuseDrive<Storage>::OpsDestroy(void* /*fuse*/) {
 template <typename Storage>
 int FuseDrive<Storage>::OpsFgetattr(const char* path, struct stat* stbuf,
                                     struct fuse_file_info* /*file_info*/) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kFgetattr);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kFgetattr, path);
   LOG(kInfo) << "OpsFgetattr: " << path;
-  return GetAttributes(path, stbuf);
+  if (IsControlPath(path))
+    return record.Return(ControlGetAttributes(path, stbuf));
+  return record.Return(GetAttributes(path, stbuf));
 }
 
 // Quote from FUSE documentation:
@@ -473,19 +526,26 @@ int FuseDrive<Storage>::OpsFgetattr(const char* path, struct stat* stbuf,
 // be called at all.
 template <typename Storage>
 int FuseDrive<Storage>::OpsFlush(const char* path, struct fuse_file_info* file_info) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kFlush);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kFlush, path, 0, 0, file_info->flags);
   LOG(kInfo) << "OpsFlush: " << path << ", flags: " << file_info->flags;
+  if (IsControlPath(path))
+    return record.Return(0);
   try {
     Global<Storage>::g_fuse_drive->Flush(path);
   }
   catch (const drive_error& error) {
     LOG(kError) << "OpsFlush: " << fs::path(path) << ": " << error.what();
-    return (error.code() == make_error_code(DriveErrors::no_such_file)) ? -EINVAL : -EBADF;
+    return record.Return(
+        (error.code() == make_error_code(DriveErrors::no_such_file)) ? -EINVAL : -EBADF);
   }
   catch (const std::exception& e) {
     LOG(kError) << "OpsFlush: " << fs::path(path) << ": " << e.what();
-    return -EBADF;
+    return record.Return(-EBADF);
   }
-  return 0;
+  return record.Return(0);
 }
 
 /*
@@ -558,8 +618,12 @@ int FuseDrive<Storage>::OpsFsyncDir(const char* path, int isdatasync,
 template <typename Storage>
 int FuseDrive<Storage>::OpsFtruncate(const char* path, off_t size,
                                      struct fuse_file_info* /*file_info*/) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kFtruncate);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kFtruncate, path, 0, size);
   LOG(kInfo) << "OpsFtruncate: " << path << ", size: " << size;
-  return Truncate(path, size);
+  return record.Return(Truncate(path, size));
 }
 
 // Quote from FUSE documentation:
@@ -570,8 +634,14 @@ int FuseDrive<Storage>::OpsFtruncate(const char* path, off_t size,
 // ignored except if the 'use_ino' mount option is given.
 template <typename Storage>
 int FuseDrive<Storage>::OpsGetattr(const char* path, struct stat* stbuf) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kGetattr);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kGetattr, path);
   LOG(kInfo) << "OpsGetattr: " << path;
-  return GetAttributes(path, stbuf);
+  if (IsControlPath(path))
+    return record.Return(ControlGetAttributes(path, stbuf));
+  return record.Return(GetAttributes(path, stbuf));
 }
 
 // Quote from FUSE documentation:
@@ -582,6 +652,8 @@ int FuseDrive<Storage>::OpsGetattr(const char* path, struct stat* stbuf) {
 // as a parameter to the destroy() method.
 template <typename Storage>
 void* FuseDrive<Storage>::OpsInit(struct fuse_conn_info* /*conn*/) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kInit);
   Global<Storage>::g_fuse_drive->SetMounted();
   return nullptr;
 }
@@ -635,10 +707,16 @@ int FuseDrive<Storage>::OpsLink(const char* to, const char* from) {
 // be false. To obtain the correct directory type bits use mode|S_IFDIR
 template <typename Storage>
 int FuseDrive<Storage>::OpsMkdir(const char* path, mode_t mode) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kMkdir);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kMkdir, path, 0, 0, mode);
   mode |= S_IFDIR;
   LOG(kInfo) << "OpsMkdir: " << path << " (" << detail::GetFileType(mode) << "), mode: " << std::oct
              << mode;
-  return Global<Storage>::g_fuse_drive->CreateNew(path, mode);
+  if (IsControlPath(path))
+    return record.Return(-EACCES);
+  return record.Return(Global<Storage>::g_fuse_drive->CreateNew(path, mode));
 }
 
 // Quote from FUSE documentation:
@@ -649,10 +727,16 @@ int FuseDrive<Storage>::OpsMkdir(const char* path, mode_t mode) {
 // create() method, then for regular files that will be called instead.
 template <typename Storage>
 int FuseDrive<Storage>::OpsMknod(const char* path, mode_t mode, dev_t rdev) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kMknod);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kMknod, path, 0, 0, mode);
   LOG(kInfo) << "OpsMknod: " << path << " (" << detail::GetFileType(mode) << "), mode: " << std::oct
              << mode << std::dec << ", rdev: " << rdev;
+  if (IsControlPath(path))
+    return record.Return(-EACCES);
   assert(!S_ISDIR(mode) && !detail::GetFileType(mode).empty());
-  return Global<Storage>::g_fuse_drive->CreateNew(path, mode, rdev);
+  return record.Return(Global<Storage>::g_fuse_drive->CreateNew(path, mode, rdev));
 }
 
 // Quote from FUSE documentation:
@@ -669,13 +753,19 @@ int FuseDrive<Storage>::OpsMknod(const char* path, mode_t mode, dev_t rdev) {
 // fuse_file_info structure, which will be passed to all file operations.
 template <typename Storage>
 int FuseDrive<Storage>::OpsOpen(const char* path, struct fuse_file_info* file_info) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kOpen);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kOpen, path, 0, 0, file_info->flags);
   LOG(kInfo) << "OpsOpen: " << path << ", flags: " << file_info->flags << ", keep_cache: "
              << file_info->keep_cache << ", direct_io: " << file_info->direct_io;
 
   if (file_info->flags & O_NOFOLLOW) {
     LOG(kError) << "OpsOpen: " << path << " is a symlink.";
-    return -ELOOP;
+    return record.Return(-ELOOP);
   }
+  if (IsControlPath(path))
+    return record.Return(ControlOpen(path, file_info));
 
   // TODO(Fraser#5#): 2013-11-26 - Investigate option to use direct IO for some/all files.
 
@@ -685,7 +775,7 @@ int FuseDrive<Storage>::OpsOpen(const char* path, struct fuse_file_info* file_in
   }
   catch (const std::exception& e) {
     LOG(kError) << "OpsOpen: " << fs::path(path) << ": " << e.what();
-    return -ENOENT;
+    return record.Return(-ENOENT);
   }
 
   // Safe to allow the kernel to cache the file assuming it doesn't change "spontaneously".  For us,
@@ -696,7 +786,7 @@ int FuseDrive<Storage>::OpsOpen(const char* path, struct fuse_file_info* file_in
   // See http://fuse.996288.n3.nabble.com/fuse-file-info-keep-cache-usage-guidelines-td5130.html
   file_info->keep_cache = 1;
 
-  return 0;
+  return record.Return(0);
 }
 
 // Quote from FUSE documentation:
@@ -708,20 +798,26 @@ int FuseDrive<Storage>::OpsOpen(const char* path, struct fuse_file_info* file_in
 // fuse_file_info structure, which will be passed to readdir, closedir and fsyncdir.
 template <typename Storage>
 int FuseDrive<Storage>::OpsOpendir(const char* path, struct fuse_file_info* file_info) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kOpendir);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kOpendir, path, 0, 0, file_info->flags);
   LOG(kInfo) << "OpsOpendir: " << path << ", flags: " << file_info->flags << ", keep_cache: "
              << file_info->keep_cache << ", direct_io: " << file_info->direct_io;
   if (file_info->flags & O_NOFOLLOW) {
     LOG(kError) << "OpsOpendir: " << path << " is a symlink.";
-    return -ELOOP;
+    return record.Return(-ELOOP);
   }
+  if (IsControlPath(path))
+    return record.Return(IsControlDirectory(path) ? 0 : -ENOTDIR);
   try {
     Global<Storage>::g_fuse_drive->Open(path);
   }
   catch (const std::exception& e) {
     LOG(kError) << "OpsOpen: " << fs::path(path) << ": " << e.what();
-    return -ENOENT;
+    return record.Return(-ENOENT);
   }
-  return 0;
+  return record.Return(0);
 }
 
 // Quote from FUSE documentation:
@@ -735,14 +831,22 @@ int FuseDrive<Storage>::OpsOpendir(const char* path, struct fuse_file_info* file
 template <typename Storage>
 int FuseDrive<Storage>::OpsRead(const char* path, char* buf, size_t size, off_t offset,
                                 struct fuse_file_info* file_info) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kRead);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kRead, path,
+                                         offset, size, file_info->flags);
   LOG(kInfo) << "OpsRead: " << path << ", flags: 0x" << std::hex << file_info->flags << std::dec
              << " Size : " << size << " Offset : " << offset;
+  if (IsControlPath(path))
+    return record.Return(ControlRead(buf, size, offset, file_info));
   try {
-    return static_cast<int>(Global<Storage>::g_fuse_drive->Read(path, buf, size, offset));
+    return record.Return(
+        static_cast<int>(Global<Storage>::g_fuse_drive->Read(path, buf, size, offset)));
   }
   catch (const std::exception& e) {
     LOG(kWarning) << "Failed to read " << path << ": " << e.what();
-    return -EINVAL;
+    return record.Return(-EINVAL);
   }
 }
 
@@ -762,7 +866,13 @@ int FuseDrive<Storage>::OpsRead(const char* path, char* buf, size_t size, off_t
 template <typename Storage>
 int FuseDrive<Storage>::OpsReaddir(const char* path, void* buf, fuse_fill_dir_t filler,
                                    off_t offset, struct fuse_file_info* /*file_info*/) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kReaddir);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kReaddir, path, offset);
   LOG(kInfo) << "OpsReaddir: " << path << "; offset = " << offset;
+  if (IsControlPath(path))
+    return record.Return(ControlReaddir(path, buf, filler));
 
   filler(buf, ".", nullptr, 0);
   filler(buf, "..", nullptr, 0);
@@ -772,7 +882,7 @@ int FuseDrive<Storage>::OpsReaddir(const char* path, void* buf, fuse_fill_dir_t
   }
   catch (const std::exception& e) {
     LOG(kError) << "OpsReaddir: " << path << ", can't get directory: " << e.what();
-    return -EBADF;
+    return record.Return(-EBADF);
   }
   assert(directory);
 
@@ -791,7 +901,7 @@ int FuseDrive<Storage>::OpsReaddir(const char* path, void* buf, fuse_fill_dir_t
 //    file_context->content_changed = true;
 //    time(&file_context->meta_data->attributes.st_atime);
 //  }
-  return 0;
+  return record.Return(0);
 }
 
 /*
@@ -836,15 +946,21 @@ int FuseDrive<Storage>::OpsReadlink(const char* path, char* buf, size_t size) {
 // is ignored.
 template <typename Storage>
 int FuseDrive<Storage>::OpsRelease(const char* path, struct fuse_file_info* file_info) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kRelease);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kRelease, path, 0, 0, file_info->flags);
   LOG(kInfo) << "OpsRelease: " << path << ", flags: " << file_info->flags;
+  if (IsControlPath(path))
+    return record.Return(ControlRelease(file_info));
   try {
     Global<Storage>::g_fuse_drive->Release(path);
   }
   catch (const std::exception& e) {
     LOG(kError) << "OpsRelease: " << path << ": " << e.what();
-    return -EBADF;
+    return record.Return(-EBADF);
   }
-  return 0;
+  return record.Return(0);
 }
 
 // Quote from FUSE documentation:
@@ -852,15 +968,21 @@ int FuseDrive<Storage>::OpsRelease(const char* path, struct fuse_file_info* file
 // Release directory.
 template <typename Storage>
 int FuseDrive<Storage>::OpsReleasedir(const char* path, struct fuse_file_info* file_info) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kReleasedir);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kReleasedir, path, 0, 0, file_info->flags);
   LOG(kInfo) << "OpsReleasedir: " << path << ", flags: " << file_info->flags;
+  if (IsControlPath(path))
+    return record.Return(0);
   try {
     Global<Storage>::g_fuse_drive->ReleaseDir(path);
   }
   catch (const std::exception& e) {
     LOG(kError) << "OpsReleasedir: " << path << ": " << e.what();
-    return -EBADF;
+    return record.Return(-EBADF);
   }
-  return 0;
+  return record.Return(0);
 }
 
 // Quote from FUSE documentation:
@@ -868,7 +990,13 @@ int FuseDrive<Storage>::OpsReleasedir(const char* path, struct fuse_file_info* f
 // Rename a file.
 template <typename Storage>
 int FuseDrive<Storage>::OpsRename(const char* old_name, const char* new_name) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kRename);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kRename, old_name, new_name);
   LOG(kInfo) << "OpsRename: " << old_name << " to " << new_name;
+  if (IsControlPath(old_name) || IsControlPath(new_name))
+    return record.Return(-EACCES);
   try {
     Global<Storage>::g_fuse_drive->Rename(old_name, new_name);
   }
@@ -885,9 +1013,9 @@ int FuseDrive<Storage>::OpsRename(const char* old_name, const char* new_name) {
     //       default:
     //         return -EIO;
     //     }
-    return -EIO;
+    return record.Return(-EIO);
   }
-  return 0;
+  return record.Return(0);
 }
 
 // Quote from FUSE documentation:
@@ -895,14 +1023,20 @@ int FuseDrive<Storage>::OpsRename(const char* old_name, const char* new_name) {
 // Remove a directory.
 template <typename Storage>
 int FuseDrive<Storage>::OpsRmdir(const char* path) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kRmdir);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kRmdir, path);
   LOG(kInfo) << "OpsRmdir: " << path;
+  if (IsControlPath(path))
+    return record.Return(-EACCES);
   try {
     Global<Storage>::g_fuse_drive->Delete(path);
   }
   catch (const std::exception&) {
-    return -EIO;
+    return record.Return(-EIO);
   }
-  return 0;
+  return record.Return(0);
 }
 
 // Quote from FUSE documentation:
@@ -912,6 +1046,10 @@ int FuseDrive<Storage>::OpsRmdir(const char* path) {
 // The 'f_frsize', 'f_favail', 'f_fsid' and 'f_flag' fields are ignored.
 template <typename Storage>
 int FuseDrive<Storage>::OpsStatfs(const char* path, struct statvfs* stbuf) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kStatfs);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kStatfs, path);
   LOG(kInfo) << "OpsStatfs: " << path;
 
   stbuf->f_bsize = 4096;
@@ -924,7 +1062,7 @@ int FuseDrive<Storage>::OpsStatfs(const char* path, struct statvfs* stbuf) {
   stbuf->f_ffree = 0;    // # free inodes
   stbuf->f_namemax = 0;  // maximum filename length
   */
-  return 0;
+  return record.Return(0);
 }
 
 /*
@@ -962,8 +1100,12 @@ int FuseDrive<Storage>::OpsSymlink(const char* to, const char* from) {
 // Change the size of a file.
 template <typename Storage>
 int FuseDrive<Storage>::OpsTruncate(const char* path, off_t size) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kTruncate);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kTruncate, path, 0, size);
   LOG(kInfo) << "OpsTruncate: " << path << ", size: " << size;
-  return Truncate(path, size);
+  return record.Return(Truncate(path, size));
 }
 
 // Quote from FUSE documentation:
@@ -971,14 +1113,20 @@ int FuseDrive<Storage>::OpsTruncate(const char* path, off_t size) {
 // Remove a file.
 template <typename Storage>
 int FuseDrive<Storage>::OpsUnlink(const char* path) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kUnlink);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kUnlink, path);
   LOG(kInfo) << "OpsUnlink: " << path;
+  if (IsControlPath(path))
+    return record.Return(-EACCES);
   try {
     Global<Storage>::g_fuse_drive->Delete(path);
   }
   catch (const std::exception&) {
-    return -EIO;
+    return record.Return(-EIO);
   }
-  return 0;
+  return record.Return(0);
 }
 
 // Quote from FUSE documentation:
@@ -989,14 +1137,20 @@ int FuseDrive<Storage>::OpsUnlink(const char* path) {
 // utimensat(2) man page for details.
 template <typename Storage>
 int FuseDrive<Storage>::OpsUtimens(const char* path, const struct timespec ts[2]) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kUtimens);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kUtimens, path);
   LOG(kInfo) << "OpsUtimens: " << path;
+  if (IsControlPath(path))
+    return record.Return(-EACCES);
   detail::FileContext* file_context(nullptr);
   try {
     file_context = Global<Storage>::g_fuse_drive->GetMutableContext(path);
   }
   catch (const std::exception& e) {
     LOG(kWarning) << "Failed to change times for " << path << ": " << e.what();
-    return -ENOENT;
+    return record.Return(-ENOENT);
   }
 
   timespec tspec;
@@ -1024,7 +1178,7 @@ int FuseDrive<Storage>::OpsUtimens(const char* path, const struct timespec ts[2]
     st_mtim = tspec;
   }
   file_context->parent->ScheduleForStoring();
-  return 0;
+  return record.Return(0);
 }
 
 // Quote from FUSE documentation:
@@ -1036,15 +1190,23 @@ int FuseDrive<Storage>::OpsUtimens(const char* path, const struct timespec ts[2]
 template <typename Storage>
 int FuseDrive<Storage>::OpsWrite(const char* path, const char* buf, size_t size, off_t offset,
                                  struct fuse_file_info* file_info) {
+  OperationMetrics::ScopedRecorder recorder(Global<Storage>::g_fuse_drive->operation_metrics_,
+                                            DriveOperation::kWrite);
+  OperationRecorder::ScopedRecord record(Global<Storage>::g_fuse_drive->operation_recorder_,
+                                         DriveOperation::kWrite, path,
+                                         offset, size, file_info->flags);
   LOG(kInfo) << "OpsWrite: " << path << ", flags: 0x" << std::hex << file_info->flags << std::dec
              << " Size : " << size << " Offset : " << offset;
+  if (IsControlPath(path))
+    return record.Return(ControlWrite(path, size));
 
   try {
-    return static_cast<int>(Global<Storage>::g_fuse_drive->Write(path, buf, size, offset));
+    return record.Return(
+        static_cast<int>(Global<Storage>::g_fuse_drive->Write(path, buf, size, offset)));
   }
   catch (const std::exception& e) {
     LOG(kWarning) << "Failed to write " << path << ": " << e.what();
-    return -EINVAL;
+    return record.Return(-EINVAL);
   }
 }
 
@@ -1162,10 +1324,15 @@ int FuseDrive<Storage>::GetAttributes(const char* path, struct stat* stbuf) {
 
 template <typename Storage>
 int FuseDrive<Storage>::Truncate(const char* path, off_t size) {
+  // Shells truncate control files before writing to them, e.g. 'echo 1 > /.drive/flush'.
+  if (IsControlPath(path))
+    return Global<Storage>::g_fuse_drive->control_files_.IsControlFile(path) ? 0 : -EACCES;
   try {
     auto file_context(Global<Storage>::g_fuse_drive->GetMutableContext(path));
     assert(file_context->self_encryptor);
     file_context->self_encryptor->Truncate(size);
+    if (file_context->content_hasher)
+      file_context->content_hasher->Truncate(size);
     file_context->meta_data.attributes.st_size = size;
     time(&file_context->meta_data.attributes.st_mtime);
     file_context->meta_data.attributes.st_ctime = file_context->meta_data.attributes.st_atime =
@@ -1179,6 +1346,116 @@ int FuseDrive<Storage>::Truncate(const char* path, off_t size) {
   return 0;
 }
 
+template <typename Storage>
+bool FuseDrive<Storage>::IsControlPath(const fs::path& path) {
+  return Global<Storage>::g_fuse_drive->control_files_.IsControlPath(path);
+}
+
+template <typename Storage>
+bool FuseDrive<Storage>::IsControlDirectory(const fs::path& path) {
+  return Global<Storage>::g_fuse_drive->control_files_.IsControlDirectory(path);
+}
+
+template <typename Storage>
+int FuseDrive<Storage>::ControlGetAttributes(const char* path, struct stat* stbuf) {
+  const auto& control_files(Global<Storage>::g_fuse_drive->control_files_);
+  std::memset(stbuf, 0, sizeof(*stbuf));
+  if (IsControlDirectory(path)) {
+    stbuf->st_mode = S_IFDIR | 0555;
+    stbuf->st_nlink = 2;
+  } else if (control_files.IsStatFile(path)) {
+    // The size is left at 0 since the contents are only generated on open; the files are opened
+    // with 'direct_io' so reads aren't limited by it.
+    stbuf->st_mode = S_IFREG | 0444;
+    stbuf->st_nlink = 1;
+  } else if (control_files.IsControlFile(path)) {
+    stbuf->st_mode = S_IFREG | 0200;
+    stbuf->st_nlink = 1;
+  } else {
+    return -ENOENT;
+  }
+  stbuf->st_uid = fuse_get_context()->uid;
+  stbuf->st_gid = fuse_get_context()->gid;
+  time(&stbuf->st_mtime);
+  stbuf->st_atime = stbuf->st_ctime = stbuf->st_mtime;
+  return 0;
+}
+
+template <typename Storage>
+int FuseDrive<Storage>::ControlOpen(const char* path, struct fuse_file_info* file_info) {
+  auto drive(Global<Storage>::g_fuse_drive);
+  std::string snapshot;
+  if (drive->control_files_.IsStatFile(path)) {
+    if ((file_info->flags & O_ACCMODE) != O_RDONLY)
+      return -EACCES;
+    try {
+      snapshot = drive->control_files_.Generate(path);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "ControlOpen: " << path << ": " << e.what();
+      return -EIO;
+    }
+  } else if (drive->control_files_.IsControlFile(path)) {
+    if ((file_info->flags & O_ACCMODE) != O_WRONLY)
+      return -EACCES;
+  } else {
+    return IsControlDirectory(path) ? -EISDIR : -ENOENT;
+  }
+  std::lock_guard<std::mutex> lock(drive->control_mutex_);
+  file_info->fh = ++drive->next_control_handle_;
+  file_info->direct_io = 1;
+  drive->control_snapshots_[file_info->fh] = std::move(snapshot);
+  return 0;
+}
+
+template <typename Storage>
+int FuseDrive<Storage>::ControlRead(char* buf, size_t size, off_t offset,
+                                    struct fuse_file_info* file_info) {
+  auto drive(Global<Storage>::g_fuse_drive);
+  std::lock_guard<std::mutex> lock(drive->control_mutex_);
+  auto itr(drive->control_snapshots_.find(file_info->fh));
+  if (itr == std::end(drive->control_snapshots_))
+    return -EBADF;
+  if (offset < 0 || static_cast<uint64_t>(offset) >= itr->second.size())
+    return 0;
+  size = std::min(size, itr->second.size() - static_cast<size_t>(offset));
+  std::memcpy(buf, itr->second.data() + offset, size);
+  return static_cast<int>(size);
+}
+
+template <typename Storage>
+int FuseDrive<Storage>::ControlWrite(const char* path, size_t size) {
+  try {
+    Global<Storage>::g_fuse_drive->control_files_.Trigger(path);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "ControlWrite: " << path << ": " << e.what();
+    return -EIO;
+  }
+  return static_cast<int>(size);
+}
+
+template <typename Storage>
+int FuseDrive<Storage>::ControlRelease(struct fuse_file_info* file_info) {
+  auto drive(Global<Storage>::g_fuse_drive);
+  std::lock_guard<std::mutex> lock(drive->control_mutex_);
+  drive->control_snapshots_.erase(file_info->fh);
+  return 0;
+}
+
+template <typename Storage>
+int FuseDrive<Storage>::ControlReaddir(const char* path, void* buf, fuse_fill_dir_t filler) {
+  if (!IsControlDirectory(path))
+    return -ENOTDIR;
+  filler(buf, ".", nullptr, 0);
+  filler(buf, "..", nullptr, 0);
+  for (const auto& name : Global<Storage>::g_fuse_drive->control_files_.Names()) {
+    if (filler(buf, name.c_str(), nullptr, 0))
+      break;
+  }
+  return 0;
+}
+
 }  // namespace drive
 
 }  // namespace maidsafe
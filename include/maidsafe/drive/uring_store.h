@@ -0,0 +1,141 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_URING_STORE_H_
+#define MAIDSAFE_DRIVE_URING_STORE_H_
+
+#ifdef MAIDSAFE_DRIVE_LIBURING
+
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+#include "boost/thread/future.hpp"
+
+#include "maidsafe/common/data_stores/local_store.h"
+#include "maidsafe/common/data_types/immutable_data.h"
+#include "maidsafe/common/data_types/mutable_data.h"
+#include "maidsafe/common/data_types/structured_data_versions.h"
+
+struct io_uring;
+
+namespace maidsafe {
+
+namespace drive {
+
+// A local Storage which holds each chunk in its own file, like data_stores::LocalStore, but which
+// performs the chunk reads, writes and fsyncs through io_uring.  A single I/O thread gathers
+// queued requests into batches of up to 'queue_depth' operations and submits each batch with one
+// system call.  Puts return as soon as they're queued; the chunk is served from memory until its
+// write and fsync have completed.  A write which fails is retried, backing off up to
+// 'kMaxRetryDelay' between attempts, and its chunk is held in memory until it succeeds; writes are
+// only abandoned (and logged) if they fail while the store is being destroyed.  Chunks are
+// checked against their names when read, so a chunk torn by a crash mid-write is treated as
+// missing.  A read which fails for any other reason, e.g. running out of file descriptors, leaves
+// the chunk indexed.
+//
+// Version trees are small and rarely written, so version operations are passed to
+// 'version_store'.  The drive never deletes chunks, so reference counts aren't tracked.
+class UringStore {
+ public:
+  typedef std::vector<StructuredDataVersions::VersionName> VersionNames;
+
+  UringStore(const boost::filesystem::path& chunk_dir, unsigned queue_depth,
+             std::shared_ptr<data_stores::LocalStore> version_store);
+  // Blocks until all queued writes have completed.
+  ~UringStore();
+
+  // The returned future throws CommonErrors::no_such_element if 'data_name' isn't held.
+  boost::future<ImmutableData> Get(const ImmutableData::Name& data_name);
+  void Put(const ImmutableData& data);
+  void IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names);
+  boost::future<VersionNames> GetVersions(const MutableData::Name& data_name);
+  boost::future<VersionNames> GetBranch(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& branch_tip);
+  void PutVersion(const MutableData::Name& data_name,
+                  const StructuredDataVersions::VersionName& old_version_name,
+                  const StructuredDataVersions::VersionName& new_version_name);
+  boost::future<void> CreateVersionTree(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& version_name,
+                                        uint32_t max_versions, uint32_t max_branches);
+
+  // Blocks until every Put made so far is durable, including while failed writes are retried.
+  void Flush();
+  // Number of io_uring submissions made and operations completed; the ratio is the mean batch size.
+  uint64_t submission_count() const;
+  uint64_t operation_count() const;
+
+ private:
+  struct Request;
+
+  UringStore(const UringStore&);
+  UringStore(UringStore&&);
+  UringStore& operator=(UringStore);
+
+  boost::filesystem::path ChunkPath(const ImmutableData::Name& data_name) const;
+  void LoadIndex();
+  void Enqueue(std::shared_ptr<Request> request);
+  void Run();
+  // Opens the request's file and queues its operations on the ring.  Returns the number of
+  // submission queue entries used, or 0 if the request failed before reaching the ring.
+  unsigned Prepare(Request& request);
+  void Complete(Request& request, int result);
+  void Finish(Request& request, bool succeeded);
+  // Must be called with 'mutex_' locked.
+  void ScheduleRetry(const Request& request);
+
+  static const std::chrono::steady_clock::duration kMinRetryDelay, kMaxRetryDelay;
+
+  const boost::filesystem::path kChunkDir_;
+  const unsigned kQueueDepth_;
+  std::shared_ptr<data_stores::LocalStore> version_store_;
+  std::unique_ptr<io_uring> ring_;
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<std::shared_ptr<Request>> queue_;
+  // Failed writes, requeued together once 'retry_time_' is reached.
+  std::deque<std::shared_ptr<Request>> retries_;
+  std::chrono::steady_clock::time_point retry_time_;
+  std::chrono::steady_clock::duration retry_delay_;
+  // Chunks which are being written or waiting to be retried, and chunks known to be on disk.
+  std::map<ImmutableData::Name, std::shared_ptr<const std::string>> pending_writes_;
+  std::set<ImmutableData::Name> stored_;
+  // Chunk subdirectories with entries added since the last Flush.
+  std::set<std::string> dirty_dirs_;
+  unsigned in_flight_;
+  bool stopping_;
+  uint64_t submission_count_, operation_count_;
+  std::thread io_thread_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_LIBURING
+
+#endif  // MAIDSAFE_DRIVE_URING_STORE_H_
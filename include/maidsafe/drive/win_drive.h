@@ -43,6 +43,7 @@
 
 #include "maidsafe/drive/drive.h"
 #include "maidsafe/drive/directory_handler.h"
+#include "maidsafe/drive/tracer.h"
 #include "maidsafe/drive/utils.h"
 
 namespace maidsafe {
@@ -280,6 +281,8 @@ void CbfsDrive<Storage>::Unmount() {
         // Only one instance of this lambda function can be run simultaneously.  If any CBFS
         // function throws, the unmounted_once_flag_ remains unset and another attempt can be made.
         UnmountDrive(std::chrono::seconds(3));
+        DumpStorageMetrics();
+        DumpOperationMetrics();
         if (callback_filesystem_.StoragePresent())
           callback_filesystem_.DeleteStorage();
         callback_filesystem_.SetRegistrationKey(nullptr);
@@ -565,6 +568,7 @@ void CbfsDrive<Storage>::CbFsCreateFile(CallbackFileSystem* sender, LPCTSTR file
                                         CbFsFileInfo* /*file_info*/,
                                         CbFsHandleInfo* /*handle_info*/) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsCreateFile");
   boost::filesystem::path relative_path(file_name);
   LOG(kInfo) << "CbFsCreateFile - " << relative_path << " 0x" << std::hex << file_attributes;
 
@@ -620,6 +624,7 @@ void CbfsDrive<Storage>::CbFsOpenFile(CallbackFileSystem* sender, LPCWSTR file_n
                                       CbFsFileInfo* /*file_info*/,
                                       CbFsHandleInfo* /*handle_info*/) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsOpenFile");
   LOG(kInfo) << "CbFsOpenFile - " << boost::filesystem::path(file_name);
   try {
     detail::GetDrive<Storage>(sender)->Open(file_name);
@@ -648,6 +653,7 @@ template <typename Storage>
 void CbfsDrive<Storage>::CbFsCloseFile(CallbackFileSystem* sender, CbFsFileInfo* file_info,
                                        CbFsHandleInfo* /*handle_info*/) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsCloseFile");
   auto cbfs_drive(detail::GetDrive<Storage>(sender));
   auto relative_path(detail::GetRelativePath<Storage>(cbfs_drive, file_info));
   LOG(kInfo) << "CbFsCloseFile - " << relative_path;
@@ -695,6 +701,7 @@ void CbfsDrive<Storage>::CbFsGetFileInfo(
     LPWSTR /*short_file_name*/ OPTIONAL, PWORD /*short_file_name_length*/ OPTIONAL,
     LPWSTR real_file_name OPTIONAL, LPWORD real_file_name_length OPTIONAL) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsGetFileInfo");
   boost::filesystem::path relative_path(file_name);
   LOG(kInfo) << "CbFsGetFileInfo - " << relative_path;
   const detail::FileContext* file_context(nullptr);
@@ -771,6 +778,7 @@ void CbfsDrive<Storage>::CbFsEnumerateDirectory(
     int64_t* end_of_file, int64_t* allocation_size, int64_t* /*file_id*/ OPTIONAL,
     PDWORD file_attributes) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsEnumerateDirectory");
   auto cbfs_drive(detail::GetDrive<Storage>(sender));
   auto relative_path(detail::GetRelativePath<Storage>(cbfs_drive, directory_info));
   std::wstring mask_str(mask);
@@ -850,6 +858,7 @@ template <typename Storage>
 void CbfsDrive<Storage>::CbFsSetAllocationSize(CallbackFileSystem* sender, CbFsFileInfo* file_info,
                                                int64_t allocation_size) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsSetAllocationSize");
   auto cbfs_drive(detail::GetDrive<Storage>(sender));
   auto relative_path(detail::GetRelativePath<Storage>(cbfs_drive, file_info));
   LOG(kInfo) << "CbFsSetAllocationSize - " << relative_path << " to " << allocation_size
@@ -881,6 +890,7 @@ template <typename Storage>
 void CbfsDrive<Storage>::CbFsSetEndOfFile(CallbackFileSystem* sender, CbFsFileInfo* file_info,
                                           int64_t end_of_file) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsSetEndOfFile");
   auto cbfs_drive(detail::GetDrive<Storage>(sender));
   auto relative_path(detail::GetRelativePath<Storage>(cbfs_drive, file_info));
   LOG(kInfo) << "CbFsSetEndOfFile - " << relative_path << " to " << end_of_file << " bytes.";
@@ -888,6 +898,8 @@ void CbfsDrive<Storage>::CbFsSetEndOfFile(CallbackFileSystem* sender, CbFsFileIn
     auto file_context(cbfs_drive->GetMutableContext(relative_path));
     assert(file_context->self_encryptor);
     file_context->self_encryptor->Truncate(end_of_file);
+    if (file_context->content_hasher)
+      file_context->content_hasher->Truncate(end_of_file);
     file_context->meta_data.end_of_file = end_of_file;
     file_context->parent->ScheduleForStoring();
   }
@@ -920,6 +932,7 @@ void CbfsDrive<Storage>::CbFsSetFileAttributes(
     PFILETIME creation_time, PFILETIME last_access_time, PFILETIME last_write_time,
     DWORD file_attributes) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsSetFileAttributes");
   auto cbfs_drive(detail::GetDrive<Storage>(sender));
   auto relative_path(detail::GetRelativePath<Storage>(cbfs_drive, file_info));
   LOG(kInfo) << "CbFsSetFileAttributes- " << relative_path << " 0x" << std::hex << file_attributes;
@@ -952,6 +965,7 @@ void CbfsDrive<Storage>::CbFsCanFileBeDeleted(CallbackFileSystem* /*sender*/,
                                               CbFsHandleInfo* /*handle_info*/,
                                               LPBOOL can_be_deleted) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsCanFileBeDeleted");
   // auto cbfs_drive(detail::GetDrive<Storage>(sender));
   // auto relative_path(detail::GetRelativePath<Storage>(cbfs_drive, file_info));
   LOG(kInfo) << "CbFsCanFileBeDeleted - ";  //  << relative_path;
@@ -966,6 +980,7 @@ void CbfsDrive<Storage>::CbFsCanFileBeDeleted(CallbackFileSystem* /*sender*/,
 template <typename Storage>
 void CbfsDrive<Storage>::CbFsDeleteFile(CallbackFileSystem* sender, CbFsFileInfo* file_info) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsDeleteFile");
   auto cbfs_drive(detail::GetDrive<Storage>(sender));
   auto relative_path(detail::GetRelativePath<Storage>(cbfs_drive, file_info));
   LOG(kInfo) << "CbFsDeleteFile - " << relative_path;
@@ -984,6 +999,7 @@ template <typename Storage>
 void CbfsDrive<Storage>::CbFsRenameOrMoveFile(CallbackFileSystem* sender, CbFsFileInfo* file_info,
                                               LPCTSTR new_file_name) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsRenameOrMoveFile");
   auto cbfs_drive(detail::GetDrive<Storage>(sender));
   auto old_relative_path(detail::GetRelativePath<Storage>(cbfs_drive, file_info));
   boost::filesystem::path new_relative_path(new_file_name);
@@ -1009,6 +1025,7 @@ void CbfsDrive<Storage>::CbFsReadFile(CallbackFileSystem* sender, CbFsFileInfo*
                                       int64_t position, PVOID buffer, DWORD bytes_to_read,
                                       PDWORD bytes_read) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsReadFile");
   auto cbfs_drive(detail::GetDrive<Storage>(sender));
   auto relative_path(detail::GetRelativePath<Storage>(cbfs_drive, file_info));
   try {
@@ -1034,6 +1051,7 @@ void CbfsDrive<Storage>::CbFsWriteFile(CallbackFileSystem* sender, CbFsFileInfo*
                                        int64_t position, PVOID buffer, DWORD bytes_to_write,
                                        PDWORD bytes_written) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsWriteFile");
   auto cbfs_drive(detail::GetDrive<Storage>(sender));
   auto relative_path(detail::GetRelativePath<Storage>(cbfs_drive, file_info));
   LOG(kInfo) << "CbFsWriteFile- " << relative_path << " writing " << bytes_to_write
@@ -1058,6 +1076,7 @@ void CbfsDrive<Storage>::CbFsIsDirectoryEmpty(CallbackFileSystem* sender,
                                               CbFsFileInfo* /*directory_info*/, LPCWSTR file_name,
                                               LPBOOL is_empty) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsIsDirectoryEmpty");
   LOG(kInfo) << "CbFsIsDirectoryEmpty - " << boost::filesystem::path(file_name);
   try {
     auto cbfs_drive(detail::GetDrive<Storage>(sender));
@@ -1077,6 +1096,7 @@ void CbfsDrive<Storage>::CbFsIsDirectoryEmpty(CallbackFileSystem* sender,
 template <typename Storage>
 void CbfsDrive<Storage>::CbFsFlushFile(CallbackFileSystem* sender, CbFsFileInfo* file_info) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("cbfs", "CbfsDrive::CbFsFlushFile");
   auto cbfs_drive(detail::GetDrive<Storage>(sender));
   if (!file_info) {
     LOG(kInfo) << "CbFsFlushFile - All files";
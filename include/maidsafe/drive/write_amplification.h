@@ -0,0 +1,93 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_WRITE_AMPLIFICATION_H_
+#define MAIDSAFE_DRIVE_WRITE_AMPLIFICATION_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/drive/control_files.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// Counts what the drive sends to storage against the file content written by applications.  Each
+// Directory keeps one for the files it holds and the storing of its own listing, and passes
+// everything it records on to the DirectoryHandler's total.  All member functions are threadsafe.
+class WriteAmplification {
+ public:
+  struct Counters {
+    Counters();
+    // Data chunk bytes put per application byte written.
+    double DataRatio() const;
+    // Directory listing bytes put per application byte written.
+    double ListingRatio() const;
+    // All bytes put per application byte written.
+    double TotalRatio() const;
+    uint64_t StorageBytes() const { return data_bytes_put + listing_bytes_put; }
+
+    uint64_t application_bytes, data_bytes_put, data_chunks_put, listing_bytes_put,
+        listing_chunks_put, version_operations, refcount_operations, refcount_increments;
+  };
+
+  explicit WriteAmplification(WriteAmplification* total = nullptr);
+
+  void RecordApplicationWrite(uint64_t bytes);
+  void RecordDataPut(uint64_t bytes);
+  // Listing chunks include the encrypted data map of the listing.
+  void RecordListingPut(uint64_t bytes);
+  void RecordVersionOperation();
+  // A single IncrementReferenceCount call covering 'chunk_count' chunks.
+  void RecordReferenceCountIncrement(uint64_t chunk_count);
+  Counters Get() const;
+  // Doesn't reset the total.
+  void Reset();
+
+ private:
+  WriteAmplification(const WriteAmplification&);
+  WriteAmplification(WriteAmplification&&);
+  WriteAmplification& operator=(WriteAmplification);
+
+  WriteAmplification* const total_;
+  std::atomic<uint64_t> application_bytes_, data_bytes_put_, data_chunks_put_,
+      listing_bytes_put_, listing_chunks_put_, version_operations_, refcount_operations_,
+      refcount_increments_;
+};
+
+// The totals as "write_amplification_ratio{kind=...}" and "write_amplification_*_total"
+// statistics.
+std::vector<Statistic> ToStatistics(const WriteAmplification::Counters& counters);
+
+// A table of the totals followed by 'top', as served by the "write_amplification" control file.
+std::string FormatWriteAmplification(
+    const WriteAmplification::Counters& totals,
+    const std::vector<std::pair<boost::filesystem::path, WriteAmplification::Counters>>& top);
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_WRITE_AMPLIFICATION_H_
@@ -0,0 +1,127 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_WRITE_BACK_JOURNAL_H_
+#define MAIDSAFE_DRIVE_WRITE_BACK_JOURNAL_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/data_types/immutable_data.h"
+#include "maidsafe/common/data_types/mutable_data.h"
+#include "maidsafe/common/data_types/structured_data_versions.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// A crash-safe, append-only log of the mutating Storage operations which haven't yet reached
+// storage.  Each record is checksummed and synced to disk before 'Append' returns.  Records are
+// committed strictly in the order they were appended; the committed offset is persisted
+// separately.  The log is split into segment files of about 'max_segment_size' bytes, each named
+// after the offset of its first record, and a segment is deleted once all of its records have been
+// committed, so the log's size on disk follows the uncommitted bytes even if it never drains.  On
+// construction, any uncommitted records are recovered, and a torn record at the tail (from a crash
+// mid-append) is discarded.  Thread-safe.
+class WriteBackJournal {
+ public:
+  struct Record {
+    enum class Type : uint8_t {
+      kPut = 1,
+      kIncrementReferenceCount,
+      kPutVersion,
+      kCreateVersionTree
+    };
+
+    Record();
+    static Record Put(const ImmutableData& data);
+    static Record IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names);
+    static Record PutVersion(const MutableData::Name& data_name,
+                             const StructuredDataVersions::VersionName& old_version_name,
+                             const StructuredDataVersions::VersionName& new_version_name);
+    static Record CreateVersionTree(const MutableData::Name& data_name,
+                                    const StructuredDataVersions::VersionName& version_name,
+                                    uint32_t max_versions, uint32_t max_branches);
+
+    Type type;
+    // kPut.  Recovered records don't hold 'content'; it can be read back with 'ReadContent'.
+    std::string content;
+    ImmutableData::Name chunk_name;  // kPut; not stored, as it's derived from 'content'.
+    std::vector<ImmutableData::Name> data_names;  // kIncrementReferenceCount
+    std::string version_tree_name;  // kPutVersion, kCreateVersionTree
+    StructuredDataVersions::VersionName old_version_name, new_version_name;
+    uint32_t max_versions, max_branches;  // kCreateVersionTree
+    uint64_t offset, size_on_disk;  // Set by 'Append' and recovery.
+  };
+
+  static const uint64_t kDefaultMaxSegmentSize = 64 * 1024 * 1024;
+
+  explicit WriteBackJournal(const boost::filesystem::path& journal_dir,
+                            uint64_t max_segment_size = kDefaultMaxSegmentSize);
+  ~WriteBackJournal();
+
+  // Records which were appended but not committed by a previous instance, oldest first.  Only
+  // returns them on the first call.
+  std::deque<Record> TakeRecoveredRecords();
+  // Throws if the record can't be written and synced.  Sets 'record.size_on_disk'.
+  void Append(Record& record);
+  // Marks the oldest uncommitted record as done.  The committed offset is synced to disk before
+  // returning, so the record won't be replayed after a crash.  Throws if that fails.
+  void CommitOldest(const Record& record);
+  // Reads the content of an uncommitted kPut record back from the log.  Throws if the record has
+  // been committed since.
+  std::string ReadContent(const Record& record) const;
+  uint64_t uncommitted_bytes() const;
+
+ private:
+  WriteBackJournal(const WriteBackJournal&);
+  WriteBackJournal(WriteBackJournal&&);
+  WriteBackJournal& operator=(WriteBackJournal);
+
+  boost::filesystem::path SegmentPath(uint64_t segment_start) const;
+  void Recover();
+  // Reads the records of the segment starting at 'segment_start' from 'committed_offset_' (or its
+  // start) onwards.  Returns false if the segment ends with a torn or corrupt record, having
+  // truncated it.
+  bool RecoverSegment(uint64_t segment_start);
+  void OpenLogForAppending();
+  void StartNewSegment();
+  void RemoveCommittedSegments();
+  void WriteCommittedOffset();
+
+  const boost::filesystem::path kJournalDir_, kCommittedOffsetPath_;
+  const uint64_t kMaxSegmentSize_;
+  mutable std::mutex mutex_;
+  // 'log_' is the newest segment, which is the one appended to.
+  std::FILE* log_;
+  std::deque<uint64_t> segment_starts_;
+  uint64_t committed_offset_, end_offset_;
+  std::deque<Record> recovered_records_;
+};
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_WRITE_BACK_JOURNAL_H_
@@ -0,0 +1,488 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_WRITE_BACK_STORE_H_
+#define MAIDSAFE_DRIVE_WRITE_BACK_STORE_H_
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "boost/thread/future.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/data_types/immutable_data.h"
+#include "maidsafe/common/data_types/mutable_data.h"
+#include "maidsafe/common/data_types/structured_data_versions.h"
+
+#include "maidsafe/drive/storage_completion.h"
+#include "maidsafe/drive/storage_scheduler.h"
+#include "maidsafe/drive/write_back_journal.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+// Completes Put, IncrementReferenceCount, PutVersion and CreateVersionTree as soon as they've been
+// recorded in a WriteBackJournal, and replays them to 'storage' in order on a background thread.
+// A record is only committed once 'storage' has completed the operation: calls returning a future
+// are waited on, so 'storage' must not return from a void call until it's done (DeduplicatingStore
+// waits for the network client to report completion).  Failed operations are retried with
+// exponential backoff capped at 'max_backoff', and are never dropped, so a network outage only
+// delays the replay.  Records left over from a crash are replayed on construction.
+//
+// Chunks are read back from the journal file until they've been replayed, so only their names are
+// held in memory.  GetVersions and GetBranch for a version tree with unreplayed changes are
+// answered from the journalled records, so they don't wait for 'storage' (e.g. while loading the
+// root directory after a crash during an outage).  Only the part of a branch older than the
+// journalled changes is fetched from 'storage', and if that fails the journalled part is returned
+// alone.
+//
+// Replayed operations are the ones which actually reach 'storage', so if 'scheduler' is non-null
+// each one waits for a slot from it first; that's where upload rate limits should be applied.
+//
+// Once the journal holds 'max_uncommitted_bytes' (e.g. during a long outage), further mutating
+// calls block until the replay catches up.  If 'journal' is null, every call is passed through.
+template <typename Storage>
+class WriteBackStore {
+ public:
+  typedef std::vector<StructuredDataVersions::VersionName> VersionNames;
+
+  WriteBackStore(std::shared_ptr<Storage> storage, std::shared_ptr<WriteBackJournal> journal,
+                 std::shared_ptr<StorageScheduler> scheduler = nullptr,
+                 uint64_t max_uncommitted_bytes = 512 * 1024 * 1024,
+                 const std::chrono::steady_clock::duration& max_backoff = std::chrono::seconds(64));
+  // Allows a few seconds for outstanding records to be replayed.  Any left after that stay in the
+  // journal for the next instance.
+  ~WriteBackStore();
+
+  boost::future<ImmutableData> Get(const ImmutableData::Name& data_name);
+  void Put(const ImmutableData& data);
+  void IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names);
+  boost::future<VersionNames> GetVersions(const MutableData::Name& data_name);
+  boost::future<VersionNames> GetBranch(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& branch_tip);
+  void PutVersion(const MutableData::Name& data_name,
+                  const StructuredDataVersions::VersionName& old_version_name,
+                  const StructuredDataVersions::VersionName& new_version_name);
+  boost::future<void> CreateVersionTree(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& version_name,
+                                        uint32_t max_versions, uint32_t max_branches);
+
+  // Blocks until every journalled operation has been replayed or 'timeout' expires.  Returns true
+  // if nothing remains to be replayed.
+  bool Flush(const std::chrono::steady_clock::duration& timeout);
+  size_t pending_count() const;
+
+ private:
+  typedef WriteBackJournal::Record Record;
+
+  WriteBackStore(const WriteBackStore&);
+  WriteBackStore(WriteBackStore&&);
+  WriteBackStore& operator=(WriteBackStore);
+
+  void Enqueue(Record&& record);
+  // Must be called with 'mutex_' locked.
+  void Index(const Record& record);
+  void Unindex(const Record& record);
+  // Copies of the unreplayed kPutVersion and kCreateVersionTree records for 'data_name', oldest
+  // first.
+  std::vector<Record> PendingVersionRecords(const MutableData::Name& data_name) const;
+  void Apply(const Record& record);
+  void Replay();
+
+  std::shared_ptr<Storage> storage_;
+  std::shared_ptr<WriteBackJournal> journal_;
+  std::shared_ptr<StorageScheduler> scheduler_;
+  const uint64_t kMaxUncommittedBytes_;
+  const std::chrono::steady_clock::duration kMaxBackoff_;
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  // Elements of a deque aren't moved by push_back or pop_front, so the indices can point into it.
+  // kPut records don't hold their content once it's in the journal.
+  std::deque<Record> pending_;
+  std::map<ImmutableData::Name, std::pair<const Record*, int>> pending_chunks_;
+  std::map<std::string, int> pending_version_trees_;
+  bool stopping_;
+  uint64_t replayed_count_, retry_count_;
+  std::thread replay_thread_;
+};
+
+// ==================== Implementation =============================================================
+template <typename Storage>
+WriteBackStore<Storage>::WriteBackStore(std::shared_ptr<Storage> storage,
+                                        std::shared_ptr<WriteBackJournal> journal,
+                                        std::shared_ptr<StorageScheduler> scheduler,
+                                        uint64_t max_uncommitted_bytes,
+                                        const std::chrono::steady_clock::duration& max_backoff)
+    : storage_(storage),
+      journal_(journal),
+      scheduler_(scheduler),
+      kMaxUncommittedBytes_(max_uncommitted_bytes),
+      kMaxBackoff_(max_backoff),
+      mutex_(),
+      condition_(),
+      pending_(),
+      pending_chunks_(),
+      pending_version_trees_(),
+      stopping_(false),
+      replayed_count_(0),
+      retry_count_(0),
+      replay_thread_() {
+  if (!storage_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+  if (!journal_)
+    return;
+  pending_ = journal_->TakeRecoveredRecords();
+  for (const auto& record : pending_)
+    Index(record);
+  replay_thread_ = std::thread([this] { Replay(); });
+}
+
+template <typename Storage>
+WriteBackStore<Storage>::~WriteBackStore() {
+  if (!journal_)
+    return;
+  Flush(std::chrono::seconds(10));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+  replay_thread_.join();
+  LOG(kInfo) << "Write-back journal replayed " << replayed_count_ << " operations (" << retry_count_
+             << " retries); " << pending_.size() << " left for the next mount.";
+}
+
+template <typename Storage>
+boost::future<ImmutableData> WriteBackStore<Storage>::Get(const ImmutableData::Name& data_name) {
+  if (journal_) {
+    Record record;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto itr(pending_chunks_.find(data_name));
+      if (itr != std::end(pending_chunks_))
+        record = *itr->second.first;
+    }
+    if (record.size_on_disk != 0) {
+      try {
+        boost::promise<ImmutableData> promise;
+        promise.set_value(ImmutableData(NonEmptyString(journal_->ReadContent(record))));
+        return promise.get_future();
+      }
+      catch (const std::exception&) {
+        // The record was replayed and committed meanwhile, so 'storage' now holds the chunk.
+      }
+    }
+  }
+  return storage_->Get(data_name);
+}
+
+template <typename Storage>
+void WriteBackStore<Storage>::Put(const ImmutableData& data) {
+  if (!journal_) {
+    storage_->Put(data);
+    return;
+  }
+  Enqueue(Record::Put(data));
+}
+
+template <typename Storage>
+void WriteBackStore<Storage>::IncrementReferenceCount(
+    const std::vector<ImmutableData::Name>& data_names) {
+  if (!journal_) {
+    storage_->IncrementReferenceCount(data_names);
+    return;
+  }
+  Enqueue(Record::IncrementReferenceCount(data_names));
+}
+
+template <typename Storage>
+boost::future<typename WriteBackStore<Storage>::VersionNames> WriteBackStore<Storage>::GetVersions(
+    const MutableData::Name& data_name) {
+  if (journal_) {
+    auto records(PendingVersionRecords(data_name));
+    if (!records.empty()) {
+      // Tips which only exist in 'storage' can't be known without asking it, but the drive keeps a
+      // single branch, whose tip is then the newest journalled version.
+      VersionNames tips;
+      for (const auto& record : records) {
+        if (record.type == Record::Type::kCreateVersionTree)
+          tips.clear();
+        else
+          tips.erase(std::remove(std::begin(tips), std::end(tips), record.old_version_name),
+                     std::end(tips));
+        tips.insert(std::begin(tips), record.new_version_name);
+      }
+      boost::promise<VersionNames> promise;
+      promise.set_value(tips);
+      return promise.get_future();
+    }
+  }
+  return storage_->GetVersions(data_name);
+}
+
+template <typename Storage>
+boost::future<typename WriteBackStore<Storage>::VersionNames> WriteBackStore<Storage>::GetBranch(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& branch_tip) {
+  if (journal_) {
+    auto records(PendingVersionRecords(data_name));
+    VersionNames branch;
+    auto version(branch_tip);
+    bool reached_root(false);
+    for (auto itr(records.rbegin()); itr != records.rend() && !reached_root; ++itr) {
+      if (!(itr->new_version_name == version))
+        continue;
+      branch.push_back(version);
+      reached_root = (itr->type == Record::Type::kCreateVersionTree);
+      version = itr->old_version_name;
+    }
+    if (!branch.empty()) {
+      if (!reached_root) {
+        try {
+          auto older(storage_->GetBranch(data_name, version).get());
+          branch.insert(std::end(branch), std::begin(older), std::end(older));
+        }
+        catch (const std::exception& e) {
+          LOG(kWarning) << "Returning only the journalled part of a version branch: " << e.what();
+        }
+      }
+      boost::promise<VersionNames> promise;
+      promise.set_value(branch);
+      return promise.get_future();
+    }
+  }
+  return storage_->GetBranch(data_name, branch_tip);
+}
+
+template <typename Storage>
+void WriteBackStore<Storage>::PutVersion(
+    const MutableData::Name& data_name,
+    const StructuredDataVersions::VersionName& old_version_name,
+    const StructuredDataVersions::VersionName& new_version_name) {
+  if (!journal_) {
+    storage_->PutVersion(data_name, old_version_name, new_version_name);
+    return;
+  }
+  Enqueue(Record::PutVersion(data_name, old_version_name, new_version_name));
+}
+
+template <typename Storage>
+boost::future<void> WriteBackStore<Storage>::CreateVersionTree(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& version_name,
+    uint32_t max_versions, uint32_t max_branches) {
+  if (!journal_)
+    return storage_->CreateVersionTree(data_name, version_name, max_versions, max_branches);
+  boost::promise<void> promise;
+  try {
+    Enqueue(Record::CreateVersionTree(data_name, version_name, max_versions, max_branches));
+    promise.set_value();
+  }
+  catch (...) {
+    promise.set_exception(boost::current_exception());
+  }
+  return promise.get_future();
+}
+
+template <typename Storage>
+bool WriteBackStore<Storage>::Flush(const std::chrono::steady_clock::duration& timeout) {
+  if (!journal_)
+    return true;
+  std::unique_lock<std::mutex> lock(mutex_);
+  return condition_.wait_for(lock, timeout, [&] { return pending_.empty(); });
+}
+
+template <typename Storage>
+size_t WriteBackStore<Storage>::pending_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_.size();
+}
+
+template <typename Storage>
+void WriteBackStore<Storage>::Enqueue(Record&& record) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (journal_->uncommitted_bytes() >= kMaxUncommittedBytes_) {
+    LOG(kWarning) << "Write-back journal is full (" << pending_.size() << " operations awaiting "
+                  << "replay); blocking until storage catches up.";
+    condition_.wait(lock, [&] {
+      return stopping_ || journal_->uncommitted_bytes() < kMaxUncommittedBytes_;
+    });
+  }
+  // Appending under 'mutex_' keeps 'pending_' in the same order as the journal.
+  journal_->Append(record);
+  std::string().swap(record.content);
+  pending_.push_back(std::move(record));
+  Index(pending_.back());
+  lock.unlock();
+  condition_.notify_all();
+}
+
+template <typename Storage>
+void WriteBackStore<Storage>::Index(const Record& record) {
+  if (record.type == Record::Type::kPut) {
+    auto& entry(pending_chunks_[record.chunk_name]);
+    entry.first = &record;
+    ++entry.second;
+  } else if (record.type == Record::Type::kPutVersion ||
+             record.type == Record::Type::kCreateVersionTree) {
+    ++pending_version_trees_[record.version_tree_name];
+  }
+}
+
+template <typename Storage>
+void WriteBackStore<Storage>::Unindex(const Record& record) {
+  if (record.type == Record::Type::kPut) {
+    auto itr(pending_chunks_.find(record.chunk_name));
+    assert(itr != std::end(pending_chunks_));
+    // 'itr->second.first' always points to the newest record, so stays valid unless this is it.
+    if (--itr->second.second == 0)
+      pending_chunks_.erase(itr);
+  } else if (record.type == Record::Type::kPutVersion ||
+             record.type == Record::Type::kCreateVersionTree) {
+    auto itr(pending_version_trees_.find(record.version_tree_name));
+    assert(itr != std::end(pending_version_trees_));
+    if (--itr->second == 0)
+      pending_version_trees_.erase(itr);
+  }
+}
+
+template <typename Storage>
+std::vector<typename WriteBackStore<Storage>::Record>
+    WriteBackStore<Storage>::PendingVersionRecords(const MutableData::Name& data_name) const {
+  std::vector<Record> records;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (pending_version_trees_.count(data_name->string()) == 0)
+    return records;
+  for (const auto& record : pending_) {
+    if ((record.type == Record::Type::kPutVersion ||
+         record.type == Record::Type::kCreateVersionTree) &&
+        record.version_tree_name == data_name->string()) {
+      records.push_back(record);
+    }
+  }
+  return records;
+}
+
+template <typename Storage>
+void WriteBackStore<Storage>::Apply(const Record& record) {
+  std::unique_ptr<StorageScheduler::ScopedSlot> slot;
+  if (scheduler_) {
+    bool is_upload(record.type == Record::Type::kPut ||
+                   record.type == Record::Type::kIncrementReferenceCount);
+    slot.reset(new StorageScheduler::ScopedSlot(*scheduler_,
+        is_upload ? StorageScheduler::Priority::kDataUpload
+                  : StorageScheduler::Priority::kMetadataStore,
+        record.type == Record::Type::kPut ? record.size_on_disk : 0));
+  }
+  switch (record.type) {
+    case Record::Type::kPut: {
+      ImmutableData data(NonEmptyString(journal_->ReadContent(record)));
+      detail::WaitFor([&] { return storage_->Put(data); });
+      break;
+    }
+    case Record::Type::kIncrementReferenceCount:
+      detail::WaitFor([&] { return storage_->IncrementReferenceCount(record.data_names); });
+      break;
+    case Record::Type::kPutVersion:
+      detail::WaitFor([&] {
+        return storage_->PutVersion(MutableData::Name(Identity(record.version_tree_name)),
+                                    record.old_version_name, record.new_version_name);
+      });
+      break;
+    case Record::Type::kCreateVersionTree:
+      detail::WaitFor([&] {
+        return storage_->CreateVersionTree(MutableData::Name(Identity(record.version_tree_name)),
+                                           record.new_version_name, record.max_versions,
+                                           record.max_branches);
+      });
+      break;
+    default:
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+}
+
+template <typename Storage>
+void WriteBackStore<Storage>::Replay() {
+  const std::chrono::steady_clock::duration kInitialBackoff(
+      std::min<std::chrono::steady_clock::duration>(std::chrono::seconds(1), kMaxBackoff_));
+  auto backoff(kInitialBackoff);
+  int attempts(0);
+  for (;;) {
+    const Record* record(nullptr);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [&] { return stopping_ || !pending_.empty(); });
+      if (stopping_)
+        return;
+      // Only this thread removes records, so 'record' stays valid while the lock is released.
+      record = &pending_.front();
+    }
+
+    try {
+      Apply(*record);
+    }
+    catch (const std::exception& e) {
+      // Never drop the operation: later ones may depend on it, and the journal is the only copy.
+      ++attempts;
+      LOG(kWarning) << "Failed to replay journalled operation (attempt " << attempts << "): "
+                    << e.what() << ".  Retrying in "
+                    << std::chrono::duration_cast<std::chrono::milliseconds>(backoff).count()
+                    << "ms.";
+      std::unique_lock<std::mutex> lock(mutex_);
+      ++retry_count_;
+      condition_.wait_for(lock, backoff, [&] { return stopping_; });
+      backoff = std::min(backoff * 2, kMaxBackoff_);
+      continue;
+    }
+    attempts = 0;
+    backoff = kInitialBackoff;
+
+    try {
+      journal_->CommitOldest(*record);
+    }
+    catch (const std::exception& e) {
+      // The operation will be replayed again by the next instance, which is harmless.
+      LOG(kError) << "Failed to commit journalled operation: " << e.what();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Unindex(*record);
+      pending_.pop_front();
+      ++replayed_count_;
+    }
+    condition_.notify_all();
+  }
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_WRITE_BACK_STORE_H_
@@ -0,0 +1,83 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <cstdlib>
+#include <new>
+
+#include "maidsafe/common/config.h"
+
+#include "maidsafe/drive/allocation_tracker.h"
+
+// Replacements for the global allocation functions which feed the AllocationTracker.  This file is
+// built once as its own object library, which the benchmarks always link and the drive library
+// only includes when configured with DRIVE_ALLOCATION_TRACKING.  The tracker is only touched once
+// it has been started, so these are safe to call before static initialisation has reached it.
+
+namespace {
+
+// Lets AllocationTracker::hooked() report that these replacements are linked in.
+const bool kHooked((maidsafe::drive::AllocationTracker::SetHooked(), true));
+
+}  // unnamed namespace
+
+void* operator new(std::size_t size) {
+  if (maidsafe::drive::AllocationTracker::enabled())
+    maidsafe::drive::AllocationTracker::Instance().RecordAllocation(size);
+  for (;;) {
+    if (void* memory = std::malloc(size == 0 ? 1 : size))
+      return memory;
+    std::new_handler handler(std::get_new_handler());
+    if (!handler)
+      throw std::bad_alloc();
+    handler();
+  }
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) MAIDSAFE_NOEXCEPT {
+  try {
+    return operator new(size);
+  }
+  catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) MAIDSAFE_NOEXCEPT {
+  return operator new(size, std::nothrow);
+}
+
+void operator delete(void* memory) MAIDSAFE_NOEXCEPT { std::free(memory); }
+
+void operator delete[](void* memory) MAIDSAFE_NOEXCEPT { std::free(memory); }
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* memory, std::size_t) MAIDSAFE_NOEXCEPT { std::free(memory); }
+
+void operator delete[](void* memory, std::size_t) MAIDSAFE_NOEXCEPT { std::free(memory); }
+#endif
+
+void operator delete(void* memory, const std::nothrow_t&) MAIDSAFE_NOEXCEPT {
+  std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) MAIDSAFE_NOEXCEPT {
+  std::free(memory);
+}
+
@@ -0,0 +1,214 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/allocation_tracker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+// Thread-local storage which needs no construction, so that it's safe to use from operator new.
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define MAIDSAFE_DRIVE_THREAD_LOCAL __declspec(thread)
+#else
+#define MAIDSAFE_DRIVE_THREAD_LOCAL thread_local
+#endif
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+MAIDSAFE_DRIVE_THREAD_LOCAL AllocationScope* t_current_scope = nullptr;
+MAIDSAFE_DRIVE_THREAD_LOCAL uint64_t t_allocation_count = 0;
+MAIDSAFE_DRIVE_THREAD_LOCAL uint64_t t_allocated_bytes = 0;
+
+// FNV-1a, over the name's text since equal literals in different translation units needn't share
+// an address.
+size_t Hash(const char* name) {
+  uint32_t hash(2166136261U);
+  for (; *name != '\0'; ++name)
+    hash = (hash ^ static_cast<unsigned char>(*name)) * 16777619U;
+  return hash;
+}
+
+void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+  counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t Load(const std::atomic<uint64_t>& counter) {
+  return counter.load(std::memory_order_relaxed);
+}
+
+}  // unnamed namespace
+
+std::atomic<bool> AllocationTracker::enabled_(false);
+std::atomic<bool> AllocationTracker::hooked_(false);
+
+AllocationTracker::Site::Site()
+    : name(), calls(0), self_count(0), self_bytes(0), total_count(0), total_bytes(0) {}
+
+double AllocationTracker::Site::AllocationsPerCall() const {
+  return calls == 0 ? 0.0 : static_cast<double>(total_count) / calls;
+}
+
+double AllocationTracker::Site::BytesPerCall() const {
+  return calls == 0 ? 0.0 : static_cast<double>(total_bytes) / calls;
+}
+
+AllocationTracker::Entry::Entry()
+    : name(nullptr), calls(0), self_count(0), self_bytes(0), total_count(0), total_bytes(0) {}
+
+void AllocationTracker::Entry::Reset() {
+  calls = 0;
+  self_count = 0;
+  self_bytes = 0;
+  total_count = 0;
+  total_bytes = 0;
+}
+
+AllocationTracker& AllocationTracker::Instance() {
+  // Never destroyed, so that threads still running during static destruction can safely allocate.
+  static AllocationTracker* const tracker(new AllocationTracker);
+  return *tracker;
+}
+
+void AllocationTracker::SetHooked() { hooked_.store(true); }
+
+uint64_t AllocationTracker::thread_allocation_count() { return t_allocation_count; }
+
+uint64_t AllocationTracker::thread_allocated_bytes() { return t_allocated_bytes; }
+
+AllocationTracker::AllocationTracker()
+    : entries_(), unscoped_(), other_(), total_count_(0), total_bytes_(0) {
+  unscoped_.name = "(unscoped)";
+  other_.name = "(other)";
+}
+
+void AllocationTracker::Start() {
+  enabled_ = false;
+  for (auto& entry : entries_)
+    entry.Reset();
+  unscoped_.Reset();
+  other_.Reset();
+  total_count_ = 0;
+  total_bytes_ = 0;
+  enabled_ = true;
+}
+
+void AllocationTracker::Stop() { enabled_ = false; }
+
+void AllocationTracker::RecordAllocation(size_t size) {
+  if (!enabled())
+    return;
+  ++t_allocation_count;
+  t_allocated_bytes += size;
+  Add(total_count_, 1);
+  Add(total_bytes_, size);
+  AllocationScope* scope(t_current_scope);
+  Entry& innermost(scope ? *scope->entry_ : unscoped_);
+  Add(innermost.self_count, 1);
+  Add(innermost.self_bytes, size);
+  if (!scope) {
+    Add(unscoped_.total_count, 1);
+    Add(unscoped_.total_bytes, size);
+  }
+  for (; scope; scope = scope->parent_) {
+    Add(scope->entry_->total_count, 1);
+    Add(scope->entry_->total_bytes, size);
+  }
+}
+
+AllocationTracker::Entry& AllocationTracker::GetEntry(const char* name) {
+  const size_t kStart(Hash(name) % kMaxSites);
+  for (size_t probe(0); probe != kMaxSites; ++probe) {
+    Entry& entry(entries_[(kStart + probe) % kMaxSites]);
+    const char* existing(entry.name.load(std::memory_order_acquire));
+    if (!existing && entry.name.compare_exchange_strong(existing, name))
+      return entry;
+    if (existing == name || std::strcmp(existing, name) == 0)
+      return entry;
+  }
+  return other_;
+}
+
+std::vector<AllocationTracker::Site> AllocationTracker::GetSites() const {
+  std::vector<Site> sites;
+  auto add([&sites](const Entry& entry) {
+    const char* name(entry.name.load(std::memory_order_acquire));
+    if (!name || (Load(entry.calls) == 0 && Load(entry.self_count) == 0))
+      return;
+    Site site;
+    site.name = name;
+    site.calls = Load(entry.calls);
+    site.self_count = Load(entry.self_count);
+    site.self_bytes = Load(entry.self_bytes);
+    site.total_count = Load(entry.total_count);
+    site.total_bytes = Load(entry.total_bytes);
+    sites.push_back(site);
+  });
+  for (const auto& entry : entries_)
+    add(entry);
+  add(unscoped_);
+  add(other_);
+  std::sort(std::begin(sites), std::end(sites), [](const Site& lhs, const Site& rhs) {
+    return lhs.self_bytes != rhs.self_bytes ? lhs.self_bytes > rhs.self_bytes
+                                            : lhs.self_count > rhs.self_count;
+  });
+  return sites;
+}
+
+std::string AllocationTracker::Report(size_t site_count) const {
+  std::ostringstream stream;
+  if (!hooked()) {
+    stream << "Allocation tracking isn't built in (configure with DRIVE_ALLOCATION_TRACKING).\n";
+    return stream.str();
+  }
+  auto sites(GetSites());
+  stream << "Allocations: " << total_count() << " (" << total_bytes() << " bytes), "
+         << (enabled() ? "tracking" : "stopped") << "\n\n"
+         << std::left << std::setw(40) << "Site" << std::right << std::setw(12) << "Calls"
+         << std::setw(14) << "Self allocs" << std::setw(16) << "Self bytes" << std::setw(14)
+         << "Allocs/call" << std::setw(14) << "Bytes/call" << '\n';
+  for (size_t i(0); i != std::min(site_count, sites.size()); ++i) {
+    const Site& site(sites[i]);
+    stream << std::left << std::setw(40) << site.name << std::right << std::setw(12)
+           << site.calls << std::setw(14) << site.self_count << std::setw(16) << site.self_bytes
+           << std::fixed << std::setprecision(1) << std::setw(14) << site.AllocationsPerCall()
+           << std::setw(14) << site.BytesPerCall() << '\n';
+  }
+  return stream.str();
+}
+
+void AllocationScope::Enter(const char* name) {
+  entry_ = &AllocationTracker::Instance().GetEntry(name);
+  Add(entry_->calls, 1);
+  parent_ = t_current_scope;
+  t_current_scope = this;
+}
+
+void AllocationScope::Exit() {
+  if (t_current_scope == this)
+    t_current_scope = parent_;
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
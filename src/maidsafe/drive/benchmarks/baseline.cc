@@ -0,0 +1,308 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/benchmarks/baseline.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "maidsafe/common/error.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace benchmark {
+
+namespace {
+
+// Parses the single-line JSON objects which the benchmarks write: string and number members, and
+// nested objects of the same.
+class JsonLine {
+ public:
+  explicit JsonLine(const std::string& line) : kLine_(line), position_(0) {}
+
+  void Parse(std::map<std::string, std::string>& strings, std::map<std::string, double>& numbers) {
+    ParseObject("", strings, numbers);
+    SkipSpace();
+    if (position_ != kLine_.size())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+
+ private:
+  JsonLine(const JsonLine&);
+  JsonLine& operator=(const JsonLine&);
+
+  void ParseObject(const std::string& prefix, std::map<std::string, std::string>& strings,
+                   std::map<std::string, double>& numbers) {
+    Expect('{');
+    SkipSpace();
+    if (Peek() == '}') {
+      ++position_;
+      return;
+    }
+    for (;;) {
+      SkipSpace();
+      std::string name(prefix + ParseString());
+      Expect(':');
+      SkipSpace();
+      if (Peek() == '"')
+        strings[name] = ParseString();
+      else if (Peek() == '{')
+        ParseObject(name + '.', strings, numbers);
+      else
+        numbers[name] = ParseNumber();
+      SkipSpace();
+      if (Peek() != ',')
+        break;
+      ++position_;
+    }
+    Expect('}');
+  }
+
+  std::string ParseString() {
+    Expect('"');
+    std::string value;
+    while (Peek() != '"') {
+      if (Peek() == '\\')
+        ++position_;
+      value += Peek();
+      ++position_;
+    }
+    ++position_;
+    return value;
+  }
+
+  double ParseNumber() {
+    const char* start(kLine_.c_str() + position_);
+    char* end(nullptr);
+    double value(std::strtod(start, &end));
+    if (end == start)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    position_ += end - start;
+    return value;
+  }
+
+  char Peek() const {
+    if (position_ >= kLine_.size())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    return kLine_[position_];
+  }
+
+  void Expect(char expected) {
+    SkipSpace();
+    if (Peek() != expected)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    ++position_;
+  }
+
+  void SkipSpace() {
+    while (position_ < kLine_.size() && std::isspace(static_cast<unsigned char>(kLine_[position_])))
+      ++position_;
+  }
+
+  const std::string kLine_;
+  size_t position_;
+};
+
+std::string ResultKey(const std::map<std::string, std::string>& strings,
+                      const std::map<std::string, double>& numbers) {
+  auto string([&](const char* name) -> const std::string& {
+    auto itr(strings.find(name));
+    if (itr == std::end(strings))
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    return itr->second;
+  });
+  auto integer([&](const char* name) {
+    auto itr(numbers.find(name));
+    if (itr == std::end(numbers))
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    return std::to_string(static_cast<uint64_t>(itr->second));
+  });
+  if (strings.count("benchmark"))
+    return string("benchmark") + '/' + string("variant");
+  return string("target") + '/' + string("workload") + '/' + integer("block_size") + '/' +
+         integer("threads");
+}
+
+double ToDouble(const std::string& text) {
+  char* end(nullptr);
+  double value(std::strtod(text.c_str(), &end));
+  if (text.empty() || *end != '\0')
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  return value;
+}
+
+bool IsEntry(const std::string& line) {
+  auto first(line.find_first_not_of(" \t\r"));
+  return first != std::string::npos && line[first] != '#';
+}
+
+// Splits an entry into its five fields, the last being the tolerance as written.
+std::vector<std::string> Fields(const std::string& line) {
+  std::istringstream stream(line);
+  std::vector<std::string> fields;
+  std::string field;
+  while (stream >> field)
+    fields.push_back(field);
+  if (fields.size() != 5)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  return fields;
+}
+
+Expectation ToExpectation(const std::vector<std::string>& fields) {
+  Expectation expectation;
+  expectation.key = fields[0];
+  expectation.metric = fields[1];
+  if (fields[2] == "higher")
+    expectation.higher_is_better = true;
+  else if (fields[2] == "lower")
+    expectation.higher_is_better = false;
+  else
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  expectation.value = ToDouble(fields[3]);
+  std::string tolerance(fields[4]);
+  bool is_percentage(!tolerance.empty() && tolerance.back() == '%');
+  if (is_percentage)
+    tolerance.pop_back();
+  expectation.tolerance = ToDouble(tolerance) / (is_percentage ? 100.0 : 1.0);
+  if (expectation.value <= 0.0 || expectation.tolerance < 0.0)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  return expectation;
+}
+
+const double* FindMeasurement(const Measurements& measurements, const std::string& key,
+                              const std::string& metric) {
+  auto result_itr(measurements.find(key));
+  if (result_itr == std::end(measurements))
+    return nullptr;
+  auto metric_itr(result_itr->second.find(metric));
+  return metric_itr == std::end(result_itr->second) ? nullptr : &metric_itr->second;
+}
+
+std::string Format(double value) {
+  std::ostringstream stream;
+  if (value >= 1000.0)
+    stream << std::fixed << std::setprecision(0);
+  else
+    stream << std::setprecision(4);
+  stream << value;
+  return stream.str();
+}
+
+}  // unnamed namespace
+
+Expectation::Expectation()
+    : key(), metric(), higher_is_better(true), value(0.0), tolerance(0.0) {}
+
+Measurements ParseMeasurements(std::istream& json_lines) {
+  Measurements measurements;
+  std::string line;
+  while (std::getline(json_lines, line)) {
+    if (!IsEntry(line))
+      continue;
+    std::map<std::string, std::string> strings;
+    std::map<std::string, double> numbers;
+    JsonLine(line).Parse(strings, numbers);
+    measurements[ResultKey(strings, numbers)] = numbers;
+  }
+  return measurements;
+}
+
+std::vector<Expectation> ParseBaseline(std::istream& baseline) {
+  std::vector<Expectation> expectations;
+  std::string line;
+  while (std::getline(baseline, line)) {
+    if (IsEntry(line))
+      expectations.push_back(ToExpectation(Fields(line)));
+  }
+  return expectations;
+}
+
+int CheckBaseline(const std::vector<Expectation>& expectations, const Measurements& measurements,
+                  std::ostream& report) {
+  int regressions(0);
+  for (const auto& expectation : expectations) {
+    std::string name(expectation.key + ' ' + expectation.metric);
+    const double* measured(FindMeasurement(measurements, expectation.key, expectation.metric));
+    if (!measured) {
+      report << "MISSING    " << name << '\n';
+      ++regressions;
+      continue;
+    }
+    double change((*measured - expectation.value) / expectation.value);
+    bool regressed(expectation.higher_is_better ? change < -expectation.tolerance
+                                                : change > expectation.tolerance);
+    if (regressed)
+      ++regressions;
+    report << (regressed ? "REGRESSED  " : "ok         ") << name << ": " << Format(*measured)
+           << " against " << Format(expectation.value) << " (" << std::showpos << std::fixed
+           << std::setprecision(1) << change * 100.0 << std::noshowpos << "%, "
+           << (expectation.higher_is_better ? "-" : "+") << expectation.tolerance * 100.0
+           << "% allowed)\n";
+    report.unsetf(std::ios::floatfield);
+  }
+  return regressions;
+}
+
+std::string UpdateBaseline(std::istream& baseline, const Measurements& measurements) {
+  std::string updated, line;
+  while (std::getline(baseline, line)) {
+    if (IsEntry(line)) {
+      auto fields(Fields(line));
+      auto expectation(ToExpectation(fields));
+      const double* measured(FindMeasurement(measurements, expectation.key, expectation.metric));
+      if (measured && *measured > 0.0) {
+        line = fields[0] + "  " + fields[1] + "  " + fields[2] + "  " + Format(*measured) + "  " +
+               fields[4];
+      }
+    }
+    updated += line + '\n';
+  }
+  return updated;
+}
+
+int CompareWithBaseline(const boost::filesystem::path& baseline_file,
+                        const std::string& json_lines, bool update, std::ostream& report) {
+  std::istringstream json_stream(json_lines);
+  auto measurements(ParseMeasurements(json_stream));
+  std::ifstream baseline(baseline_file.string());
+  if (!baseline)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  if (!update) {
+    report << "Comparing with " << baseline_file << '\n';
+    return CheckBaseline(ParseBaseline(baseline), measurements, report);
+  }
+  auto updated(UpdateBaseline(baseline, measurements));
+  baseline.close();
+  std::ofstream output(baseline_file.string(), std::ios::out | std::ios::trunc);
+  if (!output || !(output << updated))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  report << "Updated " << baseline_file << '\n';
+  return 0;
+}
+
+}  // namespace benchmark
+
+}  // namespace drive
+
+}  // namespace maidsafe
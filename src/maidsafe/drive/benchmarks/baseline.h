@@ -0,0 +1,80 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_BENCHMARKS_BASELINE_H_
+#define MAIDSAFE_DRIVE_BENCHMARKS_BASELINE_H_
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace benchmark {
+
+// One line of a baseline file, e.g.
+//   chunk_store/memory/write/64KiB  bytes_per_second  higher  200000000  60%
+// The measurement regresses if it is worse than 'value' by more than 'tolerance', a fraction of
+// 'value'.  Blank lines and lines starting with '#' are ignored.
+struct Expectation {
+  Expectation();
+  std::string key, metric;
+  bool higher_is_better;
+  double value, tolerance;
+};
+
+// Metric values indexed by result key, then by metric name.
+typedef std::map<std::string, std::map<std::string, double>> Measurements;
+
+// Parses lines of JSON as written by 'benchmark_drive' and 'filesystem_benchmark'.  A result's key
+// is its "benchmark" and "variant", or its "target", "workload", "block_size" and "threads",
+// joined with '/'.  Members of nested objects are named "<object>.<member>", e.g. "latency_us.p99".
+// A later result replaces an earlier one with the same key.  Throws parsing_error.
+Measurements ParseMeasurements(std::istream& json_lines);
+
+// Throws parsing_error.
+std::vector<Expectation> ParseBaseline(std::istream& baseline);
+
+// Writes a line to 'report' for each expectation and returns the number of regressions.  An
+// expectation with no matching measurement counts as a regression, so that renaming a benchmark
+// can't silently disable its check.
+int CheckBaseline(const std::vector<Expectation>& expectations, const Measurements& measurements,
+                  std::ostream& report);
+
+// Returns the contents of 'baseline' with each expectation's value replaced by its measurement,
+// keeping comments, ordering and tolerances.
+std::string UpdateBaseline(std::istream& baseline, const Measurements& measurements);
+
+// Compares the JSON lines in 'json_lines' with 'baseline_file', or rewrites the file with the new
+// values if 'update' is set.  Returns the number of regressions.
+int CompareWithBaseline(const boost::filesystem::path& baseline_file,
+                        const std::string& json_lines, bool update, std::ostream& report);
+
+}  // namespace benchmark
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_BENCHMARKS_BASELINE_H_
@@ -0,0 +1,192 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/benchmarks/benchmark.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <utility>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/drive/allocation_tracker.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace benchmark {
+
+namespace {
+
+std::map<std::string, Function>& Registry() {
+  static std::map<std::string, Function> registry;
+  return registry;
+}
+
+std::string Escape(const std::string& input) {
+  std::string output;
+  for (char c : input) {
+    if (c == '"' || c == '\\')
+      output += '\\';
+    output += c;
+  }
+  return output;
+}
+
+double Seconds(std::chrono::nanoseconds elapsed) {
+  return std::chrono::duration<double>(elapsed).count();
+}
+
+}  // unnamed namespace
+
+Result::Result() : benchmark(), variant(), operations(0), bytes(0), elapsed(0), metrics() {}
+
+Context::Context(std::string benchmark, bool quick, std::ostream* json_output)
+    : kBenchmark_(std::move(benchmark)),
+      kQuick_(quick),
+      json_output_(json_output),
+      scratch_dir_(),
+      results_() {}
+
+Context::~Context() {
+  if (scratch_dir_.empty())
+    return;
+  boost::system::error_code error_code;
+  fs::remove_all(scratch_dir_, error_code);
+  if (error_code)
+    LOG(kWarning) << "Failed to remove " << scratch_dir_ << ": " << error_code.message();
+}
+
+const fs::path& Context::scratch_dir() {
+  if (scratch_dir_.empty()) {
+    scratch_dir_ = fs::unique_path(fs::temp_directory_path() /
+                                   ("MaidSafe_Benchmark_" + kBenchmark_ + "_%%%%-%%%%-%%%%"));
+    fs::create_directories(scratch_dir_);
+  }
+  return scratch_dir_;
+}
+
+void Context::Report(const std::string& variant, uint64_t operations, uint64_t bytes,
+                     std::chrono::nanoseconds elapsed,
+                     std::vector<std::pair<std::string, double>> metrics) {
+  Result result;
+  result.benchmark = kBenchmark_;
+  result.variant = variant;
+  result.operations = operations;
+  result.bytes = bytes;
+  result.elapsed = elapsed;
+  result.metrics = std::move(metrics);
+  Record(result);
+}
+
+void Context::Record(const Result& result) {
+  results_.push_back(result);
+  double seconds(std::max(Seconds(result.elapsed), 1e-9));
+  std::cout << std::left << std::setw(20) << kBenchmark_ << std::setw(32) << result.variant
+            << std::right << std::fixed << std::setprecision(1) << std::setw(14)
+            << result.operations / seconds << " op/s" << std::setw(12)
+            << result.bytes / seconds / (1024.0 * 1024.0) << " MiB/s";
+  for (const auto& metric : result.metrics)
+    std::cout << "  " << metric.first << ' ' << metric.second;
+  std::cout << '\n';
+  if (json_output_)
+    *json_output_ << ToJson(result) << std::endl;
+}
+
+uint64_t Context::Measure(const std::string& variant, uint64_t max_operations,
+                          const std::function<void(uint64_t)>& operation,
+                          uint64_t bytes_per_operation) {
+  const std::chrono::steady_clock::duration kTimeLimit(
+      kQuick_ ? std::chrono::milliseconds(100) : std::chrono::milliseconds(2000));
+  uint64_t operations(0);
+  const uint64_t kAllocationCount(AllocationTracker::thread_allocation_count());
+  const uint64_t kAllocatedBytes(AllocationTracker::thread_allocated_bytes());
+  auto start(std::chrono::steady_clock::now()), now(start);
+  while (operations != max_operations && now - start < kTimeLimit) {
+    operation(operations++);
+    now = std::chrono::steady_clock::now();
+  }
+  Result result;
+  result.benchmark = kBenchmark_;
+  result.variant = variant;
+  result.operations = operations;
+  result.bytes = operations * bytes_per_operation;
+  result.elapsed = now - start;
+  if (AllocationTracker::enabled() && operations != 0) {
+    result.metrics.emplace_back(
+        "allocations_per_operation",
+        static_cast<double>(AllocationTracker::thread_allocation_count() - kAllocationCount) /
+            operations);
+    result.metrics.emplace_back(
+        "allocated_bytes_per_operation",
+        static_cast<double>(AllocationTracker::thread_allocated_bytes() - kAllocatedBytes) /
+            operations);
+  }
+  Record(result);
+  return operations;
+}
+
+bool Register(const std::string& name, Function function) {
+  return Registry().insert(std::make_pair(name, std::move(function))).second;
+}
+
+int RunAll(const std::string& filter, bool quick, std::ostream* json_output) {
+  int failures(0);
+  for (const auto& benchmark : Registry()) {
+    if (benchmark.first.find(filter) == std::string::npos)
+      continue;
+    try {
+      Context context(benchmark.first, quick, json_output);
+      benchmark.second(context);
+    }
+    catch (const std::exception& e) {
+      std::cerr << benchmark.first << " failed: " << e.what() << '\n';
+      ++failures;
+    }
+  }
+  return failures;
+}
+
+std::string ToJson(const Result& result) {
+  double seconds(Seconds(result.elapsed));
+  std::ostringstream stream;
+  stream << std::setprecision(9) << "{\"benchmark\":\"" << Escape(result.benchmark)
+         << "\",\"variant\":\"" << Escape(result.variant) << "\",\"operations\":"
+         << result.operations << ",\"bytes\":" << result.bytes << ",\"seconds\":" << seconds
+         << ",\"operations_per_second\":" << (seconds > 0 ? result.operations / seconds : 0)
+         << ",\"bytes_per_second\":" << (seconds > 0 ? result.bytes / seconds : 0);
+  for (const auto& metric : result.metrics)
+    stream << ",\"" << Escape(metric.first) << "\":" << metric.second;
+  stream << "}";
+  return stream.str();
+}
+
+}  // namespace benchmark
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,110 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_DRIVE_BENCHMARKS_BENCHMARK_H_
+#define MAIDSAFE_DRIVE_BENCHMARKS_BENCHMARK_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace benchmark {
+
+// A single measurement, written by 'benchmark_drive' as one line of JSON.
+struct Result {
+  Result();
+  std::string benchmark, variant;
+  uint64_t operations, bytes;
+  std::chrono::nanoseconds elapsed;
+  // Further named figures, e.g. "allocations_per_operation".
+  std::vector<std::pair<std::string, double>> metrics;
+};
+
+// Passed to each benchmark to provide scratch space and to collect its results.
+class Context {
+ public:
+  Context(std::string benchmark, bool quick, std::ostream* json_output);
+  // Removes the scratch directory, if one was created.
+  ~Context();
+
+  // Benchmarks should do a small fraction of their usual work when this is set, e.g. when run as
+  // part of a test suite.
+  bool quick() const { return kQuick_; }
+  // A directory which is created on first use and removed with the Context.
+  const boost::filesystem::path& scratch_dir();
+  void Report(const std::string& variant, uint64_t operations, uint64_t bytes,
+              std::chrono::nanoseconds elapsed,
+              std::vector<std::pair<std::string, double>> metrics =
+                  std::vector<std::pair<std::string, double>>());
+  // Calls 'operation' with 0, 1, 2... until it has been called 'max_operations' times or the
+  // time allowed for one measurement has elapsed, then reports the calls made.  This keeps
+  // operations whose cost grows with the size of the data being measured from taking hours.
+  // While allocation tracking is enabled, the calling thread's allocations per call are reported
+  // too.  Returns the number of calls made.
+  uint64_t Measure(const std::string& variant, uint64_t max_operations,
+               const std::function<void(uint64_t)>& operation, uint64_t bytes_per_operation = 0);
+  const std::vector<Result>& results() const { return results_; }
+
+ private:
+  Context(const Context&);
+  Context(Context&&);
+  Context& operator=(Context);
+
+  void Record(const Result& result);
+
+  const std::string kBenchmark_;
+  const bool kQuick_;
+  std::ostream* json_output_;
+  boost::filesystem::path scratch_dir_;
+  std::vector<Result> results_;
+};
+
+typedef std::function<void(Context&)> Function;
+
+bool Register(const std::string& name, Function function);
+// Runs each registered benchmark whose name contains 'filter', in name order.  Returns the number
+// which threw.
+int RunAll(const std::string& filter, bool quick, std::ostream* json_output);
+
+std::string ToJson(const Result& result);
+
+}  // namespace benchmark
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+// Defines a benchmark which 'benchmark_drive' runs as 'name', e.g.
+//   DRIVE_BENCHMARK(chunk_store) { context.Report(...); }
+#define DRIVE_BENCHMARK(name)                                                              \
+  static void DriveBenchmark_##name(maidsafe::drive::benchmark::Context& context);         \
+  static const bool drive_benchmark_registered_##name =                                    \
+      maidsafe::drive::benchmark::Register(#name, DriveBenchmark_##name);                  \
+  static void DriveBenchmark_##name(maidsafe::drive::benchmark::Context& context)
+
+#endif  // MAIDSAFE_DRIVE_BENCHMARKS_BENCHMARK_H_
@@ -0,0 +1,92 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "boost/program_options.hpp"
+
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/drive/allocation_tracker.h"
+#include "maidsafe/drive/benchmarks/baseline.h"
+#include "maidsafe/drive/benchmarks/benchmark.h"
+
+namespace po = boost::program_options;
+
+int main(int argc, char** argv) {
+  try {
+    auto unuseds(maidsafe::log::Logging::Instance().Initialise(argc, argv));
+    std::vector<std::string> unused_options;
+    for (const auto& unused : unuseds)
+      unused_options.emplace_back(&unused[0]);
+
+    po::options_description options("Drive benchmark options");
+    options.add_options()("help,h", "Show help message.")
+        ("filter", po::value<std::string>()->default_value(""),
+            "Only run benchmarks whose names contain this string.")
+        ("output", po::value<std::string>(),
+            "Append each result to this file as a line of JSON.")
+        ("quick", "Do a small fraction of the usual work, e.g. to check the benchmarks run.")
+        ("baseline", po::value<std::string>(),
+            "Fail if any result has regressed beyond the tolerance given in this file.")
+        ("update_baseline", "Replace the values in the baseline file with these results.");
+    po::variables_map variables_map;
+    po::store(po::command_line_parser(unused_options).options(options).run(), variables_map);
+    po::notify(variables_map);
+    if (variables_map.count("help")) {
+      std::cout << options << '\n';
+      return 0;
+    }
+
+    std::unique_ptr<std::ofstream> json_output;
+    if (variables_map.count("output")) {
+      json_output.reset(new std::ofstream(variables_map.at("output").as<std::string>(),
+                                          std::ios::out | std::ios::app));
+      if (!*json_output) {
+        std::cout << "Failed to open " << variables_map.at("output").as<std::string>() << '\n';
+        return 1;
+      }
+    }
+    // benchmark_drive is always built with the allocation hook (see CMakeLists.txt), so results
+    // include allocations per operation.
+    if (maidsafe::drive::AllocationTracker::hooked())
+      maidsafe::drive::AllocationTracker::Instance().Start();
+    // Results are collected in memory when they're to be compared, and only then written out.
+    std::ostringstream results;
+    bool has_baseline(variables_map.count("baseline") != 0);
+    auto failures(maidsafe::drive::benchmark::RunAll(
+        variables_map.at("filter").as<std::string>(), variables_map.count("quick") != 0,
+        has_baseline ? static_cast<std::ostream*>(&results) : json_output.get()));
+    if (!has_baseline)
+      return failures;
+    if (json_output)
+      *json_output << results.str() << std::flush;
+    return failures + maidsafe::drive::benchmark::CompareWithBaseline(
+        variables_map.at("baseline").as<std::string>(), results.str(),
+        variables_map.count("update_baseline") != 0, std::cout);
+  }
+  catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << "\nRun with -h to see all options.\n";
+  }
+  return 64;
+}
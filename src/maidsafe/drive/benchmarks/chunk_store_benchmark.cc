@@ -0,0 +1,135 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boost/thread/future.hpp"
+
+#include "maidsafe/common/data_stores/local_store.h"
+#include "maidsafe/common/data_types/immutable_data.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/memory_store.h"
+#include "maidsafe/drive/packed_store.h"
+#include "maidsafe/drive/uring_store.h"
+#include "maidsafe/drive/benchmarks/benchmark.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace benchmark {
+
+namespace {
+
+std::vector<ImmutableData> MakeChunks(size_t chunk_size, size_t count) {
+  // Chunks are only ever written once, so a pool of content is reused with a varying prefix to
+  // avoid paying for 'count' random strings.
+  std::string content(RandomString(chunk_size));
+  std::vector<ImmutableData> chunks;
+  chunks.reserve(count);
+  for (size_t i(0); i != count; ++i) {
+    std::string index(std::to_string(i) + ':');
+    std::copy(std::begin(index), std::end(index), std::begin(content));
+    chunks.emplace_back(NonEmptyString(content));
+  }
+  return chunks;
+}
+
+void Flush(data_stores::LocalStore&) {}
+void Flush(MemoryStore&) {}
+void Flush(PackedStore&) {}
+#ifdef MAIDSAFE_DRIVE_LIBURING
+void Flush(UringStore& store) { store.Flush(); }
+#endif
+
+// Puts all of 'chunks', then Gets them all with every future outstanding at once, as the drive
+// does when reading ahead.
+template <typename Store>
+void WriteThenRead(Context& context, const std::string& store_name, Store& store,
+                   const std::vector<ImmutableData>& chunks) {
+  const uint64_t kBytes(chunks.size() * chunks.front().data().string().size());
+  std::string size_name(std::to_string(chunks.front().data().string().size() / 1024) + "KiB");
+
+  auto start(std::chrono::steady_clock::now());
+  for (const auto& chunk : chunks)
+    store.Put(chunk);
+  Flush(store);
+  context.Report(store_name + "/write/" + size_name, chunks.size(), kBytes,
+                 std::chrono::steady_clock::now() - start);
+
+  start = std::chrono::steady_clock::now();
+  std::vector<boost::future<ImmutableData>> gets;
+  gets.reserve(chunks.size());
+  for (const auto& chunk : chunks)
+    gets.push_back(store.Get(chunk.name()));
+  for (auto& get : gets)
+    get.get();
+  context.Report(store_name + "/read/" + size_name, chunks.size(), kBytes,
+                 std::chrono::steady_clock::now() - start);
+}
+
+}  // unnamed namespace
+
+// Compares chunk write and read throughput of the drive's local Storage implementations.  All but
+// MemoryStore go to disk under the scratch dir, so their figures depend on the filesystem it's on;
+// MemoryStore gives the upper bound.
+DRIVE_BENCHMARK(chunk_store) {
+  const DiskUsage kDiskUsage(std::numeric_limits<uint64_t>::max());
+  const uint64_t kTotalBytes(context.quick() ? 4 * 1024 * 1024 : 128 * 1024 * 1024);
+  for (size_t chunk_size : {1024, 4 * 1024, 64 * 1024, 1024 * 1024}) {
+    auto chunks(MakeChunks(chunk_size, std::max<size_t>(kTotalBytes / chunk_size, 16)));
+    std::string size_dir(std::to_string(chunk_size));
+    {
+      MemoryStore store;
+      WriteThenRead(context, "memory", store, chunks);
+    }
+    {
+      data_stores::LocalStore store(context.scratch_dir() / ("local_" + size_dir), kDiskUsage);
+      WriteThenRead(context, "local", store, chunks);
+    }
+    {
+      auto version_store(std::make_shared<data_stores::LocalStore>(
+          context.scratch_dir() / ("packed_versions_" + size_dir), kDiskUsage));
+      PackedStore store(context.scratch_dir() / ("packed_" + size_dir), version_store);
+      WriteThenRead(context, "packed", store, chunks);
+    }
+#ifdef MAIDSAFE_DRIVE_LIBURING
+    for (unsigned queue_depth : {8U, 64U}) {
+      auto version_store(std::make_shared<data_stores::LocalStore>(
+          context.scratch_dir() / ("versions_" + size_dir), kDiskUsage));
+      UringStore store(context.scratch_dir() / ("uring_" + std::to_string(queue_depth) + "_" +
+                                                size_dir),
+                       queue_depth, version_store);
+      WriteThenRead(context, "uring_qd" + std::to_string(queue_depth), store, chunks);
+    }
+#endif
+  }
+}
+
+}  // namespace benchmark
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,200 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/common/data_types/immutable_data.h"
+
+#include "maidsafe/drive/config.h"
+#include "maidsafe/drive/directory.h"
+#include "maidsafe/drive/file_context.h"
+#include "maidsafe/drive/memory_accounting.h"
+#include "maidsafe/drive/meta_data.h"
+#include "maidsafe/drive/proto_structs.pb.h"
+#include "maidsafe/drive/benchmarks/benchmark.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace benchmark {
+
+namespace {
+
+typedef std::vector<fs::path> Names;
+
+// Names are unique, as they end in their index.  "uniform" names are short and differ from their
+// first character; "long" names share a 200 character prefix, which is the worst case for the
+// name comparisons Directory makes when searching and sorting its children.
+Names MakeNames(const std::string& distribution, size_t first_index, size_t count,
+                std::mt19937& generator) {
+  static const std::string kCharacters(
+      "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789");
+  const std::string kPrefix(distribution == "long" ? std::string(200, 'n') : std::string());
+  std::uniform_int_distribution<size_t> character(0, kCharacters.size() - 1);
+  Names names;
+  names.reserve(count);
+  std::string name;
+  for (size_t i(first_index); i != first_index + count; ++i) {
+    name = kPrefix;
+    for (int j(0); j != 8; ++j)
+      name += kCharacters[character(generator)];
+    names.emplace_back(name + '_' + std::to_string(i));
+  }
+  return names;
+}
+
+// Builds the serialised form directly, as adding a million children one at a time would take
+// hours.
+std::string SerialiseDirectory(const Names& names) {
+  detail::protobuf::Directory proto_directory;
+  proto_directory.set_directory_id(RandomString(64));
+  proto_directory.set_max_versions(detail::kMaxVersions.data);
+  for (const auto& name : names)
+    detail::MetaData(name, false).ToProtobuf(proto_directory.add_children());
+  return proto_directory.SerializeAsString();
+}
+
+// Supplies the functors a Directory needs.  Nothing is stored: a scheduled store just completes.
+class DirectoryFactory {
+ public:
+  DirectoryFactory()
+      : asio_service_(1),
+        version_(Identity(RandomString(64))),
+        put_functor_([this](detail::Directory* directory) { directory->AddNewVersion(version_); }),
+        put_chunk_functor_([](const ImmutableData&) {}),
+        increment_chunks_functor_([](const std::vector<ImmutableData::Name>&) {}) {}
+
+  std::unique_ptr<detail::Directory> Parse(const std::string& serialised_directory) {
+    return std::unique_ptr<detail::Directory>(new detail::Directory(
+        ParentId(Identity(RandomString(64))), serialised_directory,
+        std::vector<StructuredDataVersions::VersionName>(), asio_service_.service(),
+        put_functor_, put_chunk_functor_, increment_chunks_functor_, ""));
+  }
+
+  const ImmutableData::Name& version() const { return version_; }
+
+ private:
+  AsioService asio_service_;
+  const ImmutableData::Name version_;
+  std::function<void(detail::Directory*)> put_functor_;  // NOLINT
+  std::function<void(const ImmutableData&)> put_chunk_functor_;
+  std::function<void(const std::vector<ImmutableData::Name>&)> increment_chunks_functor_;
+};
+
+void MeasureDirectory(Context& context, DirectoryFactory& factory, const std::string& distribution,
+                      size_t size, std::mt19937& generator) {
+  const std::string kPrefix(distribution + '/');
+  const std::string kSuffix('/' + std::to_string(size));
+  const uint64_t kMaxOperations(1000000);
+  const Names kNames(MakeNames(distribution, 0, size, generator));
+  // Names which aren't in the directory; used for misses and as the names of added children.
+  const Names kOtherNames(MakeNames(distribution, size, 1000, generator));
+  const Names kNewNames(MakeNames(distribution, size + kOtherNames.size(), kOtherNames.size(),
+                                  generator));
+  const std::string kSerialised(SerialiseDirectory(kNames));
+  // Visits the children in a scattered order which is the same on every run.
+  auto existing([&](uint64_t i) -> const fs::path& { return kNames[(i * 7919) % size]; });
+  auto other([&](uint64_t i) -> const fs::path& { return kOtherNames[i % kOtherNames.size()]; });
+
+  context.Measure(kPrefix + "parse" + kSuffix, kMaxOperations,
+                  [&](uint64_t) { factory.Parse(kSerialised); }, kSerialised.size());
+  // What the parsed directory holds per child: "bytes_per_entry" is measured from the heap where
+  // the C library reports it and is otherwise the directory's own estimate.
+  auto heap_before(HeapBytesInUse());
+  auto start(std::chrono::steady_clock::now());
+  auto directory(factory.Parse(kSerialised));
+  auto elapsed(std::chrono::steady_clock::now() - start);
+  auto heap_after(HeapBytesInUse());
+  auto estimate(directory->GetStatistics().memory.TotalMemory());
+  auto measured(heap_after > heap_before ? heap_after - heap_before : estimate);
+  context.Report(kPrefix + "memory" + kSuffix, 1, 0,
+                 std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed),
+                 {{"bytes_per_entry", static_cast<double>(measured) / size},
+                  {"estimated_bytes_per_entry", static_cast<double>(estimate) / size}});
+
+  context.Measure(kPrefix + "has_hit" + kSuffix, kMaxOperations,
+                  [&](uint64_t i) { directory->HasChild(existing(i)); });
+  context.Measure(kPrefix + "has_miss" + kSuffix, kMaxOperations,
+                  [&](uint64_t i) { directory->HasChild(other(i)); });
+  context.Measure(kPrefix + "get_hit" + kSuffix, kMaxOperations,
+                  [&](uint64_t i) { directory->GetChild(existing(i)); });
+  context.Measure(kPrefix + "get_miss" + kSuffix, kMaxOperations, [&](uint64_t i) {
+    try {
+      directory->GetChild(other(i));
+    }
+    catch (const std::exception&) {}
+  });
+  // Each operation is a full iteration of the children.
+  context.Measure(kPrefix + "iterate" + kSuffix, kMaxOperations, [&](uint64_t) {
+    directory->ResetChildrenCounter();
+    while (directory->GetChildAndIncrementCounter()) {}
+  });
+  context.Measure(kPrefix + "serialise" + kSuffix, kMaxOperations, [&](uint64_t) {
+    directory->Serialise();
+    directory->AddNewVersion(factory.version());
+  }, kSerialised.size());
+
+  auto added(context.Measure(kPrefix + "add" + kSuffix, kOtherNames.size(), [&](uint64_t i) {
+    directory->AddChild(detail::FileContext(kOtherNames[i], false));
+  }));
+  auto renamed(context.Measure(kPrefix + "rename" + kSuffix, added, [&](uint64_t i) {
+    directory->RenameChild(kOtherNames[i], kNewNames[i]);
+  }));
+  context.Measure(kPrefix + "remove" + kSuffix, renamed,
+                  [&](uint64_t i) { directory->RemoveChild(kNewNames[i]); });
+}
+
+}  // unnamed namespace
+
+// Measures the operations on a single Directory at sizes up to a million children.  Each
+// measurement stops after a fixed time, so the largest sizes report only a few operations.  The
+// million-child runs need around a gigabyte of memory.
+DRIVE_BENCHMARK(directory) {
+  std::vector<size_t> sizes;
+  if (context.quick())
+    sizes = {10, 1000};
+  else
+    sizes = {10, 100, 1000, 10000, 100000, 1000000};
+  std::mt19937 generator(0);
+  DirectoryFactory factory;
+  for (const std::string distribution : {"uniform", "long"}) {
+    for (auto size : sizes)
+      MeasureDirectory(context, factory, distribution, size, generator);
+  }
+}
+
+}  // namespace benchmark
+
+}  // namespace drive
+
+}  // namespace maidsafe
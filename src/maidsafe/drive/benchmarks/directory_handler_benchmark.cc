@@ -0,0 +1,329 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/config.h"
+#include "maidsafe/drive/directory.h"
+#include "maidsafe/drive/directory_handler.h"
+#include "maidsafe/drive/file_context.h"
+#include "maidsafe/drive/memory_store.h"
+#include "maidsafe/drive/simulated_network_store.h"
+#include "maidsafe/drive/storage_metrics.h"
+#include "maidsafe/drive/benchmarks/benchmark.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace benchmark {
+
+namespace {
+
+// Creates DirectoryHandlers which all use the same storage and root, so that a handler created
+// after another has been destroyed starts with an empty cache and loads what the other stored.
+template <typename Storage>
+class HandlerFactory {
+ public:
+  typedef detail::DirectoryHandler<Storage> Handler;
+
+  HandlerFactory(Context& context, std::shared_ptr<Storage> storage)
+      : context_(context),
+        storage_(std::move(storage)),
+        unique_user_id_(RandomString(64)),
+        root_parent_id_(RandomString(64)),
+        asio_service_(2) {}
+
+  ~HandlerFactory() { asio_service_.Stop(); }
+
+  std::unique_ptr<Handler> Create(bool create) {
+    return std::unique_ptr<Handler>(new Handler(storage_, unique_user_id_, root_parent_id_,
+        fs::unique_path(context_.scratch_dir() / "buffer_%%%%-%%%%-%%%%"), create,
+        asio_service_.service()));
+  }
+
+ private:
+  HandlerFactory(const HandlerFactory&);
+  HandlerFactory& operator=(const HandlerFactory&);
+
+  Context& context_;
+  std::shared_ptr<Storage> storage_;
+  const Identity unique_user_id_, root_parent_id_;
+  AsioService asio_service_;
+};
+
+// Every directory store finishes with a single versioning call.
+template <typename Handler>
+uint64_t StoreCount(const Handler& handler) {
+  return handler.storage_metrics().Get(StorageOperation::kPutVersion).count +
+         handler.storage_metrics().Get(StorageOperation::kCreateVersionTree).count;
+}
+
+template <typename Handler>
+void WaitForStoreCount(const Handler& handler, uint64_t count) {
+  auto deadline(std::chrono::steady_clock::now() + std::chrono::minutes(10));
+  while (StoreCount(handler) < count) {
+    if (std::chrono::steady_clock::now() > deadline)
+      throw std::runtime_error("Timed out waiting for directories to be stored.");
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
+// Stores every pending directory and waits until no more stores are being made.  Handlers with
+// many pending stores must be flushed this way before being destroyed, as each Directory only
+// waits a few seconds for its own store to finish.
+template <typename Handler>
+void FlushAndWait(Handler& handler) {
+  handler.FlushAll();
+  auto count(StoreCount(handler));
+  for (;;) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    auto new_count(StoreCount(handler));
+    if (new_count == count)
+      return;
+    count = new_count;
+  }
+}
+
+fs::path Chain(int depth) {
+  fs::path path(detail::kRoot);
+  for (int i(1); i <= depth; ++i)
+    path /= "level_" + std::to_string(i);
+  return path;
+}
+
+template <typename Handler>
+void AddDirectory(Handler& handler, const fs::path& path) {
+  handler.Add(path, detail::FileContext(path.filename(), true));
+}
+
+template <typename Handler>
+void AddTree(Handler& handler, const fs::path& path, int fanout, int depth, uint64_t& count) {
+  if (depth == 0)
+    return;
+  for (int i(0); i != fanout; ++i) {
+    fs::path child(path / ("node_" + std::to_string(i)));
+    AddDirectory(handler, child);
+    ++count;
+    AddTree(handler, child, fanout, depth - 1, count);
+  }
+}
+
+// Gets every directory below 'path', loading each from storage if the handler is cold.
+template <typename Handler>
+void LoadTree(Handler& handler, const fs::path& path, uint64_t& count) {
+  auto directory(handler.Get(path));
+  ++count;
+  std::vector<fs::path> children;
+  directory->ResetChildrenCounter();
+  auto child(directory->GetChildAndIncrementCounter());
+  while (child) {
+    if (child->meta_data.directory_id)
+      children.push_back(path / child->meta_data.name);
+    child = directory->GetChildAndIncrementCounter();
+  }
+  directory->ResetChildrenCounter();
+  for (const auto& child : children)
+    LoadTree(handler, child, count);
+}
+
+template <typename Storage>
+void MeasureGet(Context& context, HandlerFactory<Storage>& factory, const std::string& prefix) {
+  const int kMaxDepth(32);
+  {
+    auto builder(factory.Create(true));
+    for (int depth(1); depth <= kMaxDepth; ++depth)
+      AddDirectory(*builder, Chain(depth));
+    FlushAndWait(*builder);
+  }
+
+  const uint64_t kColdRepeats(context.quick() ? 3 : 20);
+  for (int depth : {1, 2, 4, 8, 16, 32}) {
+    std::chrono::steady_clock::duration elapsed(0);
+    for (uint64_t i(0); i != kColdRepeats; ++i) {
+      auto handler(factory.Create(false));
+      auto start(std::chrono::steady_clock::now());
+      handler->Get(Chain(depth));
+      elapsed += std::chrono::steady_clock::now() - start;
+    }
+    context.Report(prefix + "cold_get/" + std::to_string(depth), kColdRepeats, 0, elapsed);
+  }
+
+  auto handler(factory.Create(false));
+  handler->Get(Chain(kMaxDepth));
+  for (int depth : {1, 2, 4, 8, 16, 32}) {
+    context.Measure(prefix + "warm_get/" + std::to_string(depth), 1000000,
+                    [&](uint64_t) { handler->Get(Chain(depth)); });
+  }
+}
+
+template <typename Storage>
+void MeasureAddAndDelete(Context& context, HandlerFactory<Storage>& factory,
+                         const std::string& prefix) {
+  const uint64_t kMaxOperations(context.quick() ? 1000 : 10000);
+  auto handler(factory.Create(false));
+  for (bool is_directory : {false, true}) {
+    const std::string kType(is_directory ? "directory" : "file");
+    const fs::path kParent(detail::kRoot / ("add_" + kType));
+    AddDirectory(*handler, kParent);
+    auto path([&](uint64_t i) { return kParent / (kType + '_' + std::to_string(i)); });
+    auto added(context.Measure(prefix + "add_" + kType, kMaxOperations, [&](uint64_t i) {
+      handler->Add(path(i), detail::FileContext(path(i).filename(), is_directory));
+    }));
+    context.Measure(prefix + "delete_" + kType, added,
+                    [&](uint64_t i) { handler->Delete(path(i)); });
+  }
+  FlushAndWait(*handler);
+}
+
+// Renames a directory in place, which also renames the cache entries of all its cached
+// descendants.
+template <typename Storage>
+void MeasureRename(Context& context, HandlerFactory<Storage>& factory, const std::string& prefix) {
+  std::vector<uint64_t> descendant_counts;
+  if (context.quick())
+    descendant_counts = {0, 100};
+  else
+    descendant_counts = {0, 100, 10000, 100000};
+  for (auto descendant_count : descendant_counts) {
+    auto handler(factory.Create(false));
+    const fs::path kSource(detail::kRoot / ("rename_" + std::to_string(descendant_count)));
+    const fs::path kTarget(kSource.string() + "_renamed");
+    AddDirectory(*handler, kSource);
+    // Descendants are spread over groups of 1000 to keep each directory a realistic size.
+    uint64_t created(0);
+    for (int group(0); created != descendant_count; ++group) {
+      fs::path group_path(kSource / ("group_" + std::to_string(group)));
+      AddDirectory(*handler, group_path);
+      ++created;
+      for (int i(0); i != 999 && created != descendant_count; ++i, ++created)
+        AddDirectory(*handler, group_path / ("node_" + std::to_string(i)));
+    }
+    FlushAndWait(*handler);
+    context.Measure(prefix + "rename/" + std::to_string(descendant_count), 1000, [&](uint64_t i) {
+      if (i % 2 == 0)
+        handler->Rename(kSource, kTarget);
+      else
+        handler->Rename(kTarget, kSource);
+    });
+    FlushAndWait(*handler);
+  }
+}
+
+template <typename Storage>
+void MeasureFlushAll(Context& context, HandlerFactory<Storage>& factory,
+                     const std::string& prefix) {
+  std::vector<int> dirty_counts;
+  if (context.quick())
+    dirty_counts = {1, 10};
+  else
+    dirty_counts = {1, 10, 100, 1000};
+  const fs::path kParent(detail::kRoot / "flush");
+  auto handler(factory.Create(false));
+  AddDirectory(*handler, kParent);
+  for (int i(0); i != dirty_counts.back(); ++i)
+    AddDirectory(*handler, kParent / std::to_string(i));
+  FlushAndWait(*handler);
+
+  int file_index(0);
+  for (auto dirty_count : dirty_counts) {
+    for (int i(0); i != dirty_count; ++i) {
+      fs::path file(kParent / std::to_string(i) / ("file_" + std::to_string(file_index++)));
+      handler->Add(file, detail::FileContext(file.filename(), false));
+    }
+    auto target_count(StoreCount(*handler) + dirty_count);
+    auto start(std::chrono::steady_clock::now());
+    handler->FlushAll();
+    WaitForStoreCount(*handler, target_count);
+    context.Report(prefix + "flush_all/" + std::to_string(dirty_count), dirty_count, 0,
+                   std::chrono::steady_clock::now() - start);
+  }
+  FlushAndWait(*handler);
+}
+
+template <typename Storage>
+void MeasureTreeLoad(Context& context, HandlerFactory<Storage>& factory, const std::string& prefix,
+                     int fanout, int depth) {
+  const fs::path kTreeRoot(detail::kRoot / "tree");
+  uint64_t directory_count(1);
+  {
+    auto builder(factory.Create(false));
+    AddDirectory(*builder, kTreeRoot);
+    AddTree(*builder, kTreeRoot, fanout, depth, directory_count);
+    FlushAndWait(*builder);
+  }
+  auto handler(factory.Create(false));
+  uint64_t loaded_count(0);
+  auto start(std::chrono::steady_clock::now());
+  LoadTree(*handler, kTreeRoot, loaded_count);
+  context.Report(prefix + "tree_load/" + std::to_string(directory_count), loaded_count, 0,
+                 std::chrono::steady_clock::now() - start);
+}
+
+}  // unnamed namespace
+
+// Measures DirectoryHandler's metadata operations without FUSE or the kernel.  "memory" uses
+// MemoryStore, so only the handler's own costs are measured; "simulated" adds 5ms to every storage
+// call, which dominates cold Gets, FlushAll and tree loads.  The operations which don't wait for
+// storage are only measured against MemoryStore.
+DRIVE_BENCHMARK(directory_handler) {
+  {
+    HandlerFactory<MemoryStore> factory(context, std::make_shared<MemoryStore>());
+    MeasureGet(context, factory, "memory/");
+    MeasureAddAndDelete(context, factory, "memory/");
+    MeasureRename(context, factory, "memory/");
+    MeasureFlushAll(context, factory, "memory/");
+    if (context.quick())
+      MeasureTreeLoad(context, factory, "memory/", 3, 3);
+    else
+      MeasureTreeLoad(context, factory, "memory/", 10, 4);
+  }
+  {
+    typedef SimulatedNetworkStore<MemoryStore> Storage;
+    HandlerFactory<Storage> factory(context, std::make_shared<Storage>(
+        std::make_shared<MemoryStore>(),
+        SimulatedNetworkProfile::Parse("latency=constant:5,seed=1")));
+    MeasureGet(context, factory, "simulated/");
+    MeasureFlushAll(context, factory, "simulated/");
+    if (context.quick())
+      MeasureTreeLoad(context, factory, "simulated/", 3, 3);
+    else
+      MeasureTreeLoad(context, factory, "simulated/", 4, 4);
+  }
+}
+
+}  // namespace benchmark
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,288 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/config.h"
+#include "maidsafe/drive/drive.h"
+#include "maidsafe/drive/file_context.h"
+#include "maidsafe/drive/memory_store.h"
+#include "maidsafe/drive/storage_metrics.h"
+#include "maidsafe/drive/benchmarks/benchmark.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace benchmark {
+
+namespace {
+
+const uint64_t kKiB(1024), kMiB(1024 * kKiB), kGiB(1024 * kMiB);
+
+// Counts the chunk names passed to 'IncrementReferenceCount', as StorageMetrics only counts the
+// calls.
+class CountingStore : public MemoryStore {
+ public:
+  CountingStore() : MemoryStore(), incremented_count_(0) {}
+
+  void IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names) {
+    incremented_count_ += data_names.size();
+    MemoryStore::IncrementReferenceCount(data_names);
+  }
+
+  uint64_t incremented_count() const { return incremented_count_; }
+
+ private:
+  std::atomic<uint64_t> incremented_count_;
+};
+
+// A drive which is never mounted, exposing the primitives which a close and the following
+// directory store run through.
+class FlushDrive : public Drive<CountingStore> {
+ public:
+  FlushDrive(std::shared_ptr<CountingStore> storage, const fs::path& user_app_dir)
+      : Drive<CountingStore>(storage, Identity(RandomString(64)), Identity(RandomString(64)),
+                             user_app_dir, user_app_dir, "", true) {}
+  virtual ~FlushDrive() {}
+
+  using Drive<CountingStore>::Open;
+  using Drive<CountingStore>::Write;
+  using Drive<CountingStore>::Release;
+
+  void AddDirectory(const fs::path& path) {
+    Create(path, detail::FileContext(path.filename(), true));
+  }
+
+  void AddFile(const fs::path& path) {
+    detail::FileContext file_context(path.filename(), false);
+#ifndef MAIDSAFE_WIN32
+    time(&file_context.meta_data.attributes.st_atime);
+    file_context.meta_data.attributes.st_ctime = file_context.meta_data.attributes.st_mtime =
+        file_context.meta_data.attributes.st_atime;
+    file_context.meta_data.attributes.st_mode = S_IFREG | 0644;
+    file_context.meta_data.attributes.st_nlink = 1;
+#endif
+    Create(path, std::move(file_context));
+  }
+
+  void Truncate(const fs::path& path, uint64_t size) {
+    auto file_context(GetMutableContext(path));
+    file_context->self_encryptor->Truncate(size);
+    if (file_context->content_hasher)
+      file_context->content_hasher->Truncate(size);
+#ifndef MAIDSAFE_WIN32
+    file_context->meta_data.attributes.st_size = size;
+#endif
+    file_context->parent->ScheduleForStoring();
+  }
+
+  // Marks the parent of 'path' for storing without touching 'path' itself, as a change to a
+  // sibling's metadata would.
+  void TouchParent(const fs::path& path) {
+    GetMutableContext(path)->parent->ScheduleForStoring();
+  }
+
+  void FlushAll() { directory_handler_.FlushAll(); }
+
+ private:
+  FlushDrive(const FlushDrive&);
+  FlushDrive(FlushDrive&&);
+  FlushDrive& operator=(FlushDrive);
+
+  virtual void Mount() {}
+  virtual void Unmount() {}
+};
+
+// Every directory store finishes with a single versioning call.
+uint64_t StoreCount(const FlushDrive& drive) {
+  return drive.storage_metrics().Get(StorageOperation::kPutVersion).count +
+         drive.storage_metrics().Get(StorageOperation::kCreateVersionTree).count;
+}
+
+// Stores every pending directory and waits until no more stores are being made.
+void FlushAndWait(FlushDrive& drive) {
+  drive.FlushAll();
+  auto count(StoreCount(drive));
+  for (;;) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    auto new_count(StoreCount(drive));
+    if (new_count == count)
+      return;
+    count = new_count;
+  }
+}
+
+std::string SizeName(uint64_t size) {
+  if (size >= kGiB)
+    return std::to_string(size / kGiB) + "GiB";
+  if (size >= kMiB)
+    return std::to_string(size / kMiB) + "MiB";
+  return std::to_string(size / kKiB) + "KiB";
+}
+
+// Data is written in 1 MiB blocks which repeat throughout the file.  Once a file spans more than
+// a few chunks its middle chunks are then identical, so MemoryStore holds them once and even the
+// largest files fit in memory; each one is still encrypted and put as normal.
+class Fixture {
+ public:
+  Fixture(Context& context, FlushDrive& drive, CountingStore& storage)
+      : context_(context), drive_(drive), storage_(storage), block_() {
+    std::mt19937 generator(0);
+    block_.reserve(kMiB + kKiB);
+    while (block_.size() != kMiB + kKiB)
+      block_.push_back(static_cast<char>(generator() & 0xff));
+  }
+
+  void WriteFile(const fs::path& path, uint64_t size) {
+    for (uint64_t offset(0); offset < size; offset += kMiB) {
+      drive_.Write(path, block_.data(), static_cast<uint32_t>(std::min(kMiB, size - offset)),
+                   offset);
+    }
+  }
+
+  // Writes data which differs from the original block at 'offset'.
+  void Edit(const fs::path& path, uint64_t size, uint64_t offset) {
+    drive_.Write(path, block_.data() + kKiB, static_cast<uint32_t>(size), offset);
+  }
+
+  // Calls 'close', then stores the directory holding 'file' and reports the cost of both.
+  // 'bytes_changed' is the number of bytes written by the application since the file was last
+  // stored, against which the bytes encrypted are compared.
+  void Measure(const std::string& variant, uint64_t bytes_changed,
+               const std::function<void()>& close) {
+    const auto& metrics(drive_.storage_metrics());
+    auto data_before(metrics.Get(StorageOperation::kPut, StorageCaller::kFileData));
+    auto listing_before(metrics.Get(StorageOperation::kPut, StorageCaller::kDirectoryListing));
+    auto incremented_before(storage_.incremented_count());
+    auto target_store_count(StoreCount(drive_) + 1);
+    auto cpu_start(std::clock());
+    auto start(std::chrono::steady_clock::now());
+
+    close();
+    drive_.FlushAll();
+    auto deadline(start + std::chrono::minutes(30));
+    while (StoreCount(drive_) < target_store_count) {
+      if (std::chrono::steady_clock::now() > deadline)
+        throw std::runtime_error("Timed out waiting for the directory to be stored.");
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    auto elapsed(std::chrono::steady_clock::now() - start);
+    double cpu_seconds(static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC);
+    auto data_after(metrics.Get(StorageOperation::kPut, StorageCaller::kFileData));
+    auto listing_after(metrics.Get(StorageOperation::kPut, StorageCaller::kDirectoryListing));
+    uint64_t bytes_encrypted(data_after.bytes - data_before.bytes);
+    std::vector<std::pair<std::string, double>> results;
+    results.emplace_back("cpu_seconds", cpu_seconds);
+    results.emplace_back("bytes_encrypted", static_cast<double>(bytes_encrypted));
+    results.emplace_back("chunks_put", static_cast<double>(data_after.count - data_before.count));
+    results.emplace_back("refcount_increments",
+                         static_cast<double>(storage_.incremented_count() - incremented_before));
+    results.emplace_back("listing_bytes_put",
+                         static_cast<double>(listing_after.bytes - listing_before.bytes));
+    if (bytes_changed != 0) {
+      results.emplace_back("write_amplification",
+                           static_cast<double>(bytes_encrypted) / bytes_changed);
+    }
+    context_.Report(variant, 1, bytes_encrypted, elapsed, std::move(results));
+  }
+
+ private:
+  Context& context_;
+  FlushDrive& drive_;
+  CountingStore& storage_;
+  std::vector<char> block_;
+};
+
+// Runs each edit pattern in turn against a single file of 'size' bytes, so the file only has to be
+// written once.  Each pattern starts from a stored file which isn't open.
+void MeasureFileSize(Fixture& fixture, FlushDrive& drive, uint64_t size) {
+  const std::string kPrefix(SizeName(size) + '/');
+  const fs::path kDirectory(detail::kRoot / SizeName(size));
+  const fs::path kFile(kDirectory / "file");
+  const uint64_t kEditSize(std::min<uint64_t>(4 * kKiB, size / 4));
+  drive.AddDirectory(kDirectory);
+  FlushAndWait(drive);
+
+  drive.AddFile(kFile);
+  fixture.WriteFile(kFile, size);
+  fixture.Measure(kPrefix + "new", size, [&] { drive.Release(kFile); });
+
+  // The file's chunks only need their reference counts incremented when its directory is stored.
+  fixture.Measure(kPrefix + "untouched_sibling", 0, [&] { drive.TouchParent(kFile); });
+
+  auto measure_edit([&](const std::string& pattern, uint64_t offset) {
+    drive.Open(kFile);
+    fixture.Edit(kFile, kEditSize, offset);
+    fixture.Measure(kPrefix + pattern, kEditSize, [&] { drive.Release(kFile); });
+  });
+  measure_edit("edit_start", 0);
+  measure_edit("edit_middle", size / 2);
+  measure_edit("edit_end", size - kEditSize);
+  measure_edit("append", size);
+
+  drive.Open(kFile);
+  drive.Truncate(kFile, size / 2);
+  fixture.Measure(kPrefix + "truncate", 0, [&] { drive.Release(kFile); });
+}
+
+}  // unnamed namespace
+
+// Measures the work caused by closing a file and storing its directory, i.e. 'FlushEncryptor',
+// 'Directory::Serialise' and the put of the serialised directory, for new files, edits at the
+// start, middle and end, appends, truncates and files which weren't opened at all.  Alongside the
+// time taken, each result reports the process CPU time, bytes encrypted and chunks put for the
+// file's data, the chunk reference counts incremented and the directory listing bytes put.
+DRIVE_BENCHMARK(flush) {
+  std::vector<uint64_t> sizes;
+  if (context.quick())
+    sizes = {kKiB, kMiB};
+  else
+    sizes = {kKiB, 64 * kKiB, kMiB, 16 * kMiB, 256 * kMiB, kGiB, 10 * kGiB};
+  auto storage(std::make_shared<CountingStore>());
+  FlushDrive drive(storage, context.scratch_dir());
+  Fixture fixture(context, drive, *storage);
+  for (auto size : sizes)
+    MeasureFileSize(fixture, drive, size);
+  FlushAndWait(drive);
+}
+
+}  // namespace benchmark
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,321 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/chunk_cache.h"
+
+#include <algorithm>
+#include <ctime>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+void RemoveFiles(const std::vector<fs::path>& paths) {
+  boost::system::error_code error_code;
+  for (const auto& path : paths) {
+    fs::remove(path, error_code);
+    if (error_code)
+      LOG(kWarning) << "Failed to remove " << path << " from cache: " << error_code.message();
+  }
+}
+
+// Writes via a temporary file so that a crash can't leave a truncated file at 'path'.
+bool WriteFileAtomically(const fs::path& path, const std::string& content) {
+  auto temp_path(fs::unique_path(path.string() + ".%%%%-%%%%.tmp"));
+  boost::system::error_code error_code;
+  if (!WriteFile(temp_path, content)) {
+    fs::remove(temp_path, error_code);
+    return false;
+  }
+  fs::rename(temp_path, path, error_code);
+  if (error_code) {
+    LOG(kWarning) << "Failed to rename " << temp_path << ": " << error_code.message();
+    fs::remove(temp_path, error_code);
+    return false;
+  }
+  return true;
+}
+
+}  // unnamed namespace
+
+ChunkCache::ChunkCache(const fs::path& cache_dir, DiskUsage max_disk_usage)
+    : kCacheDir_(cache_dir),
+      kMaxDiskUsage_(max_disk_usage),
+      mutex_(),
+      recency_list_(),
+      entries_(),
+      current_disk_usage_(0),
+      statistics_() {
+  boost::system::error_code error_code;
+  if (!fs::exists(kCacheDir_, error_code) && !fs::create_directories(kCacheDir_, error_code)) {
+    LOG(kError) << "Failed to create chunk cache at " << kCacheDir_ << ": "
+                << error_code.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  LoadIndex();
+  LOG(kInfo) << "Chunk cache at " << kCacheDir_ << " holds " << entries_.size() << " chunks ("
+             << current_disk_usage_ << " of " << kMaxDiskUsage_ << " bytes).";
+}
+
+ChunkCache::~ChunkCache() {
+  try {
+    SaveRecency();
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Failed to save chunk cache recency order: " << e.what();
+  }
+}
+
+boost::optional<ImmutableData> ChunkCache::Get(const ImmutableData::Name& name) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.count(name) == 0) {
+      ++statistics_.misses;
+      return boost::none;
+    }
+  }
+
+  boost::optional<ImmutableData> data;
+  std::string content;
+  if (ReadFile(GetPath(name), &content) && !content.empty())
+    data = ImmutableData(NonEmptyString(std::move(content)));
+
+  std::vector<fs::path> doomed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The chunk may have been evicted while it was being read.
+    auto itr(entries_.find(name));
+    if (data && data->name() == name) {
+      ++statistics_.hits;
+      if (itr != std::end(entries_))
+        MarkAsMostRecent(itr);
+      return data;
+    }
+    if (data) {
+      LOG(kError) << "Cached chunk " << HexSubstr(name->string()) << " is corrupt.";
+      ++statistics_.corruptions;
+    } else {
+      LOG(kWarning) << "Failed to read cached chunk " << HexSubstr(name->string());
+    }
+    ++statistics_.misses;
+    if (itr != std::end(entries_))
+      Erase(itr, doomed);
+  }
+  RemoveFiles(doomed);
+  return boost::none;
+}
+
+void ChunkCache::Put(const ImmutableData& data) {
+  const std::string& content(data.data().string());
+  if (content.size() > kMaxDiskUsage_)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr(entries_.find(data.name()));
+    if (itr != std::end(entries_)) {
+      MarkAsMostRecent(itr);
+      return;
+    }
+  }
+
+  if (!WriteFileAtomically(GetPath(data.name()), content)) {
+    LOG(kWarning) << "Failed to add chunk " << HexSubstr(data.name()->string()) << " to cache.";
+    return;
+  }
+
+  std::vector<fs::path> doomed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Another thread may have added the same chunk meanwhile, with the same content.
+    if (entries_.count(data.name()) != 0)
+      return;
+    EvictUntilWithinLimit(content.size(), doomed);
+    recency_list_.push_front(data.name());
+    Entry entry = { std::begin(recency_list_), content.size() };
+    entries_.insert(std::make_pair(data.name(), entry));
+    current_disk_usage_ += content.size();
+    ++statistics_.insertions;
+  }
+  RemoveFiles(doomed);
+}
+
+bool ChunkCache::Has(const ImmutableData::Name& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.count(name) != 0;
+}
+
+void ChunkCache::Clear() {
+  std::vector<fs::path> doomed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!entries_.empty())
+      Erase(std::begin(entries_), doomed);
+  }
+  doomed.push_back(GetRecencyPath());
+  RemoveFiles(doomed);
+}
+
+DiskUsage ChunkCache::GetCurrentDiskUsage() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return DiskUsage(current_disk_usage_);
+}
+
+ChunkCache::Statistics ChunkCache::GetStatistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+
+fs::path ChunkCache::GetPath(const ImmutableData::Name& name) const {
+  return kCacheDir_ / HexEncode(name->string());
+}
+
+fs::path ChunkCache::GetRecencyPath() const {
+  return kCacheDir_ / "recency";
+}
+
+void ChunkCache::LoadIndex() {
+  // The chunks listed in the recency file, most recently used first.
+  const size_t kUnranked(std::numeric_limits<size_t>::max());
+  std::map<ImmutableData::Name, size_t> ranks;
+  std::time_t recency_saved(0);
+  boost::system::error_code error_code;
+  std::string recency;
+  if (ReadFile(GetRecencyPath(), &recency)) {
+    recency_saved = fs::last_write_time(GetRecencyPath(), error_code);
+    std::istringstream stream(recency);
+    std::string hex_name;
+    while (std::getline(stream, hex_name)) {
+      try {
+        std::string decoded_name(HexDecode(hex_name));
+        if (decoded_name.size() == crypto::SHA512::DIGESTSIZE)
+          ranks.insert(std::make_pair(ImmutableData::Name(Identity(decoded_name)), ranks.size()));
+      }
+      catch (const std::exception&) {}
+    }
+  }
+
+  struct Found {
+    ImmutableData::Name name;
+    uint64_t size;
+    std::time_t last_written;
+    size_t rank;
+  };
+  std::vector<Found> found;
+  for (fs::directory_iterator itr(kCacheDir_, error_code), end; itr != end;
+       itr.increment(error_code)) {
+    const auto& path(itr->path());
+    if (path.extension() == ".tmp") {  // Left over from a crash while writing.
+      fs::remove(path, error_code);
+      continue;
+    }
+    std::string decoded_name;
+    try {
+      decoded_name = HexDecode(path.filename().string());
+    }
+    catch (const std::exception&) {
+      continue;
+    }
+    if (decoded_name.size() != crypto::SHA512::DIGESTSIZE)
+      continue;
+    auto size(fs::file_size(path, error_code));
+    auto last_written(fs::last_write_time(path, error_code));
+    if (error_code)
+      continue;
+    ImmutableData::Name name(Identity(std::move(decoded_name)));
+    auto rank_itr(ranks.find(name));
+    Found entry = { name, size, last_written,
+                    rank_itr == std::end(ranks) ? kUnranked : rank_itr->second };
+    found.push_back(entry);
+  }
+
+  // Unlisted chunks written since the recency file (i.e. before a crash) come first, then the
+  // listed chunks in order, then any other unlisted ones by age.
+  auto group([&](const Found& entry) {
+    return entry.rank != kUnranked ? 1 : (entry.last_written >= recency_saved ? 0 : 2);
+  });
+  std::sort(std::begin(found), std::end(found), [&](const Found& lhs, const Found& rhs) {
+    if (group(lhs) != group(rhs))
+      return group(lhs) < group(rhs);
+    return lhs.rank != kUnranked ? lhs.rank < rhs.rank : lhs.last_written > rhs.last_written;
+  });
+  for (const auto& entry : found) {
+    recency_list_.push_back(entry.name);
+    Entry index_entry = { std::prev(std::end(recency_list_)), entry.size };
+    entries_.insert(std::make_pair(entry.name, index_entry));
+    current_disk_usage_ += entry.size;
+  }
+  std::vector<fs::path> doomed;
+  EvictUntilWithinLimit(0, doomed);
+  RemoveFiles(doomed);
+}
+
+void ChunkCache::SaveRecency() const {
+  std::string recency;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recency.reserve(recency_list_.size() * (2 * crypto::SHA512::DIGESTSIZE + 1));
+    for (const auto& name : recency_list_)
+      recency += HexEncode(name->string()) + '\n';
+  }
+  if (recency.empty()) {
+    boost::system::error_code error_code;
+    fs::remove(GetRecencyPath(), error_code);
+  } else if (!WriteFileAtomically(GetRecencyPath(), recency)) {
+    LOG(kWarning) << "Failed to save chunk cache recency order.";
+  }
+}
+
+void ChunkCache::Erase(std::map<ImmutableData::Name, Entry>::iterator itr,
+                       std::vector<fs::path>& doomed) {
+  doomed.push_back(GetPath(itr->first));
+  current_disk_usage_ -= itr->second.size;
+  recency_list_.erase(itr->second.recency_itr);
+  entries_.erase(itr);
+}
+
+void ChunkCache::EvictUntilWithinLimit(uint64_t required_space, std::vector<fs::path>& doomed) {
+  while (!recency_list_.empty() && current_disk_usage_ + required_space > kMaxDiskUsage_) {
+    Erase(entries_.find(recency_list_.back()), doomed);
+    ++statistics_.evictions;
+  }
+}
+
+void ChunkCache::MarkAsMostRecent(std::map<ImmutableData::Name, Entry>::iterator itr) {
+  // Only reordered in memory; the order reaches disk in 'SaveRecency'.
+  recency_list_.splice(std::begin(recency_list_), recency_list_, itr->second.recency_itr);
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
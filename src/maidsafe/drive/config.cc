@@ -25,6 +25,8 @@ namespace drive {
 namespace detail {
 
 const boost::filesystem::path kRoot(boost::filesystem::path("/").make_preferred());
+const boost::filesystem::path kControlDirectory(
+    boost::filesystem::path("/.drive").make_preferred());
 
 const MaxVersions kMaxVersions(1);
 
@@ -0,0 +1,271 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/content_index.h"
+
+#include <fstream>
+
+#include "boost/crc.hpp"
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+// Each record is a 4-byte payload size and a 4-byte CRC-32 of the payload, followed by the
+// payload: the content hash (4-byte size then bytes), the 8-byte content size and the serialised
+// data map.  All integers are little-endian.
+const size_t kHeaderSize(8);
+const uint32_t kMaxPayloadSize(64 * 1024 * 1024);
+
+void AppendUint32(uint32_t value, std::string& output) {
+  for (int i(0); i != 4; ++i)
+    output.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+void AppendUint64(uint64_t value, std::string& output) {
+  for (int i(0); i != 8; ++i)
+    output.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+uint32_t ReadUint32(const char* input) {
+  uint32_t value(0);
+  for (int i(0); i != 4; ++i)
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(input[i])) << (8 * i);
+  return value;
+}
+
+uint64_t ReadUint64(const char* input) {
+  uint64_t value(0);
+  for (int i(0); i != 8; ++i)
+    value |= static_cast<uint64_t>(static_cast<uint8_t>(input[i])) << (8 * i);
+  return value;
+}
+
+uint32_t Checksum(const std::string& payload) {
+  boost::crc_32_type crc;
+  crc.process_bytes(payload.data(), payload.size());
+  return crc.checksum();
+}
+
+std::FILE* OpenFile(const fs::path& path) {
+#ifdef MAIDSAFE_WIN32
+  return _wfopen(path.c_str(), L"a+b");
+#else
+  return std::fopen(path.c_str(), "a+b");
+#endif
+}
+
+bool Seek(std::FILE* file, uint64_t offset, int origin) {
+#ifdef MAIDSAFE_WIN32
+  return _fseeki64(file, static_cast<__int64>(offset), origin) == 0;
+#else
+  return fseeko(file, static_cast<off_t>(offset), origin) == 0;
+#endif
+}
+
+}  // unnamed namespace
+
+ContentIndex::ContentIndex(const fs::path& index_dir)
+    : kIndexPath_(index_dir / "content_index"),
+      mutex_(),
+      entries_(),
+      file_(nullptr),
+      file_size_(0),
+      hit_count_(0),
+      hit_bytes_(0) {
+  boost::system::error_code error_code;
+  if (!fs::exists(index_dir, error_code) && !fs::create_directories(index_dir, error_code)) {
+    LOG(kError) << "Failed to create content index at " << index_dir << ": "
+                << error_code.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  Load();
+  file_ = OpenFile(kIndexPath_);
+  if (!file_) {
+    LOG(kError) << "Failed to open " << kIndexPath_;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+}
+
+ContentIndex::~ContentIndex() {
+  if (file_)
+    std::fclose(file_);
+  LOG(kInfo) << "Content index reused " << hit_count_ << " data maps covering " << hit_bytes_
+             << " bytes.";
+}
+
+void ContentIndex::Load() {
+  boost::system::error_code error_code;
+  uint64_t index_size(fs::exists(kIndexPath_, error_code) ? fs::file_size(kIndexPath_, error_code)
+                                                           : 0);
+  if (error_code || index_size == 0)
+    return;
+
+  std::ifstream stream(kIndexPath_.string().c_str(), std::ios::binary);
+  std::string header(kHeaderSize, 0);
+  while (stream.read(&header[0], kHeaderSize)) {
+    auto payload_size(ReadUint32(&header[0]));
+    auto checksum(ReadUint32(&header[4]));
+    if (payload_size > kMaxPayloadSize || payload_size < 12)
+      break;
+    std::string payload(payload_size, 0);
+    if (!stream.read(&payload[0], payload_size) || Checksum(payload) != checksum)
+      break;
+    auto hash_size(ReadUint32(&payload[0]));
+    if (payload_size < 12 + static_cast<uint64_t>(hash_size))
+      break;
+    Key key(payload.substr(4, hash_size), ReadUint64(&payload[4 + hash_size]));
+    auto data_map_position(4 + hash_size + 8);
+    entries_[key] = std::make_pair(file_size_ + kHeaderSize + data_map_position,
+                                   payload_size - data_map_position);
+    file_size_ += kHeaderSize + payload_size;
+  }
+  stream.close();
+
+  if (file_size_ != index_size) {
+    LOG(kWarning) << "Discarding " << index_size - file_size_ << " bytes of torn or corrupt "
+                  << "records from the end of " << kIndexPath_;
+    fs::resize_file(kIndexPath_, file_size_);
+  }
+}
+
+bool ContentIndex::Find(const Key& key, encrypt::DataMap& data_map) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(entries_.find(key));
+  if (itr == std::end(entries_))
+    return false;
+  std::string serialised_data_map(itr->second.second, 0);
+  if (!Seek(file_, itr->second.first, SEEK_SET) ||
+      std::fread(&serialised_data_map[0], 1, serialised_data_map.size(), file_) !=
+          serialised_data_map.size()) {
+    LOG(kError) << "Failed to read from " << kIndexPath_;
+    return false;
+  }
+  try {
+    encrypt::ParseDataMap(serialised_data_map, data_map);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to parse indexed data map: " << e.what();
+    return false;
+  }
+  return true;
+}
+
+void ContentIndex::Add(const Key& key, const encrypt::DataMap& data_map) {
+  if (data_map.chunks.empty())
+    return;
+  std::string serialised_data_map;
+  encrypt::SerialiseDataMap(data_map, serialised_data_map);
+  std::string payload;
+  AppendUint32(static_cast<uint32_t>(key.first.size()), payload);
+  payload += key.first;
+  AppendUint64(key.second, payload);
+  auto data_map_position(payload.size());
+  payload += serialised_data_map;
+  if (payload.size() > kMaxPayloadSize)
+    return;
+  std::string record;
+  AppendUint32(static_cast<uint32_t>(payload.size()), record);
+  AppendUint32(Checksum(payload), record);
+  record += payload;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (entries_.count(key) != 0)
+    return;
+  // The index is only an optimisation, so it isn't synced; a torn record is dropped on the next
+  // load.  The seek is required between a read and a write on the same stream.
+  if (!Seek(file_, 0, SEEK_END) ||
+      std::fwrite(record.data(), 1, record.size(), file_) != record.size() ||
+      std::fflush(file_) != 0) {
+    LOG(kError) << "Failed to append to " << kIndexPath_;
+    return;
+  }
+  entries_[key] = std::make_pair(file_size_ + kHeaderSize + data_map_position,
+                                 static_cast<uint32_t>(serialised_data_map.size()));
+  file_size_ += record.size();
+}
+
+size_t ContentIndex::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void ContentIndex::RecordHit(uint64_t content_size) {
+  ++hit_count_;
+  hit_bytes_ += content_size;
+}
+
+ContentHasher::ContentHasher(std::shared_ptr<ContentIndex> content_index)
+    : content_index_(std::move(content_index)), hash_(), size_(0), valid_(true) {}
+
+void ContentHasher::Update(const char* data, uint32_t size, uint64_t offset) {
+  if (!valid_)
+    return;
+  if (offset != size_) {
+    valid_ = false;
+    return;
+  }
+  hash_.Update(reinterpret_cast<const byte*>(data), size);
+  size_ += size;
+}
+
+void ContentHasher::Truncate(uint64_t size) {
+  if (size == 0) {
+    hash_.Restart();
+    size_ = 0;
+    valid_ = true;
+  } else if (size != size_) {
+    valid_ = false;
+  }
+}
+
+bool ContentHasher::HashedWholeFile(uint64_t file_size) const {
+  return valid_ && size_ == file_size && file_size != 0;
+}
+
+ContentIndex::Key ContentHasher::GetKey() const {
+  // Finalising resets the hash, so a copy is finalised to allow hashing to continue.
+  crypto::SHA512 hash(hash_);
+  std::string digest(crypto::SHA512::DIGESTSIZE, 0);
+  hash.Final(reinterpret_cast<byte*>(&digest[0]));
+  return ContentIndex::Key(digest, size_);
+}
+
+bool ContentHasher::Find(uint64_t file_size, encrypt::DataMap& data_map) const {
+  return HashedWholeFile(file_size) && content_index_->Find(GetKey(), data_map);
+}
+
+bool ContentHasher::GetKey(uint64_t file_size, ContentIndex::Key& key) const {
+  if (!HashedWholeFile(file_size))
+    return false;
+  key = GetKey();
+  return true;
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,167 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/control_files.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+
+#include "maidsafe/common/error.h"
+
+#include "maidsafe/drive/config.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+void WriteValue(std::ostream& stream, double value) {
+  if (value == std::floor(value) && std::fabs(value) < 9007199254740992.0)  // 2^53
+    stream << static_cast<int64_t>(value);
+  else
+    stream << std::setprecision(6) << std::fixed << value;
+  stream.unsetf(std::ios::floatfield);
+}
+
+}  // unnamed namespace
+
+Statistic::Statistic(const std::string& name_in, const std::string& help_in, double value_in,
+                     Type type_in)
+    : name(name_in), help(help_in), value(value_in), type(type_in) {}
+
+std::string FormatStatistics(const std::vector<Statistic>& statistics) {
+  std::ostringstream stream;
+  for (const auto& statistic : statistics) {
+    stream << statistic.name << ' ';
+    WriteValue(stream, statistic.value);
+    stream << '\n';
+  }
+  return stream.str();
+}
+
+std::string FormatStatisticsForPrometheus(const std::vector<Statistic>& statistics) {
+  std::ostringstream stream;
+  std::string previous_family;
+  for (const auto& statistic : statistics) {
+    // Labelled statistics of the same family (e.g. 'name{label="value"}') share a single
+    // description.
+    std::string family("maidsafe_drive_" + statistic.name.substr(0, statistic.name.find('{')));
+    if (family != previous_family) {
+      stream << "# HELP " << family << ' ' << statistic.help << '\n' << "# TYPE " << family << ' '
+             << (statistic.type == Statistic::Type::kCounter ? "counter" : "gauge") << '\n';
+      previous_family = family;
+    }
+    stream << "maidsafe_drive_" << statistic.name << ' ';
+    WriteValue(stream, statistic.value);
+    stream << '\n';
+  }
+  return stream.str();
+}
+
+ControlFiles::ControlFiles() : enabled_(true), mutex_(), stat_files_(), control_files_() {}
+
+void ControlFiles::AddStatFile(const std::string& name, Generator generator) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  control_files_.erase(name);
+  stat_files_[name] = generator;
+}
+
+void ControlFiles::AddControlFile(const std::string& name, Action action) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stat_files_.erase(name);
+  control_files_[name] = action;
+}
+
+void ControlFiles::Disable() { enabled_ = false; }
+
+bool ControlFiles::IsControlPath(const boost::filesystem::path& path) const {
+  if (!enabled_)
+    return false;
+  auto itr(std::begin(path));
+  if (itr == std::end(path) || *itr != detail::kRoot)
+    return false;
+  ++itr;
+  return itr != std::end(path) && *itr == detail::kControlDirectory.filename();
+}
+
+bool ControlFiles::IsControlDirectory(const boost::filesystem::path& path) const {
+  return enabled_ && path == detail::kControlDirectory;
+}
+
+bool ControlFiles::IsStatFile(const boost::filesystem::path& path) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stat_files_.count(Name(path)) != 0;
+}
+
+bool ControlFiles::IsControlFile(const boost::filesystem::path& path) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return control_files_.count(Name(path)) != 0;
+}
+
+std::vector<std::string> ControlFiles::Names() const {
+  std::vector<std::string> names;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& stat_file : stat_files_)
+      names.push_back(stat_file.first);
+    for (const auto& control_file : control_files_)
+      names.push_back(control_file.first);
+  }
+  std::sort(std::begin(names), std::end(names));
+  return names;
+}
+
+std::string ControlFiles::Generate(const boost::filesystem::path& path) const {
+  Generator generator;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr(stat_files_.find(Name(path)));
+    if (itr == std::end(stat_files_))
+      BOOST_THROW_EXCEPTION(MakeError(DriveErrors::no_such_file));
+    generator = itr->second;
+  }
+  return generator();
+}
+
+void ControlFiles::Trigger(const boost::filesystem::path& path) const {
+  Action action;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr(control_files_.find(Name(path)));
+    if (itr == std::end(control_files_))
+      BOOST_THROW_EXCEPTION(MakeError(DriveErrors::no_such_file));
+    action = itr->second;
+  }
+  action();
+}
+
+// Returns an empty name (which never matches a file) unless 'path' is directly inside the control
+// directory.
+std::string ControlFiles::Name(const boost::filesystem::path& path) {
+  if (path.parent_path() != detail::kControlDirectory)
+    return std::string();
+  return path.filename().string();
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -21,9 +21,14 @@
 #include <algorithm>
 #include <iterator>
 
+#include "maidsafe/common/log.h"
 #include "maidsafe/common/profiler.h"
+#include "maidsafe/common/utils.h"
 
 #include "maidsafe/drive/meta_data.h"
+#include "maidsafe/drive/probes.h"
+#include "maidsafe/drive/slow_operation_log.h"
+#include "maidsafe/drive/tracer.h"
 #include "maidsafe/drive/utils.h"
 #include "maidsafe/drive/proto_structs.pb.h"
 
@@ -43,46 +48,200 @@ std::function<void(const boost::system::error_code&)> GetStoreFunctor(
   return [=](const boost::system::error_code& ec) {  // NOLINT
     if (ec != boost::asio::error::operation_aborted) {
       LOG(kInfo) << "Storing " << path;
-      put_functor(directory);
+      try {
+        put_functor(directory);
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Failed to store " << path << ", will retry: " << e.what();
+        directory->ScheduleForStoring();
+      }
     } else {
       LOG(kInfo) << "Timer was cancelled - not storing " << path;
     }
   };
 }
 
-void FlushEncryptor(FileContext* file_context,
-                    std::function<void(const ImmutableData&)> put_chunk_functor,
-                    std::vector<ImmutableData::Name>& chunks_to_be_incremented) {
-  file_context->self_encryptor->Flush();
-  if (file_context->self_encryptor->original_data_map().chunks.empty()) {
-    // If the original data map didn't contain any chunks, just store the new ones.
-    for (const auto& chunk : file_context->self_encryptor->data_map().chunks) {
-      auto content(file_context->buffer->Get(chunk.hash));
-      put_chunk_functor(ImmutableData(content));
+// Counts each chunk put on behalf of one of 'directory's children once the put has been handed to
+// storage.  A failure is logged and reported as false rather than thrown, since the child's
+// encryptor has already been flushed and the caller may be a destructor.
+std::function<bool(const ImmutableData&)> GetRecordingPutChunkFunctor(
+    Directory* directory, std::function<void(const ImmutableData&)> put_chunk_functor) {
+  return [=](const ImmutableData& chunk) -> bool {
+    try {
+      put_chunk_functor(chunk);
+      directory->write_amplification().RecordDataPut(chunk.data().string().size());
+      return true;
     }
-  } else {
-    // Check each new chunk against the original data map's chunks.  Store the new ones and
-    // increment the reference count on the existing chunks.
-    for (const auto& chunk : file_context->self_encryptor->data_map().chunks) {
-      if (std::any_of(std::begin(file_context->self_encryptor->original_data_map().chunks),
-                      std::end(file_context->self_encryptor->original_data_map().chunks),
-                      [&chunk](const encrypt::ChunkDetails& original_chunk) {
-                            return chunk.hash == original_chunk.hash;
-                      })) {
-        chunks_to_be_incremented.emplace_back(Identity(chunk.hash));
-      } else {
-        auto content(file_context->buffer->Get(chunk.hash));
-        put_chunk_functor(ImmutableData(content));
-      }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to store chunk " << HexSubstr(chunk.name()->string()) << ": "
+                  << e.what();
+      return false;
     }
+  };
+}
+
+// The chunks of one flushed file, to be put once 'Directory::mutex_' has been released, since
+// putting a chunk can wait for an upload slot or for the upload rate limit.
+struct FlushedChunks {
+  FlushedChunks() : buffer(), names(), copies(), content_index(), content_key(), data_map() {}
+  // The buffer of a deleted encryptor, with the names of the chunks to be put from it.
+  std::unique_ptr<FileContext::Buffer> buffer;
+  std::vector<std::string> names;
+  // Chunks of an encryptor which stays open are copied, as it may go on to change its buffer.
+  std::vector<ImmutableData> copies;
+  // Set if the file's content is to be indexed once all of its chunks have been put.
+  std::shared_ptr<ContentIndex> content_index;
+  ContentIndex::Key content_key;
+  encrypt::DataMap data_map;
+};
+
+typedef std::vector<std::unique_ptr<FlushedChunks>> PendingChunks;
+
+// If the whole of a file being closed was written from empty and the content index shows that the
+// same content has been stored before, the file is given the indexed data map rather than having
+// its encryptor flushed, and the chunks only have their reference counts incremented.
+bool ReuseIndexedDataMap(FileContext* file_context,
+                         std::vector<ImmutableData::Name>& chunks_to_be_incremented) {
+  if (!file_context->content_hasher || *file_context->open_count != 0)
+    return false;
+  const auto file_size(file_context->self_encryptor->size());
+  encrypt::DataMap indexed_data_map;
+  if (!file_context->content_hasher->Find(file_size, indexed_data_map))
+    return false;
+  file_context->content_hasher->content_index()->RecordHit(file_size);
+  // Emptying the encryptor leaves it nothing to encrypt should deleting it flush it.
+  file_context->self_encryptor->Truncate(0);
+  DRIVE_PROBE2(encryptor__delete, static_cast<void*>(file_context),
+               file_context->meta_data.name.c_str());
+  file_context->self_encryptor.reset();
+  file_context->buffer.reset();
+  file_context->content_hasher.reset();
+  *file_context->meta_data.data_map = indexed_data_map;
+  for (const auto& chunk : indexed_data_map.chunks)
+    chunks_to_be_incremented.emplace_back(Identity(chunk.hash));
+  LOG(kInfo) << "Content of " << file_context->meta_data.name << " already stored.";
+  return true;
+}
+
+// Must be called with the directory's mutex locked.  New chunks are added to 'pending' and chunks
+// which the original data map already held are added to 'chunks_to_be_incremented'.
+void FlushEncryptor(FileContext* file_context,
+                    std::vector<ImmutableData::Name>& chunks_to_be_incremented,
+                    PendingChunks& pending) {
+  DRIVE_TRACE_SCOPE("flush", "FlushEncryptor");
+  if (ReuseIndexedDataMap(file_context, chunks_to_be_incremented)) {
+    file_context->flushed = true;
+    return;
+  }
+  {
+    SlowOperationTimer timer(SlowOperationPhase::kEncryption);
+    file_context->self_encryptor->Flush();
+  }
+  std::unique_ptr<FlushedChunks> flushed(new FlushedChunks);
+  const auto& original_chunks(file_context->self_encryptor->original_data_map().chunks);
+  for (const auto& chunk : file_context->self_encryptor->data_map().chunks) {
+    if (std::any_of(std::begin(original_chunks), std::end(original_chunks),
+                    [&chunk](const encrypt::ChunkDetails& original_chunk) {
+                          return chunk.hash == original_chunk.hash;
+                    })) {
+      chunks_to_be_incremented.emplace_back(Identity(chunk.hash));
+    } else {
+      flushed->names.push_back(chunk.hash);
+    }
+  }
+  if (file_context->content_hasher &&
+      file_context->content_hasher->GetKey(file_context->self_encryptor->size(),
+                                           flushed->content_key)) {
+    flushed->content_index = file_context->content_hasher->content_index();
+    flushed->data_map = file_context->self_encryptor->data_map();
   }
   if (*file_context->open_count == 0) {
+    DRIVE_PROBE2(encryptor__delete, static_cast<void*>(file_context),
+                 file_context->meta_data.name.c_str());
     file_context->self_encryptor.reset();
-    file_context->buffer.reset();
+    file_context->content_hasher.reset();
+    flushed->buffer = std::move(file_context->buffer);
+  } else {
+    for (const auto& name : flushed->names)
+      flushed->copies.emplace_back(file_context->buffer->Get(name));
+    flushed->names.clear();
   }
+  pending.push_back(std::move(flushed));
   file_context->flushed = true;
 }
 
+// Must be called without the directory's mutex locked.  'put_chunk_functor' logs its own failures,
+// so only a chunk which can't be read back from its buffer is reported here.  A file's content is
+// only indexed once all of its chunks have been put.
+void PutChunks(const PendingChunks& pending,
+               const std::function<bool(const ImmutableData&)>& put_chunk_functor) {
+  for (const auto& flushed : pending) {
+    bool all_put(true);
+    for (const auto& chunk : flushed->copies)
+      all_put = put_chunk_functor(chunk) && all_put;
+    for (const auto& name : flushed->names) {
+      try {
+        all_put = put_chunk_functor(ImmutableData(flushed->buffer->Get(name))) && all_put;
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Failed to read chunk " << HexSubstr(name) << " for storing: " << e.what();
+        all_put = false;
+      }
+    }
+    if (all_put && flushed->content_index)
+      flushed->content_index->Add(flushed->content_key, flushed->data_map);
+  }
+}
+
+// What 'child' adds to its directory's statistics.
+Directory::Statistics ChildStatistics(const FileContext& child) {
+  Directory::Statistics statistics;
+  auto& memory(statistics.memory);
+  if (*child.open_count > 0)
+    ++statistics.open_children;
+  memory.file_contexts = sizeof(FileContext) + kHeapBlockOverhead + sizeof(std::atomic<int>) +
+                         kHeapBlockOverhead + HeapBytes(child.meta_data);
+  memory.file_context_count = 1;
+  if (child.meta_data.data_map) {
+    memory.data_maps = sizeof(encrypt::DataMap) + kHeapBlockOverhead +
+                       HeapBytes(*child.meta_data.data_map);
+  }
+  if (child.self_encryptor) {
+    ++statistics.live_encryptors;
+    memory.file_contexts += sizeof(encrypt::SelfEncryptor) + kHeapBlockOverhead;
+    memory.data_maps += sizeof(encrypt::DataMap) +
+                        HeapBytes(child.self_encryptor->original_data_map());
+  }
+  if (child.timer) {
+    memory.timers = sizeof(boost::asio::steady_timer) + kHeapBlockOverhead;
+    memory.timer_count = 1;
+  }
+  return statistics;
+}
+
+void AddChildStatistics(const Directory::Statistics& child, Directory::Statistics& total) {
+  total.open_children += child.open_children;
+  total.live_encryptors += child.live_encryptors;
+  total.memory.file_contexts += child.memory.file_contexts;
+  total.memory.file_context_count += child.memory.file_context_count;
+  total.memory.data_maps += child.memory.data_maps;
+  total.memory.timers += child.memory.timers;
+  total.memory.timer_count += child.memory.timer_count;
+}
+
+// A child may have grown since it was counted, so this stops at zero rather than wrapping.
+void SubtractChildStatistics(const Directory::Statistics& child, Directory::Statistics& total) {
+  auto subtract([](uint64_t amount, uint64_t& from) { from -= std::min(amount, from); });
+  auto subtract_count([](size_t amount, size_t& from) { from -= std::min(amount, from); });
+  subtract_count(child.open_children, total.open_children);
+  subtract_count(child.live_encryptors, total.live_encryptors);
+  subtract(child.memory.file_contexts, total.memory.file_contexts);
+  subtract_count(child.memory.file_context_count, total.memory.file_context_count);
+  subtract(child.memory.data_maps, total.memory.data_maps);
+  subtract(child.memory.timers, total.memory.timers);
+  subtract_count(child.memory.timer_count, total.memory.timer_count);
+}
+
 }  // unnamed namespace
 
 Directory::Directory(
@@ -90,14 +249,16 @@ Directory::Directory(
     std::function<void(Directory*)> put_functor,  // NOLINT
     std::function<void(const ImmutableData&)> put_chunk_functor,
     std::function<void(const std::vector<ImmutableData::Name>&)> increment_chunks_functor,
-    const boost::filesystem::path& path)
-        : mutex_(), cond_var_(), parent_id_(std::move(parent_id)),
+    const boost::filesystem::path& path, WriteAmplification* total_write_amplification)
+        : mutex_(SlowOperationPhase::kDirectoryLock), cond_var_(), parent_id_(std::move(parent_id)),
           directory_id_(std::move(directory_id)), timer_(io_service),
           store_functor_(GetStoreFunctor(this, put_functor, path)),
-          put_chunk_functor_(put_chunk_functor),
+          put_chunk_functor_(GetRecordingPutChunkFunctor(this, put_chunk_functor)),
           increment_chunks_functor_(increment_chunks_functor), chunks_to_be_incremented_(),
-          versions_(), max_versions_(kMaxVersions), children_(), children_count_position_(0),
-          store_state_(StoreState::kComplete) {
+          uploads_in_progress_(0), versions_(), max_versions_(kMaxVersions), children_(),
+          children_count_position_(0), store_state_(StoreState::kComplete),
+          write_amplification_(total_write_amplification), children_statistics_(),
+          statistics_mutex_(), statistics_() {
   DoScheduleForStoring();
 }
 
@@ -108,13 +269,18 @@ Directory::Directory(
     std::function<void(Directory*)> put_functor,  // NOLINT
     std::function<void(const ImmutableData&)> put_chunk_functor,
     std::function<void(const std::vector<ImmutableData::Name>&)> increment_chunks_functor,
-    const boost::filesystem::path& path)
-        : mutex_(), cond_var_(), parent_id_(std::move(parent_id)), directory_id_(),
-          timer_(io_service), store_functor_(GetStoreFunctor(this, put_functor, path)),
-          put_chunk_functor_(put_chunk_functor),
+    const boost::filesystem::path& path, WriteAmplification* total_write_amplification)
+        : mutex_(SlowOperationPhase::kDirectoryLock), cond_var_(), parent_id_(std::move(parent_id)),
+          directory_id_(), timer_(io_service),
+          store_functor_(GetStoreFunctor(this, put_functor, path)),
+          put_chunk_functor_(GetRecordingPutChunkFunctor(this, put_chunk_functor)),
           increment_chunks_functor_(increment_chunks_functor), chunks_to_be_incremented_(),
-          versions_(std::begin(versions), std::end(versions)), max_versions_(kMaxVersions),
-          children_(), children_count_position_(0), store_state_(StoreState::kComplete) {
+          uploads_in_progress_(0), versions_(std::begin(versions), std::end(versions)),
+          max_versions_(kMaxVersions), children_(), children_count_position_(0),
+          store_state_(StoreState::kComplete),
+          write_amplification_(total_write_amplification), children_statistics_(),
+          statistics_mutex_(), statistics_() {
+  DRIVE_TRACE_SCOPE("directory", "Directory::Parse");
   protobuf::Directory proto_directory;
   if (!proto_directory.ParseFromString(serialised_directory))
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
@@ -125,29 +291,42 @@ Directory::Directory(
   for (int i(0); i != proto_directory.children_size(); ++i)
     children_.emplace_back(new FileContext(MetaData(proto_directory.children(i)), this));
   SortAndResetChildrenCounter();
+  for (const auto& child : children_)
+    AddChildStatistics(ChildStatistics(*child), children_statistics_);
+  UpdateStatistics();
 }
 
 Directory::~Directory() {
-  std::unique_lock<std::mutex> lock(mutex_);
+  DRIVE_TRACE_SCOPE("scheduler", "Directory::~Directory");
+  std::unique_lock<TimedMutex> lock(mutex_);
   DoScheduleForStoring(false);
+  SlowOperationTimer timer(SlowOperationPhase::kStoreWait);
   bool result(cond_var_.wait_for(lock, kDirectoryInactivityDelay + std::chrono::milliseconds(500),
-                                 [&] { return store_state_ == StoreState::kComplete; }));
+                                 [&] {
+                                   return store_state_ == StoreState::kComplete &&
+                                          uploads_in_progress_ == 0;
+                                 }));
   assert(result);
   static_cast<void>(result);
 }
 
 std::string Directory::Serialise() {
+  DRIVE_TRACE_SCOPE("flush", "Directory::Serialise");
   protobuf::Directory proto_directory;
+  PendingChunks pending;
+  std::vector<ImmutableData::Name> chunks_to_be_incremented;
   {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<TimedMutex> lock(mutex_);
     proto_directory.set_directory_id(directory_id_.string());
     proto_directory.set_max_versions(max_versions_.data);
 
+    // Every child is visited anyway, so the running totals are recounted from scratch.
+    children_statistics_ = Statistics();
     for (const auto& child : children_) {
       child->meta_data.ToProtobuf(proto_directory.add_children());
       if (child->self_encryptor) {  // Child is a file which has been opened
         child->timer->cancel();
-        FlushEncryptor(child.get(), put_chunk_functor_, chunks_to_be_incremented_);
+        FlushEncryptor(child.get(), chunks_to_be_incremented_, pending);
         child->flushed = false;
       } else if (child->meta_data.data_map) {
         if (child->flushed) {  // Child is a file which has already been flushed
@@ -157,19 +336,55 @@ std::string Directory::Serialise() {
             chunks_to_be_incremented_.emplace_back(Identity(chunk.hash));
         }
       }
+      AddChildStatistics(ChildStatistics(*child), children_statistics_);
     }
-    increment_chunks_functor_(chunks_to_be_incremented_);
-    chunks_to_be_incremented_.clear();
+    chunks_to_be_incremented.swap(chunks_to_be_incremented_);
+    ++uploads_in_progress_;
+    SetStoreState(StoreState::kOngoing);
+  }
+
+  PutChunks(pending, put_chunk_functor_);
+  try {
+    increment_chunks_functor_(chunks_to_be_incremented);
+    write_amplification_.RecordReferenceCountIncrement(chunks_to_be_incremented.size());
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to increment " << chunks_to_be_incremented.size() << " chunks: "
+                << e.what();
+  }
 
-    store_state_ = StoreState::kOngoing;
+  {
+    // The listing mustn't be stored before chunks which other threads are still putting for its
+    // children.
+    std::unique_lock<TimedMutex> lock(mutex_);
+    --uploads_in_progress_;
+    cond_var_.notify_all();
+    SlowOperationTimer timer(SlowOperationPhase::kStoreWait);
+    cond_var_.wait(lock, [&] { return uploads_in_progress_ == 0; });
   }
   return proto_directory.SerializeAsString();
 }
 
 void Directory::FlushChildAndDeleteEncryptor(FileContext* child) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (child->self_encryptor)  // Child could already have been flushed via 'Directory::Serialise'
-    FlushEncryptor(child, put_chunk_functor_, chunks_to_be_incremented_);
+  DRIVE_TRACE_SCOPE("flush", "Directory::FlushChildAndDeleteEncryptor");
+  PendingChunks pending;
+  {
+    std::lock_guard<TimedMutex> lock(mutex_);
+    // Child could already have been flushed via 'Directory::Serialise'
+    if (!child->self_encryptor)
+      return;
+    SubtractChildStatistics(ChildStatistics(*child), children_statistics_);
+    FlushEncryptor(child, chunks_to_be_incremented_, pending);
+    AddChildStatistics(ChildStatistics(*child), children_statistics_);
+    UpdateStatistics();
+    ++uploads_in_progress_;
+  }
+  PutChunks(pending, put_chunk_functor_);
+  {
+    std::lock_guard<TimedMutex> lock(mutex_);
+    --uploads_in_progress_;
+  }
+  cond_var_.notify_all();
 }
 
 size_t Directory::VersionsCount() const {
@@ -180,16 +395,17 @@ std::tuple<DirectoryId, StructuredDataVersions::VersionName>
     Directory::InitialiseVersions(ImmutableData::Name version_id) {
   std::tuple<DirectoryId, StructuredDataVersions::VersionName> result;
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    store_state_ = StoreState::kComplete;
+    std::lock_guard<TimedMutex> lock(mutex_);
+    SetStoreState(StoreState::kComplete);
     if (versions_.empty()) {
       versions_.emplace_back(0, version_id);
       result = std::make_tuple(directory_id_, versions_[0]);
+      UpdateStatistics();
     } else {
       BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
     }
   }
-  cond_var_.notify_one();
+  cond_var_.notify_all();
   return result;
 }
 
@@ -198,8 +414,8 @@ std::tuple<DirectoryId, StructuredDataVersions::VersionName, StructuredDataVersi
   std::tuple<DirectoryId, StructuredDataVersions::VersionName,
              StructuredDataVersions::VersionName> result;
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    store_state_ = StoreState::kComplete;
+    std::lock_guard<TimedMutex> lock(mutex_);
+    SetStoreState(StoreState::kComplete);
     if (versions_.empty()) {
       versions_.emplace_back(0, version_id);
       result = std::make_tuple(directory_id_, StructuredDataVersions::VersionName(), versions_[0]);
@@ -210,8 +426,9 @@ std::tuple<DirectoryId, StructuredDataVersions::VersionName, StructuredDataVersi
       if (versions_.size() > max_versions_)
         versions_.pop_back();
     }
+    UpdateStatistics();
   }
-  cond_var_.notify_one();
+  cond_var_.notify_all();
   return result;
 }
 
@@ -236,6 +453,7 @@ void Directory::SortAndResetChildrenCounter() {
 }
 
 void Directory::DoScheduleForStoring(bool use_delay) {
+  DRIVE_TRACE_SCOPE("scheduler", "Directory::DoScheduleForStoring");
   if (use_delay) {
     auto cancelled_count(timer_.expires_from_now(kDirectoryInactivityDelay));
 #ifndef NDEBUG
@@ -248,7 +466,7 @@ void Directory::DoScheduleForStoring(bool use_delay) {
 #endif
     static_cast<void>(cancelled_count);
     timer_.async_wait(store_functor_);
-    store_state_ = StoreState::kPending;
+    SetStoreState(StoreState::kPending);
   } else if (store_state_ == StoreState::kPending) {
     // If 'use_delay' is false, the implication is that we should only store if there's already
     // a pending store waiting - i.e. we're just bringing forward the deadline of any outstanding
@@ -262,7 +480,7 @@ void Directory::DoScheduleForStoring(bool use_delay) {
     } else {
       LOG(kWarning) << "Failed to cancel store functor.";
     }
-    store_state_ = StoreState::kPending;
+    SetStoreState(StoreState::kPending);
 #ifndef NDEBUG
   } else {
     LOG(kInfo) << "No store functor pending.";
@@ -270,15 +488,39 @@ void Directory::DoScheduleForStoring(bool use_delay) {
   }
 }
 
+void Directory::SetStoreState(StoreState store_state) {
+  store_state_ = store_state;
+  DRIVE_PROBE2(directory__store__state, static_cast<void*>(this), static_cast<int>(store_state));
+  UpdateStatistics();
+}
+
+void Directory::UpdateStatistics() {
+  Statistics statistics(children_statistics_);
+  auto& memory(statistics.memory);
+  memory.directories = sizeof(Directory) + kHeapBlockOverhead +
+                       children_.capacity() * sizeof(Children::value_type) + kHeapBlockOverhead +
+                       versions_.size() * sizeof(StructuredDataVersions::VersionName);
+  for (const auto& version : versions_)
+    memory.directories += HeapBytes(version.id->string());
+  memory.upload_queues = chunks_to_be_incremented_.capacity() * sizeof(ImmutableData::Name);
+  for (const auto& name : chunks_to_be_incremented_)
+    memory.upload_queues += HeapBytes(name->string());
+  memory.timers += sizeof(timer_);
+  ++memory.timer_count;
+  statistics.store_pending = (store_state_ != StoreState::kComplete);
+  std::lock_guard<std::mutex> lock(statistics_mutex_);
+  statistics_ = statistics;
+}
+
 bool Directory::HasChild(const fs::path& name) const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<TimedMutex> lock(mutex_);
   return std::any_of(std::begin(children_), std::end(children_),
       [&name](const Children::value_type& file_context) {
           return file_context->meta_data.name == name; });
 }
 
 const FileContext* Directory::GetChild(const fs::path& name) const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<TimedMutex> lock(mutex_);
   auto itr(Find(name));
   if (itr == std::end(children_))
     BOOST_THROW_EXCEPTION(MakeError(DriveErrors::no_such_file));
@@ -292,7 +534,8 @@ const FileContext* Directory::GetChild(const fs::path& name) const {
 
 FileContext* Directory::GetMutableChild(const fs::path& name) {
   SCOPED_PROFILE
-  std::lock_guard<std::mutex> lock(mutex_);
+  DRIVE_TRACE_SCOPE("directory", "Directory::GetMutableChild");
+  std::lock_guard<TimedMutex> lock(mutex_);
   auto itr(Find(name));
   if (itr == std::end(children_))
     BOOST_THROW_EXCEPTION(MakeError(DriveErrors::no_such_file));
@@ -305,7 +548,7 @@ FileContext* Directory::GetMutableChild(const fs::path& name) {
 }
 
 const FileContext* Directory::GetChildAndIncrementCounter() {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<TimedMutex> lock(mutex_);
   if (children_count_position_ < children_.size()) {
     const FileContext* file_context(children_[children_count_position_].get());
     ++children_count_position_;
@@ -315,57 +558,62 @@ const FileContext* Directory::GetChildAndIncrementCounter() {
 }
 
 void Directory::AddChild(FileContext&& child) {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<TimedMutex> lock(mutex_);
   auto itr(Find(child.meta_data.name));
   if (itr != std::end(children_))
     BOOST_THROW_EXCEPTION(MakeError(DriveErrors::file_exists));
   child.parent = this;
   children_.emplace_back(new FileContext(std::move(child)));
+  AddChildStatistics(ChildStatistics(*children_.back()), children_statistics_);
   SortAndResetChildrenCounter();
   DoScheduleForStoring();
 }
 
 FileContext Directory::RemoveChild(const fs::path& name) {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<TimedMutex> lock(mutex_);
   auto itr(Find(name));
   if (itr == std::end(children_))
     BOOST_THROW_EXCEPTION(MakeError(DriveErrors::no_such_file));
   std::unique_ptr<FileContext> file_context(std::move(*itr));
   children_.erase(itr);
+  SubtractChildStatistics(ChildStatistics(*file_context), children_statistics_);
   SortAndResetChildrenCounter();
   DoScheduleForStoring();
   return std::move(*file_context);
 }
 
 void Directory::RenameChild(const fs::path& old_name, const fs::path& new_name) {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<TimedMutex> lock(mutex_);
   assert(Find(new_name) == std::end(children_));
   auto itr(Find(old_name));
   if (itr == std::end(children_))
     BOOST_THROW_EXCEPTION(MakeError(DriveErrors::no_such_file));
+  SubtractChildStatistics(ChildStatistics(**itr), children_statistics_);
   (*itr)->meta_data.name = new_name;
+  AddChildStatistics(ChildStatistics(**itr), children_statistics_);
   SortAndResetChildrenCounter();
   DoScheduleForStoring();
 }
 
 void Directory::ResetChildrenCounter() {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<TimedMutex> lock(mutex_);
   children_count_position_ = 0;
 }
 
 bool Directory::empty() const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<TimedMutex> lock(mutex_);
   return children_.empty();
 }
 
 ParentId Directory::parent_id() const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<TimedMutex> lock(mutex_);
   return parent_id_;
 }
 
 void Directory::SetNewParent(const ParentId parent_id, std::function<void(Directory*)> put_functor,  // NOLINT
                              const boost::filesystem::path& path) {
-  std::unique_lock<std::mutex> lock(mutex_);
+  std::unique_lock<TimedMutex> lock(mutex_);
+  SlowOperationTimer timer(SlowOperationPhase::kStoreWait);
   bool result(cond_var_.wait_for(lock, std::chrono::milliseconds(500),
                                  [&] { return store_state_ != StoreState::kOngoing; }));
   assert(result);
@@ -375,20 +623,25 @@ void Directory::SetNewParent(const ParentId parent_id, std::function<void(Direct
 }
 
 DirectoryId Directory::directory_id() const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<TimedMutex> lock(mutex_);
   return directory_id_;
 }
 
 void Directory::ScheduleForStoring() {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<TimedMutex> lock(mutex_);
   DoScheduleForStoring();
 }
 
 void Directory::StoreImmediatelyIfPending() {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<TimedMutex> lock(mutex_);
   DoScheduleForStoring(false);
 }
 
+Directory::Statistics Directory::GetStatistics() const {
+  std::lock_guard<std::mutex> lock(statistics_mutex_);
+  return statistics_;
+}
+
 bool operator<(const Directory& lhs, const Directory& rhs) {
   return lhs.directory_id() < rhs.directory_id();
 }
@@ -29,20 +29,21 @@ namespace drive {
 namespace detail {
 
 FileContext::FileContext()
-    : meta_data(), buffer(), self_encryptor(), timer(), open_count(new std::atomic<int>(0)),
-      parent(nullptr), flushed(false) {}
+    : meta_data(), buffer(), self_encryptor(), content_hasher(), timer(),
+      open_count(new std::atomic<int>(0)), parent(nullptr), flushed(false) {}
 
 FileContext::FileContext(FileContext&& other)
     : meta_data(std::move(other.meta_data)), buffer(std::move(other.buffer)),
-      self_encryptor(std::move(other.self_encryptor)), timer(std::move(other.timer)),
+      self_encryptor(std::move(other.self_encryptor)),
+      content_hasher(std::move(other.content_hasher)), timer(std::move(other.timer)),
       open_count(std::move(other.open_count)), parent(other.parent), flushed(other.flushed) {}
 
 FileContext::FileContext(MetaData meta_data_in, Directory* parent_in)
-    : meta_data(std::move(meta_data_in)), buffer(), self_encryptor(), timer(),
+    : meta_data(std::move(meta_data_in)), buffer(), self_encryptor(), content_hasher(), timer(),
       open_count(new std::atomic<int>(0)), parent(parent_in), flushed(false) {}
 
 FileContext::FileContext(const boost::filesystem::path& name, bool is_directory)
-    : meta_data(name, is_directory), buffer(), self_encryptor(), timer(),
+    : meta_data(name, is_directory), buffer(), self_encryptor(), content_hasher(), timer(),
       open_count(new std::atomic<int>(0)), parent(nullptr), flushed(false) {}
 
 FileContext& FileContext::operator=(FileContext other) {
@@ -62,6 +63,7 @@ void swap(FileContext& lhs, FileContext& rhs) MAIDSAFE_NOEXCEPT {
   swap(lhs.meta_data, rhs.meta_data);
   swap(lhs.buffer, rhs.buffer);
   swap(lhs.self_encryptor, rhs.self_encryptor);
+  swap(lhs.content_hasher, rhs.content_hasher);
   swap(lhs.timer, rhs.timer);
   swap(lhs.open_count, rhs.open_count);
   swap(lhs.parent, rhs.parent);
@@ -0,0 +1,192 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/known_chunk_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+const size_t kNameSize(crypto::SHA512::DIGESTSIZE);
+// Keeps a linear scan of the recent keys cheap next to the binary search of the sorted ones.
+const size_t kMaxRecentKeys(1024);
+
+}  // unnamed namespace
+
+const size_t KnownChunkIndex::kDefaultMaxNames;
+
+KnownChunkIndex::KnownChunkIndex(const fs::path& index_path, size_t max_names)
+    : kIndexPath_(index_path),
+      kMaxNames_(max_names),
+      mutex_(),
+      keys_(),
+      recent_keys_(),
+      index_file_(),
+      names_in_file_(0),
+      persistent_(true),
+      full_(false),
+      statistics_() {
+  boost::system::error_code error_code;
+  if (!fs::exists(kIndexPath_.parent_path(), error_code))
+    fs::create_directories(kIndexPath_.parent_path(), error_code);
+  LoadIndex();
+  index_file_.open(kIndexPath_.string().c_str(),
+                   std::ios::out | std::ios::binary | std::ios::app);
+  if (!index_file_) {
+    LOG(kError) << "Failed to open known chunk index " << kIndexPath_;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  LOG(kInfo) << "Known chunk index " << kIndexPath_ << " holds " << keys_.size() << " names.";
+}
+
+bool KnownChunkIndex::Contains(const ImmutableData::Name& name) {
+  auto key(ToKey(name->string()));
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++statistics_.lookups;
+  if (!ContainsKey(key))
+    return false;
+  ++statistics_.hits;
+  return true;
+}
+
+void KnownChunkIndex::Add(const ImmutableData::Name& name) {
+  auto key(ToKey(name->string()));
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (ContainsKey(key))
+    return;
+  if (keys_.size() + recent_keys_.size() >= kMaxNames_) {
+    if (!full_) {
+      LOG(kWarning) << "Known chunk index " << kIndexPath_ << " holds its limit of " << kMaxNames_
+                    << " names.  Further chunks won't be deduplicated.";
+      full_ = true;
+    }
+    return;
+  }
+  recent_keys_.push_back(key);
+  if (recent_keys_.size() == kMaxRecentKeys)
+    MergeRecentKeys();
+  ++statistics_.additions;
+  if (persistent_ && !Append(name->string())) {
+    LOG(kError) << "Failed to append to known chunk index " << kIndexPath_
+                << ".  Newly known chunks will only be held in memory.";
+    persistent_ = false;
+  }
+}
+
+size_t KnownChunkIndex::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return keys_.size() + recent_keys_.size();
+}
+
+KnownChunkIndex::Statistics KnownChunkIndex::GetStatistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+
+KnownChunkIndex::Key KnownChunkIndex::ToKey(const std::string& name) {
+  Key key(0, 0);
+  std::memcpy(&key.first, name.data(), std::min(sizeof(key.first), name.size()));
+  if (name.size() > sizeof(key.first)) {
+    std::memcpy(&key.second, name.data() + sizeof(key.first),
+                std::min(sizeof(key.second), name.size() - sizeof(key.first)));
+  }
+  return key;
+}
+
+void KnownChunkIndex::LoadIndex() {
+  std::ifstream index_file(kIndexPath_.string().c_str(), std::ios::in | std::ios::binary);
+  if (!index_file)
+    return;
+  std::string name(kNameSize, 0);
+  while (index_file.read(&name[0], kNameSize)) {
+    ++names_in_file_;
+    if (keys_.size() < kMaxNames_)
+      keys_.push_back(ToKey(name));
+  }
+  if (index_file.gcount() != 0) {
+    LOG(kWarning) << "Ignoring truncated entry at end of known chunk index " << kIndexPath_;
+    index_file.close();
+    boost::system::error_code error_code;
+    fs::resize_file(kIndexPath_, names_in_file_ * kNameSize, error_code);
+  }
+  std::sort(std::begin(keys_), std::end(keys_));
+  keys_.erase(std::unique(std::begin(keys_), std::end(keys_)), std::end(keys_));
+}
+
+// Must be called with 'mutex_' locked.
+bool KnownChunkIndex::ContainsKey(const Key& key) const {
+  return std::binary_search(std::begin(keys_), std::end(keys_), key) ||
+         std::find(std::begin(recent_keys_), std::end(recent_keys_), key) !=
+             std::end(recent_keys_);
+}
+
+// Must be called with 'mutex_' locked.
+void KnownChunkIndex::MergeRecentKeys() {
+  std::sort(std::begin(recent_keys_), std::end(recent_keys_));
+  auto middle(keys_.insert(std::end(keys_), std::begin(recent_keys_), std::end(recent_keys_)));
+  std::inplace_merge(std::begin(keys_), middle, std::end(keys_));
+  recent_keys_.clear();
+}
+
+// Must be called with 'mutex_' locked.  After a failed write the file is cut back to its last
+// complete name and reopened once, so a partial name can't misalign the names appended after it.
+bool KnownChunkIndex::Append(const std::string& name) {
+  index_file_.write(name.data(), name.size());
+  index_file_.flush();
+  if (!index_file_) {
+    LOG(kWarning) << "Failed to append to known chunk index " << kIndexPath_ << ", reopening it.";
+    if (!ReopenIndexFile())
+      return false;
+    index_file_.write(name.data(), name.size());
+    index_file_.flush();
+    if (!index_file_)
+      return false;
+  }
+  ++names_in_file_;
+  return true;
+}
+
+// Must be called with 'mutex_' locked.
+bool KnownChunkIndex::ReopenIndexFile() {
+  index_file_.close();
+  index_file_.clear();
+  boost::system::error_code error_code;
+  fs::resize_file(kIndexPath_, names_in_file_ * kNameSize, error_code);
+  if (error_code)
+    return false;
+  index_file_.open(kIndexPath_.string().c_str(),
+                   std::ios::out | std::ios::binary | std::ios::app);
+  return static_cast<bool>(index_file_);
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
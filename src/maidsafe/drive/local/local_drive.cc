@@ -22,6 +22,9 @@
 #endif
 #include <csignal>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -44,6 +47,7 @@
 #include "maidsafe/common/crypto.h"
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
+#include "maidsafe/common/on_scope_exit.h"
 #include "maidsafe/common/process.h"
 #include "maidsafe/common/rsa.h"
 #include "maidsafe/common/utils.h"
@@ -56,6 +60,14 @@
 #else
 #include "maidsafe/drive/unix_drive.h"
 #endif
+#include "maidsafe/drive/allocation_tracker.h"
+#include "maidsafe/drive/content_index.h"
+#include "maidsafe/drive/memory_store.h"
+#include "maidsafe/drive/packed_store.h"
+#include "maidsafe/drive/simulated_network_store.h"
+#include "maidsafe/drive/slow_operation_log.h"
+#include "maidsafe/drive/tracer.h"
+#include "maidsafe/drive/uring_store.h"
 #include "maidsafe/drive/tools/launcher.h"
 
 namespace fs = boost::filesystem;
@@ -68,12 +80,32 @@ namespace drive {
 namespace {
 
 #ifdef MAIDSAFE_WIN32
-typedef CbfsDrive<data_stores::LocalStore> LocalDrive;
+template <typename Storage>
+using LocalDrive = CbfsDrive<Storage>;
 #else
-typedef FuseDrive<data_stores::LocalStore> LocalDrive;
+template <typename Storage>
+using LocalDrive = FuseDrive<Storage>;
 #endif
 
-LocalDrive* g_local_drive(nullptr);
+// The drive's Storage type depends on the options, so the mounted drive is only reachable from the
+// signal handlers and parent monitor via 'g_unmount_functor'.
+std::function<void()> g_unmount_functor;
+std::atomic<bool> g_drive_mounted(false);
+// Runtime settings applied to the drive once it's been constructed.
+struct DriveSettings {
+  DriveSettings()
+      : storage_metrics_interval(0),
+        upload_bytes_per_second(0),
+        content_index(),
+        operation_trace_file(),
+        control_files(true) {}
+  std::chrono::seconds storage_metrics_interval;
+  uint64_t upload_bytes_per_second;
+  std::shared_ptr<ContentIndex> content_index;
+  fs::path operation_trace_file;
+  bool control_files;
+};
+DriveSettings g_drive_settings;
 std::once_flag g_unmount_flag;
 const std::string kConfigFile("maidsafe_local_drive.conf");
 std::string g_error_message;
@@ -81,8 +113,9 @@ int g_return_code(0);
 
 void Unmount() {
   std::call_once(g_unmount_flag, [&] {
-    g_local_drive->Unmount();
-    g_local_drive = nullptr;
+    if (g_unmount_functor)
+      g_unmount_functor();
+    g_drive_mounted = false;
   });
 }
 
@@ -94,7 +127,7 @@ process::ProcessInfo GetParentProcessInfo(const Options& options) {
 
 BOOL CtrlHandler(DWORD control_type) {
   LOG(kInfo) << "Received console control signal " << control_type << ".  Unmounting.";
-  if (!g_local_drive)
+  if (!g_drive_mounted)
     return FALSE;
   Unmount();
   return TRUE;
@@ -142,7 +175,36 @@ po::options_description VisibleOptions() {
       ("parent_id,R", po::value<std::string>(), " root parent directory identifier (required)")
       ("drive_name,N", po::value<std::string>(), " virtual drive name")
       ("create,C", " Must be called on first run")
-      ("check_data,Z", " check all data in chunkstore");
+      ("check_data,Z", " check all data in chunkstore")
+      ("in_memory", " hold all chunks in memory rather than in storage_dir (nothing is persisted)")
+      ("packed", " append chunks to pack files in storage_dir rather than storing one file per chunk "
+          "(a drive must always be mounted with the same choice)")
+      ("simulated_network", po::value<std::string>(), " simulate network storage latency, bandwidth "
+          "and failures, e.g. \"latency=normal:80:20,upload_kbps=512,failure=0.01,seed=1\"")
+      ("storage_metrics_interval", po::value<int>()->default_value(0),
+          " seconds between dumps of the storage metrics to storage_metrics.txt (0 only dumps on "
+          "unmount)")
+      ("upload_rate_limit", po::value<uint64_t>()->default_value(0),
+          " maximum rate in kB/s at which file content is written to storage (0 is unlimited)")
+      ("disable_content_index", " store the chunks of every file written, even when a file with "
+          "the same content has already been stored")
+      ("disable_control_files", " don't serve the .drive directory of stat and control files")
+      ("trace_file", po::value<std::string>(), " record a timeline of the drive's internal "
+          "operations and write it to this file (Chrome trace-event JSON) on unmount")
+      ("allocation_report", po::value<std::string>(), " count heap allocations by drive operation "
+          "and write the heaviest sites to this file on unmount (only in builds configured with "
+          "DRIVE_ALLOCATION_TRACKING)")
+      ("slow_operation_ms", po::value<int>()->default_value(0), " log a breakdown of each "
+          "filesystem call taking at least this many milliseconds (0 disables)")
+      ("record_operations", po::value<std::string>(), " record every filesystem call to this file "
+          "(for replay with the filesystem_commands tool)");
+#ifdef MAIDSAFE_DRIVE_LIBURING
+  options.add_options()
+      ("io_uring", " read and write chunks in storage_dir via io_uring (a drive must always be "
+          "mounted with the same choice)")
+      ("uring_queue_depth", po::value<unsigned>()->default_value(64),
+          " maximum number of io_uring operations in flight");
+#endif
   return options;
 }
 
@@ -250,16 +312,12 @@ void ValidateOptions(const Options& options) {
 
 void MonitorParentProcess(const Options& options) {
   auto parent_process_info(GetParentProcessInfo(options));
-  while (g_local_drive && process::IsRunning(parent_process_info))
+  while (g_drive_mounted && process::IsRunning(parent_process_info))
     std::this_thread::sleep_for(std::chrono::milliseconds(250));
   Unmount();
 }
 
-int MountAndWaitForIpcNotification(const Options& options) {
-  fs::path storage_path(options.storage_path / "local_store");
-  DiskUsage disk_usage(std::numeric_limits<uint64_t>().max());
-  auto storage(std::make_shared<data_stores::LocalStore>(storage_path, disk_usage));
-
+int CheckDirectories(const Options& options) {
   boost::system::error_code error_code;
   if (!fs::exists(options.storage_path, error_code)) {
     LOG(kError) << options.storage_path << " doesn't exist.";
@@ -272,11 +330,35 @@ int MountAndWaitForIpcNotification(const Options& options) {
       return error_code.value();
     }
   }
+  return 0;
+}
 
-  LocalDrive drive(storage, options.unique_id, options.root_parent_id, options.mount_path,
-                   GetUserAppDir(), options.drive_name, options.mount_status_shared_object_name,
-                   options.create_store);
-  g_local_drive = &drive;
+template <typename Storage>
+void ApplyDriveSettings(LocalDrive<Storage>& drive) {
+  drive.SetStorageMetricsDumpInterval(g_drive_settings.storage_metrics_interval);
+  drive.SetUploadRateLimit(g_drive_settings.upload_bytes_per_second);
+  drive.SetContentIndex(g_drive_settings.content_index);
+  if (!g_drive_settings.control_files)
+    drive.control_files().Disable();
+  if (!g_drive_settings.operation_trace_file.empty()) {
+    try {
+      drive.StartRecordingOperations(g_drive_settings.operation_trace_file);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to start recording operations to "
+                  << g_drive_settings.operation_trace_file << ": " << e.what();
+    }
+  }
+}
+
+template <typename Storage>
+int MountAndWaitForIpcNotification(const Options& options, std::shared_ptr<Storage> storage) {
+  LocalDrive<Storage> drive(storage, options.unique_id, options.root_parent_id, options.mount_path,
+                            GetUserAppDir(), options.drive_name,
+                            options.mount_status_shared_object_name, options.create_store);
+  g_unmount_functor = [&drive] { drive.Unmount(); };
+  g_drive_mounted = true;
+  ApplyDriveSettings(drive);
 #ifdef MAIDSAFE_WIN32
   std::string guid(BOOST_PP_STRINGIZE(PRODUCT_ID));
   drive.SetGuid(guid);
@@ -285,34 +367,20 @@ int MountAndWaitForIpcNotification(const Options& options) {
   std::thread poll_parent([&] { MonitorParentProcess(options); });
 
   drive.Mount();
-  // Drive should already be unmounted by this point, but we need to make 'g_local_drive' null to
+  // Drive should already be unmounted by this point, but we need to clear 'g_drive_mounted' to
   // allow 'poll_parent' to join.
   Unmount();
   poll_parent.join();
   return 0;
 }
 
-int MountAndWaitForSignal(const Options& options) {
-  fs::path storage_path(options.storage_path / "local_store");
-  DiskUsage disk_usage(std::numeric_limits<uint64_t>().max());
-  auto storage(std::make_shared<data_stores::LocalStore>(storage_path, disk_usage));
-
-  boost::system::error_code error_code;
-  if (!fs::exists(options.storage_path, error_code)) {
-    LOG(kError) << options.storage_path << " doesn't exist.";
-    return error_code.value();
-  }
-  if (!fs::exists(GetUserAppDir(), error_code)) {
-    LOG(kError) << "Creating " << GetUserAppDir();
-    if (!fs::create_directories(GetUserAppDir(), error_code)) {
-      LOG(kError) << GetUserAppDir() << " creation failed.";
-      return error_code.value();
-    }
-  }
-
-  LocalDrive drive(storage, options.unique_id, options.root_parent_id, options.mount_path,
-                   GetUserAppDir(), options.drive_name, "", options.create_store);
-  g_local_drive = &drive;
+template <typename Storage>
+int MountAndWaitForSignal(const Options& options, std::shared_ptr<Storage> storage) {
+  LocalDrive<Storage> drive(storage, options.unique_id, options.root_parent_id, options.mount_path,
+                            GetUserAppDir(), options.drive_name, "", options.create_store);
+  g_unmount_functor = [&drive] { drive.Unmount(); };
+  g_drive_mounted = true;
+  ApplyDriveSettings(drive);
 #ifdef MAIDSAFE_WIN32
   std::string guid(BOOST_PP_STRINGIZE(PRODUCT_ID));
   drive.SetGuid(guid);
@@ -321,6 +389,130 @@ int MountAndWaitForSignal(const Options& options) {
   return 0;
 }
 
+template <typename Storage>
+int Mount(const Options& options, bool using_ipc, std::shared_ptr<Storage> storage) {
+  auto result(CheckDirectories(options));
+  if (result != 0)
+    return result;
+  if (using_ipc)
+    return MountAndWaitForIpcNotification(options, storage);
+  SetSignalHandler();
+  return MountAndWaitForSignal(options, storage);
+}
+
+template <typename Storage>
+int MountAndWait(const Options& options, bool using_ipc, const po::variables_map& variables_map,
+                 std::shared_ptr<Storage> storage) {
+  auto simulated_network(GetStringFromProgramOption("simulated_network", variables_map));
+  if (simulated_network.empty())
+    return Mount(options, using_ipc, storage);
+
+  SimulatedNetworkProfile profile;
+  try {
+    profile = SimulatedNetworkProfile::Parse(simulated_network);
+  }
+  catch (const std::exception&) {
+    g_error_message = "Fatal error:\n  Invalid simulated_network value \"" + simulated_network +
+                      "\"\nRun with -h to see all options.\n\n";
+    g_return_code = 32;
+    throw;
+  }
+  return Mount(options, using_ipc,
+               std::make_shared<SimulatedNetworkStore<Storage>>(storage, profile));
+}
+
+void WriteTrace(const fs::path& trace_file) {
+  if (trace_file.empty())
+    return;
+  if (Tracer::Instance().StopAndWrite(trace_file))
+    LOG(kInfo) << "Wrote trace to " << trace_file;
+  else
+    LOG(kWarning) << "Failed to write trace to " << trace_file;
+}
+
+void StartAllocationTracking(const fs::path& report_file) {
+  if (report_file.empty())
+    return;
+  if (!AllocationTracker::hooked())
+    LOG(kWarning) << "Allocation tracking isn't built in; the report will be empty.";
+  AllocationTracker::Instance().Start();
+}
+
+void WriteAllocationReport(const fs::path& report_file) {
+  if (report_file.empty())
+    return;
+  AllocationTracker::Instance().Stop();
+  std::ofstream stream(report_file.string(), std::ios::out | std::ios::trunc);
+  if (stream << AllocationTracker::Instance().Report(AllocationTracker::kMaxSites))
+    LOG(kInfo) << "Wrote allocation report to " << report_file;
+  else
+    LOG(kWarning) << "Failed to write allocation report to " << report_file;
+}
+
+// Indexed data maps are only known to be held by the store which they were recorded against, so
+// each store has its own index.  There's none for in-memory storage, which is lost on unmount, or
+// for io_uring storage, whose Puts return before their chunks have been written.
+void UseContentIndex(const po::variables_map& variables_map, const fs::path& index_dir) {
+  if (variables_map.count("disable_content_index"))
+    return;
+  try {
+    g_drive_settings.content_index = std::make_shared<ContentIndex>(index_dir);
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Running without a content index: " << e.what();
+  }
+}
+
+int MountAndWait(const Options& options, bool using_ipc, const po::variables_map& variables_map) {
+  fs::path trace_file(GetStringFromProgramOption("trace_file", variables_map));
+  if (!trace_file.empty())
+    Tracer::Instance().Start();
+  on_scope_exit write_trace([trace_file] { WriteTrace(trace_file); });
+  fs::path allocation_report(GetStringFromProgramOption("allocation_report", variables_map));
+  StartAllocationTracking(allocation_report);
+  on_scope_exit write_allocation_report([allocation_report] {
+    WriteAllocationReport(allocation_report);
+  });
+  SlowOperationLog::Instance().SetThreshold(
+      std::chrono::milliseconds(std::max(variables_map.at("slow_operation_ms").as<int>(), 0)));
+  g_drive_settings.storage_metrics_interval =
+      std::chrono::seconds(std::max(variables_map.at("storage_metrics_interval").as<int>(), 0));
+  g_drive_settings.upload_bytes_per_second =
+      variables_map.at("upload_rate_limit").as<uint64_t>() * 1024;
+  g_drive_settings.operation_trace_file =
+      GetStringFromProgramOption("record_operations", variables_map);
+  g_drive_settings.control_files = variables_map.count("disable_control_files") == 0;
+  if (variables_map.count("in_memory")) {
+    LOG(kInfo) << "Using in-memory storage - all data will be lost on unmount.";
+    return MountAndWait(options, using_ipc, variables_map, std::make_shared<MemoryStore>());
+  }
+  DiskUsage disk_usage(std::numeric_limits<uint64_t>().max());
+  if (variables_map.count("packed")) {
+    LOG(kInfo) << "Using packed storage.";
+    UseContentIndex(variables_map, options.storage_path / "packed_store_content_index");
+    auto version_store(std::make_shared<data_stores::LocalStore>(
+        options.storage_path / "packed_store_versions", disk_usage));
+    return MountAndWait(options, using_ipc, variables_map,
+                        std::make_shared<PackedStore>(options.storage_path / "packed_store",
+                                                      version_store));
+  }
+#ifdef MAIDSAFE_DRIVE_LIBURING
+  if (variables_map.count("io_uring")) {
+    auto queue_depth(variables_map.at("uring_queue_depth").as<unsigned>());
+    LOG(kInfo) << "Using io_uring storage with a queue depth of " << queue_depth;
+    auto version_store(std::make_shared<data_stores::LocalStore>(
+        options.storage_path / "uring_store_versions", disk_usage));
+    return MountAndWait(options, using_ipc, variables_map,
+                        std::make_shared<UringStore>(options.storage_path / "uring_store",
+                                                     queue_depth, version_store));
+  }
+#endif
+  UseContentIndex(variables_map, options.storage_path / "local_store_content_index");
+  fs::path storage_path(options.storage_path / "local_store");
+  return MountAndWait(options, using_ipc, variables_map,
+                      std::make_shared<data_stores::LocalStore>(storage_path, disk_usage));
+}
+
 }  // unnamed namespace
 
 }  // namespace drive
@@ -362,12 +554,7 @@ int main(int argc, char* argv[]) {
 
     // Validate options and run the Drive
     maidsafe::drive::ValidateOptions(options);
-    if (using_ipc) {
-      return maidsafe::drive::MountAndWaitForIpcNotification(options);
-    } else {
-      maidsafe::drive::SetSignalHandler();
-      return maidsafe::drive::MountAndWaitForSignal(options);
-    }
+    return maidsafe::drive::MountAndWait(options, using_ipc, variables_map);
   }
   catch (const std::exception& e) {
     if (!maidsafe::drive::g_error_message.empty()) {
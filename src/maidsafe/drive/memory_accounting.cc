@@ -0,0 +1,173 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/memory_accounting.h"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "boost/filesystem/operations.hpp"
+
+namespace maidsafe {
+
+namespace drive {
+
+MemoryStatistics::MemoryStatistics()
+    : directories(0),
+      file_contexts(0),
+      data_maps(0),
+      file_buffer_memory_limit(0),
+      directory_buffer_memory_limit(0),
+      file_buffer_disk(0),
+      directory_buffer_disk(0),
+      upload_queues(0),
+      timers(0),
+      timer_count(0),
+      file_context_count(0) {}
+
+MemoryStatistics& MemoryStatistics::operator+=(const MemoryStatistics& other) {
+  directories += other.directories;
+  file_contexts += other.file_contexts;
+  data_maps += other.data_maps;
+  file_buffer_memory_limit += other.file_buffer_memory_limit;
+  directory_buffer_memory_limit += other.directory_buffer_memory_limit;
+  file_buffer_disk += other.file_buffer_disk;
+  directory_buffer_disk += other.directory_buffer_disk;
+  upload_queues += other.upload_queues;
+  timers += other.timers;
+  timer_count += other.timer_count;
+  file_context_count += other.file_context_count;
+  return *this;
+}
+
+uint64_t MemoryStatistics::TotalMemory() const {
+  return directories + file_contexts + data_maps + file_buffer_memory_limit +
+         directory_buffer_memory_limit + upload_queues + timers;
+}
+
+std::vector<Statistic> ToStatistics(const MemoryStatistics& memory) {
+  const std::string kHelp("Estimated live bytes held in memory by each subsystem; the buffers "
+                          "give their limits.");
+  std::vector<Statistic> statistics;
+  auto add([&](const std::string& subsystem, uint64_t bytes) {
+    statistics.emplace_back("memory_bytes{subsystem=\"" + subsystem + "\"}", kHelp,
+                            static_cast<double>(bytes));
+  });
+  add("directories", memory.directories);
+  add("file_contexts", memory.file_contexts);
+  add("data_maps", memory.data_maps);
+  add("file_buffers", memory.file_buffer_memory_limit);
+  add("directory_buffer", memory.directory_buffer_memory_limit);
+  add("upload_queues", memory.upload_queues);
+  add("timers", memory.timers);
+  statistics.emplace_back("memory_bytes_total", "Sum of the memory_bytes statistics.",
+                          static_cast<double>(memory.TotalMemory()));
+  statistics.emplace_back("memory_bytes_per_cached_entry",
+      "Memory held by cached directories, FileContexts and data maps per cached FileContext.",
+      memory.file_context_count == 0 ? 0.0 :
+          static_cast<double>(memory.directories + memory.file_contexts + memory.data_maps) /
+              memory.file_context_count);
+  statistics.emplace_back("memory_disk_bytes{subsystem=\"file_buffers\"}",
+                          "Disk space used by each buffer.",
+                          static_cast<double>(memory.file_buffer_disk));
+  statistics.emplace_back("memory_disk_bytes{subsystem=\"directory_buffer\"}",
+                          "Disk space used by each buffer.",
+                          static_cast<double>(memory.directory_buffer_disk));
+  statistics.emplace_back("memory_timers", "Live asio timers.",
+                          static_cast<double>(memory.timer_count));
+  return statistics;
+}
+
+uint64_t HeapBytesInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  auto info(mallinfo2());
+  return static_cast<uint64_t>(info.uordblks) + static_cast<uint64_t>(info.hblkhd);
+#elif defined(__GLIBC__)
+  auto info(mallinfo());
+  return static_cast<uint64_t>(static_cast<unsigned>(info.uordblks)) +
+         static_cast<uint64_t>(static_cast<unsigned>(info.hblkhd));
+#else
+  return 0;
+#endif
+}
+
+namespace detail {
+
+uint64_t HeapBytes(const std::string& value) {
+  // Short strings are held within the object itself.
+  const char* object(reinterpret_cast<const char*>(&value));
+  if (value.data() >= object && value.data() < object + sizeof(value))
+    return 0;
+  return value.capacity() + 1 + kHeapBlockOverhead;
+}
+
+uint64_t HeapBytes(const boost::filesystem::path& path) {
+#ifdef MAIDSAFE_WIN32
+  const std::wstring& value(path.native());
+  const char* object(reinterpret_cast<const char*>(&value));
+  const char* data(reinterpret_cast<const char*>(value.data()));
+  if (data >= object && data < object + sizeof(value))
+    return 0;
+  return (value.capacity() + 1) * sizeof(wchar_t) + kHeapBlockOverhead;
+#else
+  return HeapBytes(path.native());
+#endif
+}
+
+uint64_t HeapBytes(const encrypt::DataMap& data_map) {
+  uint64_t bytes(HeapBytes(data_map.content));
+  if (data_map.chunks.capacity() != 0)
+    bytes += data_map.chunks.capacity() * sizeof(encrypt::ChunkDetails) + kHeapBlockOverhead;
+  for (const auto& chunk : data_map.chunks)
+    bytes += HeapBytes(chunk.hash) + HeapBytes(chunk.pre_hash);
+  return bytes;
+}
+
+uint64_t HeapBytes(const MetaData& meta_data) {
+  uint64_t bytes(HeapBytes(meta_data.name));
+#ifndef MAIDSAFE_WIN32
+  bytes += HeapBytes(meta_data.link_to);
+#endif
+  if (meta_data.directory_id) {
+    bytes += sizeof(DirectoryId) + kHeapBlockOverhead +
+             HeapBytes(meta_data.directory_id->string());
+  }
+  return bytes;
+}
+
+uint64_t DirectorySize(const boost::filesystem::path& directory) {
+  uint64_t total(0);
+  boost::system::error_code ec;
+  boost::filesystem::recursive_directory_iterator itr(directory, ec), end;
+  while (!ec && itr != end) {
+    if (boost::filesystem::is_regular_file(itr->status())) {
+      auto size(boost::filesystem::file_size(itr->path(), ec));
+      if (!ec)
+        total += size;
+    }
+    itr.increment(ec);
+  }
+  return total;
+}
+
+}  // namespace detail
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,154 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/memory_store.h"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+template <typename T>
+boost::future<T> MakeErrorFuture(CommonErrors error) {
+  boost::promise<T> promise;
+  promise.set_exception(boost::copy_exception(MakeError(error)));
+  return promise.get_future();
+}
+
+}  // unnamed namespace
+
+MemoryStore::MemoryStore() : mutex_(), chunks_(), version_trees_(), memory_usage_(0) {}
+
+boost::future<ImmutableData> MemoryStore::Get(const ImmutableData::Name& data_name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(chunks_.find(data_name));
+  if (itr == std::end(chunks_)) {
+    LOG(kWarning) << HexSubstr(data_name->string()) << " not in memory store.";
+    return MakeErrorFuture<ImmutableData>(CommonErrors::no_such_element);
+  }
+  boost::promise<ImmutableData> promise;
+  promise.set_value(itr->second.first);
+  return promise.get_future();
+}
+
+void MemoryStore::Put(const ImmutableData& data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto result(chunks_.insert(std::make_pair(data.name(), Chunk(data, 1))));
+  if (result.second)
+    memory_usage_ += data.data().string().size();
+  else
+    ++result.first->second.second;
+}
+
+void MemoryStore::Delete(const ImmutableData::Name& data_name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(chunks_.find(data_name));
+  if (itr == std::end(chunks_)) {
+    LOG(kWarning) << "Can't delete " << HexSubstr(data_name->string()) << " - not held.";
+    return;
+  }
+  if (--itr->second.second == 0) {
+    memory_usage_ -= itr->second.first.data().string().size();
+    chunks_.erase(itr);
+  }
+}
+
+void MemoryStore::IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& data_name : data_names) {
+    auto itr(chunks_.find(data_name));
+    if (itr == std::end(chunks_))
+      LOG(kWarning) << "Can't increment " << HexSubstr(data_name->string()) << " - not held.";
+    else
+      ++itr->second.second;
+  }
+}
+
+boost::future<MemoryStore::VersionNames> MemoryStore::GetVersions(
+    const MutableData::Name& data_name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(version_trees_.find(data_name));
+  if (itr == std::end(version_trees_))
+    return MakeErrorFuture<VersionNames>(CommonErrors::no_such_element);
+  boost::promise<VersionNames> promise;
+  promise.set_value(itr->second->Get());
+  return promise.get_future();
+}
+
+boost::future<MemoryStore::VersionNames> MemoryStore::GetBranch(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& branch_tip) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(version_trees_.find(data_name));
+  if (itr == std::end(version_trees_))
+    return MakeErrorFuture<VersionNames>(CommonErrors::no_such_element);
+  boost::promise<VersionNames> promise;
+  try {
+    promise.set_value(itr->second->GetBranch(branch_tip));
+  }
+  catch (...) {
+    promise.set_exception(boost::current_exception());
+  }
+  return promise.get_future();
+}
+
+void MemoryStore::PutVersion(const MutableData::Name& data_name,
+                             const StructuredDataVersions::VersionName& old_version_name,
+                             const StructuredDataVersions::VersionName& new_version_name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(version_trees_.find(data_name));
+  if (itr == std::end(version_trees_))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  itr->second->Put(old_version_name, new_version_name);
+}
+
+boost::future<void> MemoryStore::CreateVersionTree(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& version_name,
+    uint32_t max_versions, uint32_t max_branches) {
+  std::unique_ptr<StructuredDataVersions> versions(
+      new StructuredDataVersions(max_versions, max_branches));
+  boost::promise<void> promise;
+  try {
+    versions->Put(StructuredDataVersions::VersionName(), version_name);
+    std::lock_guard<std::mutex> lock(mutex_);
+    version_trees_[data_name] = std::move(versions);
+    promise.set_value();
+  }
+  catch (...) {
+    promise.set_exception(boost::current_exception());
+  }
+  return promise.get_future();
+}
+
+MemoryUsage MemoryStore::GetCurrentMemoryUsage() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return MemoryUsage(memory_usage_);
+}
+
+size_t MemoryStore::ChunkCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return chunks_.size();
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -22,10 +22,13 @@
 #endif
 #include <signal.h>
 
+#include <algorithm>
+#include <chrono>
 #include <functional>
 #include <iostream>  // NOLINT
 #include <memory>
 #include <string>
+#include <vector>
 #include <fstream>  // NOLINT
 #include <iterator>
 
@@ -43,6 +46,7 @@
 #include "maidsafe/common/crypto.h"
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
+#include "maidsafe/common/on_scope_exit.h"
 #include "maidsafe/common/process.h"
 #include "maidsafe/common/rsa.h"
 #include "maidsafe/common/utils.h"
@@ -60,6 +64,17 @@
 #else
 #include "maidsafe/drive/unix_drive.h"
 #endif
+#include "maidsafe/drive/allocation_tracker.h"
+#include "maidsafe/drive/cached_store.h"
+#include "maidsafe/drive/chunk_cache.h"
+#include "maidsafe/drive/content_index.h"
+#include "maidsafe/drive/deduplicating_store.h"
+#include "maidsafe/drive/known_chunk_index.h"
+#include "maidsafe/drive/slow_operation_log.h"
+#include "maidsafe/drive/storage_scheduler.h"
+#include "maidsafe/drive/tracer.h"
+#include "maidsafe/drive/write_back_journal.h"
+#include "maidsafe/drive/write_back_store.h"
 #include "maidsafe/drive/tools/launcher.h"
 
 namespace fs = boost::filesystem;
@@ -71,10 +86,11 @@ namespace drive {
 
 namespace {
 
+typedef WriteBackStore<CachedStore<DeduplicatingStore<nfs_client::MaidNodeNfs>>> NetworkStorage;
 #ifdef MAIDSAFE_WIN32
-typedef CbfsDrive<nfs_client::MaidNodeNfs> NetworkDrive;
+typedef CbfsDrive<NetworkStorage> NetworkDrive;
 #else
-typedef FuseDrive<nfs_client::MaidNodeNfs> NetworkDrive;
+typedef FuseDrive<NetworkStorage> NetworkDrive;
 #endif
 
 fs::path g_root, g_temp, g_storage;
@@ -228,7 +244,28 @@ po::options_description VisibleOptions() {
                       "The index of key to be used as client")
       ("keys_path", po::value<std::string>()->default_value(fs::path(
                        fs::temp_directory_path(error_code) / "key_directory.dat").string()),
-                    "Path to keys file");
+                    "Path to keys file")
+      ("chunk_cache_size", po::value<uint64_t>()->default_value(1024),
+                           " maximum size in MB of the local chunk cache (0 disables it)")
+      ("disable_known_chunk_index", " upload every chunk, even those known to be held already")
+      ("disable_write_back_journal", " wait for every store to reach the network")
+      ("disable_content_index", " upload the chunks of every file written, even when a file with "
+          "the same content has already been uploaded")
+      ("disable_control_files", " don't serve the .drive directory of stat and control files")
+      ("storage_metrics_interval", po::value<int>()->default_value(0),
+          " seconds between dumps of the storage metrics to storage_metrics.txt (0 only dumps on "
+          "unmount)")
+      ("upload_rate_limit", po::value<uint64_t>()->default_value(0),
+          " maximum rate in kB/s at which file content is uploaded (0 is unlimited)")
+      ("trace_file", po::value<std::string>(), " record a timeline of the drive's internal "
+          "operations and write it to this file (Chrome trace-event JSON) on unmount")
+      ("allocation_report", po::value<std::string>(), " count heap allocations by drive operation "
+          "and write the heaviest sites to this file on unmount (only in builds configured with "
+          "DRIVE_ALLOCATION_TRACKING)")
+      ("slow_operation_ms", po::value<int>()->default_value(0), " log a breakdown of each "
+          "filesystem call taking at least this many milliseconds (0 disables)")
+      ("record_operations", po::value<std::string>(), " record every filesystem call to this file "
+          "(for replay with the filesystem_commands tool)");
   return options;
 }
 
@@ -371,7 +408,129 @@ int MountAndWaitForSignal(NetworkDrive& drive) {
   return 0;
 }
 
-int MountAndWait(const Options& options, bool use_ipc) {
+std::shared_ptr<ChunkCache> CreateChunkCache(uint64_t chunk_cache_size) {
+  if (chunk_cache_size == 0)
+    return nullptr;
+  try {
+    return std::make_shared<ChunkCache>(GetUserAppDir() / "chunk_cache",
+                                        DiskUsage(chunk_cache_size * 1024 * 1024));
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Running without a chunk cache: " << e.what();
+    return nullptr;
+  }
+}
+
+// The network holds reference counts per account, so each account needs its own index.
+std::shared_ptr<KnownChunkIndex> CreateKnownChunkIndex(bool enabled, const Identity& unique_id) {
+  if (!enabled)
+    return nullptr;
+  try {
+    return std::make_shared<KnownChunkIndex>(
+        GetUserAppDir() / "known_chunks" / HexEncode(unique_id.string()).substr(0, 32));
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Running without a known chunk index: " << e.what();
+    return nullptr;
+  }
+}
+
+// Like the known chunk index, the journal's contents are only valid for the account which wrote
+// them.
+std::shared_ptr<WriteBackJournal> CreateWriteBackJournal(bool enabled, const Identity& unique_id) {
+  if (!enabled)
+    return nullptr;
+  try {
+    return std::make_shared<WriteBackJournal>(
+        GetUserAppDir() / "write_back_journal" / HexEncode(unique_id.string()).substr(0, 32));
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Running without a write-back journal: " << e.what();
+    return nullptr;
+  }
+}
+
+// Indexed data maps are only known to be stored for the account which stored them.
+std::shared_ptr<ContentIndex> CreateContentIndex(bool enabled, const Identity& unique_id) {
+  if (!enabled)
+    return nullptr;
+  try {
+    return std::make_shared<ContentIndex>(
+        GetUserAppDir() / "content_index" / HexEncode(unique_id.string()).substr(0, 32));
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Running without a content index: " << e.what();
+    return nullptr;
+  }
+}
+
+void WriteTrace(const fs::path& trace_file) {
+  if (trace_file.empty())
+    return;
+  if (Tracer::Instance().StopAndWrite(trace_file))
+    LOG(kInfo) << "Wrote trace to " << trace_file;
+  else
+    LOG(kWarning) << "Failed to write trace to " << trace_file;
+}
+
+void StartAllocationTracking(const fs::path& report_file) {
+  if (report_file.empty())
+    return;
+  if (!AllocationTracker::hooked())
+    LOG(kWarning) << "Allocation tracking isn't built in; the report will be empty.";
+  AllocationTracker::Instance().Start();
+}
+
+void WriteAllocationReport(const fs::path& report_file) {
+  if (report_file.empty())
+    return;
+  AllocationTracker::Instance().Stop();
+  std::ofstream stream(report_file.string(), std::ios::out | std::ios::trunc);
+  if (stream << AllocationTracker::Instance().Report(AllocationTracker::kMaxSites))
+    LOG(kInfo) << "Wrote allocation report to " << report_file;
+  else
+    LOG(kWarning) << "Failed to write allocation report to " << report_file;
+}
+
+// Exposes the state of the chunk cache and write-back queue through the drive's control directory.
+void AddStorageStatistics(NetworkDrive& drive, std::shared_ptr<NetworkStorage> storage,
+                          std::shared_ptr<ChunkCache> chunk_cache) {
+  drive.AddStatisticsProvider([storage, chunk_cache]()->std::vector<Statistic> {
+    std::vector<Statistic> statistics;
+    statistics.emplace_back("write_back_pending_chunks",
+                            "Chunks stored locally but not yet on the network.",
+                            static_cast<double>(storage->pending_count()));
+    if (!chunk_cache)
+      return statistics;
+    auto cache(chunk_cache->GetStatistics());
+    statistics.emplace_back("chunk_cache_hits_total", "Chunks served from the local cache.",
+                            static_cast<double>(cache.hits), Statistic::Type::kCounter);
+    statistics.emplace_back("chunk_cache_misses_total", "Chunks fetched from the network.",
+                            static_cast<double>(cache.misses), Statistic::Type::kCounter);
+    statistics.emplace_back("chunk_cache_evictions_total", "Chunks evicted from the local cache.",
+                            static_cast<double>(cache.evictions), Statistic::Type::kCounter);
+    statistics.emplace_back("chunk_cache_hit_ratio", "Fraction of chunk fetches which hit.",
+                            cache.HitRate());
+    statistics.emplace_back("chunk_cache_disk_bytes", "Disk space used by the local cache.",
+                            static_cast<double>(chunk_cache->GetCurrentDiskUsage().data));
+    return statistics;
+  });
+  if (chunk_cache)
+    drive.control_files().AddControlFile("drop_caches", [chunk_cache] { chunk_cache->Clear(); });
+}
+
+int MountAndWait(const Options& options, bool use_ipc, const po::variables_map& variables_map) {
+  fs::path trace_file(GetStringFromProgramOption("trace_file", variables_map));
+  if (!trace_file.empty())
+    Tracer::Instance().Start();
+  on_scope_exit write_trace([trace_file] { WriteTrace(trace_file); });
+  fs::path allocation_report(GetStringFromProgramOption("allocation_report", variables_map));
+  StartAllocationTracking(allocation_report);
+  on_scope_exit write_allocation_report([allocation_report] {
+    WriteAllocationReport(allocation_report);
+  });
+  SlowOperationLog::Instance().SetThreshold(
+      std::chrono::milliseconds(std::max(variables_map.at("slow_operation_ms").as<int>(), 0)));
   std::shared_ptr<passport::Maid> maid;
   std::shared_ptr<passport::Anmaid> anmaid;
   std::shared_ptr<passport::Pmid> pmid;
@@ -414,12 +573,48 @@ int MountAndWait(const Options& options, bool use_ipc) {
   std::cout << "network_drive root_parent_id : " << HexSubstr(root_parent_id.string()) << std::endl;
 
 //   bool create_store(!account_exists);
-  NetworkDrive drive(g_client_nfs_, unique_id, root_parent_id, options.mount_path, GetUserAppDir(),
+  bool use_known_chunk_index(variables_map.count("disable_known_chunk_index") == 0);
+  auto deduplicating_storage(std::make_shared<DeduplicatingStore<nfs_client::MaidNodeNfs>>(
+      g_client_nfs_, CreateKnownChunkIndex(use_known_chunk_index, unique_id)));
+  auto cached_storage(std::make_shared<CachedStore<DeduplicatingStore<nfs_client::MaidNodeNfs>>>(
+      deduplicating_storage,
+      CreateChunkCache(variables_map.at("chunk_cache_size").as<uint64_t>())));
+  bool use_write_back_journal(variables_map.count("disable_write_back_journal") == 0);
+  auto journal(CreateWriteBackJournal(use_write_back_journal, unique_id));
+  // With a journal, uploads reach the network from its replay thread, so they're scheduled and
+  // rate limited there; the drive's own scheduler would only throttle appends to the journal.
+  std::shared_ptr<StorageScheduler> replay_scheduler;
+  if (journal)
+    replay_scheduler = std::make_shared<StorageScheduler>();
+  auto storage(std::make_shared<NetworkStorage>(cached_storage, journal, replay_scheduler));
+  NetworkDrive drive(storage, unique_id, root_parent_id, options.mount_path, GetUserAppDir(),
                      options.drive_name, options.mount_status_shared_object_name, false);
   g_network_drive = &drive;
 #ifdef MAIDSAFE_WIN32
   g_network_drive->SetGuid(BOOST_PP_STRINGIZE(PRODUCT_ID));
 #endif
+  drive.SetStorageMetricsDumpInterval(std::chrono::seconds(
+      std::max(variables_map.at("storage_metrics_interval").as<int>(), 0)));
+  uint64_t upload_rate_limit(variables_map.at("upload_rate_limit").as<uint64_t>() * 1024);
+  if (replay_scheduler)
+    replay_scheduler->SetUploadRateLimit(upload_rate_limit);
+  else
+    drive.SetUploadRateLimit(upload_rate_limit);
+  drive.SetContentIndex(
+      CreateContentIndex(variables_map.count("disable_content_index") == 0, unique_id));
+  if (variables_map.count("disable_control_files"))
+    drive.control_files().Disable();
+  AddStorageStatistics(drive, storage, cached_storage->cache());
+  fs::path operation_trace_file(GetStringFromProgramOption("record_operations", variables_map));
+  if (!operation_trace_file.empty()) {
+    try {
+      drive.StartRecordingOperations(operation_trace_file);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to start recording operations to " << operation_trace_file << ": "
+                  << e.what();
+    }
+  }
   if (use_ipc) {
     return MountAndWaitForIpcNotification(options, drive);
   } else {
@@ -474,10 +669,10 @@ int main(int argc, char* argv[]) {
     // Validate options and run the Drive
     maidsafe::drive::ValidateOptions(options);
     if (using_ipc) {
-      return maidsafe::drive::MountAndWait(options, true);
+      return maidsafe::drive::MountAndWait(options, true, variables_map);
     } else {
       maidsafe::drive::SetSignalHandler();
-      maidsafe::drive::MountAndWait(options, false);
+      maidsafe::drive::MountAndWait(options, false, variables_map);
 
       maidsafe::drive::RemoveTempDirectory();
       maidsafe::drive::RemoveStorageDirectory(options.storage_path);
@@ -0,0 +1,280 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/operation_metrics.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+size_t HighestSetBit(uint64_t value) {
+  size_t bit(0);
+  for (size_t shift(32); shift != 0; shift >>= 1) {
+    if ((value >> shift) != 0) {
+      value >>= shift;
+      bit += shift;
+    }
+  }
+  return bit;
+}
+
+// String literals, so that they can name allocation scopes.
+const char* OperationName(DriveOperation operation) {
+  switch (operation) {
+    case DriveOperation::kAccess: return "OpsAccess";
+    case DriveOperation::kChmod: return "OpsChmod";
+    case DriveOperation::kChown: return "OpsChown";
+    case DriveOperation::kCreate: return "OpsCreate";
+    case DriveOperation::kDestroy: return "OpsDestroy";
+    case DriveOperation::kFgetattr: return "OpsFgetattr";
+    case DriveOperation::kFlush: return "OpsFlush";
+    case DriveOperation::kFtruncate: return "OpsFtruncate";
+    case DriveOperation::kGetattr: return "OpsGetattr";
+    case DriveOperation::kInit: return "OpsInit";
+    case DriveOperation::kMkdir: return "OpsMkdir";
+    case DriveOperation::kMknod: return "OpsMknod";
+    case DriveOperation::kOpen: return "OpsOpen";
+    case DriveOperation::kOpendir: return "OpsOpendir";
+    case DriveOperation::kRead: return "OpsRead";
+    case DriveOperation::kReaddir: return "OpsReaddir";
+    case DriveOperation::kRelease: return "OpsRelease";
+    case DriveOperation::kReleasedir: return "OpsReleasedir";
+    case DriveOperation::kRename: return "OpsRename";
+    case DriveOperation::kRmdir: return "OpsRmdir";
+    case DriveOperation::kStatfs: return "OpsStatfs";
+    case DriveOperation::kTruncate: return "OpsTruncate";
+    case DriveOperation::kUnlink: return "OpsUnlink";
+    case DriveOperation::kUtimens: return "OpsUtimens";
+    case DriveOperation::kWrite: return "OpsWrite";
+    case DriveOperation::kDriveGetContext: return "Drive::GetContext";
+    case DriveOperation::kDriveGetMutableContext: return "Drive::GetMutableContext";
+    case DriveOperation::kDriveCreate: return "Drive::Create";
+    case DriveOperation::kDriveOpen: return "Drive::Open";
+    case DriveOperation::kDriveFlush: return "Drive::Flush";
+    case DriveOperation::kDriveRelease: return "Drive::Release";
+    case DriveOperation::kDriveReleaseDir: return "Drive::ReleaseDir";
+    case DriveOperation::kDriveDelete: return "Drive::Delete";
+    case DriveOperation::kDriveRename: return "Drive::Rename";
+    case DriveOperation::kDriveRead: return "Drive::Read";
+    case DriveOperation::kDriveWrite: return "Drive::Write";
+    default: return "Unknown";
+  }
+}
+
+}  // unnamed namespace
+
+std::string ToString(DriveOperation operation) { return OperationName(operation); }
+
+size_t OperationMetrics::BucketIndex(uint64_t nanoseconds) {
+  if (nanoseconds < kSubBucketCount)
+    return static_cast<size_t>(nanoseconds);
+  size_t exponent(HighestSetBit(nanoseconds));
+  if (exponent > kMaxExponent)
+    return kHistogramBucketCount - 1;
+  size_t sub_bucket((nanoseconds >> (exponent - kSubBucketBits)) & (kSubBucketCount - 1));
+  return (exponent - kSubBucketBits + 1) * kSubBucketCount + sub_bucket;
+}
+
+uint64_t OperationMetrics::BucketUpperBound(size_t index) {
+  if (index < kSubBucketCount)
+    return index;
+  size_t shift(index / kSubBucketCount - 1);
+  uint64_t lower_bound(static_cast<uint64_t>(kSubBucketCount + index % kSubBucketCount) << shift);
+  return lower_bound + (uint64_t(1) << shift) - 1;
+}
+
+OperationMetrics::Summary::Summary()
+    : count(0), total_nanoseconds(0), max_nanoseconds(0), histogram(kHistogramBucketCount, 0) {}
+
+double OperationMetrics::Summary::MeanMicroseconds() const {
+  return count == 0 ? 0.0 : static_cast<double>(total_nanoseconds) / count / 1000.0;
+}
+
+double OperationMetrics::Summary::PercentileMicroseconds(double percentile) const {
+  if (count == 0)
+    return 0.0;
+  percentile = std::min(std::max(percentile, 0.0), 1.0);
+  uint64_t target(std::max(static_cast<uint64_t>(percentile * count + 0.5), uint64_t(1)));
+  uint64_t seen(0);
+  for (size_t i(0); i != kHistogramBucketCount; ++i) {
+    seen += histogram[i];
+    if (seen >= target)
+      return std::min(BucketUpperBound(i), max_nanoseconds) / 1000.0;
+  }
+  return MaxMicroseconds();
+}
+
+double OperationMetrics::Summary::MaxMicroseconds() const {
+  return max_nanoseconds / 1000.0;
+}
+
+OperationMetrics::ScopedRecorder::ScopedRecorder(OperationMetrics& metrics,
+                                                 DriveOperation operation)
+    : allocation_scope_(OperationName(operation)),
+      slow_operation_scope_(OperationName(operation)),
+      metrics_(metrics),
+      kOperation_(operation),
+      kStartTime_(std::chrono::steady_clock::now()) {}
+
+OperationMetrics::ScopedRecorder::~ScopedRecorder() {
+  metrics_.Record(kOperation_, std::chrono::steady_clock::now() - kStartTime_);
+}
+
+OperationMetrics::Cell::Cell()
+    : count(0), total_nanoseconds(0), max_nanoseconds(0), histogram() {
+  for (auto& bucket : histogram)
+    bucket = 0;
+}
+
+void OperationMetrics::Cell::AddTo(Summary& summary) const {
+  summary.count += count.load(std::memory_order_relaxed);
+  summary.total_nanoseconds += total_nanoseconds.load(std::memory_order_relaxed);
+  summary.max_nanoseconds =
+      std::max(summary.max_nanoseconds, max_nanoseconds.load(std::memory_order_relaxed));
+  for (size_t i(0); i != kHistogramBucketCount; ++i)
+    summary.histogram[i] += histogram[i].load(std::memory_order_relaxed);
+}
+
+void OperationMetrics::Cell::AddTo(Cell& cell) const {
+  cell.count.fetch_add(count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  cell.total_nanoseconds.fetch_add(total_nanoseconds.load(std::memory_order_relaxed),
+                                   std::memory_order_relaxed);
+  cell.max_nanoseconds.store(std::max(cell.max_nanoseconds.load(std::memory_order_relaxed),
+                                      max_nanoseconds.load(std::memory_order_relaxed)),
+                             std::memory_order_relaxed);
+  for (size_t i(0); i != kHistogramBucketCount; ++i) {
+    cell.histogram[i].fetch_add(histogram[i].load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+  }
+}
+
+void OperationMetrics::Cell::Reset() {
+  count.store(0, std::memory_order_relaxed);
+  total_nanoseconds.store(0, std::memory_order_relaxed);
+  max_nanoseconds.store(0, std::memory_order_relaxed);
+  for (auto& bucket : histogram)
+    bucket.store(0, std::memory_order_relaxed);
+}
+
+OperationMetrics::Shards::Shards() : mutex(), live(), retired() {}
+
+OperationMetrics::OperationMetrics()
+    : shards_(std::make_shared<Shards>()), local_shard_(&OperationMetrics::RetireLocalShard) {}
+
+void OperationMetrics::Record(DriveOperation operation,
+                              std::chrono::steady_clock::duration duration) {
+  auto count(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+  uint64_t nanoseconds(count < 0 ? 0 : static_cast<uint64_t>(count));
+  Cell& cell(GetLocalShard()[static_cast<size_t>(operation)]);
+  cell.count.fetch_add(1, std::memory_order_relaxed);
+  cell.total_nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+  // Only this thread writes to 'cell' (other than 'Reset'), so there's no need for a CAS loop.
+  if (nanoseconds > cell.max_nanoseconds.load(std::memory_order_relaxed))
+    cell.max_nanoseconds.store(nanoseconds, std::memory_order_relaxed);
+  cell.histogram[BucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+}
+
+OperationMetrics::Summary OperationMetrics::Get(DriveOperation operation) const {
+  Summary summary;
+  std::lock_guard<std::mutex> lock(shards_->mutex);
+  for (const auto& shard : shards_->live)
+    (*shard)[static_cast<size_t>(operation)].AddTo(summary);
+  shards_->retired[static_cast<size_t>(operation)].AddTo(summary);
+  return summary;
+}
+
+void OperationMetrics::Reset() {
+  std::lock_guard<std::mutex> lock(shards_->mutex);
+  for (auto& shard : shards_->live) {
+    for (auto& cell : *shard)
+      cell.Reset();
+  }
+  for (auto& cell : shards_->retired)
+    cell.Reset();
+}
+
+size_t OperationMetrics::LiveShardCount() const {
+  std::lock_guard<std::mutex> lock(shards_->mutex);
+  return shards_->live.size();
+}
+
+std::string OperationMetrics::Report() const {
+  std::ostringstream stream;
+  stream << std::left << std::setw(26) << "operation" << std::right << std::setw(10) << "count"
+         << std::setw(11) << "mean(us)" << std::setw(11) << "p50(us)" << std::setw(11)
+         << "p90(us)" << std::setw(11) << "p99(us)" << std::setw(12) << "p99.9(us)"
+         << std::setw(12) << "max(us)" << '\n';
+  for (size_t operation(0); operation != kOperationCount; ++operation) {
+    auto summary(Get(static_cast<DriveOperation>(operation)));
+    if (summary.count == 0)
+      continue;
+    stream << std::left << std::setw(26) << ToString(static_cast<DriveOperation>(operation))
+           << std::right << std::setw(10) << summary.count << std::fixed << std::setprecision(1)
+           << std::setw(11) << summary.MeanMicroseconds()
+           << std::setw(11) << summary.PercentileMicroseconds(0.5)
+           << std::setw(11) << summary.PercentileMicroseconds(0.9)
+           << std::setw(11) << summary.PercentileMicroseconds(0.99)
+           << std::setw(12) << summary.PercentileMicroseconds(0.999)
+           << std::setw(12) << summary.MaxMicroseconds() << '\n';
+  }
+  return stream.str();
+}
+
+void OperationMetrics::RetireLocalShard(LocalShard* local_shard) {
+  std::unique_ptr<LocalShard> retiring(local_shard);
+  Shards& shards(*retiring->shards);
+  std::lock_guard<std::mutex> lock(shards.mutex);
+  auto itr(std::find_if(std::begin(shards.live), std::end(shards.live),
+                        [&](const std::unique_ptr<Shard>& shard) {
+                          return shard.get() == retiring->shard;
+                        }));
+  if (itr == std::end(shards.live))
+    return;
+  for (size_t i(0); i != kOperationCount; ++i)
+    (**itr)[i].AddTo(shards.retired[i]);
+  shards.live.erase(itr);
+}
+
+OperationMetrics::Shard& OperationMetrics::GetLocalShard() {
+  LocalShard* local_shard(local_shard_.get());
+  if (local_shard && local_shard->shards == shards_)
+    return *local_shard->shard;
+
+  std::unique_ptr<Shard> shard(new Shard);
+  Shard* result(shard.get());
+  {
+    std::lock_guard<std::mutex> lock(shards_->mutex);
+    shards_->live.push_back(std::move(shard));
+  }
+  // Resetting retires any shard left behind by a destroyed instance at the same address.
+  std::unique_ptr<LocalShard> new_local_shard(new LocalShard);
+  new_local_shard->shards = shards_;
+  new_local_shard->shard = result;
+  local_shard_.reset(new_local_shard.release());
+  return *result;
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,288 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/operation_trace.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/probes.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+// A trace is the magic string followed by a sequence of entries, each starting with a tag byte.  A
+// tag of 0 defines the next path (as a varint length then the path), numbered from 0 in order of
+// definition.  Any other tag is a record of the operation 'tag - 1', followed by varints: the path
+// index, the new path index (rename only), the zigzag-encoded start time delta in nanoseconds from
+// the previous record, the duration in nanoseconds, the offset, the size, the flags and the
+// zigzag-encoded result.
+const std::string kMagic("MSDRVOP2");
+const uint8_t kPathTag(0);
+const size_t kFlushThreshold(64 * 1024);
+
+void AppendVarint(uint64_t value, std::string& output) {
+  while (value >= 0x80) {
+    output.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  output.push_back(static_cast<char>(value));
+}
+
+uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+}  // unnamed namespace
+
+OperationTraceRecord::OperationTraceRecord()
+    : operation(DriveOperation::kCount),
+      path(),
+      new_path(),
+      offset(0),
+      size(0),
+      flags(0),
+      result(0),
+      start(0),
+      duration(0) {}
+
+OperationTraceWriter::OperationTraceWriter(const boost::filesystem::path& trace_file)
+    : stream_(trace_file.string(), std::ios::binary | std::ios::trunc),
+      buffer_(kMagic),
+      path_indices_(),
+      previous_start_(0) {
+  if (!stream_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+}
+
+OperationTraceWriter::~OperationTraceWriter() {
+  try {
+    Flush();
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to flush operation trace: " << e.what();
+  }
+}
+
+void OperationTraceWriter::Write(const OperationTraceRecord& record) {
+  auto path_index(PathIndex(record.path));
+  auto new_path_index(record.operation == DriveOperation::kRename ? PathIndex(record.new_path) : 0);
+  buffer_.push_back(static_cast<char>(static_cast<uint8_t>(record.operation) + 1));
+  AppendVarint(path_index, buffer_);
+  if (record.operation == DriveOperation::kRename)
+    AppendVarint(new_path_index, buffer_);
+  int64_t start(record.start.count());
+  AppendVarint(ZigZagEncode(start - previous_start_), buffer_);
+  previous_start_ = start;
+  AppendVarint(static_cast<uint64_t>(std::max<int64_t>(record.duration.count(), 0)), buffer_);
+  AppendVarint(record.offset, buffer_);
+  AppendVarint(record.size, buffer_);
+  AppendVarint(record.flags, buffer_);
+  AppendVarint(ZigZagEncode(record.result), buffer_);
+  if (buffer_.size() >= kFlushThreshold)
+    Flush();
+}
+
+void OperationTraceWriter::Flush() {
+  stream_.write(buffer_.data(), buffer_.size());
+  stream_.flush();
+  buffer_.clear();
+  if (!stream_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+}
+
+uint64_t OperationTraceWriter::PathIndex(const std::string& path) {
+  auto itr(path_indices_.find(path));
+  if (itr != std::end(path_indices_))
+    return itr->second;
+  buffer_.push_back(static_cast<char>(kPathTag));
+  AppendVarint(path.size(), buffer_);
+  buffer_ += path;
+  auto index(static_cast<uint64_t>(path_indices_.size()));
+  path_indices_.insert(std::make_pair(path, index));
+  return index;
+}
+
+OperationTraceReader::OperationTraceReader(const boost::filesystem::path& trace_file)
+    : contents_(), position_(kMagic.size()), paths_(), previous_start_(0) {
+  if (!ReadFile(trace_file, &contents_))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  if (contents_.compare(0, kMagic.size(), kMagic) != 0)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+}
+
+bool OperationTraceReader::Next(OperationTraceRecord& record) {
+  for (;;) {
+    if (position_ == contents_.size())
+      return false;
+    auto tag(static_cast<uint8_t>(contents_[position_++]));
+    if (tag == kPathTag) {
+      auto size(ReadVarint());
+      if (contents_.size() - position_ < size)
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+      paths_.push_back(contents_.substr(position_, static_cast<size_t>(size)));
+      position_ += static_cast<size_t>(size);
+      continue;
+    }
+    if (tag - 1 >= static_cast<int>(DriveOperation::kCount))
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    record.operation = static_cast<DriveOperation>(tag - 1);
+    record.path = ReadPath();
+    record.new_path = (record.operation == DriveOperation::kRename ? ReadPath() : std::string());
+    previous_start_ += ZigZagDecode(ReadVarint());
+    record.start = std::chrono::nanoseconds(previous_start_);
+    record.duration = std::chrono::nanoseconds(static_cast<int64_t>(ReadVarint()));
+    record.offset = ReadVarint();
+    record.size = ReadVarint();
+    record.flags = static_cast<uint32_t>(ReadVarint());
+    record.result = static_cast<int32_t>(ZigZagDecode(ReadVarint()));
+    return true;
+  }
+}
+
+uint64_t OperationTraceReader::ReadVarint() {
+  uint64_t value(0);
+  for (int shift(0); shift < 64; shift += 7) {
+    if (position_ == contents_.size())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    auto byte(static_cast<uint8_t>(contents_[position_++]));
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+      return value;
+  }
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+}
+
+const std::string& OperationTraceReader::ReadPath() {
+  auto index(ReadVarint());
+  if (index >= paths_.size())
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  return paths_[static_cast<size_t>(index)];
+}
+
+OperationRecorder::ScopedRecord::ScopedRecord(OperationRecorder& recorder,
+                                              DriveOperation operation, const char* path,
+                                              uint64_t offset, uint64_t size, uint32_t flags)
+    : recorder_(recorder),
+      kEnabled_(recorder.enabled()),
+      operation_(operation),
+      path_(path),
+      new_path_(nullptr),
+      offset_(offset),
+      size_(size),
+      flags_(flags),
+      result_(0),
+      start_() {
+  DRIVE_PROBE2(operation__entry, static_cast<int>(operation), path);
+  if (kEnabled_)
+    start_ = std::chrono::steady_clock::now();
+}
+
+OperationRecorder::ScopedRecord::ScopedRecord(OperationRecorder& recorder,
+                                              DriveOperation operation, const char* path,
+                                              const char* new_path)
+    : recorder_(recorder),
+      kEnabled_(recorder.enabled()),
+      operation_(operation),
+      path_(path),
+      new_path_(new_path),
+      offset_(0),
+      size_(0),
+      flags_(0),
+      result_(0),
+      start_() {
+  DRIVE_PROBE2(operation__entry, static_cast<int>(operation), path);
+  if (kEnabled_)
+    start_ = std::chrono::steady_clock::now();
+}
+
+OperationRecorder::ScopedRecord::~ScopedRecord() {
+  DRIVE_PROBE2(operation__exit, static_cast<int>(operation_), path_);
+  if (!kEnabled_)
+    return;
+  auto end(std::chrono::steady_clock::now());
+  try {
+    OperationTraceRecord record;
+    record.operation = operation_;
+    record.path = (path_ ? path_ : "");
+    record.new_path = (new_path_ ? new_path_ : "");
+    record.offset = offset_;
+    record.size = size_;
+    record.flags = flags_;
+    record.result = result_;
+    recorder_.Record(record, start_, end);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to record " << ToString(operation_) << ": " << e.what();
+  }
+}
+
+OperationRecorder::OperationRecorder()
+    : enabled_(false), mutex_(), writer_(), start_time_(), record_count_(0) {}
+
+void OperationRecorder::Start(const boost::filesystem::path& trace_file) {
+  std::unique_ptr<OperationTraceWriter> writer(new OperationTraceWriter(trace_file));
+  std::lock_guard<std::mutex> lock(mutex_);
+  writer_ = std::move(writer);
+  start_time_ = std::chrono::steady_clock::now();
+  record_count_ = 0;
+  enabled_.store(true);
+}
+
+void OperationRecorder::Stop() {
+  std::unique_ptr<OperationTraceWriter> writer;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    enabled_.store(false);
+    writer = std::move(writer_);
+  }
+  // 'writer' is flushed as it's destroyed here, outside the lock.
+}
+
+uint64_t OperationRecorder::record_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return record_count_;
+}
+
+void OperationRecorder::Record(OperationTraceRecord& record,
+                               std::chrono::steady_clock::time_point start,
+                               std::chrono::steady_clock::time_point end) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!writer_)  // Stopped since the operation began.
+    return;
+  record.start = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::max(start, start_time_) - start_time_);
+  record.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+  writer_->Write(record);
+  ++record_count_;
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
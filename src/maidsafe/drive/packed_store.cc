@@ -0,0 +1,696 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/packed_store.h"
+
+#ifdef MAIDSAFE_WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+#include "boost/crc.hpp"
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+// Each record in a pack is a 4-byte payload size and a 4-byte CRC-32 of the payload, followed by
+// the payload: the chunk name (4-byte size then bytes), its 4-byte reference count and, for chunk
+// records, the chunk content.  All integers are little-endian.
+const size_t kHeaderSize(8);
+const uint32_t kMaxPayloadSize(64 * 1024 * 1024);
+const char kPackExtension[] = ".pack";
+
+template <typename T>
+boost::future<T> MakeErrorFuture(CommonErrors error) {
+  boost::promise<T> promise;
+  promise.set_exception(boost::copy_exception(MakeError(error)));
+  return promise.get_future();
+}
+
+void AppendUint32(uint32_t value, std::string& output) {
+  for (int i(0); i != 4; ++i)
+    output.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+void AppendUint64(uint64_t value, std::string& output) {
+  for (int i(0); i != 8; ++i)
+    output.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+void AppendString(const std::string& value, std::string& output) {
+  AppendUint32(static_cast<uint32_t>(value.size()), output);
+  output += value;
+}
+
+uint32_t Checksum(const char* data, size_t size) {
+  boost::crc_32_type crc;
+  crc.process_bytes(data, size);
+  return crc.checksum();
+}
+
+class Parser {
+ public:
+  explicit Parser(const std::string& input) : input_(input), position_(0) {}
+
+  uint32_t ReadUint32() {
+    Require(4);
+    uint32_t value(0);
+    for (int i(0); i != 4; ++i)
+      value |= static_cast<uint32_t>(static_cast<uint8_t>(input_[position_++])) << (8 * i);
+    return value;
+  }
+
+  uint64_t ReadUint64() {
+    Require(8);
+    uint64_t value(0);
+    for (int i(0); i != 8; ++i)
+      value |= static_cast<uint64_t>(static_cast<uint8_t>(input_[position_++])) << (8 * i);
+    return value;
+  }
+
+  std::string ReadString() {
+    auto size(ReadUint32());
+    Require(size);
+    std::string value(input_.substr(position_, size));
+    position_ += size;
+    return value;
+  }
+
+  size_t position() const { return position_; }
+  bool AtEnd() const { return position_ == input_.size(); }
+
+ private:
+  void Require(size_t size) const {
+    if (input_.size() - position_ < size)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+
+  const std::string& input_;
+  size_t position_;
+};
+
+uint64_t RecordSize(const ImmutableData::Name& data_name, uint64_t content_size) {
+  return kHeaderSize + 4 + data_name->string().size() + 4 + content_size;
+}
+
+std::string SerialiseRecord(const ImmutableData::Name& data_name, uint32_t count,
+                            const std::string* content) {
+  std::string payload;
+  AppendString(data_name->string(), payload);
+  AppendUint32(count, payload);
+  if (content)
+    payload += *content;
+  if (payload.size() > kMaxPayloadSize)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  std::string record;
+  record.reserve(kHeaderSize + payload.size());
+  AppendUint32(static_cast<uint32_t>(payload.size()), record);
+  AppendUint32(Checksum(payload.data(), payload.size()), record);
+  return record + payload;
+}
+
+std::FILE* OpenFile(const fs::path& path, bool for_append) {
+#ifdef MAIDSAFE_WIN32
+  return _wfopen(path.c_str(), for_append ? L"ab" : L"rb");
+#else
+  return std::fopen(path.c_str(), for_append ? "ab" : "rb");
+#endif
+}
+
+bool Seek(std::FILE* file, uint64_t offset) {
+#ifdef MAIDSAFE_WIN32
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+bool SyncFile(std::FILE* file) {
+  if (std::fflush(file) != 0)
+    return false;
+#ifdef MAIDSAFE_WIN32
+  return _commit(_fileno(file)) == 0;
+#else
+  return fsync(fileno(file)) == 0;
+#endif
+}
+
+}  // unnamed namespace
+
+// A pack file.  Its mutable fields are guarded by the store's mutex; reads are serialised by the
+// pack's own mutex so they don't block the store.  An obsolete pack's file is removed once the last
+// reader has released it.
+class PackedStore::Pack {
+ public:
+  Pack(uint32_t id_in, fs::path path_in)
+      : id(id_in), path(std::move(path_in)), size(0), live_bytes(0), obsolete(false), mutex_(),
+        reader_(nullptr) {}
+
+  ~Pack() {
+    if (reader_)
+      std::fclose(reader_);
+    if (obsolete) {
+      boost::system::error_code error_code;
+      if (!fs::remove(path, error_code) || error_code)
+        LOG(kWarning) << "Failed to remove compacted pack " << path << ": " << error_code.message();
+    }
+  }
+
+  std::string Read(uint64_t offset, uint32_t read_size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!reader_)
+      reader_ = OpenFile(path, false);
+    std::string content(read_size, 0);
+    if (!reader_ || !Seek(reader_, offset) ||
+        std::fread(&content[0], 1, read_size, reader_) != read_size) {
+      LOG(kError) << "Failed to read " << read_size << " bytes at " << offset << " in " << path;
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+    }
+    return content;
+  }
+
+  const uint32_t id;
+  const fs::path path;
+  uint64_t size, live_bytes;
+  bool obsolete;
+
+ private:
+  Pack(const Pack&);
+  Pack& operator=(const Pack&);
+
+  std::mutex mutex_;
+  std::FILE* reader_;
+};
+
+PackedStore::Statistics::Statistics()
+    : pack_count(0), chunk_count(0), live_bytes(0), total_bytes(0), compaction_count(0) {}
+
+PackedStore::Entry::Entry() : pack_id(0), count_pack_id(0), size(0), count(0), offset(0) {}
+
+PackedStore::PackedStore(const fs::path& pack_dir,
+                         std::shared_ptr<data_stores::LocalStore> version_store,
+                         uint64_t max_pack_size, double compaction_threshold)
+    : kPackDir_(pack_dir),
+      kMaxPackSize_(max_pack_size),
+      kCompactionThreshold_(compaction_threshold),
+      version_store_(std::move(version_store)),
+      mutex_(),
+      condition_(),
+      index_(),
+      packs_(),
+      active_pack_(),
+      writer_(nullptr),
+      compaction_count_(0),
+      compaction_requested_(false),
+      stopping_(false),
+      compaction_mutex_(),
+      compaction_thread_() {
+  if (!version_store_ || kCompactionThreshold_ <= 0.0 || kCompactionThreshold_ > 1.0)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  LoadPacks();
+  compaction_thread_ = std::thread([this] { RunCompaction(); });
+}
+
+PackedStore::~PackedStore() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+  compaction_thread_.join();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (writer_) {
+    if (!SyncFile(writer_))
+      LOG(kError) << "Failed to sync " << active_pack_->path;
+    std::fclose(writer_);
+  }
+  try {
+    SaveIndex();
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to save pack index: " << e.what();
+  }
+}
+
+void PackedStore::LoadPacks() {
+  boost::system::error_code error_code;
+  if (!fs::exists(kPackDir_, error_code) && !fs::create_directories(kPackDir_, error_code)) {
+    LOG(kError) << "Failed to create packed store at " << kPackDir_ << ": "
+                << error_code.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  for (fs::directory_iterator itr(kPackDir_); itr != fs::directory_iterator(); ++itr) {
+    if (itr->path().extension() != kPackExtension)
+      continue;
+    try {
+      auto id(static_cast<uint32_t>(std::stoul(itr->path().stem().string())));
+      auto pack(std::make_shared<Pack>(id, itr->path()));
+      pack->size = fs::file_size(itr->path());
+      packs_.insert(std::make_pair(id, pack));
+    }
+    catch (const std::exception&) {
+      LOG(kWarning) << "Ignoring " << itr->path();
+    }
+  }
+
+  if (!LoadIndex()) {
+    index_.clear();
+    for (const auto& pack : packs_)
+      ScanPack(*pack.second, pack.first == packs_.rbegin()->first);
+  }
+  for (const auto& entry : index_) {
+    if (entry.second.count != 0)
+      packs_.at(entry.second.pack_id)->live_bytes += RecordSize(entry.first, entry.second.size);
+  }
+
+  if (packs_.empty()) {
+    StartNewPack();
+  } else {
+    active_pack_ = packs_.rbegin()->second;
+    OpenWriter();
+  }
+  LOG(kInfo) << "Packed store at " << kPackDir_ << " indexes " << index_.size() << " chunks in "
+             << packs_.size() << " packs.";
+}
+
+bool PackedStore::LoadIndex() {
+  std::string contents;
+  if (!ReadFile(kPackDir_ / "index", &contents) || contents.size() < kHeaderSize)
+    return false;
+  try {
+    std::string payload(contents.substr(kHeaderSize));
+    Parser header(contents);
+    if (header.ReadUint32() != payload.size() ||
+        header.ReadUint32() != Checksum(payload.data(), payload.size()))
+      return false;
+
+    // The index is only valid if no pack has been added, removed or appended to since it was saved.
+    Parser parser(payload);
+    auto pack_count(parser.ReadUint32());
+    if (pack_count != packs_.size())
+      return false;
+    for (uint32_t i(0); i != pack_count; ++i) {
+      auto itr(packs_.find(parser.ReadUint32()));
+      if (itr == std::end(packs_) || itr->second->size != parser.ReadUint64())
+        return false;
+    }
+    auto entry_count(parser.ReadUint64());
+    for (uint64_t i(0); i != entry_count; ++i) {
+      ImmutableData::Name data_name(Identity(parser.ReadString()));
+      Entry entry;
+      entry.pack_id = parser.ReadUint32();
+      entry.count_pack_id = parser.ReadUint32();
+      entry.size = parser.ReadUint32();
+      entry.count = parser.ReadUint32();
+      entry.offset = parser.ReadUint64();
+      if (packs_.count(entry.pack_id) == 0)
+        return false;
+      index_.insert(std::make_pair(data_name, entry));
+    }
+    return parser.AtEnd();
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Ignoring invalid pack index: " << e.what();
+    return false;
+  }
+}
+
+void PackedStore::SaveIndex() const {
+  std::string payload;
+  AppendUint32(static_cast<uint32_t>(packs_.size()), payload);
+  for (const auto& pack : packs_) {
+    AppendUint32(pack.first, payload);
+    AppendUint64(pack.second->size, payload);
+  }
+  AppendUint64(index_.size(), payload);
+  for (const auto& entry : index_) {
+    AppendString(entry.first->string(), payload);
+    AppendUint32(entry.second.pack_id, payload);
+    AppendUint32(entry.second.count_pack_id, payload);
+    AppendUint32(entry.second.size, payload);
+    AppendUint32(entry.second.count, payload);
+    AppendUint64(entry.second.offset, payload);
+  }
+  std::string contents;
+  AppendUint32(static_cast<uint32_t>(payload.size()), contents);
+  AppendUint32(Checksum(payload.data(), payload.size()), contents);
+  contents += payload;
+
+  fs::path temp_path(kPackDir_ / "index.tmp");
+  if (!WriteFile(temp_path, contents))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  fs::rename(temp_path, kPackDir_ / "index");
+}
+
+void PackedStore::ScanPack(Pack& pack, bool is_newest) {
+  std::ifstream stream(pack.path.string().c_str(), std::ios::binary);
+  uint64_t position(0);
+  std::string header(kHeaderSize, 0);
+  while (stream.read(&header[0], kHeaderSize)) {
+    Parser header_parser(header);
+    auto payload_size(header_parser.ReadUint32());
+    auto checksum(header_parser.ReadUint32());
+    if (payload_size > kMaxPayloadSize)
+      break;
+    std::string payload(payload_size, 0);
+    if (!stream.read(&payload[0], payload_size) ||
+        Checksum(payload.data(), payload.size()) != checksum)
+      break;
+
+    Parser parser(payload);
+    ImmutableData::Name data_name;
+    uint32_t count(0);
+    try {
+      data_name = ImmutableData::Name(Identity(parser.ReadString()));
+      count = parser.ReadUint32();
+    }
+    catch (const std::exception&) {
+      break;
+    }
+    auto content_size(static_cast<uint32_t>(payload_size - parser.position()));
+    if (content_size != 0) {
+      Entry& entry(index_[data_name]);
+      entry.pack_id = entry.count_pack_id = pack.id;
+      entry.size = content_size;
+      entry.count = count;
+      entry.offset = position + kHeaderSize + parser.position();
+    } else {
+      // A reference count record for a chunk whose pack has since been compacted away is stale.
+      auto itr(index_.find(data_name));
+      if (itr != std::end(index_)) {
+        itr->second.count = count;
+        itr->second.count_pack_id = pack.id;
+      }
+    }
+    position += kHeaderSize + payload_size;
+  }
+
+  if (position != pack.size) {
+    if (is_newest) {
+      LOG(kWarning) << "Discarding " << pack.size - position << " bytes of torn or corrupt "
+                    << "records from the end of " << pack.path;
+      fs::resize_file(pack.path, position);
+      pack.size = position;
+    } else {
+      // The unreadable tail still counts towards the pack's size, so compaction will reclaim it.
+      LOG(kError) << pack.path << " is corrupt after " << position << " bytes.";
+    }
+  }
+}
+
+void PackedStore::OpenWriter() {
+  writer_ = OpenFile(active_pack_->path, true);
+  if (!writer_) {
+    LOG(kError) << "Failed to open " << active_pack_->path;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+}
+
+void PackedStore::StartNewPack() {
+  if (writer_) {
+    if (!SyncFile(writer_))
+      LOG(kError) << "Failed to sync " << active_pack_->path;
+    std::fclose(writer_);
+    writer_ = nullptr;
+    if (NeedsCompaction(*active_pack_)) {
+      compaction_requested_ = true;
+      condition_.notify_all();
+    }
+  }
+  uint32_t id(packs_.empty() ? 1 : packs_.rbegin()->first + 1);
+  char file_name[32];
+  std::snprintf(file_name, sizeof(file_name), "%08u%s", id, kPackExtension);
+  active_pack_ = std::make_shared<Pack>(id, kPackDir_ / file_name);
+  packs_.insert(std::make_pair(id, active_pack_));
+  OpenWriter();
+}
+
+uint64_t PackedStore::Append(const ImmutableData::Name& data_name, uint32_t count,
+                             const std::string* content) {
+  auto record(SerialiseRecord(data_name, count, content));
+  if (active_pack_->size != 0 && active_pack_->size + record.size() > kMaxPackSize_)
+    StartNewPack();
+  if (std::fwrite(record.data(), 1, record.size(), writer_) != record.size() ||
+      std::fflush(writer_) != 0) {
+    LOG(kError) << "Failed to append to " << active_pack_->path;
+    // Drop whatever part of the record made it to disk, so later records aren't appended after it.
+    std::fclose(writer_);
+    writer_ = nullptr;
+    boost::system::error_code error_code;
+    fs::resize_file(active_pack_->path, active_pack_->size, error_code);
+    OpenWriter();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  uint64_t content_offset(active_pack_->size + record.size() -
+                          (content ? content->size() : 0));
+  active_pack_->size += record.size();
+  return content_offset;
+}
+
+boost::future<ImmutableData> PackedStore::Get(const ImmutableData::Name& data_name) {
+  std::shared_ptr<Pack> pack;
+  Entry entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr(index_.find(data_name));
+    if (itr == std::end(index_) || itr->second.count == 0) {
+      LOG(kWarning) << HexSubstr(data_name->string()) << " not in packed store.";
+      return MakeErrorFuture<ImmutableData>(CommonErrors::no_such_element);
+    }
+    entry = itr->second;
+    pack = packs_.at(entry.pack_id);
+  }
+
+  boost::promise<ImmutableData> promise;
+  try {
+    ImmutableData data(NonEmptyString(pack->Read(entry.offset, entry.size)));
+    if (data.name() != data_name) {
+      LOG(kError) << HexSubstr(data_name->string()) << " is corrupt in " << pack->path;
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+    }
+    promise.set_value(std::move(data));
+  }
+  catch (...) {
+    promise.set_exception(boost::current_exception());
+  }
+  return promise.get_future();
+}
+
+void PackedStore::Put(const ImmutableData& data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(index_.find(data.name()));
+  if (itr != std::end(index_) && itr->second.count != 0) {
+    Append(data.name(), itr->second.count + 1, nullptr);
+    ++itr->second.count;
+    itr->second.count_pack_id = active_pack_->id;
+    return;
+  }
+  const NonEmptyString content(data.data());
+  Entry entry;
+  entry.offset = Append(data.name(), 1, &content.string());
+  entry.pack_id = entry.count_pack_id = active_pack_->id;
+  entry.size = static_cast<uint32_t>(content.string().size());
+  entry.count = 1;
+  index_[data.name()] = entry;
+  active_pack_->live_bytes += RecordSize(data.name(), entry.size);
+}
+
+void PackedStore::Delete(const ImmutableData::Name& data_name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(index_.find(data_name));
+  if (itr == std::end(index_) || itr->second.count == 0) {
+    LOG(kWarning) << "Can't delete " << HexSubstr(data_name->string()) << " - not held.";
+    return;
+  }
+  Append(data_name, itr->second.count - 1, nullptr);
+  itr->second.count_pack_id = active_pack_->id;
+  if (--itr->second.count != 0)
+    return;
+  auto& pack(*packs_.at(itr->second.pack_id));
+  pack.live_bytes -= RecordSize(data_name, itr->second.size);
+  if (&pack != active_pack_.get() && NeedsCompaction(pack)) {
+    compaction_requested_ = true;
+    condition_.notify_all();
+  }
+}
+
+void PackedStore::IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& data_name : data_names) {
+    auto itr(index_.find(data_name));
+    if (itr == std::end(index_) || itr->second.count == 0) {
+      LOG(kWarning) << "Can't increment " << HexSubstr(data_name->string()) << " - not held.";
+      continue;
+    }
+    Append(data_name, itr->second.count + 1, nullptr);
+    ++itr->second.count;
+    itr->second.count_pack_id = active_pack_->id;
+  }
+}
+
+boost::future<PackedStore::VersionNames> PackedStore::GetVersions(
+    const MutableData::Name& data_name) {
+  return version_store_->GetVersions(data_name);
+}
+
+boost::future<PackedStore::VersionNames> PackedStore::GetBranch(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& branch_tip) {
+  return version_store_->GetBranch(data_name, branch_tip);
+}
+
+void PackedStore::PutVersion(const MutableData::Name& data_name,
+                             const StructuredDataVersions::VersionName& old_version_name,
+                             const StructuredDataVersions::VersionName& new_version_name) {
+  version_store_->PutVersion(data_name, old_version_name, new_version_name);
+}
+
+boost::future<void> PackedStore::CreateVersionTree(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& version_name,
+    uint32_t max_versions, uint32_t max_branches) {
+  return version_store_->CreateVersionTree(data_name, version_name, max_versions, max_branches);
+}
+
+bool PackedStore::NeedsCompaction(const Pack& pack) const {
+  return pack.size != 0 &&
+         static_cast<double>(pack.size - pack.live_bytes) >= kCompactionThreshold_ * pack.size;
+}
+
+size_t PackedStore::Compact() {
+  std::lock_guard<std::mutex> compaction_lock(compaction_mutex_);
+  std::vector<std::shared_ptr<Pack>> candidates;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& pack : packs_) {
+      if (pack.second != active_pack_ && NeedsCompaction(*pack.second))
+        candidates.push_back(pack.second);
+    }
+  }
+  for (auto& pack : candidates)
+    CompactPack(pack);
+  return candidates.size();
+}
+
+void PackedStore::CompactPack(std::shared_ptr<Pack> pack) {
+  std::vector<ImmutableData::Name> data_names;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : index_) {
+      if (entry.second.pack_id == pack->id || entry.second.count_pack_id == pack->id)
+        data_names.push_back(entry.first);
+    }
+  }
+
+  for (const auto& data_name : data_names) {
+    // Live chunks are read without holding the store's mutex; the pack's content never changes, so
+    // it's only necessary to check that the chunk is still held there afterwards.
+    std::string content;
+    Entry entry;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto itr(index_.find(data_name));
+      if (itr == std::end(index_))
+        continue;
+      entry = itr->second;
+    }
+    if (entry.pack_id == pack->id && entry.count != 0)
+      content = pack->Read(entry.offset, entry.size);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr(index_.find(data_name));
+    if (itr == std::end(index_))
+      continue;
+    Entry& current(itr->second);
+    if (current.pack_id == pack->id) {
+      if (current.count == 0) {
+        index_.erase(itr);
+        continue;
+      }
+      current.offset = Append(data_name, current.count, &content);
+      current.pack_id = current.count_pack_id = active_pack_->id;
+      active_pack_->live_bytes += RecordSize(data_name, current.size);
+    } else if (current.count_pack_id == pack->id) {
+      Append(data_name, current.count, nullptr);
+      current.count_pack_id = active_pack_->id;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The copies must be durable before the originals are removed.
+  if (!SyncFile(writer_)) {
+    LOG(kError) << "Failed to sync " << active_pack_->path << "; not removing " << pack->path;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  pack->obsolete = true;
+  packs_.erase(pack->id);
+  ++compaction_count_;
+  LOG(kInfo) << "Compacted " << pack->path << " (" << pack->live_bytes << " of " << pack->size
+             << " bytes live).";
+}
+
+void PackedStore::RunCompaction() {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this] { return stopping_ || compaction_requested_; });
+      if (stopping_)
+        return;
+      compaction_requested_ = false;
+    }
+    try {
+      Compact();
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Pack compaction failed: " << e.what();
+    }
+  }
+}
+
+PackedStore::Statistics PackedStore::GetStatistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Statistics statistics;
+  statistics.pack_count = packs_.size();
+  for (const auto& entry : index_) {
+    if (entry.second.count != 0)
+      ++statistics.chunk_count;
+  }
+  for (const auto& pack : packs_) {
+    statistics.live_bytes += pack.second->live_bytes;
+    statistics.total_bytes += pack.second->size;
+  }
+  statistics.compaction_count = compaction_count_;
+  return statistics;
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
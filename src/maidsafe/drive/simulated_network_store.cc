@@ -0,0 +1,201 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/simulated_network_store.h"
+
+#include <cstdlib>
+#include <type_traits>
+#include <vector>
+
+#include "boost/algorithm/string/classification.hpp"
+#include "boost/algorithm/string/split.hpp"
+#include "boost/lexical_cast.hpp"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+std::vector<std::string> Split(const std::string& input, const char* separators) {
+  std::vector<std::string> parts;
+  boost::split(parts, input, boost::is_any_of(separators));
+  return parts;
+}
+
+template <typename T>
+T ParseValue(const std::string& value) {
+  // lexical_cast wraps negative values into unsigned types rather than rejecting them.
+  if (std::is_unsigned<T>::value && !value.empty() && value[0] == '-') {
+    LOG(kError) << "Invalid simulated network value \"" << value << "\"";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  try {
+    return boost::lexical_cast<T>(value);
+  }
+  catch (const boost::bad_lexical_cast&) {
+    LOG(kError) << "Invalid simulated network value \"" << value << "\"";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+}
+
+double ParseProbability(const std::string& value) {
+  auto probability(ParseValue<double>(value));
+  if (probability < 0.0 || probability > 1.0) {
+    LOG(kError) << "Simulated network probability " << value << " not in range [0, 1]";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  return probability;
+}
+
+}  // unnamed namespace
+
+LatencyDistribution::LatencyDistribution()
+    : type_(Type::kConstant), first_(0), second_(0) {}
+
+LatencyDistribution::LatencyDistribution(Type type, std::chrono::milliseconds first,
+                                         std::chrono::milliseconds second)
+    : type_(type), first_(first), second_(second) {
+  if (first_.count() < 0 || second_.count() < 0 ||
+      (type_ == Type::kUniform && second_ < first_)) {
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+}
+
+LatencyDistribution LatencyDistribution::Parse(const std::string& spec) {
+  auto parts(Split(spec, ":"));
+  Type type;
+  if (parts.front() == "constant" && parts.size() == 2) {
+    type = Type::kConstant;
+  } else if (parts.front() == "uniform" && parts.size() == 3) {
+    type = Type::kUniform;
+  } else if (parts.front() == "normal" && parts.size() == 3) {
+    type = Type::kNormal;
+  } else if (parts.front() == "exponential" && parts.size() == 2) {
+    type = Type::kExponential;
+  } else {
+    LOG(kError) << "Invalid latency distribution \"" << spec << "\"";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  return LatencyDistribution(type, std::chrono::milliseconds(ParseValue<uint32_t>(parts[1])),
+      std::chrono::milliseconds(parts.size() == 3 ? ParseValue<uint32_t>(parts[2]) : 0));
+}
+
+std::chrono::microseconds LatencyDistribution::Sample(std::mt19937_64& generator) const {
+  typedef std::chrono::duration<double, std::milli> Milliseconds;
+  double sample(0.0);
+  switch (type_) {
+    case Type::kConstant:
+      return first_;
+    case Type::kUniform:
+      sample = std::uniform_real_distribution<double>(
+          static_cast<double>(first_.count()), static_cast<double>(second_.count()))(generator);
+      break;
+    case Type::kNormal:
+      sample = std::normal_distribution<double>(
+          static_cast<double>(first_.count()), static_cast<double>(second_.count()))(generator);
+      break;
+    case Type::kExponential:
+      if (first_.count() == 0)
+        return std::chrono::microseconds(0);
+      sample = std::exponential_distribution<double>(
+          1.0 / static_cast<double>(first_.count()))(generator);
+      break;
+    default:
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      Milliseconds(std::max(sample, 0.0)));
+}
+
+SimulatedNetworkProfile::SimulatedNetworkProfile()
+    : latencies(),
+      jitter(0),
+      upload_bytes_per_second(0),
+      download_bytes_per_second(0),
+      failure_probability(0.0),
+      timeout_probability(0.0),
+      timeout(std::chrono::seconds(10)),
+      seed(0) {}
+
+SimulatedNetworkProfile SimulatedNetworkProfile::Parse(const std::string& spec) {
+  SimulatedNetworkProfile profile;
+  std::array<bool, static_cast<size_t>(StorageOperation::kCount)> overridden = {};
+  const std::vector<std::pair<std::string, StorageOperation>> kOperationKeys {
+      std::make_pair("get", StorageOperation::kGet),
+      std::make_pair("put", StorageOperation::kPut),
+      std::make_pair("increment", StorageOperation::kIncrementReferenceCount),
+      std::make_pair("get_versions", StorageOperation::kGetVersions),
+      std::make_pair("get_branch", StorageOperation::kGetBranch),
+      std::make_pair("put_version", StorageOperation::kPutVersion),
+      std::make_pair("create_version_tree", StorageOperation::kCreateVersionTree) };
+
+  for (const auto& entry : Split(spec, ",")) {
+    if (entry.empty())
+      continue;
+    auto key_and_value(Split(entry, "="));
+    if (key_and_value.size() != 2) {
+      LOG(kError) << "Invalid simulated network entry \"" << entry << "\"";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+    const auto& key(key_and_value[0]);
+    const auto& value(key_and_value[1]);
+    auto operation_itr(std::find_if(std::begin(kOperationKeys), std::end(kOperationKeys),
+        [&key](const std::pair<std::string, StorageOperation>& operation_key) {
+          return operation_key.first == key;
+        }));
+    if (operation_itr != std::end(kOperationKeys)) {
+      auto index(static_cast<size_t>(operation_itr->second));
+      profile.latencies[index] = LatencyDistribution::Parse(value);
+      overridden[index] = true;
+    } else if (key == "latency") {
+      auto latency(LatencyDistribution::Parse(value));
+      for (size_t i(0); i != profile.latencies.size(); ++i) {
+        if (!overridden[i])
+          profile.latencies[i] = latency;
+      }
+    } else if (key == "jitter") {
+      profile.jitter = std::chrono::milliseconds(ParseValue<uint32_t>(value));
+    } else if (key == "upload_kbps") {
+      profile.upload_bytes_per_second = ParseValue<uint64_t>(value) * 1024;
+    } else if (key == "download_kbps") {
+      profile.download_bytes_per_second = ParseValue<uint64_t>(value) * 1024;
+    } else if (key == "failure") {
+      profile.failure_probability = ParseProbability(value);
+    } else if (key == "timeout") {
+      profile.timeout_probability = ParseProbability(value);
+    } else if (key == "timeout_ms") {
+      profile.timeout = std::chrono::milliseconds(ParseValue<uint32_t>(value));
+    } else if (key == "seed") {
+      profile.seed = ParseValue<uint64_t>(value);
+    } else {
+      LOG(kError) << "Unrecognised simulated network key \"" << key << "\"";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+  }
+
+  if (profile.failure_probability + profile.timeout_probability > 1.0) {
+    LOG(kError) << "Simulated network failure and timeout probabilities sum to more than 1";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  return profile;
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,200 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/slow_operation_log.h"
+
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+#include "maidsafe/common/log.h"
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define MAIDSAFE_DRIVE_THREAD_LOCAL __declspec(thread)
+#else
+#define MAIDSAFE_DRIVE_THREAD_LOCAL thread_local
+#endif
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+MAIDSAFE_DRIVE_THREAD_LOCAL SlowOperationScope* t_current_scope = nullptr;
+
+double Milliseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}  // unnamed namespace
+
+std::string ToString(SlowOperationPhase phase) {
+  switch (phase) {
+    case SlowOperationPhase::kPathResolution: return "path_resolution";
+    case SlowOperationPhase::kDirectoryLock: return "directory_lock";
+    case SlowOperationPhase::kCacheLock: return "cache_lock";
+    case SlowOperationPhase::kStorageQueue: return "storage_queue";
+    case SlowOperationPhase::kStorage: return "storage";
+    case SlowOperationPhase::kEncryption: return "encryption";
+    case SlowOperationPhase::kStoreWait: return "store_wait";
+    default: return "unknown";
+  }
+}
+
+std::atomic<int64_t> SlowOperationLog::threshold_nanoseconds_(0);
+
+SlowOperationLog::StorageCall::StorageCall() : operation(nullptr), chunk_name(), duration() {}
+
+SlowOperationLog::StorageCall::StorageCall(const char* operation_in, std::string chunk_name_in,
+                                           std::chrono::steady_clock::duration duration_in)
+    : operation(operation_in), chunk_name(std::move(chunk_name_in)), duration(duration_in) {}
+
+SlowOperationLog::Entry::Entry()
+    : number(0), operation(), duration(), phases(), storage_calls(), dropped_storage_calls(0) {
+  phases.fill(std::chrono::steady_clock::duration::zero());
+}
+
+std::string SlowOperationLog::Entry::ToString() const {
+  std::ostringstream stream;
+  stream << std::fixed << std::setprecision(1) << "#" << number << ' ' << operation << " took "
+         << Milliseconds(duration) << "ms:";
+  bool any_phase(false);
+  for (size_t i(0); i != kPhaseCount; ++i) {
+    if (phases[i] == std::chrono::steady_clock::duration::zero())
+      continue;
+    stream << (any_phase ? ", " : " ") << drive::ToString(static_cast<SlowOperationPhase>(i))
+           << ' ' << Milliseconds(phases[i]) << "ms";
+    any_phase = true;
+  }
+  if (!any_phase)
+    stream << " no time in any phase";
+  if (!storage_calls.empty() || dropped_storage_calls != 0) {
+    stream << "; " << storage_calls.size() + dropped_storage_calls << " storage call(s):";
+    const char* separator(" ");
+    for (const auto& call : storage_calls) {
+      stream << separator << call.operation;
+      if (!call.chunk_name.empty())
+        stream << ' ' << call.chunk_name;
+      stream << ' ' << Milliseconds(call.duration) << "ms";
+      separator = ", ";
+    }
+    if (dropped_storage_calls != 0)
+      stream << separator << "and " << dropped_storage_calls << " more";
+  }
+  return stream.str();
+}
+
+SlowOperationLog& SlowOperationLog::Instance() {
+  // Never destroyed, so that operations still running during static destruction can safely finish.
+  static SlowOperationLog* const log(new SlowOperationLog);
+  return *log;
+}
+
+SlowOperationLog::SlowOperationLog() : slow_count_(0), mutex_(), recent_() {}
+
+void SlowOperationLog::SetThreshold(std::chrono::steady_clock::duration threshold) {
+  auto nanoseconds(std::chrono::duration_cast<std::chrono::nanoseconds>(threshold).count());
+  threshold_nanoseconds_.store(nanoseconds > 0 ? nanoseconds : 0, std::memory_order_relaxed);
+}
+
+std::chrono::steady_clock::duration SlowOperationLog::threshold() const {
+  return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::nanoseconds(threshold_nanoseconds_.load(std::memory_order_relaxed)));
+}
+
+void SlowOperationLog::Record(Entry&& entry) {
+  entry.number = ++slow_count_;
+  LOG(kWarning) << "Slow operation " << entry.ToString();
+  std::lock_guard<std::mutex> lock(mutex_);
+  recent_.push_back(std::move(entry));
+  if (recent_.size() > kMaxEntries)
+    recent_.pop_front();
+}
+
+std::vector<SlowOperationLog::Entry> SlowOperationLog::GetRecent() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::vector<Entry>(std::begin(recent_), std::end(recent_));
+}
+
+std::string SlowOperationLog::Report() const {
+  auto recent(GetRecent());
+  std::ostringstream stream;
+  stream << "threshold " << std::fixed << std::setprecision(1) << Milliseconds(threshold())
+         << "ms, " << slow_count() << " slow operation(s)\n";
+  for (auto itr(recent.rbegin()); itr != recent.rend(); ++itr)
+    stream << itr->ToString() << '\n';
+  return stream.str();
+}
+
+void SlowOperationLog::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  recent_.clear();
+}
+
+void SlowOperationScope::AddPhaseTime(SlowOperationPhase phase,
+                                      std::chrono::steady_clock::duration duration) {
+  SlowOperationScope* scope(t_current_scope);
+  if (scope)
+    scope->phases_[static_cast<size_t>(phase)] += duration;
+}
+
+void SlowOperationScope::RecordStorageCall(const char* operation, const std::string& chunk_name,
+                                           std::chrono::steady_clock::duration duration) {
+  SlowOperationScope* scope(t_current_scope);
+  if (!scope)
+    return;
+  if (!scope->storage_calls_)
+    scope->storage_calls_.reset(new std::vector<SlowOperationLog::StorageCall>);
+  if (scope->storage_calls_->size() < SlowOperationLog::kMaxStorageCalls)
+    scope->storage_calls_->emplace_back(operation, chunk_name, duration);
+  else
+    ++scope->dropped_storage_calls_;
+}
+
+void SlowOperationScope::Enter(const char* operation) {
+  // Nested scopes leave the breakdown to the outermost.
+  if (t_current_scope)
+    return;
+  operation_ = operation;
+  start_time_ = std::chrono::steady_clock::now();
+  phases_.fill(std::chrono::steady_clock::duration::zero());
+  dropped_storage_calls_ = 0;
+  t_current_scope = this;
+}
+
+void SlowOperationScope::Exit() {
+  t_current_scope = nullptr;
+  auto duration(std::chrono::steady_clock::now() - start_time_);
+  auto& log(SlowOperationLog::Instance());
+  auto threshold(log.threshold());
+  if (threshold == std::chrono::steady_clock::duration::zero() || duration < threshold)
+    return;
+  SlowOperationLog::Entry entry;
+  entry.operation = operation_;
+  entry.duration = duration;
+  entry.phases = phases_;
+  if (storage_calls_)
+    entry.storage_calls = std::move(*storage_calls_);
+  entry.dropped_storage_calls = dropped_storage_calls_;
+  log.Record(std::move(entry));
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,217 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/storage_metrics.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/probes.h"
+#include "maidsafe/drive/slow_operation_log.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+size_t BucketIndex(uint64_t microseconds) {
+  size_t index(0);
+  while (microseconds != 0 && index < StorageMetrics::kHistogramBucketCount - 1) {
+    microseconds >>= 1;
+    ++index;
+  }
+  return index;
+}
+
+uint64_t BucketUpperBound(size_t index) {
+  return index == 0 ? 0 : (uint64_t(1) << index) - 1;
+}
+
+void UpdateMax(std::atomic<uint64_t>& current_max, uint64_t value) {
+  uint64_t previous(current_max.load());
+  while (previous < value && !current_max.compare_exchange_weak(previous, value)) {}
+}
+
+// String literals, so that they can name the storage calls of slow operations.
+const char* OperationName(StorageOperation operation) {
+  switch (operation) {
+    case StorageOperation::kGet: return "Get";
+    case StorageOperation::kPut: return "Put";
+    case StorageOperation::kIncrementReferenceCount: return "IncrementReferenceCount";
+    case StorageOperation::kGetVersions: return "GetVersions";
+    case StorageOperation::kGetBranch: return "GetBranch";
+    case StorageOperation::kPutVersion: return "PutVersion";
+    case StorageOperation::kCreateVersionTree: return "CreateVersionTree";
+    default: return "Unknown";
+  }
+}
+
+}  // unnamed namespace
+
+std::string ToString(StorageOperation operation) { return OperationName(operation); }
+
+std::string ToString(StorageCaller caller) {
+  switch (caller) {
+    case StorageCaller::kFileData: return "file data";
+    case StorageCaller::kDirectoryListing: return "directory listing";
+    case StorageCaller::kVersioning: return "versioning";
+    default: return "unknown";
+  }
+}
+
+StorageMetrics::Summary::Summary()
+    : count(0), failures(0), bytes(0), total_microseconds(0), max_microseconds(0), histogram() {}
+
+double StorageMetrics::Summary::MeanMicroseconds() const {
+  return count == 0 ? 0.0 : static_cast<double>(total_microseconds) / count;
+}
+
+uint64_t StorageMetrics::Summary::PercentileMicroseconds(double percentile) const {
+  if (count == 0)
+    return 0;
+  percentile = std::min(std::max(percentile, 0.0), 1.0);
+  uint64_t target(std::max(static_cast<uint64_t>(percentile * count + 0.5), uint64_t(1)));
+  uint64_t seen(0);
+  for (size_t i(0); i != kHistogramBucketCount; ++i) {
+    seen += histogram[i];
+    if (seen >= target)
+      return std::min(BucketUpperBound(i), max_microseconds);
+  }
+  return max_microseconds;
+}
+
+StorageMetrics::ScopedRecorder::ScopedRecorder(StorageMetrics& metrics, StorageOperation operation,
+                                               StorageCaller caller, uint64_t bytes)
+    : metrics_(metrics),
+      kOperation_(operation),
+      kCaller_(caller),
+      kStartTime_(std::chrono::steady_clock::now()),
+      bytes_(bytes),
+      succeeded_(false),
+      chunk_name_() {
+  DRIVE_PROBE3(storage__start, static_cast<int>(operation), static_cast<int>(caller), bytes);
+}
+
+StorageMetrics::ScopedRecorder::~ScopedRecorder() {
+  DRIVE_PROBE4(storage__end, static_cast<int>(kOperation_), static_cast<int>(kCaller_), bytes_,
+               succeeded_ ? 1 : 0);
+  auto duration(std::chrono::steady_clock::now() - kStartTime_);
+  metrics_.Record(kOperation_, kCaller_, bytes_, duration, succeeded_);
+  if (SlowOperationLog::enabled()) {
+    SlowOperationScope::AddPhaseTime(SlowOperationPhase::kStorage, duration);
+    SlowOperationScope::RecordStorageCall(OperationName(kOperation_), chunk_name_, duration);
+  }
+}
+
+void StorageMetrics::ScopedRecorder::set_chunk_name(const std::string& name) {
+  if (SlowOperationLog::enabled())
+    chunk_name_ = HexSubstr(name);
+}
+
+StorageMetrics::Cell::Cell()
+    : count(0), failures(0), bytes(0), total_microseconds(0), max_microseconds(0), histogram() {
+  for (auto& bucket : histogram)
+    bucket = 0;
+}
+
+void StorageMetrics::Cell::AddTo(Summary& summary) const {
+  summary.count += count;
+  summary.failures += failures;
+  summary.bytes += bytes;
+  summary.total_microseconds += total_microseconds;
+  summary.max_microseconds = std::max(summary.max_microseconds, max_microseconds.load());
+  for (size_t i(0); i != kHistogramBucketCount; ++i)
+    summary.histogram[i] += histogram[i];
+}
+
+StorageMetrics::StorageMetrics() : cells_() {}
+
+void StorageMetrics::Record(StorageOperation operation, StorageCaller caller, uint64_t bytes,
+                            std::chrono::steady_clock::duration duration, bool succeeded) {
+  auto microseconds(static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+  Cell& cell(cells_[static_cast<size_t>(operation)][static_cast<size_t>(caller)]);
+  ++cell.count;
+  if (!succeeded)
+    ++cell.failures;
+  cell.bytes += bytes;
+  cell.total_microseconds += microseconds;
+  UpdateMax(cell.max_microseconds, microseconds);
+  ++cell.histogram[BucketIndex(microseconds)];
+}
+
+StorageMetrics::Summary StorageMetrics::Get(StorageOperation operation,
+                                            StorageCaller caller) const {
+  Summary summary;
+  cells_[static_cast<size_t>(operation)][static_cast<size_t>(caller)].AddTo(summary);
+  return summary;
+}
+
+StorageMetrics::Summary StorageMetrics::Get(StorageOperation operation) const {
+  Summary summary;
+  for (const auto& cell : cells_[static_cast<size_t>(operation)])
+    cell.AddTo(summary);
+  return summary;
+}
+
+void StorageMetrics::Reset() {
+  for (auto& cells : cells_) {
+    for (auto& cell : cells) {
+      cell.count = 0;
+      cell.failures = 0;
+      cell.bytes = 0;
+      cell.total_microseconds = 0;
+      cell.max_microseconds = 0;
+      for (auto& bucket : cell.histogram)
+        bucket = 0;
+    }
+  }
+}
+
+std::string StorageMetrics::Report() const {
+  std::ostringstream stream;
+  stream << std::left << std::setw(24) << "operation" << std::setw(19) << "caller"
+         << std::right << std::setw(10) << "count" << std::setw(9) << "failed"
+         << std::setw(14) << "bytes" << std::setw(11) << "mean(us)" << std::setw(11) << "p50(us)"
+         << std::setw(11) << "p99(us)" << std::setw(11) << "max(us)" << '\n';
+  for (size_t operation(0); operation != kOperationCount; ++operation) {
+    for (size_t caller(0); caller != kCallerCount; ++caller) {
+      auto summary(Get(static_cast<StorageOperation>(operation),
+                       static_cast<StorageCaller>(caller)));
+      if (summary.count == 0)
+        continue;
+      stream << std::left << std::setw(24) << ToString(static_cast<StorageOperation>(operation))
+             << std::setw(19) << ToString(static_cast<StorageCaller>(caller)) << std::right
+             << std::setw(10) << summary.count << std::setw(9) << summary.failures
+             << std::setw(14) << summary.bytes << std::setw(11) << std::fixed
+             << std::setprecision(1) << summary.MeanMicroseconds()
+             << std::setw(11) << summary.PercentileMicroseconds(0.5)
+             << std::setw(11) << summary.PercentileMicroseconds(0.99)
+             << std::setw(11) << summary.max_microseconds << '\n';
+    }
+  }
+  return stream.str();
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
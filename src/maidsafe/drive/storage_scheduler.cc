@@ -0,0 +1,204 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/storage_scheduler.h"
+
+#include <algorithm>
+
+#include "maidsafe/common/error.h"
+
+#include "maidsafe/drive/slow_operation_log.h"
+#include "maidsafe/drive/tracer.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+// Zero-byte calls (e.g. version updates) still occupy the storage path for a round trip.
+const uint64_t kMinimumCost(4096);
+
+}  // unnamed namespace
+
+StorageScheduler::ScopedSlot::ScopedSlot(StorageScheduler& scheduler, Priority priority,
+                                         uint64_t bytes)
+    : scheduler_(scheduler) {
+  SlowOperationTimer timer(SlowOperationPhase::kStorageQueue);
+  scheduler_.Acquire(priority, bytes);
+}
+
+StorageScheduler::ScopedSlot::~ScopedSlot() { scheduler_.Release(); }
+
+StorageScheduler::StorageScheduler(int max_concurrent,
+                                   const std::array<uint32_t, kPriorityCount>& weights)
+    : kMaxConcurrent_(max_concurrent),
+      kWeights_(weights),
+      mutex_(),
+      condition_(),
+      queue_(),
+      next_sequence_number_(0),
+      active_count_(0),
+      virtual_time_(0.0),
+      last_finish_tags_(),
+      upload_bytes_per_second_(0),
+      burst_bytes_(0),
+      tokens_(0.0),
+      last_refill_(std::chrono::steady_clock::now()) {
+  if (kMaxConcurrent_ < 1)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  for (auto weight : kWeights_) {
+    if (weight == 0)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  last_finish_tags_.fill(0.0);
+}
+
+std::array<uint32_t, StorageScheduler::kPriorityCount> StorageScheduler::DefaultWeights() {
+  std::array<uint32_t, kPriorityCount> weights = {{ 8, 4, 2, 1 }};
+  return weights;
+}
+
+StorageScheduler::Priority StorageScheduler::PriorityOf(StorageOperation operation,
+                                                        StorageCaller caller) {
+  switch (operation) {
+    case StorageOperation::kGet:
+    case StorageOperation::kGetVersions:
+    case StorageOperation::kGetBranch:
+      return Priority::kInteractiveRead;
+    case StorageOperation::kPut:
+    case StorageOperation::kIncrementReferenceCount:
+      return caller == StorageCaller::kFileData ? Priority::kDataUpload : Priority::kMetadataStore;
+    default:
+      return Priority::kMetadataStore;
+  }
+}
+
+void StorageScheduler::SetUploadRateLimit(uint64_t bytes_per_second, uint64_t burst_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  upload_bytes_per_second_ = bytes_per_second;
+  burst_bytes_ = burst_bytes != 0 ? burst_bytes : bytes_per_second;
+  tokens_ = static_cast<double>(burst_bytes_);
+  last_refill_ = std::chrono::steady_clock::now();
+  Dispatch();
+  condition_.notify_all();
+}
+
+uint64_t StorageScheduler::upload_rate_limit() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return upload_bytes_per_second_;
+}
+
+size_t StorageScheduler::waiting_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size();
+}
+
+uint64_t StorageScheduler::waiting_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t bytes(0);
+  for (const auto& waiter : queue_)
+    bytes += waiter.second->bytes;
+  return bytes;
+}
+
+int StorageScheduler::active_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return active_count_;
+}
+
+void StorageScheduler::Acquire(Priority priority, uint64_t bytes) {
+  DRIVE_TRACE_SCOPE("scheduler", "StorageScheduler::Acquire");
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto index(static_cast<size_t>(priority));
+  // Self-clocked fair queueing: a call's finish tag is its cost scaled by its class weight, added
+  // to the later of the current virtual time and the finish tag of its class' previous call.
+  double cost(static_cast<double>(std::max(bytes, kMinimumCost)) / kWeights_[index]);
+  Waiter waiter(priority, bytes, std::max(virtual_time_, last_finish_tags_[index]) + cost);
+  last_finish_tags_[index] = waiter.finish_tag;
+  queue_.emplace(std::make_pair(waiter.finish_tag, next_sequence_number_++), &waiter);
+  for (;;) {
+    auto next_ready(Dispatch());
+    if (waiter.admitted)
+      return;
+    if (next_ready == std::chrono::steady_clock::time_point::max())
+      condition_.wait(lock);
+    else
+      condition_.wait_until(lock, next_ready);
+  }
+}
+
+void StorageScheduler::Release() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  --active_count_;
+  Dispatch();
+}
+
+bool StorageScheduler::IsRateLimited(Priority priority) const {
+  return upload_bytes_per_second_ != 0 &&
+         (priority == Priority::kDataUpload || priority == Priority::kBackground);
+}
+
+void StorageScheduler::RefillTokens(std::chrono::steady_clock::time_point now) {
+  if (upload_bytes_per_second_ == 0)
+    return;
+  std::chrono::duration<double> elapsed(now - last_refill_);
+  tokens_ = std::min(static_cast<double>(burst_bytes_),
+                     tokens_ + elapsed.count() * upload_bytes_per_second_);
+  last_refill_ = now;
+}
+
+std::chrono::steady_clock::time_point StorageScheduler::Dispatch() {
+  auto now(std::chrono::steady_clock::now());
+  RefillTokens(now);
+  auto next_ready(std::chrono::steady_clock::time_point::max());
+  bool admitted_any(false), uploads_blocked(false);
+  auto itr(std::begin(queue_));
+  while (active_count_ < kMaxConcurrent_ && itr != std::end(queue_)) {
+    Waiter& waiter(*itr->second);
+    if (IsRateLimited(waiter.priority)) {
+      // A call larger than the burst size is let through once the bucket is full, leaving it in
+      // debt.  Rate-limited calls are admitted in order, but don't hold up any others.
+      double needed(std::min(static_cast<double>(waiter.bytes),
+                             static_cast<double>(burst_bytes_)));
+      if (uploads_blocked || tokens_ < needed) {
+        if (!uploads_blocked) {
+          std::chrono::duration<double> wait((needed - tokens_) / upload_bytes_per_second_);
+          next_ready = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(wait) +
+                       std::chrono::milliseconds(1);
+        }
+        uploads_blocked = true;
+        ++itr;
+        continue;
+      }
+      tokens_ -= static_cast<double>(waiter.bytes);
+    }
+    waiter.admitted = true;
+    virtual_time_ = std::max(virtual_time_, waiter.finish_tag);
+    ++active_count_;
+    admitted_any = true;
+    itr = queue_.erase(itr);
+  }
+  if (admitted_any)
+    condition_.notify_all();
+  return next_ready;
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
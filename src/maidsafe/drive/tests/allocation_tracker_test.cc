@@ -0,0 +1,134 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/drive/allocation_tracker.h"
+#include "maidsafe/drive/operation_metrics.h"
+#include "maidsafe/drive/tracer.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+namespace {
+
+AllocationTracker::Site FindSite(const std::vector<AllocationTracker::Site>& sites,
+                                 const std::string& name) {
+  auto itr(std::find_if(
+      std::begin(sites), std::end(sites),
+      [&name](const AllocationTracker::Site& site) { return site.name == name; }));
+  return itr == std::end(sites) ? AllocationTracker::Site() : *itr;
+}
+
+}  // unnamed namespace
+
+TEST_CASE("Allocation scopes", "[AllocationTracker][unit]") {
+  auto& tracker(AllocationTracker::Instance());
+  tracker.Start();
+  // Nothing in the scopes allocates other than through RecordAllocation, so the counts are exact
+  // whether or not the operator new hook is built in.
+  {
+    DRIVE_ALLOCATION_SCOPE("AllocationTest::Outer");
+    tracker.RecordAllocation(100);
+    for (int i(0); i != 2; ++i) {
+      DRIVE_ALLOCATION_SCOPE("AllocationTest::Inner");
+      tracker.RecordAllocation(10);
+      tracker.RecordAllocation(20);
+    }
+  }
+  tracker.Stop();
+  {
+    DRIVE_ALLOCATION_SCOPE("AllocationTest::Stopped");
+    tracker.RecordAllocation(1000);
+  }
+  auto sites(tracker.GetSites());
+
+  auto outer(FindSite(sites, "AllocationTest::Outer"));
+  CHECK(outer.calls == 1U);
+  CHECK(outer.self_count == 1U);
+  CHECK(outer.self_bytes == 100U);
+  CHECK(outer.total_count == 5U);
+  CHECK(outer.total_bytes == 160U);
+  auto inner(FindSite(sites, "AllocationTest::Inner"));
+  CHECK(inner.calls == 2U);
+  CHECK(inner.self_count == 4U);
+  CHECK(inner.self_bytes == 60U);
+  CHECK(inner.AllocationsPerCall() == 2.0);
+  CHECK(inner.BytesPerCall() == 30.0);
+  CHECK(FindSite(sites, "AllocationTest::Stopped").calls == 0U);
+  // Heaviest first.
+  auto outer_itr(std::find_if(std::begin(sites), std::end(sites),
+                              [](const AllocationTracker::Site& site) {
+                                return site.name == "AllocationTest::Outer";
+                              }));
+  CHECK(outer_itr == std::begin(sites));
+
+  // Restarting zeroes the counts.
+  tracker.Start();
+  tracker.Stop();
+  CHECK(FindSite(tracker.GetSites(), "AllocationTest::Outer").calls == 0U);
+  CHECK(tracker.total_count() == 0U);
+}
+
+TEST_CASE("Allocation scopes of operations and traces", "[AllocationTracker][unit]") {
+  auto& tracker(AllocationTracker::Instance());
+  OperationMetrics metrics;
+  tracker.Start();
+  { OperationMetrics::ScopedRecorder recorder(metrics, DriveOperation::kRename); }
+  { DRIVE_TRACE_SCOPE("drive", "AllocationTest::Traced"); }
+  tracker.Stop();
+  auto sites(tracker.GetSites());
+  CHECK(FindSite(sites, "OpsRename").calls == 1U);
+  CHECK(FindSite(sites, "AllocationTest::Traced").calls == 1U);
+}
+
+TEST_CASE("Allocation hook", "[AllocationTracker][unit]") {
+  auto& tracker(AllocationTracker::Instance());
+  if (!AllocationTracker::hooked()) {
+    CHECK(tracker.Report().find("isn't built in") != std::string::npos);
+    return;
+  }
+  const uint64_t kThreadCount(AllocationTracker::thread_allocation_count());
+  tracker.Start();
+  {
+    DRIVE_ALLOCATION_SCOPE("AllocationTest::Hooked");
+    // Calling the allocation functions directly, since new-expressions may be optimised away.
+    void* memory(::operator new(64));
+    ::operator delete(memory);
+  }
+  tracker.Stop();
+  auto hooked(FindSite(tracker.GetSites(), "AllocationTest::Hooked"));
+  CHECK(hooked.self_count == 1U);
+  CHECK(hooked.self_bytes == 64U);
+  CHECK(AllocationTracker::thread_allocation_count() == kThreadCount + 1);
+  CHECK(tracker.Report().find("AllocationTest::Hooked") != std::string::npos);
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,111 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <sstream>
+#include <string>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/drive/benchmarks/baseline.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+namespace {
+
+benchmark::Measurements Parse(const std::string& json_lines) {
+  std::istringstream stream(json_lines);
+  return benchmark::ParseMeasurements(stream);
+}
+
+int Check(const std::string& baseline, const std::string& json_lines) {
+  std::istringstream stream(baseline);
+  std::ostringstream report;
+  return benchmark::CheckBaseline(benchmark::ParseBaseline(stream), Parse(json_lines), report);
+}
+
+const std::string kResults(
+    "{\"benchmark\":\"directory\",\"variant\":\"uniform/get_hit/10\",\"operations\":100,"
+    "\"bytes\":0,\"seconds\":0.5,\"operations_per_second\":200,\"bytes_per_second\":0}\n"
+    "{\"label\":\"a \\\"b\\\"\",\"target\":\"local\",\"workload\":\"stat\",\"block_size\":0,"
+    "\"threads\":4,\"operations\":10,\"operations_per_second\":1e+03,"
+    "\"latency_us\":{\"p50\":10,\"p99\":50.5,\"p99.9\":80}}\n");
+
+}  // unnamed namespace
+
+TEST_CASE("Benchmark results parsing", "[Benchmark][unit]") {
+  auto measurements(Parse(kResults));
+  REQUIRE(measurements.size() == 2U);
+  CHECK(measurements.at("directory/uniform/get_hit/10").at("operations_per_second") == 200.0);
+  const auto& stat(measurements.at("local/stat/0/4"));
+  CHECK(stat.at("operations_per_second") == 1000.0);
+  CHECK(stat.at("latency_us.p99") == 50.5);
+  CHECK(stat.at("latency_us.p99.9") == 80.0);
+
+  CHECK_THROWS_AS([] { Parse("{\"benchmark\":\"directory\"}\n"); }(), maidsafe_error);
+  CHECK_THROWS_AS([] { Parse("{\"target\":\"local\",\"workload\":}\n"); }(), maidsafe_error);
+  CHECK_THROWS_AS([] { Parse("{\"benchmark\":\"a\",\"variant\":\"b\"} x\n"); }(),
+                  maidsafe_error);
+}
+
+TEST_CASE("Benchmark baseline tolerances", "[Benchmark][unit]") {
+  // Throughput may fall by up to the tolerance.
+  CHECK(Check("directory/uniform/get_hit/10  operations_per_second  higher  250  25%\n",
+              kResults) == 0);
+  CHECK(Check("directory/uniform/get_hit/10  operations_per_second  higher  300  25%\n",
+              kResults) == 1);
+  CHECK(Check("directory/uniform/get_hit/10  operations_per_second  higher  100  0\n",
+              kResults) == 0);
+  // Latency may rise by up to the tolerance.
+  CHECK(Check("local/stat/0/4  latency_us.p99  lower  50  0.02\n", kResults) == 0);
+  CHECK(Check("local/stat/0/4  latency_us.p99  lower  25  100%\n", kResults) == 1);
+  // Comments are ignored, and missing results or metrics are regressions.
+  CHECK(Check("# local/stat/0/1  latency_us.p99  lower  25  0%\n\n"
+              "local/stat/0/1  latency_us.p99  lower  25  0%\n"
+              "local/stat/0/4  allocations_per_operation  lower  25  0%\n"
+              "local/stat/0/4  operations_per_second  higher  900  0%\n", kResults) == 2);
+
+  CHECK_THROWS_AS([] { Check("local/stat/0/4  latency_us.p99  lower  25\n", ""); }(),
+                  maidsafe_error);
+  CHECK_THROWS_AS([] { Check("local/stat/0/4  latency_us.p99  less  25  0%\n", ""); }(),
+                  maidsafe_error);
+  CHECK_THROWS_AS([] { Check("local/stat/0/4  latency_us.p99  lower  0  0%\n", ""); }(),
+                  maidsafe_error);
+}
+
+TEST_CASE("Benchmark baseline update", "[Benchmark][unit]") {
+  std::istringstream baseline("# Comment\n"
+                              "local/stat/0/4 latency_us.p99 lower 25 100%\n"
+                              "local/stat/0/1  latency_us.p99  lower  25  0%\n"
+                              "local/stat/0/4   operations_per_second higher 900 10%\n");
+  CHECK(benchmark::UpdateBaseline(baseline, Parse(kResults)) ==
+        "# Comment\n"
+        "local/stat/0/4  latency_us.p99  lower  50.5  100%\n"
+        "local/stat/0/1  latency_us.p99  lower  25  0%\n"
+        "local/stat/0/4  operations_per_second  higher  1000  10%\n");
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
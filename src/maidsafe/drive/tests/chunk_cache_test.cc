@@ -0,0 +1,164 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <memory>
+#include <string>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/cached_store.h"
+#include "maidsafe/drive/chunk_cache.h"
+#include "maidsafe/drive/memory_store.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+class ChunkCacheTest {
+ public:
+  ChunkCacheTest()
+      : test_dir_(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive")),
+        kCacheDir_(*test_dir_ / "chunk_cache") {}
+
+ protected:
+  ImmutableData MakeChunk(size_t size) const {
+    return ImmutableData(NonEmptyString(RandomString(size)));
+  }
+
+  maidsafe::test::TestPath test_dir_;
+  const fs::path kCacheDir_;
+
+ private:
+  ChunkCacheTest(const ChunkCacheTest&);
+  ChunkCacheTest& operator=(const ChunkCacheTest&);
+};
+
+TEST_CASE_METHOD(ChunkCacheTest, "Cache hits and misses", "[ChunkCache][behavioural]") {
+  ChunkCache cache(kCacheDir_, DiskUsage(1024 * 1024));
+  auto chunk(MakeChunk(1024));
+  CHECK_FALSE(cache.Get(chunk.name()));
+  cache.Put(chunk);
+  CHECK(cache.Has(chunk.name()));
+  auto cached(cache.Get(chunk.name()));
+  REQUIRE(cached);
+  CHECK(cached->data() == chunk.data());
+  CHECK(cache.GetCurrentDiskUsage() == 1024U);
+
+  auto statistics(cache.GetStatistics());
+  CHECK(statistics.hits == 1U);
+  CHECK(statistics.misses == 1U);
+  CHECK(statistics.insertions == 1U);
+  CHECK(statistics.HitRate() == 0.5);
+
+  cache.Clear();
+  CHECK_FALSE(cache.Has(chunk.name()));
+  CHECK(cache.GetCurrentDiskUsage() == 0U);
+  CHECK(fs::is_empty(kCacheDir_));
+}
+
+TEST_CASE_METHOD(ChunkCacheTest, "Least recently used eviction", "[ChunkCache][behavioural]") {
+  ChunkCache cache(kCacheDir_, DiskUsage(3 * 1024));
+  auto first(MakeChunk(1024)), second(MakeChunk(1024)), third(MakeChunk(1024));
+  cache.Put(first);
+  cache.Put(second);
+  cache.Put(third);
+  // Touching 'first' leaves 'second' as the least recently used chunk.
+  CHECK(cache.Get(first.name()));
+  cache.Put(MakeChunk(1024));
+  CHECK(cache.Has(first.name()));
+  CHECK_FALSE(cache.Has(second.name()));
+  CHECK(cache.Has(third.name()));
+  CHECK(cache.GetStatistics().evictions == 1U);
+  CHECK(cache.GetCurrentDiskUsage() == 3U * 1024U);
+
+  // A chunk bigger than the whole cache is ignored.
+  auto huge(MakeChunk(4 * 1024));
+  cache.Put(huge);
+  CHECK_FALSE(cache.Has(huge.name()));
+}
+
+TEST_CASE_METHOD(ChunkCacheTest, "Recency survives a restart", "[ChunkCache][behavioural]") {
+  auto first(MakeChunk(1024)), second(MakeChunk(1024)), third(MakeChunk(1024));
+  {
+    ChunkCache cache(kCacheDir_, DiskUsage(3 * 1024));
+    cache.Put(first);
+    cache.Put(second);
+    cache.Put(third);
+    CHECK(cache.Get(first.name()));
+  }
+  CHECK(fs::exists(kCacheDir_ / "recency"));
+  ChunkCache cache(kCacheDir_, DiskUsage(3 * 1024));
+  cache.Put(MakeChunk(1024));
+  CHECK(cache.Has(first.name()));
+  CHECK_FALSE(cache.Has(second.name()));
+  CHECK(cache.Has(third.name()));
+}
+
+TEST_CASE_METHOD(ChunkCacheTest, "Persistence and verification", "[ChunkCache][behavioural]") {
+  auto intact(MakeChunk(1024)), corrupted(MakeChunk(1024));
+  {
+    ChunkCache cache(kCacheDir_, DiskUsage(1024 * 1024));
+    cache.Put(intact);
+    cache.Put(corrupted);
+  }
+  REQUIRE(WriteFile(kCacheDir_ / HexEncode(corrupted.name()->string()), RandomString(1024)));
+
+  ChunkCache cache(kCacheDir_, DiskUsage(1024 * 1024));
+  CHECK(cache.GetCurrentDiskUsage() == 2U * 1024U);
+  auto cached(cache.Get(intact.name()));
+  REQUIRE(cached);
+  CHECK(cached->data() == intact.data());
+  CHECK_FALSE(cache.Get(corrupted.name()));
+  CHECK_FALSE(cache.Has(corrupted.name()));
+  CHECK(cache.GetStatistics().corruptions == 1U);
+}
+
+TEST_CASE_METHOD(ChunkCacheTest, "Cached store", "[ChunkCache][behavioural]") {
+  auto memory_store(std::make_shared<MemoryStore>());
+  auto cache(std::make_shared<ChunkCache>(kCacheDir_, DiskUsage(1024 * 1024)));
+  CachedStore<MemoryStore> cached_store(memory_store, cache);
+
+  // Stored chunks are cached on the way out...
+  auto stored(MakeChunk(1024));
+  cached_store.Put(stored);
+  CHECK(cache->Has(stored.name()));
+
+  // ... and fetched ones on the way in.
+  auto fetched(MakeChunk(1024));
+  memory_store->Put(fetched);
+  CHECK(cached_store.Get(fetched.name()).get().data() == fetched.data());
+  CHECK(cache->Has(fetched.name()));
+
+  // Once cached, a chunk no longer needs to be in the underlying store.
+  memory_store->Delete(fetched.name());
+  CHECK(cached_store.Get(fetched.name()).get().data() == fetched.data());
+  CHECK_THROWS_AS(cached_store.Get(MakeChunk(1024).name()).get(), std::exception);
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
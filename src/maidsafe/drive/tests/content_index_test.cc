@@ -0,0 +1,168 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/content_index.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+namespace {
+
+encrypt::DataMap MakeDataMap(int chunk_count) {
+  encrypt::DataMap data_map;
+  for (int i(0); i != chunk_count; ++i) {
+    encrypt::ChunkDetails chunk;
+    chunk.hash = RandomString(64);
+    chunk.pre_hash = RandomString(64);
+    chunk.size = 1024 * 1024;
+    data_map.chunks.push_back(chunk);
+  }
+  return data_map;
+}
+
+bool HaveSameChunks(const encrypt::DataMap& lhs, const encrypt::DataMap& rhs) {
+  if (lhs.chunks.size() != rhs.chunks.size())
+    return false;
+  for (size_t i(0); i != lhs.chunks.size(); ++i) {
+    if (lhs.chunks[i].hash != rhs.chunks[i].hash)
+      return false;
+  }
+  return true;
+}
+
+}  // unnamed namespace
+
+TEST_CASE("Content index persistence", "[ContentIndex][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  const ContentIndex::Key kFirstKey(RandomString(64), 3 * 1024 * 1024);
+  const ContentIndex::Key kSecondKey(RandomString(64), 5 * 1024 * 1024);
+  const auto kFirstDataMap(MakeDataMap(3)), kSecondDataMap(MakeDataMap(5));
+  encrypt::DataMap found;
+  {
+    ContentIndex index(*test_dir);
+    CHECK_FALSE(index.Find(kFirstKey, found));
+    index.Add(kFirstKey, kFirstDataMap);
+    index.Add(kFirstKey, kSecondDataMap);
+    index.Add(kSecondKey, kSecondDataMap);
+    CHECK(index.size() == 2U);
+    REQUIRE(index.Find(kFirstKey, found));
+    CHECK(HaveSameChunks(found, kFirstDataMap));
+  }
+
+  {
+    ContentIndex index(*test_dir);
+    CHECK(index.size() == 2U);
+    REQUIRE(index.Find(kSecondKey, found));
+    CHECK(HaveSameChunks(found, kSecondDataMap));
+  }
+
+  // A torn final record is dropped, leaving the earlier ones usable.
+  const auto kIndexPath(*test_dir / "content_index");
+  fs::resize_file(kIndexPath, fs::file_size(kIndexPath) - 10);
+  ContentIndex index(*test_dir);
+  CHECK(index.size() == 1U);
+  REQUIRE(index.Find(kFirstKey, found));
+  CHECK(HaveSameChunks(found, kFirstDataMap));
+  CHECK_FALSE(index.Find(kSecondKey, found));
+  index.Add(kSecondKey, kSecondDataMap);
+  REQUIRE(index.Find(kSecondKey, found));
+  CHECK(HaveSameChunks(found, kSecondDataMap));
+}
+
+TEST_CASE("Content hasher", "[ContentIndex][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  auto index(std::make_shared<ContentIndex>(*test_dir));
+  const std::string kContent(RandomString(10000));
+  const uint64_t kSize(kContent.size());
+  const auto kDataMap(MakeDataMap(3));
+  encrypt::DataMap found;
+  {
+    ContentHasher hasher(index);
+    hasher.Update(kContent.data(), 4000, 0);
+    hasher.Update(kContent.data() + 4000, 6000, 4000);
+    CHECK_FALSE(hasher.Find(kSize, found));
+    // Only the whole file is keyed.
+    ContentIndex::Key key;
+    CHECK_FALSE(hasher.GetKey(kSize - 1, key));
+    REQUIRE(hasher.GetKey(kSize, key));
+    CHECK(key.second == kSize);
+    hasher.content_index()->Add(key, kDataMap);
+    CHECK(index->size() == 1U);
+    // Nothing is indexed for content held in the data map itself.
+    hasher.content_index()->Add(ContentIndex::Key(RandomString(64), 10), encrypt::DataMap());
+    CHECK(index->size() == 1U);
+  }
+
+  SECTION("Sequential writes of the same content") {
+    ContentHasher hasher(index);
+    for (uint64_t offset(0); offset < kSize; offset += 1000)
+      hasher.Update(kContent.data() + offset, 1000, offset);
+    REQUIRE(hasher.Find(kSize, found));
+    CHECK(HaveSameChunks(found, kDataMap));
+  }
+
+  SECTION("Non-sequential writes") {
+    ContentHasher hasher(index);
+    hasher.Update(kContent.data() + 4000, 6000, 4000);
+    hasher.Update(kContent.data(), 4000, 0);
+    CHECK_FALSE(hasher.Find(kSize, found));
+    ContentIndex::Key key;
+    CHECK_FALSE(hasher.GetKey(kSize, key));
+  }
+
+  SECTION("Truncation") {
+    ContentHasher hasher(index);
+    hasher.Update(kContent.data(), 4000, 0);
+    hasher.Truncate(2000);
+    hasher.Update(kContent.data() + 2000, 8000, 2000);
+    CHECK_FALSE(hasher.Find(kSize, found));
+    // Truncating to zero starts the hash again.
+    hasher.Truncate(0);
+    hasher.Update(kContent.data(), 10000, 0);
+    REQUIRE(hasher.Find(kSize, found));
+    CHECK(HaveSameChunks(found, kDataMap));
+  }
+
+  SECTION("Different content") {
+    ContentHasher hasher(index);
+    std::string other(kContent);
+    other[5000] ^= 1;
+    hasher.Update(other.data(), 10000, 0);
+    CHECK_FALSE(hasher.Find(kSize, found));
+  }
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,121 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/drive/config.h"
+#include "maidsafe/drive/control_files.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+TEST_CASE("Statistics formatting", "[ControlFiles][unit]") {
+  std::vector<Statistic> statistics;
+  statistics.emplace_back("open_files", "Files open.", 3);
+  statistics.emplace_back("hit_ratio", "Fraction of hits.", 0.25);
+  statistics.emplace_back("calls_total{operation=\"Get\"}", "Calls made.", 7,
+                          Statistic::Type::kCounter);
+  statistics.emplace_back("calls_total{operation=\"Put\"}", "Calls made.", 2,
+                          Statistic::Type::kCounter);
+
+  CHECK(FormatStatistics(statistics) ==
+        "open_files 3\n"
+        "hit_ratio 0.250000\n"
+        "calls_total{operation=\"Get\"} 7\n"
+        "calls_total{operation=\"Put\"} 2\n");
+  CHECK(FormatStatisticsForPrometheus(statistics) ==
+        "# HELP maidsafe_drive_open_files Files open.\n"
+        "# TYPE maidsafe_drive_open_files gauge\n"
+        "maidsafe_drive_open_files 3\n"
+        "# HELP maidsafe_drive_hit_ratio Fraction of hits.\n"
+        "# TYPE maidsafe_drive_hit_ratio gauge\n"
+        "maidsafe_drive_hit_ratio 0.250000\n"
+        "# HELP maidsafe_drive_calls_total Calls made.\n"
+        "# TYPE maidsafe_drive_calls_total counter\n"
+        "maidsafe_drive_calls_total{operation=\"Get\"} 7\n"
+        "maidsafe_drive_calls_total{operation=\"Put\"} 2\n");
+}
+
+TEST_CASE("Control paths", "[ControlFiles][unit]") {
+  const auto kControlDirectory(detail::kControlDirectory);
+  ControlFiles control_files;
+  CHECK(control_files.enabled());
+  CHECK(control_files.IsControlPath(kControlDirectory));
+  CHECK(control_files.IsControlPath(kControlDirectory / "stats"));
+  CHECK(control_files.IsControlPath(kControlDirectory / "a" / "b"));
+  CHECK_FALSE(control_files.IsControlPath(detail::kRoot));
+  CHECK_FALSE(control_files.IsControlPath(detail::kRoot / ".drive2"));
+  CHECK_FALSE(control_files.IsControlPath(detail::kRoot / "a" / ".drive"));
+  CHECK_FALSE(control_files.IsControlPath(boost::filesystem::path(".drive")));
+  CHECK(control_files.IsControlDirectory(kControlDirectory));
+  CHECK_FALSE(control_files.IsControlDirectory(kControlDirectory / "stats"));
+
+  control_files.Disable();
+  CHECK_FALSE(control_files.enabled());
+  CHECK_FALSE(control_files.IsControlPath(kControlDirectory));
+  CHECK_FALSE(control_files.IsControlPath(kControlDirectory / "stats"));
+  CHECK_FALSE(control_files.IsControlDirectory(kControlDirectory));
+}
+
+TEST_CASE("Stat and control files", "[ControlFiles][behavioural]") {
+  const auto kControlDirectory(detail::kControlDirectory);
+  ControlFiles control_files;
+  int generated(0), triggered(0);
+  control_files.AddStatFile("stats", [&generated] {
+    return "generated " + std::to_string(++generated) + "\n";
+  });
+  control_files.AddControlFile("flush", [&triggered] { ++triggered; });
+
+  CHECK(control_files.IsStatFile(kControlDirectory / "stats"));
+  CHECK_FALSE(control_files.IsStatFile(kControlDirectory / "flush"));
+  CHECK(control_files.IsControlFile(kControlDirectory / "flush"));
+  CHECK_FALSE(control_files.IsControlFile(kControlDirectory / "stats"));
+  CHECK_FALSE(control_files.IsStatFile(kControlDirectory / "a" / "stats"));
+  CHECK_FALSE(control_files.IsStatFile(kControlDirectory));
+  CHECK(control_files.Names() == std::vector<std::string>({ "flush", "stats" }));
+
+  CHECK(control_files.Generate(kControlDirectory / "stats") == "generated 1\n");
+  CHECK(control_files.Generate(kControlDirectory / "stats") == "generated 2\n");
+  control_files.Trigger(kControlDirectory / "flush");
+  CHECK(triggered == 1);
+
+  CHECK_THROWS_AS(control_files.Generate(kControlDirectory / "flush"), std::exception);
+  CHECK_THROWS_AS(control_files.Trigger(kControlDirectory / "stats"), std::exception);
+  CHECK_THROWS_AS(control_files.Generate(kControlDirectory / "missing"), std::exception);
+  CHECK(triggered == 1);
+
+  // Re-adding a name replaces the existing file, even if it was of the other kind.
+  control_files.AddControlFile("stats", [&triggered] { triggered += 10; });
+  CHECK(control_files.IsControlFile(kControlDirectory / "stats"));
+  CHECK_FALSE(control_files.IsStatFile(kControlDirectory / "stats"));
+  control_files.Trigger(kControlDirectory / "stats");
+  CHECK(triggered == 11);
+  CHECK(control_files.Names() == std::vector<std::string>({ "flush", "stats" }));
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
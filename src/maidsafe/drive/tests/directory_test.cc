@@ -20,8 +20,14 @@
 #include <windows.h>
 #endif
 
+#include <atomic>
+#include <chrono>
 #include <fstream>
+#include <future>
+#include <memory>
 #include <string>
+#include <vector>
+
 #include "boost/filesystem.hpp"
 #include "boost/thread.hpp"
 #include "boost/random/mersenne_twister.hpp"
@@ -29,15 +35,19 @@
 #include "boost/random/variate_generator.hpp"
 
 #include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/test.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/common/asio_service.h"
 
 #include "maidsafe/encrypt/data_map.h"
+#include "maidsafe/encrypt/self_encryptor.h"
 
 #include "maidsafe/drive/meta_data.h"
+#include "maidsafe/drive/content_index.h"
 #include "maidsafe/drive/directory.h"
+#include "maidsafe/drive/file_context.h"
 #include "maidsafe/drive/utils.h"
 #include "maidsafe/drive/tests/test_utils.h"
 
@@ -558,6 +568,108 @@ TEST_CASE_METHOD(DirectoryTest, "Iterator reset", "[Directory][behavioural]") {
   // CHECK(directory_listing1 < directory_listing2);
 }
 
+TEST_CASE("Chunks are put without holding the directory lock", "[Directory][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  AsioService asio_service(1);
+  std::promise<void> put_started, release_put;
+  std::shared_future<void> put_released(release_put.get_future().share());
+  std::atomic<int> chunks_put(0);
+  Directory directory(
+      ParentId(Identity(RandomString(64))), Identity(RandomString(64)), asio_service.service(),
+      [](Directory* directory) {
+        ImmutableData contents(NonEmptyString(directory->Serialise()));
+        directory->AddNewVersion(contents.name());
+      },
+      [&](const ImmutableData&) {
+        if (++chunks_put == 1) {
+          put_started.set_value();
+          put_released.wait();
+        }
+      },
+      [](const std::vector<ImmutableData::Name>&) {}, "");
+  directory.AddChild(FileContext("file", false));
+  FileContext* child(directory.GetMutableChild("file"));
+  child->buffer.reset(new FileContext::Buffer(MemoryUsage(1 << 20), DiskUsage(1 << 20),
+      [](const std::string&, const NonEmptyString&) {}, *test_dir / "buffer", true));
+  child->self_encryptor.reset(new encrypt::SelfEncryptor(*child->meta_data.data_map,
+      *child->buffer, [](const std::string&) -> NonEmptyString {
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+      }));
+  const std::string content(RandomString(64 * 1024));
+  REQUIRE(child->self_encryptor->Write(content.data(), static_cast<uint32_t>(content.size()), 0));
+
+  auto flush(std::async(std::launch::async,
+                        [&] { directory.FlushChildAndDeleteEncryptor(child); }));
+  put_started.get_future().wait();
+  // The put is blocked, but other operations on the directory can still proceed.
+  auto has_child(std::async(std::launch::async, [&] { return directory.HasChild("file"); }));
+  CHECK(has_child.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+  release_put.set_value();
+  CHECK(has_child.get());
+  flush.get();
+  CHECK(chunks_put > 0);
+  CHECK_FALSE(child->self_encryptor);
+  CHECK_FALSE(child->buffer);
+  asio_service.Stop();
+}
+
+TEST_CASE("Indexed content reuses its data map", "[Directory][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  auto content_index(std::make_shared<ContentIndex>(*test_dir / "content_index"));
+  AsioService asio_service(1);
+  size_t chunks_put(0), chunks_incremented(0);
+  Directory directory(
+      ParentId(Identity(RandomString(64))), Identity(RandomString(64)), asio_service.service(),
+      [](Directory*) {},  // NOLINT
+      [&](const ImmutableData&) { ++chunks_put; },
+      [&](const std::vector<ImmutableData::Name>& names) { chunks_incremented += names.size(); },
+      "");
+  const std::string content(RandomString(64 * 1024));
+  auto write_and_close([&](const std::string& name) -> const FileContext* {
+    directory.AddChild(FileContext(name, false));
+    FileContext* child(directory.GetMutableChild(name));
+    child->buffer.reset(new FileContext::Buffer(MemoryUsage(1 << 20), DiskUsage(1 << 20),
+        [](const std::string&, const NonEmptyString&) {}, *test_dir / name, true));
+    child->self_encryptor.reset(new encrypt::SelfEncryptor(*child->meta_data.data_map,
+        *child->buffer, [](const std::string&) -> NonEmptyString {
+          BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+        }));
+    child->content_hasher.reset(new ContentHasher(content_index));
+    const uint32_t kHalf(static_cast<uint32_t>(content.size() / 2));
+    for (uint32_t offset(0); offset != 2 * kHalf; offset += kHalf) {
+      REQUIRE(child->self_encryptor->Write(content.data() + offset, kHalf, offset));
+      child->content_hasher->Update(content.data() + offset, kHalf, offset);
+    }
+    directory.FlushChildAndDeleteEncryptor(child);
+    CHECK_FALSE(child->self_encryptor);
+    CHECK_FALSE(child->content_hasher);
+    return child;
+  });
+
+  auto first(write_and_close("first"));
+  const size_t first_chunks_put(chunks_put);
+  REQUIRE(first_chunks_put > 0);
+  CHECK(content_index->size() == 1U);
+  CHECK(content_index->hit_count() == 0U);
+
+  auto second(write_and_close("second"));
+  CHECK(chunks_put == first_chunks_put);
+  CHECK(content_index->hit_count() == 1U);
+  CHECK(content_index->hit_bytes() == content.size());
+  REQUIRE(second->meta_data.data_map->chunks.size() == first->meta_data.data_map->chunks.size());
+  for (size_t i(0); i != first->meta_data.data_map->chunks.size(); ++i) {
+    CHECK(second->meta_data.data_map->chunks[i].hash ==
+          first->meta_data.data_map->chunks[i].hash);
+  }
+
+  // The reused chunks only have their reference counts incremented, with the listing.
+  ImmutableData contents(NonEmptyString(directory.Serialise()));
+  directory.AddNewVersion(contents.name());
+  CHECK(chunks_incremented == second->meta_data.data_map->chunks.size());
+  CHECK(chunks_put == first_chunks_put);
+  asio_service.Stop();
+}
+
 }  // namespace test
 
 }  // namespace detail
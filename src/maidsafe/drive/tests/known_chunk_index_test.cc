@@ -0,0 +1,170 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/deduplicating_store.h"
+#include "maidsafe/drive/known_chunk_index.h"
+#include "maidsafe/drive/memory_store.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+namespace {
+
+// Like a network client during an outage, fails Puts while 'losing_puts' is true.
+class LossyStore {
+ public:
+  LossyStore() : store(), losing_puts(false) {}
+
+  boost::future<ImmutableData> Get(const ImmutableData::Name& data_name) {
+    return store.Get(data_name);
+  }
+  boost::future<void> Put(const ImmutableData& data) {
+    boost::promise<void> promise;
+    if (losing_puts) {
+      promise.set_exception(MakeError(CommonErrors::unable_to_handle_request));
+    } else {
+      store.Put(data);
+      promise.set_value();
+    }
+    return promise.get_future();
+  }
+  void IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names) {
+    store.IncrementReferenceCount(data_names);
+  }
+
+  MemoryStore store;
+  bool losing_puts;
+};
+
+}  // unnamed namespace
+
+TEST_CASE("Known chunk index persistence", "[KnownChunkIndex][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  const auto kIndexPath(*test_dir / "known_chunks" / "index");
+  std::vector<ImmutableData::Name> names;
+  for (int i(0); i != 100; ++i)
+    names.emplace_back(Identity(RandomString(64)));
+  ImmutableData::Name unknown_name(Identity(RandomString(64)));
+  {
+    KnownChunkIndex index(kIndexPath);
+    for (const auto& name : names)
+      index.Add(name);
+    index.Add(names.front());
+    CHECK(index.size() == names.size());
+    CHECK(index.GetStatistics().additions == names.size());
+    for (const auto& name : names)
+      CHECK(index.Contains(name));
+    CHECK_FALSE(index.Contains(unknown_name));
+  }
+
+  KnownChunkIndex index(kIndexPath);
+  CHECK(index.size() == names.size());
+  for (const auto& name : names)
+    CHECK(index.Contains(name));
+  CHECK_FALSE(index.Contains(unknown_name));
+  CHECK(index.GetStatistics().lookups == names.size() + 1);
+  CHECK(index.GetStatistics().hits == names.size());
+}
+
+TEST_CASE("Known chunk index limit", "[KnownChunkIndex][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  const auto kIndexPath(*test_dir / "index");
+  const size_t kMaxNames(2500);
+  std::vector<ImmutableData::Name> names;
+  for (size_t i(0); i != kMaxNames + 100; ++i)
+    names.emplace_back(Identity(RandomString(64)));
+  {
+    KnownChunkIndex index(kIndexPath, kMaxNames);
+    for (const auto& name : names)
+      index.Add(name);
+    CHECK(index.size() == kMaxNames);
+    CHECK(index.GetStatistics().additions == kMaxNames);
+    for (size_t i(0); i != names.size(); ++i)
+      CHECK(index.Contains(names[i]) == (i < kMaxNames));
+  }
+
+  KnownChunkIndex index(kIndexPath, kMaxNames);
+  CHECK(index.size() == kMaxNames);
+  for (size_t i(0); i != names.size(); ++i)
+    CHECK(index.Contains(names[i]) == (i < kMaxNames));
+}
+
+TEST_CASE("Deduplicating store", "[KnownChunkIndex][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  auto memory_store(std::make_shared<MemoryStore>());
+  auto index(std::make_shared<KnownChunkIndex>(*test_dir / "index"));
+  DeduplicatingStore<MemoryStore> store(memory_store, index);
+
+  ImmutableData data(NonEmptyString(RandomString(1024)));
+  store.Put(data);
+  CHECK(index->Contains(data.name()));
+  CHECK(store.deduplicated_count() == 0U);
+  store.Put(data);
+  CHECK(store.deduplicated_count() == 1U);
+  CHECK(store.deduplicated_bytes() == 1024U);
+
+  // The second Put must have become an increment, so two deletes are needed to remove the chunk.
+  memory_store->Delete(data.name());
+  CHECK(memory_store->Get(data.name()).get().data() == data.data());
+  memory_store->Delete(data.name());
+  CHECK_THROWS_AS(memory_store->Get(data.name()).get(), std::exception);
+
+  // Chunks retrieved through the store become known too.
+  ImmutableData fetched(NonEmptyString(RandomString(1024)));
+  memory_store->Put(fetched);
+  CHECK_FALSE(index->Contains(fetched.name()));
+  CHECK(store.Get(fetched.name()).get().data() == fetched.data());
+  CHECK(index->Contains(fetched.name()));
+}
+
+TEST_CASE("Deduplicating store only indexes confirmed chunks", "[KnownChunkIndex][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  auto lossy_store(std::make_shared<LossyStore>());
+  auto index(std::make_shared<KnownChunkIndex>(*test_dir / "index"));
+  DeduplicatingStore<LossyStore> store(lossy_store, index);
+
+  // A lost Put mustn't make the chunk known, or later Puts of it would only increment the
+  // reference count of a chunk the network doesn't hold.
+  ImmutableData data(NonEmptyString(RandomString(1024)));
+  lossy_store->losing_puts = true;
+  CHECK_THROWS_AS(store.Put(data), std::exception);
+  CHECK_FALSE(index->Contains(data.name()));
+
+  lossy_store->losing_puts = false;
+  store.Put(data);
+  CHECK(index->Contains(data.name()));
+  CHECK(store.deduplicated_count() == 0U);
+  CHECK(lossy_store->store.Get(data.name()).get().data() == data.data());
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
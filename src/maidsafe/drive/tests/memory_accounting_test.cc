@@ -0,0 +1,179 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/encrypt/data_map.h"
+
+#include "maidsafe/drive/config.h"
+#include "maidsafe/drive/directory.h"
+#include "maidsafe/drive/file_context.h"
+#include "maidsafe/drive/memory_accounting.h"
+#include "maidsafe/drive/meta_data.h"
+#include "maidsafe/drive/proto_structs.pb.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+namespace {
+
+// Completes a store the way DirectoryHandler does, which a Directory waits for on destruction.
+void StoreDirectory(detail::Directory* directory) {
+  ImmutableData contents(NonEmptyString(directory->Serialise()));
+  directory->AddNewVersion(contents.name());
+}
+
+std::unique_ptr<detail::Directory> ParseDirectory(const std::string& serialised,
+                                                  AsioService& asio_service) {
+  return std::unique_ptr<detail::Directory>(new detail::Directory(
+      ParentId(Identity(RandomString(64))), serialised,
+      std::vector<StructuredDataVersions::VersionName>(), asio_service.service(),
+      StoreDirectory, [](const ImmutableData&) {},
+      [](const std::vector<ImmutableData::Name>&) {}, ""));
+}
+
+encrypt::DataMap ThreeChunkDataMap() {
+  encrypt::DataMap data_map;
+  for (int i(0); i != 3; ++i) {
+    encrypt::ChunkDetails chunk;
+    chunk.hash = RandomString(64);
+    chunk.pre_hash = RandomString(64);
+    chunk.size = 1024 * 1024;
+    data_map.chunks.push_back(chunk);
+  }
+  return data_map;
+}
+
+}  // unnamed namespace
+
+TEST_CASE("Memory accounting of a directory's children", "[MemoryAccounting][unit]") {
+  const size_t kFileCount(100);
+  AsioService asio_service(1);
+  detail::Directory directory(ParentId(Identity(RandomString(64))),
+                              Identity(RandomString(64)), asio_service.service(),
+                              StoreDirectory, [](const ImmutableData&) {},
+                              [](const std::vector<ImmutableData::Name>&) {}, "");
+  auto empty(directory.GetStatistics().memory);
+  CHECK(empty.file_context_count == 0U);
+  CHECK(empty.timer_count == 1U);
+  CHECK(empty.directories >= sizeof(detail::Directory));
+
+  for (size_t i(0); i != kFileCount; ++i) {
+    detail::FileContext file_context("file_" + std::to_string(i), false);
+    *file_context.meta_data.data_map = ThreeChunkDataMap();
+    directory.AddChild(std::move(file_context));
+  }
+  auto memory(directory.GetStatistics().memory);
+  CHECK(memory.file_context_count == kFileCount);
+  CHECK(memory.file_contexts >= kFileCount * sizeof(detail::FileContext));
+  // Each data map holds six 64-byte hashes.
+  CHECK(memory.data_maps >= kFileCount * 6 * 64);
+  CHECK(memory.directories > empty.directories);
+  CHECK(memory.TotalMemory() == memory.directories + memory.file_contexts + memory.data_maps +
+                                    memory.upload_queues + memory.timers);
+
+  MemoryStatistics sum(memory);
+  sum += memory;
+  CHECK(sum.TotalMemory() == 2 * memory.TotalMemory());
+  CHECK(sum.file_context_count == 2 * kFileCount);
+
+  auto statistics(ToStatistics(memory));
+  bool found_total(false);
+  for (const auto& statistic : statistics) {
+    if (statistic.name == "memory_bytes_total") {
+      CHECK(statistic.value == static_cast<double>(memory.TotalMemory()));
+      found_total = true;
+    }
+  }
+  CHECK(found_total);
+
+  // The running totals follow renames and removals without rewalking the children.
+  directory.RenameChild("file_0", "renamed_file_0");
+  CHECK(directory.GetStatistics().memory.file_context_count == kFileCount);
+  for (size_t i(1); i != kFileCount; ++i)
+    directory.RemoveChild("file_" + std::to_string(i));
+  auto one_left(directory.GetStatistics().memory);
+  CHECK(one_left.file_context_count == 1U);
+  CHECK(one_left.file_contexts < memory.file_contexts / 10);
+  CHECK(one_left.data_maps < memory.data_maps / 10);
+  directory.RemoveChild("renamed_file_0");
+  auto none_left(directory.GetStatistics().memory);
+  CHECK(none_left.file_context_count == 0U);
+  CHECK(none_left.file_contexts == 0U);
+  CHECK(none_left.data_maps == 0U);
+  asio_service.Stop();
+}
+
+TEST_CASE("Memory per cached entry at a million entries", "[MemoryAccounting][behavioural]") {
+  // One in ten entries is a directory and the rest are small files whose content is held in the
+  // data map, which is typical of source trees and mail stores.
+  const size_t kEntryCount(1000000);
+  const uint64_t kBudgetPerEntry(1024);
+  std::string serialised;
+  {
+    detail::protobuf::Directory proto_directory;
+    proto_directory.set_directory_id(RandomString(64));
+    proto_directory.set_max_versions(detail::kMaxVersions.data);
+    const std::string kContent(RandomString(64));
+    for (size_t i(0); i != kEntryCount; ++i) {
+      bool is_directory(i % 10 == 0);
+      detail::MetaData meta_data("entry_" + std::to_string(i), is_directory);
+      if (!is_directory)
+        meta_data.data_map->content = kContent;
+      meta_data.ToProtobuf(proto_directory.add_children());
+    }
+    serialised = proto_directory.SerializeAsString();
+  }
+
+  AsioService asio_service(1);
+  auto heap_before(HeapBytesInUse());
+  auto directory(ParseDirectory(serialised, asio_service));
+  auto heap_after(HeapBytesInUse());
+  auto memory(directory->GetStatistics().memory);
+  REQUIRE(memory.file_context_count == kEntryCount);
+  uint64_t estimate(memory.directories + memory.file_contexts + memory.data_maps + memory.timers);
+  INFO("Estimated bytes per cached entry: " << estimate / kEntryCount);
+  CHECK(estimate / kEntryCount <= kBudgetPerEntry);
+
+  // Check the estimate against what parsing the directory actually left allocated.
+  if (heap_after != 0) {
+    REQUIRE(heap_after > heap_before);
+    uint64_t measured(heap_after - heap_before);
+    INFO("Measured bytes per cached entry: " << measured / kEntryCount);
+    CHECK(measured / kEntryCount <= kBudgetPerEntry);
+    CHECK(estimate >= measured * 9 / 10);
+    CHECK(estimate <= measured * 11 / 10);
+  }
+  directory.reset();
+  asio_service.Stop();
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,132 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/common/application_support_directories.h"
+
+#include "maidsafe/drive/config.h"
+#include "maidsafe/drive/directory.h"
+#include "maidsafe/drive/directory_handler.h"
+#include "maidsafe/drive/memory_store.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace detail {
+
+namespace test {
+
+class MemoryStoreTest {
+ public:
+  MemoryStoreTest()
+      : memory_store_(std::make_shared<MemoryStore>()),
+        unique_user_id_(RandomString(64)),
+        root_parent_id_(RandomString(64)),
+        asio_service_(2) {}
+  ~MemoryStoreTest() { asio_service_.Stop(); }
+
+ protected:
+  std::unique_ptr<DirectoryHandler<MemoryStore>> MakeDirectoryHandler(bool create) {
+    return std::unique_ptr<DirectoryHandler<MemoryStore>>(new DirectoryHandler<MemoryStore>(
+        memory_store_, unique_user_id_, root_parent_id_, boost::filesystem::unique_path(
+            GetUserAppDir() / "Buffers" / "%%%%%-%%%%%-%%%%%-%%%%%"),
+        create, asio_service_.service()));
+  }
+
+  std::shared_ptr<MemoryStore> memory_store_;
+  Identity unique_user_id_, root_parent_id_;
+  AsioService asio_service_;
+
+ private:
+  MemoryStoreTest(const MemoryStoreTest&);
+  MemoryStoreTest& operator=(const MemoryStoreTest&);
+};
+
+TEST_CASE_METHOD(MemoryStoreTest, "Chunks", "[MemoryStore][behavioural]") {
+  ImmutableData data(NonEmptyString(RandomString(1024)));
+  CHECK_THROWS_AS(memory_store_->Get(data.name()).get(), std::exception);
+
+  memory_store_->Put(data);
+  CHECK(memory_store_->Get(data.name()).get().data() == data.data());
+  CHECK(memory_store_->ChunkCount() == 1U);
+  CHECK(memory_store_->GetCurrentMemoryUsage() == 1024U);
+
+  // Two references now, so the chunk should survive one deletion.
+  memory_store_->IncrementReferenceCount(std::vector<ImmutableData::Name>(1, data.name()));
+  memory_store_->Delete(data.name());
+  CHECK(memory_store_->Get(data.name()).get().data() == data.data());
+  memory_store_->Delete(data.name());
+  CHECK_THROWS_AS(memory_store_->Get(data.name()).get(), std::exception);
+  CHECK(memory_store_->ChunkCount() == 0U);
+  CHECK(memory_store_->GetCurrentMemoryUsage() == 0U);
+}
+
+TEST_CASE_METHOD(MemoryStoreTest, "Versions", "[MemoryStore][behavioural]") {
+  MutableData::Name name(Identity(RandomString(64)));
+  StructuredDataVersions::VersionName v0(0, ImmutableData::Name(Identity(RandomString(64))));
+  StructuredDataVersions::VersionName v1(1, ImmutableData::Name(Identity(RandomString(64))));
+  CHECK_THROWS_AS(memory_store_->GetVersions(name).get(), std::exception);
+  CHECK_THROWS_AS(memory_store_->PutVersion(name, v0, v1), std::exception);
+
+  CHECK_NOTHROW(memory_store_->CreateVersionTree(name, v0, 10, 1).get());
+  auto versions(memory_store_->GetVersions(name).get());
+  REQUIRE(versions.size() == 1U);
+  CHECK(versions.front() == v0);
+
+  CHECK_NOTHROW(memory_store_->PutVersion(name, v0, v1));
+  versions = memory_store_->GetVersions(name).get();
+  REQUIRE(versions.size() == 1U);
+  CHECK(versions.front() == v1);
+  versions = memory_store_->GetBranch(name, v1).get();
+  REQUIRE(versions.size() == 2U);
+  CHECK(versions.front() == v1);
+  CHECK(versions.back() == v0);
+}
+
+TEST_CASE_METHOD(MemoryStoreTest, "Directory handler", "[MemoryStore][behavioural]") {
+  auto directory_handler(MakeDirectoryHandler(true));
+  const std::string kDirectoryName("Directory");
+  FileContext file_context(kDirectoryName, true);
+  DirectoryId directory_id(*file_context.meta_data.directory_id);
+  Directory* directory(nullptr);
+
+  CHECK_NOTHROW(directory_handler->Add(kRoot / kDirectoryName, std::move(file_context)));
+  CHECK_NOTHROW(directory = directory_handler->Get(kRoot / kDirectoryName));
+  CHECK(directory->directory_id() == directory_id);
+  CHECK_NOTHROW(directory = directory_handler->Get(kRoot));
+  CHECK(directory->HasChild(kDirectoryName));
+  CHECK_NOTHROW(directory_handler->Delete(kRoot / kDirectoryName));
+  CHECK_FALSE(directory->HasChild(kDirectoryName));
+}
+
+}  // namespace test
+
+}  // namespace detail
+
+}  // namespace drive
+
+}  // namespace maidsafe
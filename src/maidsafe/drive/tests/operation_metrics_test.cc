@@ -0,0 +1,139 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/drive/operation_metrics.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+TEST_CASE("Operation metrics buckets", "[OperationMetrics][unit]") {
+  for (uint64_t value(0); value != 100000; ++value) {
+    auto index(OperationMetrics::BucketIndex(value));
+    REQUIRE(index < OperationMetrics::kHistogramBucketCount);
+    REQUIRE(OperationMetrics::BucketUpperBound(index) >= value);
+    if (index != 0)
+      REQUIRE(OperationMetrics::BucketUpperBound(index - 1) < value);
+    // The bucket's width never exceeds 1/kSubBucketCount of the values it holds.
+    REQUIRE(OperationMetrics::BucketUpperBound(index) - value <=
+            value / OperationMetrics::kSubBucketCount);
+  }
+  CHECK(OperationMetrics::BucketIndex(uint64_t(1) << 41) ==
+        OperationMetrics::kHistogramBucketCount - 1);
+  CHECK(OperationMetrics::BucketIndex(static_cast<uint64_t>(-1)) ==
+        OperationMetrics::kHistogramBucketCount - 1);
+  CHECK(OperationMetrics::BucketUpperBound(OperationMetrics::kHistogramBucketCount - 1) ==
+        (uint64_t(1) << 41) - 1);
+}
+
+TEST_CASE("Operation metrics recording", "[OperationMetrics][unit]") {
+  OperationMetrics metrics;
+  for (int i(0); i != 999; ++i)
+    metrics.Record(DriveOperation::kGetattr, std::chrono::microseconds(10));
+  metrics.Record(DriveOperation::kGetattr, std::chrono::milliseconds(50));
+
+  auto getattr(metrics.Get(DriveOperation::kGetattr));
+  CHECK(getattr.count == 1000U);
+  CHECK(getattr.max_nanoseconds == 50000000U);
+  // 10000ns lies in bucket [9216, 10239], 50ms is the maximum.
+  CHECK(getattr.PercentileMicroseconds(0.5) == 10.239);
+  CHECK(getattr.PercentileMicroseconds(0.999) == 10.239);
+  CHECK(getattr.PercentileMicroseconds(1.0) == 50000.0);
+  CHECK(metrics.Get(DriveOperation::kRead).count == 0U);
+  CHECK(metrics.Report().find("OpsGetattr") != std::string::npos);
+  CHECK(metrics.Report().find("OpsRead") == std::string::npos);
+
+  {
+    OperationMetrics::ScopedRecorder recorder(metrics, DriveOperation::kDriveRead);
+  }
+  CHECK(metrics.Get(DriveOperation::kDriveRead).count == 1U);
+
+  metrics.Reset();
+  CHECK(metrics.Get(DriveOperation::kGetattr).count == 0U);
+  CHECK(metrics.Get(DriveOperation::kGetattr).max_nanoseconds == 0U);
+  metrics.Record(DriveOperation::kGetattr, std::chrono::microseconds(10));
+  CHECK(metrics.Get(DriveOperation::kGetattr).count == 1U);
+}
+
+TEST_CASE("Operation metrics merged across threads", "[OperationMetrics][behavioural]") {
+  const int kThreadCount(8), kRecordsPerThread(10000);
+  // Instances created and destroyed at the same address mustn't share per-thread state.
+  for (int round(0); round != 2; ++round) {
+    OperationMetrics metrics;
+    std::vector<std::thread> threads;
+    for (int i(0); i != kThreadCount; ++i) {
+      threads.emplace_back([&metrics, i, kRecordsPerThread] {
+        for (int j(0); j != kRecordsPerThread; ++j)
+          metrics.Record(DriveOperation::kWrite, std::chrono::nanoseconds(i * 1000));
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+    // Each exited thread's shard has been folded into the totals and freed.
+    CHECK(metrics.LiveShardCount() == 0U);
+    auto write(metrics.Get(DriveOperation::kWrite));
+    CHECK(write.count == static_cast<uint64_t>(kThreadCount * kRecordsPerThread));
+    CHECK(write.max_nanoseconds == (kThreadCount - 1) * 1000U);
+    uint64_t histogram_total(0);
+    for (auto bucket : write.histogram)
+      histogram_total += bucket;
+    CHECK(histogram_total == write.count);
+  }
+}
+
+TEST_CASE("Operation metrics outlived by a recording thread", "[OperationMetrics][behavioural]") {
+  std::promise<void> recorded, metrics_destroyed;
+  std::thread thread;
+  {
+    OperationMetrics metrics;
+    metrics.Record(DriveOperation::kRead, std::chrono::microseconds(1));
+    thread = std::thread([&] {
+      metrics.Record(DriveOperation::kRead, std::chrono::microseconds(2));
+      recorded.set_value();
+      metrics_destroyed.get_future().wait();
+    });
+    recorded.get_future().wait();
+    CHECK(metrics.LiveShardCount() == 2U);
+    CHECK(metrics.Get(DriveOperation::kRead).count == 2U);
+  }
+  // The thread retires its shard on exit, after the metrics it recorded into have gone.
+  metrics_destroyed.set_value();
+  thread.join();
+
+  OperationMetrics metrics;
+  metrics.Record(DriveOperation::kRead, std::chrono::microseconds(1));
+  CHECK(metrics.Get(DriveOperation::kRead).count == 1U);
+  CHECK(metrics.LiveShardCount() == 1U);
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,250 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_WIN32
+#include <sys/stat.h>
+#endif
+
+#include <cerrno>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/config.h"
+#include "maidsafe/drive/directory_handler.h"
+#include "maidsafe/drive/memory_store.h"
+#include "maidsafe/drive/operation_trace.h"
+#include "maidsafe/drive/replay_drive.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+namespace {
+
+OperationTraceRecord MakeRecord(DriveOperation operation, const std::string& path,
+                                uint64_t offset = 0, uint64_t size = 0, uint32_t flags = 0) {
+  static std::chrono::nanoseconds start(0);
+  start += std::chrono::microseconds(10);
+  OperationTraceRecord record;
+  record.operation = operation;
+  record.path = path;
+  record.offset = offset;
+  record.size = size;
+  record.flags = flags;
+  record.start = start;
+  record.duration = std::chrono::microseconds(3);
+  return record;
+}
+
+OperationTraceRecord MakeRename(const std::string& path, const std::string& new_path) {
+  auto record(MakeRecord(DriveOperation::kRename, path));
+  record.new_path = new_path;
+  return record;
+}
+
+void WriteTrace(const fs::path& trace_file, const std::vector<OperationTraceRecord>& records) {
+  OperationTraceWriter writer(trace_file);
+  for (const auto& record : records)
+    writer.Write(record);
+}
+
+}  // unnamed namespace
+
+TEST_CASE("Operation trace round trip", "[OperationTrace][unit]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  auto trace_file(*test_dir / "operations.trace");
+  std::vector<OperationTraceRecord> records;
+  records.push_back(MakeRecord(DriveOperation::kCreate, "/a", 0, 0, 0644));
+  records.push_back(MakeRecord(DriveOperation::kWrite, "/a", 1ULL << 40, 131072, 1));
+  records.push_back(MakeRecord(DriveOperation::kRead, "/a", 4096, 4096));
+  records.back().result = 4096;
+  records.push_back(MakeRename("/a", "/b"));
+  records.back().result = -EXDEV;
+  records.push_back(MakeRecord(DriveOperation::kGetattr, "/b"));
+  // Records are written as operations complete, so starts aren't necessarily in order.
+  records.push_back(MakeRecord(DriveOperation::kGetattr, "/a"));
+  records.back().start -= std::chrono::microseconds(25);
+  WriteTrace(trace_file, records);
+
+  OperationTraceReader reader(trace_file);
+  OperationTraceRecord record;
+  for (const auto& expected : records) {
+    REQUIRE(reader.Next(record));
+    CHECK(record.operation == expected.operation);
+    CHECK(record.path == expected.path);
+    CHECK(record.new_path == expected.new_path);
+    CHECK(record.offset == expected.offset);
+    CHECK(record.size == expected.size);
+    CHECK(record.flags == expected.flags);
+    CHECK(record.result == expected.result);
+    CHECK(record.start == expected.start);
+    CHECK(record.duration == expected.duration);
+  }
+  CHECK_FALSE(reader.Next(record));
+
+  // Each path is only written once.
+  std::string contents;
+  REQUIRE(ReadFile(trace_file, &contents));
+  CHECK(contents.find("/a") == contents.rfind("/a"));
+
+  // A truncated trace is detected.
+  REQUIRE(WriteFile(trace_file, contents.substr(0, contents.size() - 1)));
+  auto read_all([&] {
+    OperationTraceReader truncated_reader(trace_file);
+    while (truncated_reader.Next(record)) {}
+  });
+  CHECK_THROWS_AS(read_all(), std::exception);
+
+  REQUIRE(WriteFile(trace_file, "not a trace"));
+  auto open_invalid([&] { OperationTraceReader invalid_reader(trace_file); });
+  CHECK_THROWS_AS(open_invalid(), std::exception);
+}
+
+TEST_CASE("Operation recorder", "[OperationTrace][unit]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  auto trace_file(*test_dir / "operations.trace");
+  OperationRecorder recorder;
+  CHECK_FALSE(recorder.enabled());
+  { OperationRecorder::ScopedRecord record(recorder, DriveOperation::kGetattr, "/ignored"); }
+
+  recorder.Start(trace_file);
+  CHECK(recorder.enabled());
+  {
+    OperationRecorder::ScopedRecord record(recorder, DriveOperation::kWrite, "/a", 10, 20, 1);
+    CHECK(record.Return(20) == 20);
+  }
+  {
+    OperationRecorder::ScopedRecord record(recorder, DriveOperation::kRename, "/a", "/b");
+    CHECK(record.Return(-ENOENT) == -ENOENT);
+  }
+  recorder.Stop();
+  CHECK_FALSE(recorder.enabled());
+  CHECK(recorder.record_count() == 2U);
+  { OperationRecorder::ScopedRecord record(recorder, DriveOperation::kGetattr, "/ignored"); }
+
+  OperationTraceReader reader(trace_file);
+  OperationTraceRecord record;
+  REQUIRE(reader.Next(record));
+  CHECK(record.operation == DriveOperation::kWrite);
+  CHECK(record.path == "/a");
+  CHECK(record.offset == 10U);
+  CHECK(record.size == 20U);
+  CHECK(record.flags == 1U);
+  CHECK(record.result == 20);
+  REQUIRE(reader.Next(record));
+  CHECK(record.operation == DriveOperation::kRename);
+  CHECK(record.new_path == "/b");
+  CHECK(record.result == -ENOENT);
+  CHECK_FALSE(reader.Next(record));
+}
+
+TEST_CASE("Replay a trace in-process", "[OperationTrace][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  auto trace_file(*test_dir / "operations.trace");
+#ifdef MAIDSAFE_WIN32
+  const uint32_t kFileMode(0), kDirectoryMode(0);
+#else
+  const uint32_t kFileMode(S_IFREG | 0644), kDirectoryMode(0755);
+#endif
+  std::vector<OperationTraceRecord> records;
+  records.push_back(MakeRecord(DriveOperation::kCreate, "/file", 0, 0, kFileMode));
+  records.push_back(MakeRecord(DriveOperation::kWrite, "/file", 0, 100000));
+  records.push_back(MakeRecord(DriveOperation::kWrite, "/file", 100000, 100000));
+  records.push_back(MakeRecord(DriveOperation::kFlush, "/file"));
+  records.push_back(MakeRecord(DriveOperation::kRelease, "/file"));
+  records.push_back(MakeRecord(DriveOperation::kGetattr, "/file"));
+  records.push_back(MakeRecord(DriveOperation::kOpen, "/file"));
+  records.push_back(MakeRecord(DriveOperation::kRead, "/file", 50000, 4096));
+  records.push_back(MakeRecord(DriveOperation::kRelease, "/file"));
+  records.push_back(MakeRecord(DriveOperation::kMkdir, "/dir", 0, 0, kDirectoryMode));
+  records.push_back(MakeRename("/file", "/dir/file"));
+  records.push_back(MakeRecord(DriveOperation::kReaddir, "/dir"));
+  records.push_back(MakeRecord(DriveOperation::kStatfs, "/"));
+  records.push_back(MakeRecord(DriveOperation::kGetattr, "/.drive/stats"));
+  // Skipped since it failed when recorded; replaying it would fail as the file exists.
+  records.push_back(MakeRecord(DriveOperation::kCreate, "/dir/file", 0, 0, kFileMode));
+  records.back().result = -EEXIST;
+  // Skipped since it targets the control directory; replaying it would move '/dir' away.
+  records.push_back(MakeRename("/dir", "/.drive"));
+  records.push_back(MakeRecord(DriveOperation::kUnlink, "/dir/file"));
+  records.push_back(MakeRecord(DriveOperation::kRmdir, "/dir"));
+  records.push_back(MakeRecord(DriveOperation::kGetattr, "/missing"));
+  WriteTrace(trace_file, records);
+
+  ReplayDrive<MemoryStore> drive(std::make_shared<MemoryStore>(), Identity(RandomString(64)),
+                                 Identity(RandomString(64)), *test_dir / "user_app_dir", true);
+  auto result(drive.Replay(trace_file, false));
+  CHECK(result.operations == records.size() - 4);
+  CHECK(result.skipped == 4U);
+  CHECK(result.failures == 1U);
+  CHECK(drive.operation_metrics().Get(DriveOperation::kDriveWrite).count == 2U);
+  CHECK(drive.operation_metrics().Get(DriveOperation::kDriveRead).count == 1U);
+}
+
+TEST_CASE("Serve a root entry shadowing the control directory", "[OperationTrace][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  auto storage(std::make_shared<MemoryStore>());
+  const Identity kUniqueUserId(RandomString(64)), kRootParentId(RandomString(64));
+  {
+    AsioService asio_service(1);
+    detail::DirectoryHandler<MemoryStore> directory_handler(storage, kUniqueUserId,
+        kRootParentId, fs::unique_path(*test_dir / "Buffers" / "%%%%%-%%%%%-%%%%%-%%%%%"), true,
+        asio_service.service());
+    directory_handler.Add(detail::kControlDirectory,
+                          detail::FileContext(detail::kControlDirectory.filename(), true));
+    directory_handler.FlushAll();
+  }
+#ifdef MAIDSAFE_WIN32
+  const uint32_t kFileMode(0);
+#else
+  const uint32_t kFileMode(S_IFREG | 0644);
+#endif
+  auto trace_file(*test_dir / "operations.trace");
+  std::vector<OperationTraceRecord> records;
+  records.push_back(MakeRecord(DriveOperation::kCreate, "/.drive/file", 0, 0, kFileMode));
+  records.push_back(MakeRecord(DriveOperation::kRelease, "/.drive/file"));
+  records.push_back(MakeRecord(DriveOperation::kGetattr, "/.drive/file"));
+  WriteTrace(trace_file, records);
+
+  // The drive's own entry is served in place of the control files.
+  ReplayDrive<MemoryStore> drive(storage, kUniqueUserId, kRootParentId,
+                                 *test_dir / "user_app_dir", false);
+  CHECK_FALSE(drive.control_files().enabled());
+  auto result(drive.Replay(trace_file, false));
+  CHECK(result.operations == records.size());
+  CHECK(result.skipped == 0U);
+  CHECK(result.failures == 0U);
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,142 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/common/data_stores/local_store.h"
+
+#include "maidsafe/drive/packed_store.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+class PackedStoreTest {
+ public:
+  PackedStoreTest()
+      : test_dir_(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive")),
+        kPackDir_(*test_dir_ / "packs"),
+        version_store_(std::make_shared<data_stores::LocalStore>(
+            *test_dir_ / "versions", DiskUsage(std::numeric_limits<uint64_t>::max()))),
+        chunks_() {
+    for (int i(0); i != 100; ++i)
+      chunks_.emplace_back(NonEmptyString(RandomString(1024 + i)));
+  }
+
+ protected:
+  // Small packs, so that 100 chunks span several.
+  std::unique_ptr<PackedStore> MakeStore() {
+    return std::unique_ptr<PackedStore>(new PackedStore(kPackDir_, version_store_, 16 * 1024));
+  }
+
+  bool Holds(PackedStore& store, const ImmutableData& chunk) {
+    try {
+      return store.Get(chunk.name()).get().data() == chunk.data();
+    }
+    catch (const std::exception&) {
+      return false;
+    }
+  }
+
+  maidsafe::test::TestPath test_dir_;
+  const fs::path kPackDir_;
+  std::shared_ptr<data_stores::LocalStore> version_store_;
+  std::vector<ImmutableData> chunks_;
+
+ private:
+  PackedStoreTest(const PackedStoreTest&);
+  PackedStoreTest& operator=(const PackedStoreTest&);
+};
+
+TEST_CASE_METHOD(PackedStoreTest, "Reference counts and compaction", "[PackedStore][behavioural]") {
+  auto store(MakeStore());
+  for (const auto& chunk : chunks_)
+    store->Put(chunk);
+  store->IncrementReferenceCount(std::vector<ImmutableData::Name>(1, chunks_.front().name()));
+  auto statistics(store->GetStatistics());
+  CHECK(statistics.chunk_count == chunks_.size());
+  CHECK(statistics.pack_count > 2U);
+
+  // Everything but the first chunk loses its only reference; the first still has one left.
+  for (const auto& chunk : chunks_)
+    store->Delete(chunk.name());
+  CHECK(Holds(*store, chunks_.front()));
+  CHECK_FALSE(Holds(*store, chunks_.back()));
+
+  store->Compact();
+  statistics = store->GetStatistics();
+  CHECK(statistics.chunk_count == 1U);
+  CHECK(statistics.compaction_count != 0U);
+  CHECK(statistics.pack_count <= 2U);
+  CHECK(Holds(*store, chunks_.front()));
+
+  // A deleted chunk can be stored again.
+  store->Put(chunks_.back());
+  CHECK(Holds(*store, chunks_.back()));
+}
+
+TEST_CASE_METHOD(PackedStoreTest, "Recovery", "[PackedStore][behavioural]") {
+  auto store(MakeStore());
+  for (const auto& chunk : chunks_)
+    store->Put(chunk);
+  store->Delete(chunks_.front().name());
+  store.reset();
+
+  // Reopening uses the saved index.
+  store = MakeStore();
+  CHECK(store->GetStatistics().chunk_count == chunks_.size() - 1);
+  CHECK_FALSE(Holds(*store, chunks_.front()));
+  store.reset();
+
+  // Without the index, and with a torn record at the end of the newest pack, the packs are
+  // rescanned.
+  fs::remove(kPackDir_ / "index");
+  fs::path newest_pack;
+  for (fs::directory_iterator itr(kPackDir_); itr != fs::directory_iterator(); ++itr) {
+    if (itr->path().extension() == ".pack" && itr->path() > newest_pack)
+      newest_pack = itr->path();
+  }
+  {
+    std::ofstream stream(newest_pack.string().c_str(), std::ios::binary | std::ios::app);
+    stream << RandomString(100);
+  }
+  store = MakeStore();
+  CHECK(store->GetStatistics().chunk_count == chunks_.size() - 1);
+  CHECK_FALSE(Holds(*store, chunks_.front()));
+  for (size_t i(1); i != chunks_.size(); ++i)
+    CHECK(Holds(*store, chunks_[i]));
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,110 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/common/data_stores/local_store.h"
+
+#include "maidsafe/drive/simulated_network_store.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+TEST_CASE("Parse simulated network profile", "[SimulatedNetworkStore][behavioural]") {
+  SimulatedNetworkProfile profile;
+  CHECK_NOTHROW(profile = SimulatedNetworkProfile::Parse(
+      "put=constant:150,latency=normal:80:20,jitter=10,upload_kbps=512,download_kbps=2048,"
+      "failure=0.25,timeout=0.5,timeout_ms=100,seed=7"));
+  CHECK(profile.jitter == std::chrono::milliseconds(10));
+  CHECK(profile.upload_bytes_per_second == 512 * 1024);
+  CHECK(profile.download_bytes_per_second == 2048 * 1024);
+  CHECK(profile.failure_probability == 0.25);
+  CHECK(profile.timeout_probability == 0.5);
+  CHECK(profile.timeout == std::chrono::milliseconds(100));
+  CHECK(profile.seed == 7U);
+  // 'put' was given its own distribution, so 'latency' mustn't override it.
+  std::mt19937_64 generator(profile.seed);
+  CHECK(profile.latencies[static_cast<size_t>(StorageOperation::kPut)].Sample(generator) ==
+        std::chrono::milliseconds(150));
+
+  CHECK_THROWS_AS(SimulatedNetworkProfile::Parse("latency=gamma:1"), std::exception);
+  CHECK_THROWS_AS(SimulatedNetworkProfile::Parse("latency=uniform:20:10"), std::exception);
+  CHECK_THROWS_AS(SimulatedNetworkProfile::Parse("bandwidth=100"), std::exception);
+  CHECK_THROWS_AS(SimulatedNetworkProfile::Parse("failure=1.5"), std::exception);
+  CHECK_THROWS_AS(SimulatedNetworkProfile::Parse("failure=0.6,timeout=0.6"), std::exception);
+  CHECK_THROWS_AS(SimulatedNetworkProfile::Parse("latency=constant:-1"), std::exception);
+  CHECK_THROWS_AS(SimulatedNetworkProfile::Parse("download_kbps=-4"), std::exception);
+  CHECK_THROWS_AS(SimulatedNetworkProfile::Parse("seed=-7"), std::exception);
+}
+
+TEST_CASE("Simulated network latency and failures", "[SimulatedNetworkStore][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  auto local_store(std::make_shared<data_stores::LocalStore>(*test_dir, DiskUsage(1 << 20)));
+  ImmutableData data(NonEmptyString(RandomString(1024)));
+
+  SECTION("Latency") {
+    SimulatedNetworkStore<data_stores::LocalStore> store(local_store,
+        SimulatedNetworkProfile::Parse("latency=constant:100"));
+    store.Put(data);
+    auto start(std::chrono::steady_clock::now());
+    auto future(store.Get(data.name()));
+    CHECK(future.get().data() == data.data());
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(100));
+  }
+
+  SECTION("Bandwidth") {
+    // 1024 bytes at 4 KiB/s takes 250ms to download.
+    SimulatedNetworkStore<data_stores::LocalStore> store(local_store,
+        SimulatedNetworkProfile::Parse("download_kbps=4"));
+    store.Put(data);
+    auto start(std::chrono::steady_clock::now());
+    CHECK(store.Get(data.name()).get().data() == data.data());
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(250));
+  }
+
+  SECTION("Failure") {
+    SimulatedNetworkStore<data_stores::LocalStore> store(local_store,
+        SimulatedNetworkProfile::Parse("failure=1"));
+    store.Put(data);
+    CHECK(local_store->Get(data.name()).get().data() == data.data());
+    CHECK_THROWS_AS(store.Get(data.name()).get(), std::exception);
+  }
+
+  SECTION("Timeout") {
+    SimulatedNetworkStore<data_stores::LocalStore> store(local_store,
+        SimulatedNetworkProfile::Parse("timeout=1,timeout_ms=50"));
+    store.Put(data);
+    auto start(std::chrono::steady_clock::now());
+    CHECK_THROWS_AS(store.Get(data.name()).get(), std::exception);
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(50));
+  }
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,104 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/drive/slow_operation_log.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+TEST_CASE("Slow operation log breakdown", "[SlowOperationLog][unit]") {
+  auto& log(SlowOperationLog::Instance());
+  log.SetThreshold(std::chrono::steady_clock::duration::zero());
+  log.Clear();
+  {
+    SlowOperationScope scope("OpsRead");
+    SlowOperationTimer timer(SlowOperationPhase::kPathResolution);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  CHECK(log.GetRecent().empty());
+
+  log.SetThreshold(std::chrono::milliseconds(20));
+  auto slow_count_before(log.slow_count());
+  {
+    // Fast operations aren't logged.
+    SlowOperationScope scope("OpsGetattr");
+  }
+  CHECK(log.slow_count() == slow_count_before);
+
+  TimedMutex mutex(SlowOperationPhase::kDirectoryLock);
+  {
+    SlowOperationScope scope("OpsRename");
+    {
+      // Nested scopes add to the outermost.
+      SlowOperationScope nested("Drive::Rename");
+      SlowOperationTimer timer(SlowOperationPhase::kPathResolution);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::unique_lock<TimedMutex> held(mutex, std::defer_lock);
+    std::thread holder([&mutex] {
+      std::lock_guard<TimedMutex> lock(mutex);
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    held.lock();
+    held.unlock();
+    holder.join();
+    for (size_t i(0); i != SlowOperationLog::kMaxStorageCalls + 2; ++i) {
+      SlowOperationScope::RecordStorageCall("Get", "abcdef..", std::chrono::milliseconds(1));
+    }
+  }
+  auto recent(log.GetRecent());
+  REQUIRE(recent.size() == 1U);
+  const auto& entry(recent.front());
+  CHECK(entry.operation == "OpsRename");
+  CHECK(entry.number == log.slow_count());
+  CHECK(entry.duration >= std::chrono::milliseconds(25));
+  auto phase([&entry](SlowOperationPhase phase) {
+    return entry.phases[static_cast<size_t>(phase)];
+  });
+  CHECK(phase(SlowOperationPhase::kPathResolution) >= std::chrono::milliseconds(10));
+  CHECK(phase(SlowOperationPhase::kDirectoryLock) > std::chrono::steady_clock::duration::zero());
+  CHECK(phase(SlowOperationPhase::kStorage) == std::chrono::steady_clock::duration::zero());
+  CHECK(entry.storage_calls.size() == SlowOperationLog::kMaxStorageCalls);
+  CHECK(entry.dropped_storage_calls == 2U);
+  auto line(entry.ToString());
+  CHECK(line.find("OpsRename") != std::string::npos);
+  CHECK(line.find("path_resolution") != std::string::npos);
+  CHECK(line.find("directory_lock") != std::string::npos);
+  CHECK(line.find("abcdef..") != std::string::npos);
+  CHECK(log.Report().find(line) != std::string::npos);
+
+  log.SetThreshold(std::chrono::steady_clock::duration::zero());
+  log.Clear();
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,106 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/common/application_support_directories.h"
+
+#include "maidsafe/drive/directory_handler.h"
+#include "maidsafe/drive/memory_store.h"
+#include "maidsafe/drive/storage_metrics.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+TEST_CASE("Storage metrics recording", "[StorageMetrics][unit]") {
+  StorageMetrics metrics;
+  for (int i(0); i != 99; ++i) {
+    metrics.Record(StorageOperation::kPut, StorageCaller::kFileData, 100,
+                   std::chrono::microseconds(10), true);
+  }
+  metrics.Record(StorageOperation::kPut, StorageCaller::kFileData, 100,
+                 std::chrono::milliseconds(5), true);
+  metrics.Record(StorageOperation::kPut, StorageCaller::kDirectoryListing, 50,
+                 std::chrono::microseconds(0), true);
+
+  auto file_data(metrics.Get(StorageOperation::kPut, StorageCaller::kFileData));
+  CHECK(file_data.count == 100U);
+  CHECK(file_data.failures == 0U);
+  CHECK(file_data.bytes == 10000U);
+  CHECK(file_data.max_microseconds == 5000U);
+  // 10us lies in bucket [8, 16), 5000us in bucket [4096, 8192).
+  CHECK(file_data.PercentileMicroseconds(0.5) == 15U);
+  CHECK(file_data.PercentileMicroseconds(1.0) == 5000U);
+
+  auto all_callers(metrics.Get(StorageOperation::kPut));
+  CHECK(all_callers.count == 101U);
+  CHECK(all_callers.bytes == 10050U);
+  CHECK(metrics.Get(StorageOperation::kGet).count == 0U);
+  CHECK(metrics.Report().find("directory listing") != std::string::npos);
+
+  try {
+    StorageMetrics::ScopedRecorder recorder(metrics, StorageOperation::kGet,
+                                            StorageCaller::kVersioning);
+    throw std::runtime_error("Get failed");
+  }
+  catch (const std::exception&) {}
+  auto failed(metrics.Get(StorageOperation::kGet, StorageCaller::kVersioning));
+  CHECK(failed.count == 1U);
+  CHECK(failed.failures == 1U);
+
+  metrics.Reset();
+  CHECK(metrics.Get(StorageOperation::kPut).count == 0U);
+  CHECK(metrics.Get(StorageOperation::kGet).failures == 0U);
+}
+
+TEST_CASE("Storage metrics from directory handler", "[StorageMetrics][behavioural]") {
+  AsioService asio_service(2);
+  auto memory_store(std::make_shared<MemoryStore>());
+  {
+    detail::DirectoryHandler<MemoryStore> directory_handler(memory_store,
+        Identity(RandomString(64)), Identity(RandomString(64)), boost::filesystem::unique_path(
+            GetUserAppDir() / "Buffers" / "%%%%%-%%%%%-%%%%%-%%%%%"),
+        true, asio_service.service());
+    directory_handler.FlushAll();
+    auto& metrics(directory_handler.storage_metrics());
+    auto listing_puts(metrics.Get(StorageOperation::kPut, StorageCaller::kDirectoryListing));
+    CHECK(listing_puts.count > 0U);
+    CHECK(listing_puts.bytes > 0U);
+    CHECK(metrics.Get(StorageOperation::kCreateVersionTree, StorageCaller::kVersioning).count ==
+          1U);
+    CHECK(metrics.Get(StorageOperation::kPut, StorageCaller::kFileData).count == 0U);
+  }
+  asio_service.Stop();
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
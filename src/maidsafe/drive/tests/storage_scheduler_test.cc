@@ -0,0 +1,99 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/drive/storage_scheduler.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+TEST_CASE("Storage scheduler priorities", "[StorageScheduler][behavioural]") {
+  typedef StorageScheduler::Priority Priority;
+  StorageScheduler scheduler(1);
+  std::mutex mutex;
+  std::vector<Priority> admission_order;
+  std::vector<std::thread> threads;
+
+  // Hold the only slot while a backlog builds up.
+  scheduler.Acquire(Priority::kDataUpload, 0);
+  auto queue([&](Priority priority) {
+    threads.emplace_back([&, priority] {
+      StorageScheduler::ScopedSlot slot(scheduler, priority, 1024 * 1024);
+      std::lock_guard<std::mutex> lock(mutex);
+      admission_order.push_back(priority);
+    });
+    while (scheduler.waiting_count() != threads.size())
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  queue(Priority::kBackground);
+  queue(Priority::kDataUpload);
+  queue(Priority::kDataUpload);
+  queue(Priority::kMetadataStore);
+  queue(Priority::kInteractiveRead);
+  CHECK(scheduler.waiting_bytes() == 5U * 1024 * 1024);
+  scheduler.Release();
+  for (auto& thread : threads)
+    thread.join();
+
+  REQUIRE(admission_order.size() == 5U);
+  CHECK(admission_order[0] == Priority::kInteractiveRead);
+  CHECK(admission_order[1] == Priority::kMetadataStore);
+  // The background call gets half the share of an upload, so it ties with the second upload.
+  CHECK(admission_order[2] == Priority::kDataUpload);
+  CHECK(scheduler.waiting_count() == 0U);
+}
+
+TEST_CASE("Storage scheduler upload rate limit", "[StorageScheduler][behavioural]") {
+  typedef StorageScheduler::Priority Priority;
+  StorageScheduler scheduler(4);
+  scheduler.SetUploadRateLimit(100 * 1024, 10 * 1024);
+  CHECK(scheduler.upload_rate_limit() == 100U * 1024);
+
+  // Reads aren't limited.
+  auto start(std::chrono::steady_clock::now());
+  for (int i(0); i != 10; ++i)
+    StorageScheduler::ScopedSlot slot(scheduler, Priority::kInteractiveRead, 1024 * 1024);
+  CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100));
+
+  // The first 10kB goes out in the burst, the remaining 20kB takes ~200ms.
+  start = std::chrono::steady_clock::now();
+  for (int i(0); i != 3; ++i)
+    StorageScheduler::ScopedSlot slot(scheduler, Priority::kDataUpload, 10 * 1024);
+  CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(150));
+
+  scheduler.SetUploadRateLimit(0);
+  start = std::chrono::steady_clock::now();
+  for (int i(0); i != 10; ++i)
+    StorageScheduler::ScopedSlot slot(scheduler, Priority::kDataUpload, 1024 * 1024);
+  CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100));
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
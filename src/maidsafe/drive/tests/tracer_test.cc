@@ -0,0 +1,85 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/tracer.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+TEST_CASE("Tracer records scopes", "[Tracer][unit]") {
+  auto& tracer(Tracer::Instance());
+  tracer.Start();
+  { DRIVE_TRACE_SCOPE("drive", "Outer"); { DRIVE_TRACE_SCOPE("storage", "Inner \"quoted\""); } }
+  std::vector<std::thread> threads;
+  for (int i(0); i != 4; ++i) {
+    threads.emplace_back([] {
+      for (int j(0); j != 100; ++j)
+        DRIVE_TRACE_SCOPE("flush", "Threaded");
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  tracer.Stop();
+  { DRIVE_TRACE_SCOPE("drive", "Disabled"); }
+
+  CHECK(tracer.event_count() == 402U);
+  CHECK(tracer.dropped_count() == 0U);
+  auto json(tracer.ToJson());
+  CHECK(json.find("{\"traceEvents\":[") == 0U);
+  CHECK(json.find("\"name\":\"Outer\",\"cat\":\"drive\",\"ph\":\"X\"") != std::string::npos);
+  CHECK(json.find("\"name\":\"Inner \\\"quoted\\\"\",\"cat\":\"storage\"") != std::string::npos);
+  CHECK(json.find("\"name\":\"thread_name\"") != std::string::npos);
+  CHECK(json.find("Disabled") == std::string::npos);
+
+  auto trace_path(boost::filesystem::temp_directory_path() /
+                  boost::filesystem::unique_path("%%%%-%%%%-%%%%.json"));
+  CHECK(tracer.StopAndWrite(trace_path));
+  std::string written;
+  CHECK(ReadFile(trace_path, &written));
+  CHECK(written == json);
+  boost::filesystem::remove(trace_path);
+
+  // Restarting discards the previous events and applies the new per-thread cap.
+  tracer.Start(10);
+  for (int i(0); i != 15; ++i)
+    DRIVE_TRACE_SCOPE("drive", "Capped");
+  tracer.Stop();
+  CHECK(tracer.event_count() == 10U);
+  CHECK(tracer.dropped_count() == 5U);
+  CHECK(tracer.ToJson().find("\"dropped_events\":\"5\"") != std::string::npos);
+  CHECK(tracer.ToJson().find("Outer") == std::string::npos);
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,142 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifdef MAIDSAFE_DRIVE_LIBURING
+
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/common/data_stores/local_store.h"
+
+#include "maidsafe/drive/uring_store.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+TEST_CASE("UringStore chunks", "[UringStore][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  const fs::path kChunkDir(*test_dir / "chunks");
+  auto version_store(std::make_shared<data_stores::LocalStore>(
+      *test_dir / "versions", DiskUsage(std::numeric_limits<uint64_t>::max())));
+  std::vector<ImmutableData> chunks;
+  for (int i(0); i != 100; ++i)
+    chunks.emplace_back(NonEmptyString(RandomString(1 + RandomUint32() % (256 * 1024))));
+
+  {
+    // A queue depth of 4 forces the 100 writes into many batches.
+    UringStore store(kChunkDir, 4, version_store);
+    CHECK_THROWS_AS(store.Get(chunks.front().name()).get(), std::exception);
+    for (const auto& chunk : chunks)
+      store.Put(chunk);
+    // Reads may be served from pending writes or from disk.
+    for (const auto& chunk : chunks)
+      CHECK(store.Get(chunk.name()).get().data() == chunk.data());
+    store.Flush();
+    CHECK(store.operation_count() >= chunks.size());
+    CHECK(store.submission_count() < store.operation_count());
+  }
+
+  // Chunks should survive a restart, and a corrupted one should be reported missing.
+  std::string hex_name(HexEncode(chunks.front().name()->string()));
+  REQUIRE(WriteFile(kChunkDir / hex_name.substr(0, 2) / hex_name, RandomString(1024)));
+  UringStore store(kChunkDir, 64, version_store);
+  std::vector<boost::future<ImmutableData>> gets;
+  for (const auto& chunk : chunks)
+    gets.push_back(store.Get(chunk.name()));
+  CHECK_THROWS_AS(gets.front().get(), std::exception);
+  for (size_t i(1); i != chunks.size(); ++i)
+    CHECK(gets[i].get().data() == chunks[i].data());
+  CHECK_THROWS_AS(store.Get(chunks.front().name()).get(), std::exception);
+}
+
+TEST_CASE("UringStore read failures", "[UringStore][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  const fs::path kChunkDir(*test_dir / "chunks");
+  auto version_store(std::make_shared<data_stores::LocalStore>(
+      *test_dir / "versions", DiskUsage(std::numeric_limits<uint64_t>::max())));
+  ImmutableData chunk(NonEmptyString(RandomString(1024)));
+  std::string hex_name(HexEncode(chunk.name()->string()));
+  const fs::path kChunkPath(kChunkDir / hex_name.substr(0, 2) / hex_name);
+  const fs::path kAsidePath(*test_dir / "aside");
+  UringStore store(kChunkDir, 8, version_store);
+  store.Put(chunk);
+  store.Flush();
+
+  // A read which fails, here because the chunk's path is a directory, leaves the chunk indexed.
+  fs::rename(kChunkPath, kAsidePath);
+  fs::create_directory(kChunkPath);
+  REQUIRE(WriteFile(kChunkPath / "blocker", "blocker"));
+  CHECK_THROWS_AS(store.Get(chunk.name()).get(), std::exception);
+  fs::remove_all(kChunkPath);
+  fs::rename(kAsidePath, kChunkPath);
+  CHECK(store.Get(chunk.name()).get().data() == chunk.data());
+
+  // A chunk whose file has gone is forgotten.
+  fs::rename(kChunkPath, kAsidePath);
+  CHECK_THROWS_AS(store.Get(chunk.name()).get(), std::exception);
+  fs::rename(kAsidePath, kChunkPath);
+  CHECK_THROWS_AS(store.Get(chunk.name()).get(), std::exception);
+}
+
+TEST_CASE("UringStore write failures", "[UringStore][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  const fs::path kChunkDir(*test_dir / "chunks");
+  auto version_store(std::make_shared<data_stores::LocalStore>(
+      *test_dir / "versions", DiskUsage(std::numeric_limits<uint64_t>::max())));
+  ImmutableData chunk(NonEmptyString(RandomString(1024)));
+  std::string hex_name(HexEncode(chunk.name()->string()));
+  const fs::path kChunkPath(kChunkDir / hex_name.substr(0, 2) / hex_name);
+  {
+    UringStore store(kChunkDir, 8, version_store);
+    // A non-empty directory in the chunk's place makes its writes fail until it's removed.
+    fs::create_directories(kChunkPath);
+    REQUIRE(WriteFile(kChunkPath / "blocker", "blocker"));
+    store.Put(chunk);
+    // The chunk is served from memory while its write is retried.
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CHECK(store.Get(chunk.name()).get().data() == chunk.data());
+    CHECK(fs::is_directory(kChunkPath));
+    fs::remove_all(kChunkPath);
+    store.Flush();
+    CHECK(fs::is_regular_file(kChunkPath));
+  }
+  UringStore store(kChunkDir, 8, version_store);
+  CHECK(store.Get(chunk.name()).get().data() == chunk.data());
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_LIBURING
@@ -0,0 +1,129 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/config.h"
+#include "maidsafe/drive/directory.h"
+#include "maidsafe/drive/file_context.h"
+#include "maidsafe/drive/write_amplification.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+TEST_CASE("Write amplification counters and ratios", "[WriteAmplification][unit]") {
+  WriteAmplification total;
+  WriteAmplification first(&total), second(&total);
+  CHECK(total.Get().TotalRatio() == 0.0);
+
+  first.RecordApplicationWrite(1000);
+  first.RecordDataPut(1500);
+  first.RecordListingPut(300);
+  first.RecordListingPut(200);
+  first.RecordVersionOperation();
+  first.RecordReferenceCountIncrement(4);
+  second.RecordApplicationWrite(1000);
+  second.RecordDataPut(1000);
+
+  auto counters(first.Get());
+  CHECK(counters.application_bytes == 1000U);
+  CHECK(counters.data_bytes_put == 1500U);
+  CHECK(counters.data_chunks_put == 1U);
+  CHECK(counters.listing_bytes_put == 500U);
+  CHECK(counters.listing_chunks_put == 2U);
+  CHECK(counters.version_operations == 1U);
+  CHECK(counters.refcount_operations == 1U);
+  CHECK(counters.refcount_increments == 4U);
+  CHECK(counters.DataRatio() == 1.5);
+  CHECK(counters.ListingRatio() == 0.5);
+  CHECK(counters.TotalRatio() == 2.0);
+
+  auto totals(total.Get());
+  CHECK(totals.application_bytes == 2000U);
+  CHECK(totals.data_bytes_put == 2500U);
+  CHECK(totals.StorageBytes() == 3000U);
+  CHECK(totals.TotalRatio() == 1.5);
+
+  // Resetting a directory leaves the total alone.
+  first.Reset();
+  CHECK(first.Get().StorageBytes() == 0U);
+  CHECK(total.Get().StorageBytes() == 3000U);
+
+  bool found_ratio(false);
+  for (const auto& statistic : ToStatistics(totals)) {
+    if (statistic.name == "write_amplification_ratio{kind=\"total\"}") {
+      CHECK(statistic.value == 1.5);
+      found_ratio = true;
+    }
+  }
+  CHECK(found_ratio);
+
+  std::vector<std::pair<boost::filesystem::path, WriteAmplification::Counters>> top;
+  top.emplace_back("/first", counters);
+  auto report(FormatWriteAmplification(totals, top));
+  CHECK(report.find("(total)") != std::string::npos);
+  CHECK(report.find("/first") != std::string::npos);
+}
+
+TEST_CASE("Directory store records reference count traffic", "[WriteAmplification][unit]") {
+  const size_t kFileCount(10), kChunksPerFile(3);
+  AsioService asio_service(1);
+  WriteAmplification total;
+  size_t incremented(0);
+  detail::Directory directory(
+      ParentId(Identity(RandomString(64))), Identity(RandomString(64)), asio_service.service(),
+      [](detail::Directory*) {}, [](const ImmutableData&) {},  // NOLINT
+      [&](const std::vector<ImmutableData::Name>& names) { incremented += names.size(); }, "",
+      &total);
+  for (size_t i(0); i != kFileCount; ++i) {
+    detail::FileContext file_context("file_" + std::to_string(i), false);
+    for (size_t j(0); j != kChunksPerFile; ++j) {
+      encrypt::ChunkDetails chunk;
+      chunk.hash = RandomString(64);
+      file_context.meta_data.data_map->chunks.push_back(chunk);
+    }
+    directory.AddChild(std::move(file_context));
+  }
+
+  ImmutableData contents(NonEmptyString(directory.Serialise()));
+  directory.InitialiseVersions(contents.name());
+  CHECK(incremented == kFileCount * kChunksPerFile);
+  auto counters(directory.write_amplification().Get());
+  CHECK(counters.refcount_operations == 1U);
+  CHECK(counters.refcount_increments == kFileCount * kChunksPerFile);
+  CHECK(total.Get().refcount_increments == kFileCount * kChunksPerFile);
+  asio_service.Stop();
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,310 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/filesystem/fstream.hpp"
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/deduplicating_store.h"
+#include "maidsafe/drive/memory_store.h"
+#include "maidsafe/drive/storage_scheduler.h"
+#include "maidsafe/drive/write_back_journal.h"
+#include "maidsafe/drive/write_back_store.h"
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace test {
+
+namespace {
+
+// Behaves like a network client during an outage while 'available' is false:  the futures returned
+// by every call fail and IncrementReferenceCount throws.
+class FlakyStore {
+ public:
+  typedef MemoryStore::VersionNames VersionNames;
+
+  FlakyStore() : store(std::make_shared<MemoryStore>()), available(false), attempts(0) {}
+
+  boost::future<ImmutableData> Get(const ImmutableData::Name& data_name) {
+    return Available() ? store->Get(data_name) : Failed<ImmutableData>();
+  }
+  boost::future<void> Put(const ImmutableData& data) {
+    if (!Available())
+      return Failed<void>();
+    store->Put(data);
+    return Succeeded();
+  }
+  void IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names) {
+    if (!Available())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+    store->IncrementReferenceCount(data_names);
+  }
+  boost::future<VersionNames> GetVersions(const MutableData::Name& data_name) {
+    return Available() ? store->GetVersions(data_name) : Failed<VersionNames>();
+  }
+  boost::future<VersionNames> GetBranch(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& branch_tip) {
+    return Available() ? store->GetBranch(data_name, branch_tip) : Failed<VersionNames>();
+  }
+  boost::future<void> PutVersion(const MutableData::Name& data_name,
+                                 const StructuredDataVersions::VersionName& old_version_name,
+                                 const StructuredDataVersions::VersionName& new_version_name) {
+    if (!Available())
+      return Failed<void>();
+    store->PutVersion(data_name, old_version_name, new_version_name);
+    return Succeeded();
+  }
+  boost::future<void> CreateVersionTree(const MutableData::Name& data_name,
+                                        const StructuredDataVersions::VersionName& version_name,
+                                        uint32_t max_versions, uint32_t max_branches) {
+    return Available() ? store->CreateVersionTree(data_name, version_name, max_versions,
+                                                  max_branches)
+                       : Failed<void>();
+  }
+
+  std::shared_ptr<MemoryStore> store;
+  std::atomic<bool> available;
+  std::atomic<int> attempts;
+
+ private:
+  bool Available() {
+    ++attempts;
+    return available;
+  }
+
+  boost::future<void> Succeeded() {
+    boost::promise<void> promise;
+    promise.set_value();
+    return promise.get_future();
+  }
+
+  template <typename T>
+  boost::future<T> Failed() {
+    boost::promise<T> promise;
+    promise.set_exception(MakeError(CommonErrors::unable_to_handle_request));
+    return promise.get_future();
+  }
+};
+
+}  // unnamed namespace
+
+TEST_CASE("Write-back journal recovery", "[WriteBackJournal][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  const auto kJournalDir(*test_dir / "journal");
+  ImmutableData data(NonEmptyString(RandomString(1024)));
+  MutableData::Name tree_name(Identity(RandomString(64)));
+  StructuredDataVersions::VersionName v0(0, ImmutableData::Name(Identity(RandomString(64))));
+  StructuredDataVersions::VersionName v1(1, ImmutableData::Name(Identity(RandomString(64))));
+  {
+    WriteBackJournal journal(kJournalDir);
+    CHECK(journal.TakeRecoveredRecords().empty());
+    auto put(WriteBackJournal::Record::Put(data));
+    auto create(WriteBackJournal::Record::CreateVersionTree(tree_name, v0, 10, 2));
+    auto put_version(WriteBackJournal::Record::PutVersion(tree_name, v0, v1));
+    journal.Append(put);
+    journal.Append(create);
+    journal.Append(put_version);
+    journal.CommitOldest(put);
+    CHECK(journal.uncommitted_bytes() == create.size_on_disk + put_version.size_on_disk);
+  }
+  {
+    // Simulate a crash part-way through appending a further record.
+    boost::filesystem::ofstream log(kJournalDir / "journal.0", std::ios::binary | std::ios::app);
+    log << std::string(5, 'x');
+  }
+
+  WriteBackJournal journal(kJournalDir);
+  auto records(journal.TakeRecoveredRecords());
+  REQUIRE(records.size() == 2U);
+  CHECK(records[0].type == WriteBackJournal::Record::Type::kCreateVersionTree);
+  CHECK(records[0].version_tree_name == tree_name->string());
+  CHECK(records[0].new_version_name == v0);
+  CHECK(records[0].max_versions == 10U);
+  CHECK(records[0].max_branches == 2U);
+  CHECK(records[1].type == WriteBackJournal::Record::Type::kPutVersion);
+  CHECK(records[1].old_version_name == v0);
+  CHECK(records[1].new_version_name == v1);
+  CHECK(journal.TakeRecoveredRecords().empty());
+
+  journal.CommitOldest(records[0]);
+  journal.CommitOldest(records[1]);
+  CHECK(journal.uncommitted_bytes() == 0U);
+}
+
+TEST_CASE("Write-back journal segments", "[WriteBackJournal][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  const auto kJournalDir(*test_dir / "journal");
+  const uint64_t kMaxSegmentSize(4096);
+  auto disk_usage([&] {
+    uint64_t size(0);
+    for (boost::filesystem::directory_iterator itr(kJournalDir), end; itr != end; ++itr)
+      size += boost::filesystem::file_size(itr->path());
+    return size;
+  });
+
+  // The journal never drains, as each record is committed only after the next is appended.
+  std::vector<ImmutableData> data;
+  {
+    WriteBackJournal journal(kJournalDir, kMaxSegmentSize);
+    std::deque<WriteBackJournal::Record> uncommitted;
+    for (int i(0); i != 100; ++i) {
+      data.emplace_back(NonEmptyString(RandomString(1000)));
+      uncommitted.push_back(WriteBackJournal::Record::Put(data.back()));
+      journal.Append(uncommitted.back());
+      if (uncommitted.size() > 2U) {
+        journal.CommitOldest(uncommitted.front());
+        uncommitted.pop_front();
+      }
+      CHECK(disk_usage() <= journal.uncommitted_bytes() + 2 * kMaxSegmentSize);
+    }
+    CHECK(uncommitted.size() == 2U);
+    CHECK(journal.ReadContent(uncommitted.front()) == data[98].data().string());
+  }
+
+  WriteBackJournal journal(kJournalDir, kMaxSegmentSize);
+  auto records(journal.TakeRecoveredRecords());
+  REQUIRE(records.size() == 2U);
+  CHECK(records[0].chunk_name == data[98].name());
+  CHECK(records[1].chunk_name == data[99].name());
+  CHECK(journal.ReadContent(records[1]) == data[99].data().string());
+}
+
+TEST_CASE("Write-back store", "[WriteBackJournal][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  const auto kJournalDir(*test_dir / "journal");
+  auto memory_store(std::make_shared<MemoryStore>());
+  ImmutableData data(NonEmptyString(RandomString(1024)));
+  ImmutableData recovered_data(NonEmptyString(RandomString(1024)));
+  MutableData::Name tree_name(Identity(RandomString(64)));
+  StructuredDataVersions::VersionName v0(0, data.name());
+
+  {
+    // A record journalled by an instance which crashed before replaying it.
+    WriteBackJournal journal(kJournalDir);
+    auto put(WriteBackJournal::Record::Put(recovered_data));
+    journal.Append(put);
+  }
+
+  WriteBackStore<MemoryStore> store(memory_store, std::make_shared<WriteBackJournal>(kJournalDir));
+  store.Put(data);
+  CHECK(store.Get(data.name()).get().data() == data.data());
+  CHECK_NOTHROW(store.CreateVersionTree(tree_name, v0, 10, 1).get());
+  auto versions(store.GetVersions(tree_name).get());
+  REQUIRE(versions.size() == 1U);
+  CHECK(versions.front() == v0);
+
+  REQUIRE(store.Flush(std::chrono::seconds(10)));
+  CHECK(store.pending_count() == 0U);
+  CHECK(memory_store->Get(data.name()).get().data() == data.data());
+  CHECK(memory_store->Get(recovered_data.name()).get().data() == recovered_data.data());
+}
+
+TEST_CASE("Write-back store outage", "[WriteBackJournal][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  typedef DeduplicatingStore<FlakyStore> NetworkStore;
+  auto flaky_store(std::make_shared<FlakyStore>());
+  const uint64_t kMaxUncommittedBytes(4096);
+  WriteBackStore<NetworkStore> store(
+      std::make_shared<NetworkStore>(flaky_store, nullptr),
+      std::make_shared<WriteBackJournal>(*test_dir / "journal"), nullptr, kMaxUncommittedBytes,
+      std::chrono::milliseconds(20));
+  ImmutableData data(NonEmptyString(RandomString(kMaxUncommittedBytes)));
+  ImmutableData blocked_data(NonEmptyString(RandomString(1024)));
+  MutableData::Name tree_name(Identity(RandomString(64)));
+  StructuredDataVersions::VersionName v0(0, ImmutableData::Name(Identity(RandomString(64))));
+  StructuredDataVersions::VersionName v1(1, ImmutableData::Name(Identity(RandomString(64))));
+
+  // Nothing can be confirmed during the outage, so every operation stays journalled however often
+  // it's retried.
+  CHECK_NOTHROW(store.CreateVersionTree(tree_name, v0, 10, 1).get());
+  store.PutVersion(tree_name, v0, v1);
+  store.Put(data);
+  CHECK_FALSE(store.Flush(std::chrono::milliseconds(500)));
+  CHECK(store.pending_count() == 3U);
+  CHECK(flaky_store->attempts > 5);
+  CHECK(store.Get(data.name()).get().data() == data.data());
+  // Versions are answered from the journal rather than waiting for storage.
+  auto journalled_versions(store.GetVersions(tree_name).get());
+  REQUIRE(journalled_versions.size() == 1U);
+  CHECK(journalled_versions.front() == v1);
+  auto journalled_branch(store.GetBranch(tree_name, v1).get());
+  REQUIRE(journalled_branch.size() == 2U);
+  CHECK(journalled_branch[0] == v1);
+  CHECK(journalled_branch[1] == v0);
+
+  // The journal is now full, so further writes block until storage catches up.
+  std::atomic<bool> blocked_put_returned(false);
+  std::thread writer([&] {
+    store.Put(blocked_data);
+    blocked_put_returned = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  CHECK_FALSE(blocked_put_returned);
+
+  flaky_store->available = true;
+  writer.join();
+  REQUIRE(store.Flush(std::chrono::seconds(10)));
+  CHECK(store.pending_count() == 0U);
+  CHECK(flaky_store->store->Get(data.name()).get().data() == data.data());
+  CHECK(flaky_store->store->Get(blocked_data.name()).get().data() == blocked_data.data());
+  auto versions(store.GetVersions(tree_name).get());
+  REQUIRE(versions.size() == 1U);
+  CHECK(versions.front() == v1);
+}
+
+TEST_CASE("Write-back store replay is scheduled", "[WriteBackJournal][behavioural]") {
+  maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath("MaidSafe_Test_Drive"));
+  auto memory_store(std::make_shared<MemoryStore>());
+  auto scheduler(std::make_shared<StorageScheduler>());
+  // Enough for one chunk's record straight away, then another one a second later.
+  scheduler->SetUploadRateLimit(1024, 1100);
+  WriteBackStore<MemoryStore> store(memory_store,
+                                    std::make_shared<WriteBackJournal>(*test_dir / "journal"),
+                                    scheduler);
+  ImmutableData data0(NonEmptyString(RandomString(1000)));
+  ImmutableData data1(NonEmptyString(RandomString(1000)));
+
+  // Writes complete at journal speed; only the replay is held back by the rate limit.
+  auto start(std::chrono::steady_clock::now());
+  store.Put(data0);
+  store.Put(data1);
+  CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+  CHECK_FALSE(store.Flush(std::chrono::milliseconds(300)));
+  CHECK(store.pending_count() == 1U);
+  REQUIRE(store.Flush(std::chrono::seconds(10)));
+  CHECK(memory_store->Get(data1.name()).get().data() == data1.data());
+}
+
+}  // namespace test
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,103 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/tools/commands/replay_trace_command.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/memory_store.h"
+#include "maidsafe/drive/replay_drive.h"
+#include "maidsafe/drive/simulated_network_store.h"
+#include "maidsafe/drive/utils.h"
+#include "maidsafe/drive/tools/commands/command_utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace tools {
+
+namespace {
+
+template <typename Storage>
+void Replay(std::shared_ptr<Storage> storage, const fs::path& user_app_dir,
+            const fs::path& trace_file, bool original_speed) {
+  ReplayDrive<Storage> drive(storage, Identity(RandomString(64)), Identity(RandomString(64)),
+                             user_app_dir, true);
+  auto result(drive.Replay(trace_file, original_speed));
+  std::cout << "\tReplayed " << result.operations << " calls (" << result.failures
+            << " failed, " << result.skipped << " skipped) in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(result.elapsed).count()
+            << " ms.\n\n" << drive.operation_metrics().Report() << '\n'
+            << drive.storage_metrics().Report() << '\n';
+}
+
+}  // unnamed namespace
+
+const std::string ReplayTraceCommand::kName("Replay operation trace");
+
+void ReplayTraceCommand::Run() {
+  fs::path trace_file;
+  std::cout << "\tEnter path to trace file";
+  while (trace_file.empty()) {
+    trace_file = fs::path(GetLine());
+    if (!fs::is_regular_file(trace_file)) {
+      std::cout << "\tInvalid choice.  Enter path to an existing trace file";
+      trace_file.clear();
+    }
+  }
+
+  std::cout << "\tReplay at original speed?  Enter \"y\" or \"n\"";
+  bool original_speed(detail::GetLowerCase(GetLine()) == "y");
+
+  std::cout << "\tEnter a simulated network profile, e.g. \"latency=normal:80:20\", or leave "
+            << "empty to replay against memory";
+  auto profile(GetLine());
+
+  fs::path user_app_dir(environment_.temp / "replay_trace");
+  boost::system::error_code error_code;
+  fs::create_directories(user_app_dir, error_code);
+  try {
+    auto memory_store(std::make_shared<MemoryStore>());
+    if (profile.empty()) {
+      Replay(memory_store, user_app_dir, trace_file, original_speed);
+    } else {
+      Replay(std::make_shared<SimulatedNetworkStore<MemoryStore>>(
+                 memory_store, SimulatedNetworkProfile::Parse(profile)),
+             user_app_dir, trace_file, original_speed);
+    }
+  }
+  catch (const std::exception& e) {
+    std::cout << "\tReplay failed: " << e.what() << '\n';
+  }
+  fs::remove_all(user_app_dir, error_code);
+}
+
+}  // namespace tools
+
+}  // namespace drive
+
+}  // namespace maidsafe
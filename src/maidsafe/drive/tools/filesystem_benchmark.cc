@@ -0,0 +1,704 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+// Measures throughput and latency of file operations on a mounted drive (or, with '--disk', on the
+// native filesystem for comparison).  Options, in addition to those of every filesystem tool:
+//   --workloads     comma-separated list of seq_write, seq_read, rand_write, rand_read, create,
+//                   stat, readdir, rename, unlink and mixed (the default), and scaling_read,
+//                   scaling_write and scaling_metadata
+//   --block_sizes   comma-separated list of block sizes in bytes for the I/O workloads
+//   --threads       comma-separated list of thread counts; each thread uses its own files
+//   --file_size     size in MiB of each thread's file in the I/O workloads
+//   --file_count    number of files each thread creates in the metadata workloads
+//   --mixed_operations  number of operations each thread performs in the mixed workload
+//   --sharing       comma-separated list of the ways the threads of the scaling workloads share
+//                   files: same_directory (a file each, all in one directory),
+//                   separate_directories (a file each, in a directory each) and same_file
+//   --scaling_threads   comma-separated list of thread counts for the scaling workloads
+//   --scaling_operations  number of operations each thread performs in each scaling workload
+//   --label         recorded with each result, e.g. to identify the build being measured
+//   --output        file to which each result is appended as a line of JSON
+//   --baseline      file of expected results (see benchmarks/baseline.h); the tool fails if any
+//                   result has regressed beyond the tolerance given there
+//   --update_baseline  replace the values in the baseline file with this run's results
+// Workloads which aren't selected but which create the files needed by a later selected one are
+// still run, untimed.  Reads may be served from the kernel's page cache.
+//
+// The scaling workloads show how throughput and latency change as threads are added, exposing
+// contention in the drive, e.g. on a Directory's mutex.  Each thread does the same number of
+// random block reads or writes, or metadata operations (create, stat and remove, or stat and
+// setting the modification time of the shared file), so perfect scaling doubles op/s with the
+// thread count.  Once all have run, each is plotted against the thread count.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/algorithm/string/classification.hpp"
+#include "boost/algorithm/string/split.hpp"
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+#include "boost/lexical_cast.hpp"
+#include "boost/program_options.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/on_scope_exit.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/drive/benchmarks/baseline.h"
+
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+namespace maidsafe {
+
+namespace test {
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+fs::path g_root;
+
+std::function<void()> clean_root([] {
+  boost::system::error_code error_code;
+  fs::directory_iterator end;
+  for (fs::directory_iterator directory_itr(g_root); directory_itr != end; ++directory_itr)
+    fs::remove_all(*directory_itr, error_code);
+});
+
+struct Settings {
+  Settings()
+      : workloads(), block_sizes(), thread_counts(), scaling_thread_counts(), sharing(),
+        file_size(0), file_count(0), mixed_operations(0), scaling_operations(0), label(),
+        target(), json_output(), baseline(), update_baseline(false), results() {}
+  std::set<std::string> workloads;
+  std::vector<uint32_t> block_sizes;
+  std::vector<int> thread_counts, scaling_thread_counts;
+  std::vector<std::string> sharing;
+  uint64_t file_size;
+  uint32_t file_count, mixed_operations, scaling_operations;
+  std::string label, target;
+  std::shared_ptr<std::ofstream> json_output;
+  std::string baseline;
+  bool update_baseline;
+  // The JSON lines to be compared with 'baseline', if set.
+  std::shared_ptr<std::ostringstream> results;
+};
+
+template <typename T>
+std::vector<T> ParseList(const std::string& list) {
+  std::vector<std::string> items;
+  boost::split(items, list, boost::is_any_of(","), boost::token_compress_on);
+  std::vector<T> values;
+  for (const auto& item : items) {
+    if (!item.empty())
+      values.push_back(boost::lexical_cast<T>(item));
+  }
+  if (values.empty())
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  return values;
+}
+
+std::string TargetName(int test_type) {
+  // The values of drive::DriveType, followed by '--disk'.
+  static const char* const kNames[] = { "local", "local_console", "network", "network_console",
+                                        "disk" };
+  return (test_type >= 0 && test_type < 5) ? kNames[test_type] : "unknown";
+}
+
+Settings ParseSettings(int argc, char** argv, int test_type) {
+  po::options_description options("Filesystem benchmark options");
+  options.add_options()
+      ("workloads", po::value<std::string>()->default_value(
+          "seq_write,seq_read,rand_write,rand_read,create,stat,readdir,rename,unlink,mixed"), "")
+      ("block_sizes", po::value<std::string>()->default_value("4096,65536,1048576"), "")
+      ("threads", po::value<std::string>()->default_value("1,4"), "")
+      ("file_size", po::value<uint64_t>()->default_value(64), "")
+      ("file_count", po::value<uint32_t>()->default_value(1000), "")
+      ("mixed_operations", po::value<uint32_t>()->default_value(2000), "")
+      ("sharing", po::value<std::string>()->default_value(
+          "same_directory,separate_directories,same_file"), "")
+      ("scaling_threads", po::value<std::string>()->default_value("1,2,4,8,16,32,64"), "")
+      ("scaling_operations", po::value<uint32_t>()->default_value(1000), "")
+      ("label", po::value<std::string>()->default_value(""), "")
+      ("output", po::value<std::string>(), "")
+      ("baseline", po::value<std::string>(), "")
+      ("update_baseline", "");
+  po::variables_map variables_map;
+  po::store(po::command_line_parser(std::vector<std::string>(argv, argv + argc))
+                .options(options).allow_unregistered().run(), variables_map);
+  po::notify(variables_map);
+
+  Settings settings;
+  for (const auto& workload : ParseList<std::string>(
+           variables_map.at("workloads").as<std::string>())) {
+    settings.workloads.insert(workload);
+  }
+  settings.block_sizes = ParseList<uint32_t>(variables_map.at("block_sizes").as<std::string>());
+  settings.thread_counts = ParseList<int>(variables_map.at("threads").as<std::string>());
+  settings.file_size = variables_map.at("file_size").as<uint64_t>() * 1024 * 1024;
+  settings.file_count = variables_map.at("file_count").as<uint32_t>();
+  settings.mixed_operations = variables_map.at("mixed_operations").as<uint32_t>();
+  settings.sharing = ParseList<std::string>(variables_map.at("sharing").as<std::string>());
+  settings.scaling_thread_counts =
+      ParseList<int>(variables_map.at("scaling_threads").as<std::string>());
+  settings.scaling_operations = variables_map.at("scaling_operations").as<uint32_t>();
+  settings.label = variables_map.at("label").as<std::string>();
+  settings.target = TargetName(test_type);
+  if (variables_map.count("output")) {
+    settings.json_output = std::make_shared<std::ofstream>(
+        variables_map.at("output").as<std::string>(), std::ios::out | std::ios::app);
+    if (!*settings.json_output)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  if (variables_map.count("baseline")) {
+    settings.baseline = variables_map.at("baseline").as<std::string>();
+    settings.update_baseline = variables_map.count("update_baseline") != 0;
+    settings.results = std::make_shared<std::ostringstream>();
+  }
+  if (std::any_of(std::begin(settings.block_sizes), std::end(settings.block_sizes),
+                  [](uint32_t block_size) { return block_size == 0; }) ||
+      std::any_of(std::begin(settings.thread_counts), std::end(settings.thread_counts),
+                  [](int thread_count) { return thread_count < 1; }) ||
+      std::any_of(std::begin(settings.scaling_thread_counts),
+                  std::end(settings.scaling_thread_counts),
+                  [](int thread_count) { return thread_count < 1; }) ||
+      std::any_of(std::begin(settings.sharing), std::end(settings.sharing),
+                  [](const std::string& sharing) {
+                    return sharing != "same_directory" && sharing != "separate_directories" &&
+                           sharing != "same_file";
+                  })) {
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  return settings;
+}
+
+// An unbuffered file, so that each Read or Write reaches the filesystem as a single call.
+class File {
+ public:
+  File(const fs::path& path, const char* mode) : file_(std::fopen(path.string().c_str(), mode)) {
+    if (!file_ || std::setvbuf(file_, nullptr, _IONBF, 0) != 0)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  ~File() {
+    if (file_)
+      std::fclose(file_);
+  }
+  void Write(const std::string& block, uint64_t offset) {
+    if (!Seek(offset) || std::fwrite(block.data(), 1, block.size(), file_) != block.size())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  void Read(std::string& block, uint64_t offset) {
+    if (!Seek(offset) || std::fread(&block[0], 1, block.size(), file_) != block.size())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  void Close() {
+    auto result(std::fclose(file_));
+    file_ = nullptr;
+    if (result != 0)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+
+ private:
+  File(const File&);
+  File& operator=(const File&);
+
+  bool Seek(uint64_t offset) {
+#ifdef MAIDSAFE_WIN32
+    return _fseeki64(file_, static_cast<int64_t>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file_, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+  }
+
+  std::FILE* file_;
+};
+
+// Collects the latency of each operation performed by one thread.
+class Recorder {
+ public:
+  explicit Recorder(int thread_index)
+      : kThreadIndex_(thread_index), generator_(thread_index + 1), latencies_(), bytes_(0) {}
+
+  template <typename Operation>
+  void Time(Operation operation, uint64_t bytes = 0) {
+    auto start(Clock::now());
+    operation();
+    latencies_.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start).count());
+    bytes_ += bytes;
+  }
+
+  int thread_index() const { return kThreadIndex_; }
+  std::mt19937_64& generator() { return generator_; }
+  const std::vector<uint64_t>& latencies() const { return latencies_; }
+  uint64_t bytes() const { return bytes_; }
+
+ private:
+  const int kThreadIndex_;
+  std::mt19937_64 generator_;
+  std::vector<uint64_t> latencies_;
+  uint64_t bytes_;
+};
+
+std::string Escape(const std::string& input) {
+  std::string output;
+  for (char c : input) {
+    if (c == '"' || c == '\\')
+      output += '\\';
+    output += c;
+  }
+  return output;
+}
+
+struct Measurement {
+  Measurement() : operations_per_second(0.0), p99_microseconds(0.0) {}
+  double operations_per_second, p99_microseconds;
+};
+
+uint64_t Percentile(const std::vector<uint64_t>& sorted_latencies, double percentile) {
+  if (sorted_latencies.empty())
+    return 0;
+  auto index(static_cast<size_t>(percentile * (sorted_latencies.size() - 1) + 0.5));
+  return sorted_latencies[std::min(index, sorted_latencies.size() - 1)];
+}
+
+Measurement Report(const Settings& settings, const std::string& workload, uint32_t block_size,
+                   int thread_count, const std::vector<Recorder>& recorders,
+                   Clock::duration elapsed) {
+  std::vector<uint64_t> latencies;
+  uint64_t bytes(0);
+  for (const auto& recorder : recorders) {
+    latencies.insert(std::end(latencies), std::begin(recorder.latencies()),
+                     std::end(recorder.latencies()));
+    bytes += recorder.bytes();
+  }
+  std::sort(std::begin(latencies), std::end(latencies));
+  double seconds(std::max(std::chrono::duration<double>(elapsed).count(), 1e-9));
+  auto microseconds([&](double percentile) {
+    return Percentile(latencies, percentile) / 1000.0;
+  });
+
+  std::cout << std::left << std::setw(12) << workload << std::right << std::setw(9) << block_size
+            << " B" << std::setw(4) << thread_count << " threads" << std::fixed
+            << std::setprecision(1) << std::setw(12) << latencies.size() / seconds << " op/s"
+            << std::setw(10) << bytes / seconds / (1024.0 * 1024.0) << " MiB/s  p50 "
+            << microseconds(0.5) << "us  p99 " << microseconds(0.99) << "us  max "
+            << microseconds(1.0) << "us\n";
+  Measurement measurement;
+  measurement.operations_per_second = latencies.size() / seconds;
+  measurement.p99_microseconds = microseconds(0.99);
+  if (!settings.json_output && !settings.results)
+    return measurement;
+  std::ostringstream json;
+  json << std::setprecision(9) << "{\"label\":\"" << Escape(settings.label) << "\",\"target\":\""
+       << settings.target << "\",\"workload\":\"" << workload << "\",\"block_size\":"
+       << block_size << ",\"threads\":" << thread_count << ",\"operations\":" << latencies.size()
+       << ",\"bytes\":" << bytes << ",\"seconds\":" << seconds << ",\"operations_per_second\":"
+       << latencies.size() / seconds << ",\"bytes_per_second\":" << bytes / seconds
+       << ",\"latency_us\":{\"p50\":" << microseconds(0.5) << ",\"p90\":" << microseconds(0.9)
+       << ",\"p99\":" << microseconds(0.99) << ",\"p99.9\":" << microseconds(0.999)
+       << ",\"max\":" << microseconds(1.0) << "}}";
+  if (settings.json_output)
+    *settings.json_output << json.str() << std::endl;
+  if (settings.results)
+    *settings.results << json.str() << '\n';
+  return measurement;
+}
+
+// Runs 'work' on 'thread_count' threads at once.  The elapsed time runs from when all threads have
+// been started until the last finishes.  The result is only reported if 'workload' was selected; a
+// workload named "<name>/<variant>" is selected by <name>.
+Measurement Run(const Settings& settings, const std::string& workload, uint32_t block_size,
+                int thread_count, const std::function<void(Recorder&)>& work) {
+  std::vector<Recorder> recorders;
+  recorders.reserve(thread_count);
+  for (int i(0); i != thread_count; ++i)
+    recorders.emplace_back(i);
+  std::vector<std::exception_ptr> errors(thread_count);
+  std::atomic<bool> go(false);
+  std::vector<std::thread> threads;
+  for (int i(0); i != thread_count; ++i) {
+    threads.emplace_back([&, i] {
+      while (!go)
+        std::this_thread::yield();
+      try {
+        work(recorders[i]);
+      }
+      catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+  auto start(Clock::now());
+  go = true;
+  for (auto& thread : threads)
+    thread.join();
+  auto elapsed(Clock::now() - start);
+  for (const auto& error : errors) {
+    if (error)
+      std::rethrow_exception(error);
+  }
+  if (!settings.workloads.count(workload.substr(0, workload.find('/'))))
+    return Measurement();
+  return Report(settings, workload, block_size, thread_count, recorders, elapsed);
+}
+
+fs::path ThreadFile(const fs::path& directory, int thread_index) {
+  return directory / ("thread_" + std::to_string(thread_index) + ".dat");
+}
+
+uint64_t RandomBlockOffset(Recorder& recorder, uint64_t file_size, uint32_t block_size) {
+  auto block_count(std::max<uint64_t>(file_size / block_size, 1));
+  return (recorder.generator()() % block_count) * block_size;
+}
+
+void RunIoWorkloads(const Settings& settings, uint32_t block_size, int thread_count) {
+  const fs::path kDirectory(g_root / ("io_" + std::to_string(block_size) + "_" +
+                                      std::to_string(thread_count)));
+  fs::create_directory(kDirectory);
+  const uint64_t kBlockCount(std::max<uint64_t>(settings.file_size / block_size, 1));
+  const uint64_t kFileSize(kBlockCount * block_size);
+  const std::string kContent(RandomString(block_size));
+
+  Run(settings, "seq_write", block_size, thread_count, [&](Recorder& recorder) {
+    File file(ThreadFile(kDirectory, recorder.thread_index()), "wb");
+    for (uint64_t i(0); i != kBlockCount; ++i)
+      recorder.Time([&] { file.Write(kContent, i * block_size); }, block_size);
+    file.Close();
+  });
+  Run(settings, "seq_read", block_size, thread_count, [&](Recorder& recorder) {
+    File file(ThreadFile(kDirectory, recorder.thread_index()), "rb");
+    std::string block(block_size, 0);
+    for (uint64_t i(0); i != kBlockCount; ++i)
+      recorder.Time([&] { file.Read(block, i * block_size); }, block_size);
+  });
+  Run(settings, "rand_write", block_size, thread_count, [&](Recorder& recorder) {
+    File file(ThreadFile(kDirectory, recorder.thread_index()), "r+b");
+    for (uint64_t i(0); i != kBlockCount; ++i) {
+      auto offset(RandomBlockOffset(recorder, kFileSize, block_size));
+      recorder.Time([&] { file.Write(kContent, offset); }, block_size);
+    }
+    file.Close();
+  });
+  Run(settings, "rand_read", block_size, thread_count, [&](Recorder& recorder) {
+    File file(ThreadFile(kDirectory, recorder.thread_index()), "rb");
+    std::string block(block_size, 0);
+    for (uint64_t i(0); i != kBlockCount; ++i) {
+      auto offset(RandomBlockOffset(recorder, kFileSize, block_size));
+      recorder.Time([&] { file.Read(block, offset); }, block_size);
+    }
+  });
+  fs::remove_all(kDirectory);
+}
+
+void RunMetadataWorkloads(const Settings& settings, int thread_count) {
+  const fs::path kDirectory(g_root / ("metadata_" + std::to_string(thread_count)));
+  for (int i(0); i != thread_count; ++i)
+    fs::create_directories(kDirectory / std::to_string(i));
+  auto path([&](const Recorder& recorder, uint32_t index, const std::string& suffix) {
+    return kDirectory / std::to_string(recorder.thread_index()) /
+           ("file_" + std::to_string(index) + suffix);
+  });
+
+  Run(settings, "create", 0, thread_count, [&](Recorder& recorder) {
+    for (uint32_t i(0); i != settings.file_count; ++i)
+      recorder.Time([&] { File(path(recorder, i, ""), "wb").Close(); });
+  });
+  Run(settings, "stat", 0, thread_count, [&](Recorder& recorder) {
+    for (uint32_t i(0); i != settings.file_count; ++i) {
+      recorder.Time([&] {
+        if (!fs::is_regular_file(path(recorder, i, "")))
+          BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+      });
+    }
+  });
+  // Each operation lists a whole directory of 'file_count' files.
+  Run(settings, "readdir", 0, thread_count, [&](Recorder& recorder) {
+    const fs::path kThreadDirectory(kDirectory / std::to_string(recorder.thread_index()));
+    for (int i(0); i != 10; ++i) {
+      recorder.Time([&] {
+        uint32_t count(0);
+        for (fs::directory_iterator itr(kThreadDirectory), end; itr != end; ++itr)
+          ++count;
+        if (count != settings.file_count)
+          BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+      });
+    }
+  });
+  Run(settings, "rename", 0, thread_count, [&](Recorder& recorder) {
+    for (uint32_t i(0); i != settings.file_count; ++i)
+      recorder.Time([&] { fs::rename(path(recorder, i, ""), path(recorder, i, ".renamed")); });
+  });
+  Run(settings, "unlink", 0, thread_count, [&](Recorder& recorder) {
+    for (uint32_t i(0); i != settings.file_count; ++i)
+      recorder.Time([&] { fs::remove(path(recorder, i, ".renamed")); });
+  });
+  fs::remove_all(kDirectory);
+}
+
+// Each thread works on its own set of files: half its operations read a block, a fifth write one,
+// a fifth stat a file and the rest create and remove a file.
+void RunMixedWorkload(const Settings& settings, uint32_t block_size, int thread_count) {
+  if (!settings.workloads.count("mixed"))
+    return;
+  const fs::path kDirectory(g_root / ("mixed_" + std::to_string(block_size) + "_" +
+                                      std::to_string(thread_count)));
+  const int kFilesPerThread(8);
+  const uint64_t kBlockCount(
+      std::max<uint64_t>(settings.file_size / kFilesPerThread / block_size, 1));
+  const uint64_t kFileSize(kBlockCount * block_size);
+  const std::string kContent(RandomString(block_size));
+  auto path([&](const Recorder& recorder, int index) {
+    return kDirectory / std::to_string(recorder.thread_index()) /
+           ("file_" + std::to_string(index));
+  });
+
+  for (int i(0); i != thread_count; ++i)
+    fs::create_directories(kDirectory / std::to_string(i));
+  Run(settings, "mixed_setup", block_size, thread_count, [&](Recorder& recorder) {
+    for (int i(0); i != kFilesPerThread; ++i) {
+      File file(path(recorder, i), "wb");
+      for (uint64_t j(0); j != kBlockCount; ++j)
+        file.Write(kContent, j * block_size);
+      file.Close();
+    }
+  });
+
+  Run(settings, "mixed", block_size, thread_count, [&](Recorder& recorder) {
+    std::string block(block_size, 0);
+    for (uint32_t i(0); i != settings.mixed_operations; ++i) {
+      auto choice(recorder.generator()() % 10);
+      auto file_path(path(recorder, static_cast<int>(recorder.generator()() % kFilesPerThread)));
+      auto offset(RandomBlockOffset(recorder, kFileSize, block_size));
+      if (choice < 5) {
+        recorder.Time([&] { File(file_path, "rb").Read(block, offset); }, block_size);
+      } else if (choice < 7) {
+        recorder.Time([&] {
+          File file(file_path, "r+b");
+          file.Write(kContent, offset);
+          file.Close();
+        }, block_size);
+      } else if (choice < 9) {
+        recorder.Time([&] { fs::status(file_path); });
+      } else {
+        recorder.Time([&] {
+          auto temp_path(path(recorder, kFilesPerThread + static_cast<int>(i)));
+          File(temp_path, "wb").Close();
+          fs::remove(temp_path);
+        });
+      }
+    }
+  });
+  fs::remove_all(kDirectory);
+}
+
+bool Selected(const Settings& settings, std::initializer_list<const char*> workloads) {
+  return std::any_of(std::begin(workloads), std::end(workloads),
+                     [&](const char* workload) { return settings.workloads.count(workload) != 0; });
+}
+
+// Measurements of each scaling workload (and block size) by sharing pattern, then thread count.
+typedef std::map<std::string, std::map<std::string, std::map<int, Measurement>>> ScalingResults;
+
+// The file used by the thread 'thread_index' of a scaling workload.
+fs::path ScalingFile(const fs::path& directory, const std::string& sharing, int thread_index) {
+  if (sharing == "same_file")
+    return directory / "shared.dat";
+  if (sharing == "separate_directories")
+    return directory / std::to_string(thread_index) / "data.dat";
+  return ThreadFile(directory, thread_index);
+}
+
+fs::path PrepareScalingDirectory(const std::string& name, const std::string& sharing,
+                                 int thread_count) {
+  const fs::path kDirectory(g_root / (name + "_" + sharing + "_" + std::to_string(thread_count)));
+  for (int i(0); i != thread_count; ++i)
+    fs::create_directories(ScalingFile(kDirectory, sharing, i).parent_path());
+  return kDirectory;
+}
+
+void RunScalingIoWorkloads(const Settings& settings, uint32_t block_size, int thread_count,
+                           const std::string& sharing, ScalingResults& results) {
+  const uint64_t kBlockCount(64);
+  const uint64_t kFileSize(kBlockCount * block_size);
+  const std::string kContent(RandomString(block_size));
+  const std::string kSuffix("/" + sharing);
+  const std::string kLabel(" " + std::to_string(block_size) + " B");
+  const fs::path kDirectory(PrepareScalingDirectory(
+      "scaling_io_" + std::to_string(block_size), sharing, thread_count));
+  auto file_path([&](const Recorder& recorder) {
+    return ScalingFile(kDirectory, sharing, recorder.thread_index());
+  });
+
+  Run(settings, "scaling_setup", block_size, thread_count, [&](Recorder& recorder) {
+    if (sharing == "same_file" && recorder.thread_index() != 0)
+      return;
+    File file(file_path(recorder), "wb");
+    for (uint64_t i(0); i != kBlockCount; ++i)
+      file.Write(kContent, i * block_size);
+    file.Close();
+  });
+  if (Selected(settings, {"scaling_write"})) {
+    results["scaling_write" + kLabel][sharing][thread_count] =
+        Run(settings, "scaling_write" + kSuffix, block_size, thread_count,
+            [&](Recorder& recorder) {
+              File file(file_path(recorder), "r+b");
+              for (uint32_t i(0); i != settings.scaling_operations; ++i) {
+                auto offset(RandomBlockOffset(recorder, kFileSize, block_size));
+                recorder.Time([&] { file.Write(kContent, offset); }, block_size);
+              }
+              file.Close();
+            });
+  }
+  if (Selected(settings, {"scaling_read"})) {
+    results["scaling_read" + kLabel][sharing][thread_count] =
+        Run(settings, "scaling_read" + kSuffix, block_size, thread_count,
+            [&](Recorder& recorder) {
+              File file(file_path(recorder), "rb");
+              std::string block(block_size, 0);
+              for (uint32_t i(0); i != settings.scaling_operations; ++i) {
+                auto offset(RandomBlockOffset(recorder, kFileSize, block_size));
+                recorder.Time([&] { file.Read(block, offset); }, block_size);
+              }
+            });
+  }
+  fs::remove_all(kDirectory);
+}
+
+void RunScalingMetadataWorkload(const Settings& settings, int thread_count,
+                                const std::string& sharing, ScalingResults& results) {
+  const fs::path kDirectory(PrepareScalingDirectory("scaling_metadata", sharing, thread_count));
+  if (sharing == "same_file")
+    File(ScalingFile(kDirectory, sharing, 0), "wb").Close();
+
+  results["scaling_metadata"][sharing][thread_count] =
+      Run(settings, "scaling_metadata/" + sharing, 0, thread_count, [&](Recorder& recorder) {
+        const fs::path kFile(ScalingFile(kDirectory, sharing, recorder.thread_index()));
+        auto check_exists([&](const fs::path& path) {
+          if (!fs::is_regular_file(path))
+            BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+        });
+        if (sharing == "same_file") {
+          for (uint32_t i(0); i != settings.scaling_operations; ++i) {
+            if (i % 2 == 0)
+              recorder.Time([&] { check_exists(kFile); });
+            else
+              recorder.Time([&] { fs::last_write_time(kFile, std::time(nullptr)); });
+          }
+          return;
+        }
+        for (uint32_t i(0); i < settings.scaling_operations; i += 3) {
+          const fs::path kPath(kFile.string() + "_" + std::to_string(i));
+          recorder.Time([&] { File(kPath, "wb").Close(); });
+          recorder.Time([&] { check_exists(kPath); });
+          recorder.Time([&] { fs::remove(kPath); });
+        }
+      });
+  fs::remove_all(kDirectory);
+}
+
+// Draws op/s against thread count for each scaling workload, with bars scaled to the workload's
+// best result across all sharing patterns.
+void PlotScalingResults(const ScalingResults& results) {
+  const double kBarWidth(40.0);
+  for (const auto& workload : results) {
+    double best(0.0);
+    for (const auto& sharing : workload.second) {
+      for (const auto& point : sharing.second)
+        best = std::max(best, point.second.operations_per_second);
+    }
+    std::cout << '\n' << workload.first << ": op/s against threads\n";
+    for (const auto& sharing : workload.second) {
+      std::cout << "  " << sharing.first << '\n';
+      for (const auto& point : sharing.second) {
+        auto bar_length(best > 0.0 ? static_cast<size_t>(
+            kBarWidth * point.second.operations_per_second / best + 0.5) : 0);
+        std::cout << std::setw(6) << point.first << " threads" << std::fixed
+                  << std::setprecision(1) << std::setw(12)
+                  << point.second.operations_per_second << " op/s  p99" << std::setw(10)
+                  << point.second.p99_microseconds << "us  " << std::string(bar_length, '#')
+                  << '\n';
+      }
+    }
+  }
+}
+
+void RunScalingWorkloads(const Settings& settings) {
+  if (!Selected(settings, {"scaling_read", "scaling_write", "scaling_metadata"}))
+    return;
+  ScalingResults results;
+  for (const auto& sharing : settings.sharing) {
+    for (auto thread_count : settings.scaling_thread_counts) {
+      if (Selected(settings, {"scaling_read", "scaling_write"})) {
+        for (auto block_size : settings.block_sizes)
+          RunScalingIoWorkloads(settings, block_size, thread_count, sharing, results);
+      }
+      if (Selected(settings, {"scaling_metadata"}))
+        RunScalingMetadataWorkload(settings, thread_count, sharing, results);
+    }
+  }
+  PlotScalingResults(results);
+}
+
+}  // unnamed namespace
+
+int RunTool(int argc, char** argv, const fs::path& root, const fs::path& /*temp*/,
+            const fs::path& /*storage*/, int test_type) {
+  g_root = root;
+  on_scope_exit cleanup(clean_root);
+  auto settings(ParseSettings(argc, argv, test_type));
+
+  for (auto thread_count : settings.thread_counts) {
+    for (auto block_size : settings.block_sizes) {
+      if (Selected(settings, {"seq_write", "seq_read", "rand_write", "rand_read"}))
+        RunIoWorkloads(settings, block_size, thread_count);
+      RunMixedWorkload(settings, block_size, thread_count);
+    }
+    if (Selected(settings, {"create", "stat", "readdir", "rename", "unlink"}))
+      RunMetadataWorkloads(settings, thread_count);
+  }
+  RunScalingWorkloads(settings);
+  if (!settings.results)
+    return 0;
+  return drive::benchmark::CompareWithBaseline(settings.baseline, settings.results->str(),
+                                               settings.update_baseline, std::cout);
+}
+
+}  // namespace test
+
+}  // namespace maidsafe
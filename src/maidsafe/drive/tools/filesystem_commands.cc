@@ -32,6 +32,7 @@
 #include "maidsafe/drive/tools/commands/close_file_command.h"
 #include "maidsafe/drive/tools/commands/create_file_command.h"
 #include "maidsafe/drive/tools/commands/exit_tool_command.h"
+#include "maidsafe/drive/tools/commands/replay_trace_command.h"
 
 namespace fs = boost::filesystem;
 namespace po = boost::program_options;
@@ -84,6 +85,7 @@ void PrintAvailableCommands() {
   PrintMainInfo<ExitToolCommand>();
   PrintMainInfo<CreateFileCommand>();
   PrintMainInfo<CloseFileCommand>();
+  PrintMainInfo<ReplayTraceCommand>();
 }
 
 void GetAndExecuteCommand() {
@@ -101,6 +103,8 @@ void GetAndExecuteCommand() {
           return Run<CreateFileCommand>();
         case CloseFileCommand::kTypeId:
           return Run<CloseFileCommand>();
+        case ReplayTraceCommand::kTypeId:
+          return Run<ReplayTraceCommand>();
         default:
           BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
       }
@@ -39,6 +39,7 @@ enum class Operation : int {
   kGetFileInfo,
   kSetAllocationSize,
   kSetEndOfFile,
+  kReplayTrace,
   kUninitialised
 };
 
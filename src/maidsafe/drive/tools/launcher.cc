@@ -325,6 +325,8 @@ void Launcher::StartDriveProcess(const Options& options) {
   process_args.emplace_back("--shared_memory " + initial_shared_memory_name_);
   if (!options.drive_logging_args.empty())
     process_args.push_back(options.drive_logging_args);
+  if (!options.drive_storage_args.empty())
+    process_args.push_back(options.drive_storage_args);
   const auto kCommandLine(process::ConstructCommandLine(process_args));
 
   // Start drive process
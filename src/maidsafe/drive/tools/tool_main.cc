@@ -171,7 +171,11 @@ po::options_description CommandLineOptions() {
                       "The index of key to be used as client")
       ("keys_path", po::value<std::string>()->default_value(fs::path(
                        fs::temp_directory_path(error_code) / "key_directory.dat").string()),
-                    "Path to keys file");
+                    "Path to keys file")
+      ("simulated_network", po::value<std::string>(), "Make the local VFS's storage behave like "
+          "a network with the given latency, bandwidth and failure profile, e.g. "
+          "'latency=normal:80:20,upload_kbps=512,seed=1'.  See SimulatedNetworkProfile::Parse.")
+      ("in_memory_store", "Make the local VFS hold all chunks in memory rather than on disk.");
 #ifdef MAIDSAFE_WIN32
   command_line_options.add_options()
       ("local_console", "Perform all tests/benchmarks on local VFS running as a console app.")
@@ -255,7 +259,7 @@ std::function<void()> PrepareDisk() {
   };
 }
 
-std::function<void()> PrepareLocalVfs() {
+std::function<void()> PrepareLocalVfs(const po::variables_map& variables_map) {
   SetUpTempDirectory();
   drive::Options options;
   SetUpRootDirectory(GetHomeDir());
@@ -269,6 +273,13 @@ std::function<void()> PrepareLocalVfs() {
   options.drive_type = static_cast<drive::DriveType>(g_test_type);
   if (g_enable_vfs_logging)
     options.drive_logging_args = "--log_* V --log_colour_mode 2 --log_no_async";
+  if (variables_map.count("in_memory_store"))
+    options.drive_storage_args = "--in_memory";
+  if (variables_map.count("simulated_network")) {
+    options.drive_storage_args += (options.drive_storage_args.empty() ? "" : " ") +
+        std::string("--simulated_network ") +
+        variables_map.at("simulated_network").as<std::string>();
+  }
 
   g_launcher.reset(new drive::Launcher(options));
   g_root = g_launcher->kMountPath();
@@ -324,7 +335,7 @@ std::function<void()> PrepareTest(const po::variables_map& variables_map) {
       return PrepareDisk();
     case TestType::kLocal:
     case TestType::kLocalConsole:
-      return PrepareLocalVfs();
+      return PrepareLocalVfs(variables_map);
     case TestType::kNetwork:
     case TestType::kNetworkConsole:
       return PrepareNetworkVfs(variables_map);
@@ -0,0 +1,170 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/tracer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+void WriteEscaped(std::ostream& stream, const char* text) {
+  for (; *text != '\0'; ++text) {
+    if (*text == '"' || *text == '\\')
+      stream << '\\';
+    stream << *text;
+  }
+}
+
+double ToMicroseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / 1000.0;
+}
+
+}  // unnamed namespace
+
+Tracer& Tracer::Instance() {
+  // Never destroyed, so that threads still running during static destruction can safely trace.
+  static Tracer* const tracer(new Tracer);
+  return *tracer;
+}
+
+Tracer::Tracer()
+    : enabled_(false),
+      max_events_per_thread_(kDefaultMaxEventsPerThread),
+      origin_(std::chrono::steady_clock::now()),
+      mutex_(),
+      thread_buffers_(),
+      thread_buffer_([](ThreadBuffer*) {}) {}
+
+void Tracer::Start(size_t max_events_per_thread) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  enabled_ = false;
+  for (auto& thread_buffer : thread_buffers_) {
+    std::lock_guard<std::mutex> buffer_lock(thread_buffer->mutex);
+    thread_buffer->events.clear();
+    thread_buffer->dropped_count = 0;
+  }
+  max_events_per_thread_ = max_events_per_thread;
+  origin_ = std::chrono::steady_clock::now();
+  enabled_ = true;
+}
+
+void Tracer::Stop() {
+  enabled_ = false;
+}
+
+void Tracer::Record(const char* category, const char* name,
+                    std::chrono::steady_clock::time_point start,
+                    std::chrono::steady_clock::time_point end) {
+  if (!enabled())
+    return;
+  ThreadBuffer& thread_buffer(GetThreadBuffer());
+  Event event = { category, name, start, end - start };
+  std::lock_guard<std::mutex> lock(thread_buffer.mutex);
+  if (thread_buffer.events.size() < max_events_per_thread_.load(std::memory_order_relaxed))
+    thread_buffer.events.push_back(event);
+  else
+    ++thread_buffer.dropped_count;
+}
+
+size_t Tracer::event_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t count(0);
+  for (const auto& thread_buffer : thread_buffers_) {
+    std::lock_guard<std::mutex> buffer_lock(thread_buffer->mutex);
+    count += thread_buffer->events.size();
+  }
+  return count;
+}
+
+size_t Tracer::dropped_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t count(0);
+  for (const auto& thread_buffer : thread_buffers_) {
+    std::lock_guard<std::mutex> buffer_lock(thread_buffer->mutex);
+    count += thread_buffer->dropped_count;
+  }
+  return count;
+}
+
+std::string Tracer::ToJson() const {
+  std::ostringstream stream;
+  WriteJson(stream);
+  return stream.str();
+}
+
+bool Tracer::StopAndWrite(const boost::filesystem::path& path) {
+  Stop();
+  std::ofstream stream(path.string().c_str(), std::ios::out | std::ios::trunc);
+  if (!stream)
+    return false;
+  WriteJson(stream);
+  stream.close();
+  return !stream.fail();
+}
+
+Tracer::ThreadBuffer& Tracer::GetThreadBuffer() {
+  ThreadBuffer* thread_buffer(thread_buffer_.get());
+  if (thread_buffer)
+    return *thread_buffer;
+  std::lock_guard<std::mutex> lock(mutex_);
+  thread_buffers_.emplace_back(
+      new ThreadBuffer(static_cast<uint32_t>(thread_buffers_.size() + 1)));
+  thread_buffer = thread_buffers_.back().get();
+  thread_buffer_.reset(thread_buffer);
+  return *thread_buffer;
+}
+
+void Tracer::WriteJson(std::ostream& stream) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stream << "{\"traceEvents\":[";
+  bool first(true);
+  size_t dropped_count(0);
+  stream << std::fixed << std::setprecision(3);
+  for (const auto& thread_buffer : thread_buffers_) {
+    std::lock_guard<std::mutex> buffer_lock(thread_buffer->mutex);
+    dropped_count += thread_buffer->dropped_count;
+    if (thread_buffer->events.empty())
+      continue;
+    stream << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+           << thread_buffer->thread_id << ",\"args\":{\"name\":\"thread "
+           << thread_buffer->thread_id << "\"}}";
+    first = false;
+    for (const auto& event : thread_buffer->events) {
+      stream << ",\n{\"name\":\"";
+      WriteEscaped(stream, event.name);
+      stream << "\",\"cat\":\"";
+      WriteEscaped(stream, event.category);
+      stream << "\",\"ph\":\"X\",\"ts\":" << ToMicroseconds(event.start - origin_)
+             << ",\"dur\":" << ToMicroseconds(event.duration) << ",\"pid\":1,\"tid\":"
+             << thread_buffer->thread_id << '}';
+    }
+  }
+  stream << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":\""
+         << dropped_count << "\"}}\n";
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
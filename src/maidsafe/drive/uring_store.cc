@@ -0,0 +1,480 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifdef MAIDSAFE_DRIVE_LIBURING
+
+#include "maidsafe/drive/uring_store.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "liburing.h"
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+// Set in the user_data of the fsync linked to a write, to tell its completion from the write's.
+const uintptr_t kFsyncTag(1);
+
+template <typename T>
+boost::future<T> MakeErrorFuture(CommonErrors error) {
+  boost::promise<T> promise;
+  promise.set_exception(boost::copy_exception(MakeError(error)));
+  return promise.get_future();
+}
+
+// Finishes a short transfer synchronously.  Returns false on error.
+bool WriteRemainder(int fd, const std::string& content, size_t offset) {
+  while (offset < content.size()) {
+    ssize_t written(pwrite(fd, content.data() + offset, content.size() - offset, offset));
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return false;
+    offset += static_cast<size_t>(written);
+  }
+  return fdatasync(fd) == 0;
+}
+
+bool ReadRemainder(int fd, std::string& buffer, size_t offset) {
+  while (offset < buffer.size()) {
+    ssize_t read(pread(fd, &buffer[offset], buffer.size() - offset, offset));
+    if (read < 0 && errno == EINTR)
+      continue;
+    if (read <= 0)
+      return false;
+    offset += static_cast<size_t>(read);
+  }
+  return true;
+}
+
+}  // unnamed namespace
+
+struct UringStore::Request {
+  enum class Kind { kRead, kWrite };
+
+  Request(Kind kind_in, ImmutableData::Name name_in)
+      : kind(kind_in), name(std::move(name_in)), content(), buffer(), promise(), fd(-1),
+        outstanding(0), synced(false), failed(false), missing(false) {}
+
+  unsigned SubmissionCount() const { return kind == Kind::kWrite ? 2 : 1; }
+
+  const Kind kind;
+  const ImmutableData::Name name;
+  std::shared_ptr<const std::string> content;
+  std::string buffer;
+  boost::promise<ImmutableData> promise;
+  int fd;
+  unsigned outstanding;
+  // 'missing' is set on a failed read if the chunk's file doesn't exist or doesn't hold the chunk,
+  // as opposed to the read having failed.
+  bool synced, failed, missing;
+};
+
+const std::chrono::steady_clock::duration UringStore::kMinRetryDelay(
+    std::chrono::milliseconds(100));
+const std::chrono::steady_clock::duration UringStore::kMaxRetryDelay(std::chrono::seconds(10));
+
+UringStore::UringStore(const fs::path& chunk_dir, unsigned queue_depth,
+                       std::shared_ptr<data_stores::LocalStore> version_store)
+    : kChunkDir_(chunk_dir),
+      kQueueDepth_(std::max(queue_depth, 2U)),
+      version_store_(std::move(version_store)),
+      ring_(new io_uring),
+      mutex_(),
+      condition_(),
+      queue_(),
+      retries_(),
+      retry_time_(),
+      retry_delay_(std::chrono::steady_clock::duration::zero()),
+      pending_writes_(),
+      stored_(),
+      dirty_dirs_(),
+      in_flight_(0),
+      stopping_(false),
+      submission_count_(0),
+      operation_count_(0),
+      io_thread_() {
+  if (!version_store_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  int result(io_uring_queue_init(kQueueDepth_, ring_.get(), 0));
+  if (result < 0) {
+    LOG(kError) << "Failed to set up io_uring: " << std::strerror(-result);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+  }
+  try {
+    LoadIndex();
+  }
+  catch (...) {
+    io_uring_queue_exit(ring_.get());
+    throw;
+  }
+  io_thread_ = std::thread([this] { Run(); });
+}
+
+UringStore::~UringStore() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+  io_thread_.join();
+  io_uring_queue_exit(ring_.get());
+  LOG(kInfo) << "io_uring store completed " << operation_count_ << " operations in "
+             << submission_count_ << " submissions.";
+}
+
+fs::path UringStore::ChunkPath(const ImmutableData::Name& data_name) const {
+  std::string hex_name(HexEncode(data_name->string()));
+  return kChunkDir_ / hex_name.substr(0, 2) / hex_name;
+}
+
+void UringStore::LoadIndex() {
+  fs::create_directories(kChunkDir_);
+  for (fs::directory_iterator itr(kChunkDir_); itr != fs::directory_iterator(); ++itr) {
+    if (!fs::is_directory(itr->status()))
+      continue;
+    for (fs::directory_iterator chunk_itr(itr->path()); chunk_itr != fs::directory_iterator();
+         ++chunk_itr) {
+      std::string name(HexDecode(chunk_itr->path().filename().string()));
+      if (!name.empty())
+        stored_.insert(ImmutableData::Name(Identity(name)));
+    }
+  }
+  LOG(kInfo) << "io_uring store at " << kChunkDir_ << " holds " << stored_.size() << " chunks.";
+}
+
+boost::future<ImmutableData> UringStore::Get(const ImmutableData::Name& data_name) {
+  std::shared_ptr<Request> request;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto pending_itr(pending_writes_.find(data_name));
+    if (pending_itr != std::end(pending_writes_)) {
+      boost::promise<ImmutableData> promise;
+      promise.set_value(ImmutableData(NonEmptyString(*pending_itr->second)));
+      return promise.get_future();
+    }
+    if (stored_.count(data_name) == 0) {
+      LOG(kWarning) << HexSubstr(data_name->string()) << " not in io_uring store.";
+      return MakeErrorFuture<ImmutableData>(CommonErrors::no_such_element);
+    }
+    request = std::make_shared<Request>(Request::Kind::kRead, data_name);
+    queue_.push_back(request);
+  }
+  condition_.notify_all();
+  return request->promise.get_future();
+}
+
+void UringStore::Put(const ImmutableData& data) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stored_.count(data.name()) != 0 || pending_writes_.count(data.name()) != 0)
+      return;
+    auto request(std::make_shared<Request>(Request::Kind::kWrite, data.name()));
+    request->content = std::make_shared<const std::string>(data.data().string());
+    pending_writes_.insert(std::make_pair(data.name(), request->content));
+    queue_.push_back(request);
+  }
+  condition_.notify_all();
+}
+
+void UringStore::IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& data_name : data_names) {
+    if (stored_.count(data_name) == 0 && pending_writes_.count(data_name) == 0)
+      LOG(kWarning) << "Can't increment " << HexSubstr(data_name->string()) << " - not held.";
+  }
+}
+
+boost::future<UringStore::VersionNames> UringStore::GetVersions(
+    const MutableData::Name& data_name) {
+  return version_store_->GetVersions(data_name);
+}
+
+boost::future<UringStore::VersionNames> UringStore::GetBranch(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& branch_tip) {
+  return version_store_->GetBranch(data_name, branch_tip);
+}
+
+void UringStore::PutVersion(const MutableData::Name& data_name,
+                            const StructuredDataVersions::VersionName& old_version_name,
+                            const StructuredDataVersions::VersionName& new_version_name) {
+  version_store_->PutVersion(data_name, old_version_name, new_version_name);
+}
+
+boost::future<void> UringStore::CreateVersionTree(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& version_name,
+    uint32_t max_versions, uint32_t max_branches) {
+  return version_store_->CreateVersionTree(data_name, version_name, max_versions, max_branches);
+}
+
+void UringStore::Flush() {
+  std::set<std::string> dirty_dirs;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return pending_writes_.empty(); });
+    dirty_dirs.swap(dirty_dirs_);
+  }
+  // The chunks themselves were synced as they were written; this makes their directory entries
+  // durable too.
+  for (const auto& dir : dirty_dirs) {
+    int fd(open((kChunkDir_ / dir).string().c_str(), O_RDONLY | O_DIRECTORY));
+    if (fd < 0 || fsync(fd) != 0)
+      LOG(kError) << "Failed to sync " << kChunkDir_ / dir << ": " << std::strerror(errno);
+    if (fd >= 0)
+      close(fd);
+  }
+}
+
+uint64_t UringStore::submission_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return submission_count_;
+}
+
+uint64_t UringStore::operation_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return operation_count_;
+}
+
+void UringStore::Run() {
+  std::map<Request*, std::shared_ptr<Request>> active;
+  for (;;) {
+    std::vector<std::shared_ptr<Request>> batch;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      auto ready([&] { return stopping_ || !queue_.empty() || in_flight_ != 0; });
+      if (retries_.empty())
+        condition_.wait(lock, ready);
+      else
+        condition_.wait_until(lock, retry_time_, ready);
+      if (!retries_.empty() && (stopping_ || std::chrono::steady_clock::now() >= retry_time_)) {
+        queue_.insert(std::end(queue_), std::begin(retries_), std::end(retries_));
+        retries_.clear();
+      }
+      if (stopping_ && queue_.empty() && in_flight_ == 0)
+        return;
+      unsigned batch_size(0);
+      while (!queue_.empty() &&
+             in_flight_ + batch_size + queue_.front()->SubmissionCount() <= kQueueDepth_) {
+        batch_size += queue_.front()->SubmissionCount();
+        batch.push_back(queue_.front());
+        queue_.pop_front();
+      }
+    }
+
+    unsigned prepared(0);
+    for (const auto& request : batch) {
+      unsigned count(Prepare(*request));
+      if (count == 0) {
+        Finish(*request, false);
+      } else {
+        prepared += count;
+        active.insert(std::make_pair(request.get(), request));
+      }
+    }
+    in_flight_ += prepared;
+
+    // Submit everything prepared and block for at least one completion.  Requests queued
+    // meanwhile are picked up as the next batch.
+    int result(io_uring_submit_and_wait(ring_.get(), in_flight_ != 0 ? 1 : 0));
+    if (result < 0 && result != -EINTR)
+      LOG(kError) << "io_uring submission failed: " << std::strerror(-result);
+    if (prepared != 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++submission_count_;
+    }
+
+    io_uring_cqe* cqe(nullptr);
+    while (io_uring_peek_cqe(ring_.get(), &cqe) == 0) {
+      uintptr_t user_data(reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe)));
+      int cqe_result(cqe->res);
+      io_uring_cqe_seen(ring_.get(), cqe);
+      --in_flight_;
+      Request* request(reinterpret_cast<Request*>(user_data & ~kFsyncTag));
+      if (user_data & kFsyncTag) {
+        if (cqe_result < 0 && !(cqe_result == -ECANCELED && request->synced))
+          request->failed = true;
+      } else {
+        Complete(*request, cqe_result);
+      }
+      if (--request->outstanding == 0) {
+        auto itr(active.find(request));
+        Finish(*request, !request->failed);
+        active.erase(itr);
+      }
+    }
+  }
+}
+
+unsigned UringStore::Prepare(Request& request) {
+  fs::path path(ChunkPath(request.name));
+  if (request.kind == Request::Kind::kWrite) {
+    request.fd = open(path.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (request.fd < 0 && errno == ENOENT) {
+      boost::system::error_code ec;
+      fs::create_directories(path.parent_path(), ec);
+      request.fd = open(path.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    }
+    if (request.fd < 0) {
+      LOG(kError) << "Failed to open " << path << ": " << std::strerror(errno);
+      return 0;
+    }
+    io_uring_sqe* write_sqe(io_uring_get_sqe(ring_.get()));
+    io_uring_prep_write(write_sqe, request.fd, request.content->data(),
+                        static_cast<unsigned>(request.content->size()), 0);
+    io_uring_sqe_set_data(write_sqe, &request);
+    io_uring_sqe_set_flags(write_sqe, IOSQE_IO_LINK);
+    io_uring_sqe* fsync_sqe(io_uring_get_sqe(ring_.get()));
+    io_uring_prep_fsync(fsync_sqe, request.fd, IORING_FSYNC_DATASYNC);
+    uintptr_t fsync_data(reinterpret_cast<uintptr_t>(&request) | kFsyncTag);
+    io_uring_sqe_set_data(fsync_sqe, reinterpret_cast<void*>(fsync_data));
+    request.outstanding = 2;
+    return 2;
+  }
+
+  request.fd = open(path.string().c_str(), O_RDONLY | O_CLOEXEC);
+  if (request.fd < 0) {
+    request.missing = (errno == ENOENT);
+    LOG(kError) << "Failed to open " << path << ": " << std::strerror(errno);
+    return 0;
+  }
+  struct stat file_stat;
+  if (fstat(request.fd, &file_stat) != 0) {
+    LOG(kError) << "Failed to stat " << path << ": " << std::strerror(errno);
+    return 0;
+  }
+  if (file_stat.st_size == 0) {
+    // Left by a crash before the chunk's write reached the disk.
+    LOG(kError) << path << " is empty.";
+    request.missing = true;
+    return 0;
+  }
+  request.buffer.resize(static_cast<size_t>(file_stat.st_size));
+  io_uring_sqe* read_sqe(io_uring_get_sqe(ring_.get()));
+  io_uring_prep_read(read_sqe, request.fd, &request.buffer[0],
+                     static_cast<unsigned>(request.buffer.size()), 0);
+  io_uring_sqe_set_data(read_sqe, &request);
+  request.outstanding = 1;
+  return 1;
+}
+
+void UringStore::Complete(Request& request, int result) {
+  const std::string& target(request.kind == Request::Kind::kWrite ? *request.content
+                                                                  : request.buffer);
+  if (result < 0) {
+    LOG(kError) << "io_uring " << (request.kind == Request::Kind::kWrite ? "write" : "read")
+                << " of " << HexSubstr(request.name->string())
+                << " failed: " << std::strerror(-result);
+    request.failed = true;
+  } else if (static_cast<size_t>(result) < target.size()) {
+    // A short transfer breaks the link to the fsync, so the remainder is completed here.
+    request.synced = request.kind == Request::Kind::kWrite
+                         ? WriteRemainder(request.fd, *request.content, result)
+                         : ReadRemainder(request.fd, request.buffer, result);
+    request.failed = !request.synced;
+  }
+}
+
+void UringStore::Finish(Request& request, bool succeeded) {
+  if (request.fd >= 0)
+    close(request.fd);
+  request.fd = -1;
+
+  std::unique_ptr<ImmutableData> data;
+  if (request.kind == Request::Kind::kRead && succeeded) {
+    data.reset(new ImmutableData(NonEmptyString(std::move(request.buffer))));
+    if (data->name() != request.name) {
+      LOG(kError) << HexSubstr(request.name->string()) << " is corrupt in io_uring store.";
+      succeeded = false;
+      request.missing = true;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++operation_count_;
+    if (request.kind == Request::Kind::kWrite) {
+      if (succeeded) {
+        pending_writes_.erase(request.name);
+        stored_.insert(request.name);
+        dirty_dirs_.insert(HexEncode(request.name->string()).substr(0, 2));
+        retry_delay_ = std::chrono::steady_clock::duration::zero();
+      } else {
+        boost::system::error_code ec;
+        fs::remove(ChunkPath(request.name), ec);
+        if (stopping_) {
+          LOG(kError) << "Abandoning write of " << HexSubstr(request.name->string())
+                      << " to io_uring store.";
+          pending_writes_.erase(request.name);
+        } else {
+          ScheduleRetry(request);
+        }
+      }
+    } else if (request.missing) {
+      stored_.erase(request.name);
+    }
+  }
+  condition_.notify_all();
+
+  // Completed once the index is up to date, so that the caller's next Get agrees with this one.
+  if (request.kind == Request::Kind::kRead) {
+    if (succeeded) {
+      request.promise.set_value(std::move(*data));
+    } else {
+      request.promise.set_exception(boost::copy_exception(MakeError(
+          request.missing ? CommonErrors::no_such_element
+                          : CommonErrors::unable_to_handle_request)));
+    }
+  }
+}
+
+void UringStore::ScheduleRetry(const Request& request) {
+  auto retry(std::make_shared<Request>(Request::Kind::kWrite, request.name));
+  retry->content = request.content;
+  // Writes failing together back off together, so the delay grows once per round of retries.
+  if (retries_.empty()) {
+    retry_delay_ = std::min(std::max(retry_delay_ * 2, kMinRetryDelay), kMaxRetryDelay);
+    retry_time_ = std::chrono::steady_clock::now() + retry_delay_;
+  }
+  retries_.push_back(retry);
+  LOG(kWarning) << "Retrying write of " << HexSubstr(request.name->string()) << " in "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(retry_delay_).count()
+                << " ms.";
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DRIVE_LIBURING
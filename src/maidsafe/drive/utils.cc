@@ -27,6 +27,8 @@
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/profiler.h"
 
+#include "maidsafe/drive/tracer.h"
+
 namespace maidsafe {
 
 namespace drive {
@@ -74,6 +76,7 @@ bool ExcludedFilename(const boost::filesystem::path& path) {
 
 bool MatchesMask(std::wstring mask, const boost::filesystem::path& file_name) {
   SCOPED_PROFILE
+  DRIVE_TRACE_SCOPE("drive", "MatchesMask");
   bool result(true);
   auto mask_ptr(mask.c_str());
   auto name_ptr(file_name.wstring().c_str());
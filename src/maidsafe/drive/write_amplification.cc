@@ -0,0 +1,182 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/write_amplification.h"
+
+#include <iomanip>
+#include <sstream>
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+double Ratio(uint64_t numerator, uint64_t denominator) {
+  return denominator == 0 ? 0.0 : static_cast<double>(numerator) / denominator;
+}
+
+}  // unnamed namespace
+
+WriteAmplification::Counters::Counters()
+    : application_bytes(0),
+      data_bytes_put(0),
+      data_chunks_put(0),
+      listing_bytes_put(0),
+      listing_chunks_put(0),
+      version_operations(0),
+      refcount_operations(0),
+      refcount_increments(0) {}
+
+double WriteAmplification::Counters::DataRatio() const {
+  return Ratio(data_bytes_put, application_bytes);
+}
+
+double WriteAmplification::Counters::ListingRatio() const {
+  return Ratio(listing_bytes_put, application_bytes);
+}
+
+double WriteAmplification::Counters::TotalRatio() const {
+  return Ratio(StorageBytes(), application_bytes);
+}
+
+WriteAmplification::WriteAmplification(WriteAmplification* total)
+    : total_(total),
+      application_bytes_(0),
+      data_bytes_put_(0),
+      data_chunks_put_(0),
+      listing_bytes_put_(0),
+      listing_chunks_put_(0),
+      version_operations_(0),
+      refcount_operations_(0),
+      refcount_increments_(0) {}
+
+void WriteAmplification::RecordApplicationWrite(uint64_t bytes) {
+  application_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  if (total_)
+    total_->RecordApplicationWrite(bytes);
+}
+
+void WriteAmplification::RecordDataPut(uint64_t bytes) {
+  data_bytes_put_.fetch_add(bytes, std::memory_order_relaxed);
+  data_chunks_put_.fetch_add(1, std::memory_order_relaxed);
+  if (total_)
+    total_->RecordDataPut(bytes);
+}
+
+void WriteAmplification::RecordListingPut(uint64_t bytes) {
+  listing_bytes_put_.fetch_add(bytes, std::memory_order_relaxed);
+  listing_chunks_put_.fetch_add(1, std::memory_order_relaxed);
+  if (total_)
+    total_->RecordListingPut(bytes);
+}
+
+void WriteAmplification::RecordVersionOperation() {
+  version_operations_.fetch_add(1, std::memory_order_relaxed);
+  if (total_)
+    total_->RecordVersionOperation();
+}
+
+void WriteAmplification::RecordReferenceCountIncrement(uint64_t chunk_count) {
+  refcount_operations_.fetch_add(1, std::memory_order_relaxed);
+  refcount_increments_.fetch_add(chunk_count, std::memory_order_relaxed);
+  if (total_)
+    total_->RecordReferenceCountIncrement(chunk_count);
+}
+
+WriteAmplification::Counters WriteAmplification::Get() const {
+  Counters counters;
+  counters.application_bytes = application_bytes_.load(std::memory_order_relaxed);
+  counters.data_bytes_put = data_bytes_put_.load(std::memory_order_relaxed);
+  counters.data_chunks_put = data_chunks_put_.load(std::memory_order_relaxed);
+  counters.listing_bytes_put = listing_bytes_put_.load(std::memory_order_relaxed);
+  counters.listing_chunks_put = listing_chunks_put_.load(std::memory_order_relaxed);
+  counters.version_operations = version_operations_.load(std::memory_order_relaxed);
+  counters.refcount_operations = refcount_operations_.load(std::memory_order_relaxed);
+  counters.refcount_increments = refcount_increments_.load(std::memory_order_relaxed);
+  return counters;
+}
+
+void WriteAmplification::Reset() {
+  application_bytes_ = 0;
+  data_bytes_put_ = 0;
+  data_chunks_put_ = 0;
+  listing_bytes_put_ = 0;
+  listing_chunks_put_ = 0;
+  version_operations_ = 0;
+  refcount_operations_ = 0;
+  refcount_increments_ = 0;
+}
+
+std::vector<Statistic> ToStatistics(const WriteAmplification::Counters& counters) {
+  typedef Statistic::Type Type;
+  const std::string kRatioHelp("Bytes put to storage per byte of file content written.");
+  std::vector<Statistic> statistics;
+  statistics.emplace_back("write_amplification_ratio{kind=\"data\"}", kRatioHelp,
+                          counters.DataRatio());
+  statistics.emplace_back("write_amplification_ratio{kind=\"listing\"}", kRatioHelp,
+                          counters.ListingRatio());
+  statistics.emplace_back("write_amplification_ratio{kind=\"total\"}", kRatioHelp,
+                          counters.TotalRatio());
+  statistics.emplace_back("write_amplification_application_bytes_total",
+                          "File content written by applications.",
+                          static_cast<double>(counters.application_bytes), Type::kCounter);
+  statistics.emplace_back("write_amplification_data_bytes_total",
+                          "File data chunk bytes put to storage.",
+                          static_cast<double>(counters.data_bytes_put), Type::kCounter);
+  statistics.emplace_back("write_amplification_listing_bytes_total",
+                          "Directory listing chunk and data map bytes put to storage.",
+                          static_cast<double>(counters.listing_bytes_put), Type::kCounter);
+  statistics.emplace_back("write_amplification_version_operations_total",
+                          "Directory versions created or put.",
+                          static_cast<double>(counters.version_operations), Type::kCounter);
+  statistics.emplace_back("write_amplification_refcount_operations_total",
+                          "Reference count increment calls made while storing directories.",
+                          static_cast<double>(counters.refcount_operations), Type::kCounter);
+  statistics.emplace_back("write_amplification_refcount_chunks_total",
+                          "Chunks whose reference counts were incremented.",
+                          static_cast<double>(counters.refcount_increments), Type::kCounter);
+  return statistics;
+}
+
+std::string FormatWriteAmplification(
+    const WriteAmplification::Counters& totals,
+    const std::vector<std::pair<boost::filesystem::path, WriteAmplification::Counters>>& top) {
+  std::ostringstream stream;
+  auto add_row([&stream](const std::string& name, const WriteAmplification::Counters& counters) {
+    stream << std::left << std::setw(32) << name << std::right << std::setw(14)
+           << counters.application_bytes << std::setw(14) << counters.data_bytes_put
+           << std::setw(14) << counters.listing_bytes_put << std::setw(10)
+           << counters.version_operations << std::setw(10) << counters.refcount_operations
+           << std::setw(12) << counters.refcount_increments << std::setw(9) << std::fixed
+           << std::setprecision(2) << counters.TotalRatio() << '\n';
+  });
+  stream << std::left << std::setw(32) << "directory" << std::right << std::setw(14) << "written"
+         << std::setw(14) << "data put" << std::setw(14) << "listing put" << std::setw(10)
+         << "versions" << std::setw(10) << "refcount" << std::setw(12) << "ref chunks"
+         << std::setw(9) << "ratio" << '\n';
+  add_row("(total)", totals);
+  for (const auto& directory : top)
+    add_row(directory.first.empty() ? "(root parent)" : directory.first.generic_string(),
+            directory.second);
+  return stream.str();
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe
@@ -0,0 +1,582 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/drive/write_back_journal.h"
+
+#ifdef MAIDSAFE_WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <utility>
+
+#include "boost/crc.hpp"
+#include "boost/filesystem/operations.hpp"
+#include "boost/lexical_cast.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace drive {
+
+namespace {
+
+// Each record on disk is a 4-byte payload size and a 4-byte CRC-32 of the payload, followed by the
+// payload itself.  All integers are little-endian.
+const size_t kHeaderSize(8);
+// Anything larger than this can only be the result of a torn or corrupt header.
+const uint32_t kMaxPayloadSize(64 * 1024 * 1024);
+// Segment files are named this followed by the offset of their first record.
+const std::string kSegmentPrefix("journal.");
+
+void AppendUint32(uint32_t value, std::string& output) {
+  for (int i(0); i != 4; ++i)
+    output.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+void AppendUint64(uint64_t value, std::string& output) {
+  for (int i(0); i != 8; ++i)
+    output.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+void AppendString(const std::string& value, std::string& output) {
+  AppendUint32(static_cast<uint32_t>(value.size()), output);
+  output += value;
+}
+
+void AppendVersionName(const StructuredDataVersions::VersionName& version_name,
+                       std::string& output) {
+  AppendUint64(version_name.index, output);
+  AppendString(version_name.id->IsInitialised() ? version_name.id->string() : std::string(),
+               output);
+}
+
+uint32_t Checksum(const std::string& payload) {
+  boost::crc_32_type crc;
+  crc.process_bytes(payload.data(), payload.size());
+  return crc.checksum();
+}
+
+class Parser {
+ public:
+  explicit Parser(const std::string& input) : input_(input), position_(0) {}
+
+  uint8_t ReadUint8() {
+    Require(1);
+    return static_cast<uint8_t>(input_[position_++]);
+  }
+
+  uint32_t ReadUint32() {
+    Require(4);
+    uint32_t value(0);
+    for (int i(0); i != 4; ++i)
+      value |= static_cast<uint32_t>(static_cast<uint8_t>(input_[position_++])) << (8 * i);
+    return value;
+  }
+
+  uint64_t ReadUint64() {
+    Require(8);
+    uint64_t value(0);
+    for (int i(0); i != 8; ++i)
+      value |= static_cast<uint64_t>(static_cast<uint8_t>(input_[position_++])) << (8 * i);
+    return value;
+  }
+
+  std::string ReadString() {
+    auto size(ReadUint32());
+    Require(size);
+    std::string value(input_.substr(position_, size));
+    position_ += size;
+    return value;
+  }
+
+  StructuredDataVersions::VersionName ReadVersionName() {
+    auto index(ReadUint64());
+    auto id(ReadString());
+    if (id.empty())
+      return StructuredDataVersions::VersionName();
+    return StructuredDataVersions::VersionName(index, ImmutableData::Name(Identity(id)));
+  }
+
+  bool AtEnd() const { return position_ == input_.size(); }
+
+ private:
+  void Require(size_t size) const {
+    if (input_.size() - position_ < size)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+
+  const std::string& input_;
+  size_t position_;
+};
+
+std::string SerialisePayload(const WriteBackJournal::Record& record) {
+  typedef WriteBackJournal::Record::Type Type;
+  std::string payload(1, static_cast<char>(record.type));
+  switch (record.type) {
+    case Type::kPut:
+      AppendString(record.content, payload);
+      break;
+    case Type::kIncrementReferenceCount:
+      AppendUint32(static_cast<uint32_t>(record.data_names.size()), payload);
+      for (const auto& data_name : record.data_names)
+        AppendString(data_name->string(), payload);
+      break;
+    case Type::kPutVersion:
+      AppendString(record.version_tree_name, payload);
+      AppendVersionName(record.old_version_name, payload);
+      AppendVersionName(record.new_version_name, payload);
+      break;
+    case Type::kCreateVersionTree:
+      AppendString(record.version_tree_name, payload);
+      AppendVersionName(record.new_version_name, payload);
+      AppendUint32(record.max_versions, payload);
+      AppendUint32(record.max_branches, payload);
+      break;
+    default:
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  return payload;
+}
+
+WriteBackJournal::Record ParsePayload(const std::string& payload) {
+  typedef WriteBackJournal::Record::Type Type;
+  Parser parser(payload);
+  WriteBackJournal::Record record;
+  record.type = static_cast<Type>(parser.ReadUint8());
+  switch (record.type) {
+    case Type::kPut:
+      record.content = parser.ReadString();
+      break;
+    case Type::kIncrementReferenceCount: {
+      auto count(parser.ReadUint32());
+      for (uint32_t i(0); i != count; ++i)
+        record.data_names.emplace_back(Identity(parser.ReadString()));
+      break;
+    }
+    case Type::kPutVersion:
+      record.version_tree_name = parser.ReadString();
+      record.old_version_name = parser.ReadVersionName();
+      record.new_version_name = parser.ReadVersionName();
+      break;
+    case Type::kCreateVersionTree:
+      record.version_tree_name = parser.ReadString();
+      record.new_version_name = parser.ReadVersionName();
+      record.max_versions = parser.ReadUint32();
+      record.max_branches = parser.ReadUint32();
+      break;
+    default:
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  if (!parser.AtEnd())
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  return record;
+}
+
+std::FILE* OpenFile(const fs::path& path, bool truncate = false) {
+#ifdef MAIDSAFE_WIN32
+  return _wfopen(path.c_str(), truncate ? L"wb" : L"ab");
+#else
+  return std::fopen(path.c_str(), truncate ? "wb" : "ab");
+#endif
+}
+
+bool SyncFile(std::FILE* file) {
+  if (std::fflush(file) != 0)
+    return false;
+#ifdef MAIDSAFE_WIN32
+  return _commit(_fileno(file)) == 0;
+#else
+  return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Makes the creation, removal or renaming of entries in 'directory' durable.  NTFS journals its
+// metadata, so there's nothing to do on Windows.
+bool SyncDirectory(const fs::path& directory) {
+#ifdef MAIDSAFE_WIN32
+  static_cast<void>(directory);
+  return true;
+#else
+  int descriptor(open(directory.c_str(), O_RDONLY));
+  if (descriptor == -1)
+    return false;
+  bool result(fsync(descriptor) == 0);
+  close(descriptor);
+  return result;
+#endif
+}
+
+bool WriteAndSyncFile(const fs::path& path, const std::string& content) {
+  std::FILE* file(OpenFile(path, true));
+  if (!file)
+    return false;
+  bool result(std::fwrite(content.data(), 1, content.size(), file) == content.size() &&
+              SyncFile(file));
+  return std::fclose(file) == 0 && result;
+}
+
+}  // unnamed namespace
+
+WriteBackJournal::Record::Record()
+    : type(Type::kPut),
+      content(),
+      chunk_name(),
+      data_names(),
+      version_tree_name(),
+      old_version_name(),
+      new_version_name(),
+      max_versions(0),
+      max_branches(0),
+      offset(0),
+      size_on_disk(0) {}
+
+WriteBackJournal::Record WriteBackJournal::Record::Put(const ImmutableData& data) {
+  Record record;
+  record.type = Type::kPut;
+  record.content = data.data().string();
+  record.chunk_name = data.name();
+  return record;
+}
+
+WriteBackJournal::Record WriteBackJournal::Record::IncrementReferenceCount(
+    const std::vector<ImmutableData::Name>& data_names) {
+  Record record;
+  record.type = Type::kIncrementReferenceCount;
+  record.data_names = data_names;
+  return record;
+}
+
+WriteBackJournal::Record WriteBackJournal::Record::PutVersion(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& old_version_name,
+    const StructuredDataVersions::VersionName& new_version_name) {
+  Record record;
+  record.type = Type::kPutVersion;
+  record.version_tree_name = data_name->string();
+  record.old_version_name = old_version_name;
+  record.new_version_name = new_version_name;
+  return record;
+}
+
+WriteBackJournal::Record WriteBackJournal::Record::CreateVersionTree(
+    const MutableData::Name& data_name, const StructuredDataVersions::VersionName& version_name,
+    uint32_t max_versions, uint32_t max_branches) {
+  Record record;
+  record.type = Type::kCreateVersionTree;
+  record.version_tree_name = data_name->string();
+  record.new_version_name = version_name;
+  record.max_versions = max_versions;
+  record.max_branches = max_branches;
+  return record;
+}
+
+const uint64_t WriteBackJournal::kDefaultMaxSegmentSize;
+
+WriteBackJournal::WriteBackJournal(const fs::path& journal_dir, uint64_t max_segment_size)
+    : kJournalDir_(journal_dir),
+      kCommittedOffsetPath_(journal_dir / "committed"),
+      kMaxSegmentSize_(max_segment_size),
+      mutex_(),
+      log_(nullptr),
+      segment_starts_(),
+      committed_offset_(0),
+      end_offset_(0),
+      recovered_records_() {
+  boost::system::error_code error_code;
+  if (!fs::exists(journal_dir, error_code) && !fs::create_directories(journal_dir, error_code)) {
+    LOG(kError) << "Failed to create write-back journal at " << journal_dir << ": "
+                << error_code.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  Recover();
+  if (segment_starts_.empty())
+    StartNewSegment();
+  else
+    OpenLogForAppending();
+  if (!recovered_records_.empty()) {
+    LOG(kInfo) << "Recovered " << recovered_records_.size() << " uncommitted records ("
+               << end_offset_ - committed_offset_ << " bytes) from " << kJournalDir_;
+  }
+}
+
+WriteBackJournal::~WriteBackJournal() {
+  if (log_)
+    std::fclose(log_);
+}
+
+fs::path WriteBackJournal::SegmentPath(uint64_t segment_start) const {
+  return kJournalDir_ / (kSegmentPrefix + std::to_string(segment_start));
+}
+
+void WriteBackJournal::Recover() {
+  std::string committed_offset;
+  bool has_committed_offset(ReadFile(kCommittedOffsetPath_, &committed_offset) &&
+                            committed_offset.size() == 8U);
+  if (has_committed_offset)
+    committed_offset_ = Parser(committed_offset).ReadUint64();
+
+  boost::system::error_code error_code;
+  std::vector<uint64_t> segment_starts;
+  for (fs::directory_iterator itr(kJournalDir_, error_code), end;
+       !error_code && itr != end; itr.increment(error_code)) {
+    auto filename(itr->path().filename().string());
+    if (filename.compare(0, kSegmentPrefix.size(), kSegmentPrefix) != 0)
+      continue;
+    try {
+      segment_starts.push_back(
+          boost::lexical_cast<uint64_t>(filename.substr(kSegmentPrefix.size())));
+    }
+    catch (const boost::bad_lexical_cast&) {
+      LOG(kWarning) << "Ignoring " << itr->path() << " in write-back journal.";
+    }
+  }
+  std::sort(std::begin(segment_starts), std::end(segment_starts));
+  segment_starts_.assign(std::begin(segment_starts), std::end(segment_starts));
+  if (segment_starts_.empty()) {
+    end_offset_ = committed_offset_;
+    return;
+  }
+  if (!has_committed_offset || committed_offset_ < segment_starts_.front()) {
+    if (has_committed_offset)
+      LOG(kWarning) << "Write-back journal segments before " << segment_starts_.front() << " lost.";
+    committed_offset_ = segment_starts_.front();
+  }
+  // A crash can come between persisting the committed offset and removing the segments it covers.
+  RemoveCommittedSegments();
+
+  for (size_t i(0); i != segment_starts_.size(); ++i) {
+    bool intact(RecoverSegment(segment_starts_[i]));
+    if (i + 1 != segment_starts_.size() && (!intact || end_offset_ != segment_starts_[i + 1])) {
+      LOG(kError) << SegmentPath(segment_starts_[i]) << " is incomplete; discarding the "
+                  << segment_starts_.size() - i - 1 << " segments after it.";
+      for (size_t j(i + 1); j != segment_starts_.size(); ++j)
+        fs::remove(SegmentPath(segment_starts_[j]), error_code);
+      segment_starts_.resize(i + 1);
+      break;
+    }
+  }
+  committed_offset_ = std::min(committed_offset_, end_offset_);
+}
+
+bool WriteBackJournal::RecoverSegment(uint64_t segment_start) {
+  auto path(SegmentPath(segment_start));
+  boost::system::error_code error_code;
+  uint64_t size(fs::file_size(path, error_code));
+  if (error_code)
+    size = 0;
+  uint64_t position(committed_offset_ > segment_start ? committed_offset_ - segment_start : 0);
+  end_offset_ = segment_start + size;
+  if (position >= size)
+    return true;
+
+  std::ifstream log(path.string().c_str(), std::ios::binary);
+  log.seekg(static_cast<std::streamoff>(position));
+  std::string header(kHeaderSize, 0);
+  while (log.read(&header[0], kHeaderSize)) {
+    Parser header_parser(header);
+    auto payload_size(header_parser.ReadUint32());
+    auto checksum(header_parser.ReadUint32());
+    if (payload_size > kMaxPayloadSize)
+      break;
+    std::string payload(payload_size, 0);
+    if (!log.read(&payload[0], payload_size) || Checksum(payload) != checksum)
+      break;
+    Record record;
+    try {
+      record = ParsePayload(payload);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to parse write-back journal record: " << e.what();
+      break;
+    }
+    if (record.type == Record::Type::kPut) {
+      // Chunks are read back from the log when needed rather than all being held in memory.
+      record.chunk_name = ImmutableData(NonEmptyString(record.content)).name();
+      std::string().swap(record.content);
+    }
+    record.offset = segment_start + position;
+    record.size_on_disk = kHeaderSize + payload_size;
+    recovered_records_.push_back(std::move(record));
+    position += kHeaderSize + payload_size;
+  }
+  log.close();
+
+  end_offset_ = segment_start + position;
+  if (position == size)
+    return true;
+  LOG(kWarning) << "Discarding " << size - position << " bytes of torn or corrupt records from the "
+                << "end of " << path;
+  fs::resize_file(path, position, error_code);
+  return false;
+}
+
+void WriteBackJournal::OpenLogForAppending() {
+  auto path(SegmentPath(segment_starts_.back()));
+  log_ = OpenFile(path);
+  if (!log_) {
+    LOG(kError) << "Failed to open " << path;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+}
+
+void WriteBackJournal::StartNewSegment() {
+  if (log_) {
+    std::fclose(log_);
+    log_ = nullptr;
+  }
+  segment_starts_.push_back(end_offset_);
+  OpenLogForAppending();
+  if (!SyncDirectory(kJournalDir_))
+    LOG(kWarning) << "Failed to sync " << kJournalDir_;
+}
+
+// The newest segment is kept even once it's fully committed, since it's the one appended to.
+void WriteBackJournal::RemoveCommittedSegments() {
+  while (segment_starts_.size() > 1U && segment_starts_[1] <= committed_offset_) {
+    boost::system::error_code error_code;
+    fs::remove(SegmentPath(segment_starts_.front()), error_code);
+    if (error_code) {
+      LOG(kWarning) << "Failed to remove " << SegmentPath(segment_starts_.front()) << ": "
+                    << error_code.message();
+    }
+    segment_starts_.pop_front();
+  }
+}
+
+// Replaying an already applied IncrementReferenceCount would count its references twice, so the
+// offset must never be lost once 'CommitOldest' returns:  the new file is synced before it replaces
+// the old one, and the rename is synced too.
+void WriteBackJournal::WriteCommittedOffset() {
+  std::string committed_offset;
+  AppendUint64(committed_offset_, committed_offset);
+  fs::path temp_path(kCommittedOffsetPath_);
+  temp_path += ".tmp";
+  if (!WriteAndSyncFile(temp_path, committed_offset)) {
+    LOG(kError) << "Failed to write " << temp_path;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  boost::system::error_code error_code;
+  fs::rename(temp_path, kCommittedOffsetPath_, error_code);
+  if (error_code || !SyncDirectory(kJournalDir_)) {
+    LOG(kError) << "Failed to write " << kCommittedOffsetPath_ << ": " << error_code.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+}
+
+std::deque<WriteBackJournal::Record> WriteBackJournal::TakeRecoveredRecords() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::deque<Record> records;
+  records.swap(recovered_records_);
+  return records;
+}
+
+void WriteBackJournal::Append(Record& record) {
+  auto payload(SerialisePayload(record));
+  if (payload.size() > kMaxPayloadSize)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  std::string frame;
+  frame.reserve(kHeaderSize + payload.size());
+  AppendUint32(static_cast<uint32_t>(payload.size()), frame);
+  AppendUint32(Checksum(payload), frame);
+  frame += payload;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (end_offset_ - segment_starts_.back() >= kMaxSegmentSize_) {
+    StartNewSegment();
+    RemoveCommittedSegments();
+  }
+  if (std::fwrite(frame.data(), 1, frame.size(), log_) != frame.size() || !SyncFile(log_)) {
+    auto path(SegmentPath(segment_starts_.back()));
+    LOG(kError) << "Failed to append to " << path;
+    // Drop whatever part of the record made it to disk, so later records aren't appended after it.
+    std::fclose(log_);
+    log_ = nullptr;
+    boost::system::error_code error_code;
+    fs::resize_file(path, end_offset_ - segment_starts_.back(), error_code);
+    OpenLogForAppending();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  record.offset = end_offset_;
+  record.size_on_disk = frame.size();
+  end_offset_ += frame.size();
+}
+
+void WriteBackJournal::CommitOldest(const Record& record) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(committed_offset_ + record.size_on_disk <= end_offset_);
+  committed_offset_ += record.size_on_disk;
+  // Persist the offset before removing the segments it covers; see 'Recover'.
+  WriteCommittedOffset();
+  RemoveCommittedSegments();
+}
+
+std::string WriteBackJournal::ReadContent(const Record& record) const {
+  fs::path path;
+  uint64_t position(0);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (record.type != Record::Type::kPut || record.offset < committed_offset_ ||
+        record.offset + record.size_on_disk > end_offset_) {
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+    }
+    auto itr(std::upper_bound(std::begin(segment_starts_), std::end(segment_starts_),
+                              record.offset));
+    assert(itr != std::begin(segment_starts_));
+    --itr;
+    path = SegmentPath(*itr);
+    position = record.offset - *itr;
+  }
+  // The segment is only read outside 'mutex_', so it may have been removed since; the read,
+  // checksum and name checks below catch that.
+  std::ifstream log(path.string().c_str(), std::ios::binary);
+  log.seekg(static_cast<std::streamoff>(position));
+  std::string frame(static_cast<size_t>(record.size_on_disk), 0);
+  if (record.size_on_disk < kHeaderSize || !log.read(&frame[0], frame.size()))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  Parser header_parser(frame);
+  auto payload_size(header_parser.ReadUint32());
+  auto checksum(header_parser.ReadUint32());
+  std::string payload(frame.substr(kHeaderSize));
+  if (payload_size != payload.size() || Checksum(payload) != checksum)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  auto parsed(ParsePayload(payload));
+  if (parsed.type != Record::Type::kPut ||
+      ImmutableData(NonEmptyString(parsed.content)).name() != record.chunk_name) {
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  }
+  return std::move(parsed.content);
+}
+
+uint64_t WriteBackJournal::uncommitted_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return end_offset_ - committed_offset_;
+}
+
+}  // namespace drive
+
+}  // namespace maidsafe